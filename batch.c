@@ -0,0 +1,494 @@
+/**
+ * batch.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the three-stage batch processor. Each queue is a ring buffer protected by
+ * a mutex with two condition variables (not empty, not full). A queue is closed when
+ * all the threads of the stage that feeds it have finished, which lets the next stage
+ * drain it and stop. Every thread measures the time it spends working and waiting.
+ *
+ * Role in the project:
+ * Applies one chain of operations to many files while keeping both the CPU and the disk busy.
+ */
+
+
+#include <pthread.h>
+#include <time.h>
+#include "batch.h"
+#include "parallel.h"
+#include "probe.h"
+
+#define BATCH_DEFAULT_IO_THREADS 2
+#define BATCH_DEFAULT_DEPTH 3
+#define BATCH_MAX_THREADS 64
+
+
+/**
+ * t_batch_item
+ * One image in flight. Exactly one of img8 and img24 is set.
+ */
+typedef struct {
+    int index;
+    t_bmp8 *img8;
+    t_bmp24 *img24;
+} t_batch_item;
+
+/**
+ * t_batch_queue
+ * Bounded queue of images between two stages.
+ */
+typedef struct {
+    t_batch_item *items;
+    int capacity;
+    int head;
+    int count;
+    int producers;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+} t_batch_queue;
+
+/**
+ * t_batch_job
+ * Shared state of a batch run.
+ */
+typedef struct {
+    char **inputs;
+    int count;
+    int next;
+    const char *outputDir;
+    const t_pipeline *pipeline;
+    t_batch_queue loaded;
+    t_batch_queue processed;
+    pthread_mutex_t lock;
+    t_batch_report report;
+} t_batch_job;
+
+/**
+ * t_batch_timer
+ * Time accounting of one thread.
+ */
+typedef struct {
+    long items;
+    double busy;
+    double waitIn;
+    double waitOut;
+} t_batch_timer;
+
+
+/**
+ * batch_now
+ * Monotonic time in seconds.
+ */
+static double batch_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/**
+ * queue_init / queue_destroy
+ * Creates or releases a queue fed by the given number of producer threads.
+ */
+static int queue_init(t_batch_queue *queue, int capacity, int producers) {
+    queue->items = malloc(capacity * sizeof(t_batch_item));
+    if (!queue->items) return 0;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->producers = producers;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->notEmpty, NULL);
+    pthread_cond_init(&queue->notFull, NULL);
+    return 1;
+}
+
+static void queue_destroy(t_batch_queue *queue) {
+    free(queue->items);
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->notEmpty);
+    pthread_cond_destroy(&queue->notFull);
+}
+
+
+/**
+ * queue_push
+ * Adds an item, waiting while the queue is full. Returns the time spent waiting.
+ */
+static double queue_push(t_batch_queue *queue, t_batch_item item) {
+    double start = batch_now();
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->capacity) {
+        pthread_cond_wait(&queue->notFull, &queue->lock);
+    }
+    double waited = batch_now() - start;
+
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+    return waited;
+}
+
+
+/**
+ * queue_pop
+ * Takes the oldest item, waiting while the queue is empty but still open.
+ * Returns 0 once the queue is empty and closed. Adds the waiting time to *waited.
+ */
+static int queue_pop(t_batch_queue *queue, t_batch_item *item, double *waited) {
+    double start = batch_now();
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && queue->producers > 0) {
+        pthread_cond_wait(&queue->notEmpty, &queue->lock);
+    }
+    *waited += batch_now() - start;
+
+    if (queue->count == 0) {
+        pthread_mutex_unlock(&queue->lock);
+        return 0;
+    }
+    *item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->notFull);
+    pthread_mutex_unlock(&queue->lock);
+    return 1;
+}
+
+
+/**
+ * queue_close
+ * Called by each producer thread when it has finished.
+ */
+static void queue_close(t_batch_queue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->producers--;
+    pthread_cond_broadcast(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+
+/**
+ * batch_addTimes
+ * Adds the time accounting of a finished thread to its stage.
+ */
+static void batch_addTimes(t_batch_job *job, t_batch_stage *stage, const t_batch_timer *timer) {
+    pthread_mutex_lock(&job->lock);
+    stage->items += timer->items;
+    stage->busy += timer->busy;
+    stage->waitIn += timer->waitIn;
+    stage->waitOut += timer->waitOut;
+    pthread_mutex_unlock(&job->lock);
+}
+
+
+/**
+ * batch_free
+ * Frees the image held by an item.
+ */
+static void batch_free(t_batch_item *item) {
+    bmp8_free(item->img8);
+    bmp24_free(item->img24);
+}
+
+
+/**
+ * batch_reader
+ * Claims the next input file, loads it and hands it to the workers.
+ */
+static void *batch_reader(void *arg) {
+    t_batch_job *job = arg;
+    t_batch_timer timer = {0, 0.0, 0.0, 0.0};
+
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        int index = job->next < job->count ? job->next++ : -1;
+        pthread_mutex_unlock(&job->lock);
+        if (index < 0) break;
+
+        double start = batch_now();
+        t_batch_item item = {index, NULL, NULL};
+        t_bmp_probe probe;
+        if (probe_file(job->inputs[index], &probe)) {
+            if (probe.depth <= 8) {
+                item.img8 = bmp8_loadImage(job->inputs[index]);
+            } else {
+                item.img24 = bmp24_loadImage(job->inputs[index]);
+            }
+        } else {
+            fprintf(stderr, "Error: %s: %s.\n", job->inputs[index], probe.error);
+        }
+        timer.busy += batch_now() - start;
+
+        if (!item.img8 && !item.img24) continue;
+        timer.items++;
+        timer.waitOut += queue_push(&job->loaded, item);
+    }
+
+    queue_close(&job->loaded);
+    batch_addTimes(job, &job->report.read, &timer);
+    return NULL;
+}
+
+
+/**
+ * batch_worker
+ * Runs the operation chain on loaded images.
+ */
+static void *batch_worker(void *arg) {
+    t_batch_job *job = arg;
+    t_batch_timer timer = {0, 0.0, 0.0, 0.0};
+    t_batch_item item;
+
+    while (queue_pop(&job->loaded, &item, &timer.waitIn)) {
+        double start = batch_now();
+        int ok = (item.img8 ? pipeline_apply8(job->pipeline, item.img8)
+                            : pipeline_apply24(job->pipeline, item.img24)) == 0;
+        timer.busy += batch_now() - start;
+        timer.items++;
+        if (!ok) {
+            // The image is dropped and counted as failed
+            fprintf(stderr, "Error: %s: processing failed.\n", job->inputs[item.index]);
+            batch_free(&item);
+            continue;
+        }
+        timer.waitOut += queue_push(&job->processed, item);
+    }
+
+    queue_close(&job->processed);
+    batch_addTimes(job, &job->report.process, &timer);
+    return NULL;
+}
+
+
+/**
+ * batch_baseName
+ * File name of a path, without its directories.
+ */
+static const char *batch_baseName(const char *path) {
+    const char *name = strrchr(path, '/');
+    return name ? name + 1 : path;
+}
+
+
+/**
+ * batch_writer
+ * Saves processed images under their original file name in the output directory.
+ * Only the images actually written count as processed.
+ */
+static void *batch_writer(void *arg) {
+    t_batch_job *job = arg;
+    t_batch_timer timer = {0, 0.0, 0.0, 0.0};
+    t_batch_item item;
+    char path[4096];
+    long saved = 0;
+
+    while (queue_pop(&job->processed, &item, &timer.waitIn)) {
+        double start = batch_now();
+        const char *input = job->inputs[item.index];
+        int length = snprintf(path, sizeof(path), "%s/%s", job->outputDir, batch_baseName(input));
+
+        int ok = length >= 0 && (size_t)length < sizeof(path);
+        if (!ok) {
+            fprintf(stderr, "Error: %s: output path too long.\n", input);
+        } else if (item.img8) {
+            ok = bmp8_saveImage(path, item.img8) == 0;
+        } else {
+            ok = bmp24_saveImage(item.img24, path) == 0;
+        }
+        if (ok) saved++;
+        batch_free(&item);
+        timer.busy += batch_now() - start;
+        timer.items++;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    job->report.processed += saved;
+    pthread_mutex_unlock(&job->lock);
+    batch_addTimes(job, &job->report.write, &timer);
+    return NULL;
+}
+
+
+/**
+ * batch_compareNames
+ * Orders input paths by file name, for batch_checkNames.
+ */
+static int batch_compareNames(const void *a, const void *b) {
+    return strcmp(batch_baseName(*(char *const *)a), batch_baseName(*(char *const *)b));
+}
+
+
+/**
+ * batch_checkNames
+ * Checks that no two inputs would be saved to the same output file: results keep only
+ * the file name of their input, so d1/x.bmp and d2/x.bmp would overwrite each other.
+ *
+ * Returns:
+ * int: 1 if every output name is unique, 0 otherwise (each clash is reported).
+ */
+static int batch_checkNames(char **inputs, int count, const char *outputDir) {
+    char **sorted = malloc(count * sizeof(char *));
+    if (!sorted) {
+        fprintf(stderr, "Error: Unable to allocate memory for the file list.\n");
+        return 0;
+    }
+    memcpy(sorted, inputs, count * sizeof(char *));
+    qsort(sorted, count, sizeof(char *), batch_compareNames);
+
+    int unique = 1;
+    for (int i = 1; i < count; i++) {
+        if (batch_compareNames(&sorted[i - 1], &sorted[i]) == 0) {
+            fprintf(stderr, "Error: %s and %s would both be saved as %s/%s.\n",
+                    sorted[i - 1], sorted[i], outputDir, batch_baseName(sorted[i]));
+            unique = 0;
+        }
+    }
+    free(sorted);
+    return unique;
+}
+
+
+/**
+ * batch_clampThreads
+ * Applies the default and the upper bound to a thread count.
+ */
+static int batch_clampThreads(int requested, int fallback) {
+    int threads = requested > 0 ? requested : fallback;
+    return threads > BATCH_MAX_THREADS ? BATCH_MAX_THREADS : threads;
+}
+
+
+/**
+ * batch_run
+ * Loads every input file (8-bit or 24/32-bit, detected from the header), applies the
+ * operations of the pipeline and saves the result under the same name in outputDir.
+ * The pipeline is optimized once and shared read-only by the worker threads. Nothing is
+ * processed if two inputs have the same file name.
+ *
+ * Parameters:
+ * inputs (char**): Paths of the input files.
+ * count (int): Number of input files.
+ * outputDir (const char*): Directory receiving the results.
+ * pipeline (t_pipeline*): Operations to apply (may be empty).
+ * config (const t_batch_config*): Thread counts and queue depth, or NULL for defaults.
+ * report (t_batch_report*): Receives the statistics of the run, or NULL.
+ *
+ * Returns:
+ * int: 1 if every image was processed, 0 otherwise.
+ */
+int batch_run(char **inputs, int count, const char *outputDir, t_pipeline *pipeline,
+              const t_batch_config *config, t_batch_report *report) {
+    t_batch_config defaults = {0, 0, 0, 0};
+    if (!config) config = &defaults;
+
+    int readers = batch_clampThreads(config->readers, BATCH_DEFAULT_IO_THREADS);
+    int workers = batch_clampThreads(config->workers, parallel_threadCount());
+    int writers = batch_clampThreads(config->writers, BATCH_DEFAULT_IO_THREADS);
+    int depth = config->queueDepth > 0 ? config->queueDepth : BATCH_DEFAULT_DEPTH;
+
+    t_batch_job job;
+    memset(&job, 0, sizeof(job));
+    job.inputs = inputs;
+    job.count = count;
+    job.outputDir = outputDir;
+    job.pipeline = pipeline;
+    job.report.read.threads = readers;
+    job.report.process.threads = workers;
+    job.report.write.threads = writers;
+
+    if (!batch_checkNames(inputs, count, outputDir)) {
+        if (report) {
+            job.report.failed = count;
+            *report = job.report;
+        }
+        return 0;
+    }
+
+    if (pipeline) pipeline_optimize(pipeline);
+    if (!queue_init(&job.loaded, depth, readers)) {
+        fprintf(stderr, "Error: Unable to allocate memory for batch queues.\n");
+        return 0;
+    }
+    if (!queue_init(&job.processed, depth, workers)) {
+        fprintf(stderr, "Error: Unable to allocate memory for batch queues.\n");
+        queue_destroy(&job.loaded);
+        return 0;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+
+    // Downstream stages start first, so that no thread ever waits on a stage that failed to start
+    pthread_t threads[3 * BATCH_MAX_THREADS];
+    void *(*stages[3])(void *) = {batch_writer, batch_worker, batch_reader};
+    int counts[3] = {writers, workers, readers};
+    t_batch_queue *feeds[3] = {NULL, &job.processed, &job.loaded};
+    int started = 0;
+    int ok = 1;
+
+    double start = batch_now();
+    for (int s = 0; s < 3; s++) {
+        int created = 0;
+        for (int i = 0; ok && i < counts[s]; i++) {
+            if (pthread_create(&threads[started], NULL, stages[s], &job) == 0) {
+                started++;
+                created++;
+            }
+        }
+        // Threads that could not be created count as finished producers
+        for (int i = created; i < counts[s]; i++) {
+            if (feeds[s]) queue_close(feeds[s]);
+        }
+        if (created == 0) ok = 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to start batch threads.\n");
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    job.report.seconds = batch_now() - start;
+
+    queue_destroy(&job.loaded);
+    queue_destroy(&job.processed);
+    pthread_mutex_destroy(&job.lock);
+
+    job.report.failed = count - job.report.processed;
+    if (report) *report = job.report;
+    return ok && job.report.processed == count;
+}
+
+
+/**
+ * batch_printStage
+ * Prints one line of the utilization table.
+ */
+static void batch_printStage(const char *name, const t_batch_stage *stage, double seconds) {
+    double capacity = seconds * stage->threads;
+    if (capacity <= 0.0) capacity = 1.0;
+    printf("%-8s %7d %7ld %7.1f%% %8.1f%% %8.1f%%\n", name, stage->threads, stage->items,
+           100.0 * stage->busy / capacity, 100.0 * stage->waitIn / capacity, 100.0 * stage->waitOut / capacity);
+}
+
+
+/**
+ * batch_printReport
+ * Prints the throughput and the utilization of each stage. A stage that is mostly
+ * starved needs more upstream threads; one that is mostly blocked needs more
+ * downstream threads or a deeper queue.
+ *
+ * Parameters:
+ * report (const t_batch_report*): Statistics returned by batch_run.
+ */
+void batch_printReport(const t_batch_report *report) {
+    double seconds = report->seconds > 0.0 ? report->seconds : 1e-9;
+    printf("%ld images processed, %ld failed, in %.3f s (%.1f images/s)\n",
+           report->processed, report->failed, report->seconds, report->processed / seconds);
+    printf("%-8s %7s %7s %8s %9s %9s\n", "Stage", "Threads", "Images", "Busy", "Starved", "Blocked");
+    batch_printStage("read", &report->read, seconds);
+    batch_printStage("process", &report->process, seconds);
+    batch_printStage("write", &report->write, seconds);
+}
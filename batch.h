@@ -0,0 +1,107 @@
+/**
+ * batch.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the batch processor. Images go through three stages connected
+ * by bounded queues: reader threads load the next images, worker threads run the
+ * operation chain and writer threads save the results. Loading, processing and saving
+ * of different images overlap, and the queue depth bounds the number of images in memory.
+ *
+ * Role in the project:
+ * Applies one chain of operations to many files while keeping both the CPU and the disk busy.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "pipeline.h"
+
+/**
+ * t_batch_config
+ * Thread counts and queue depth of a batch run. Zero fields take default values.
+ *
+ * Members:
+ * readers (int): Loading threads (default 2).
+ * workers (int): Processing threads (default parallel_threadCount()).
+ * writers (int): Saving threads (default 2).
+ * queueDepth (int): Capacity of each queue, 2 for double buffering, 3 for triple (default 3).
+ */
+typedef struct {
+    int readers;
+    int workers;
+    int writers;
+    int queueDepth;
+} t_batch_config;
+
+/**
+ * t_batch_stage
+ * Timing of one stage, summed over its threads.
+ *
+ * Members:
+ * threads (int): Number of threads of the stage.
+ * items (long): Images handled.
+ * busy (double): Seconds spent working.
+ * waitIn (double): Seconds spent waiting for input (the stage was starved).
+ * waitOut (double): Seconds spent waiting for room in the next queue (the stage was blocked).
+ */
+typedef struct {
+    int threads;
+    long items;
+    double busy;
+    double waitIn;
+    double waitOut;
+} t_batch_stage;
+
+/**
+ * t_batch_report
+ * Result of a batch run.
+ *
+ * Members:
+ * processed (long): Images saved.
+ * failed (long): Images that could not be loaded, processed or saved.
+ * seconds (double): Wall-clock time of the run.
+ * read, process, write (t_batch_stage): Per-stage timing.
+ */
+typedef struct {
+    long processed;
+    long failed;
+    double seconds;
+    t_batch_stage read;
+    t_batch_stage process;
+    t_batch_stage write;
+} t_batch_report;
+
+/**
+ * batch_run
+ * Loads every input file (8-bit or 24/32-bit, detected from the header), applies the
+ * operations of the pipeline and saves the result under the same name in outputDir.
+ * The pipeline is optimized once and shared read-only by the worker threads. Nothing is
+ * processed if two inputs have the same file name.
+ *
+ * Parameters:
+ * inputs (char**): Paths of the input files.
+ * count (int): Number of input files.
+ * outputDir (const char*): Directory receiving the results.
+ * pipeline (t_pipeline*): Operations to apply (may be empty).
+ * config (const t_batch_config*): Thread counts and queue depth, or NULL for defaults.
+ * report (t_batch_report*): Receives the statistics of the run, or NULL.
+ *
+ * Returns:
+ * int: 1 if every image was processed, 0 otherwise.
+ */
+int batch_run(char **inputs, int count, const char *outputDir, t_pipeline *pipeline,
+              const t_batch_config *config, t_batch_report *report);
+
+/**
+ * batch_printReport
+ * Prints the throughput and the utilization of each stage. A stage that is mostly
+ * starved needs more upstream threads; one that is mostly blocked needs more
+ * downstream threads or a deeper queue.
+ *
+ * Parameters:
+ * report (const t_batch_report*): Statistics returned by batch_run.
+ */
+void batch_printReport(const t_batch_report *report);
+
+#endif // BATCH_H
@@ -0,0 +1,462 @@
+/**
+ * bilateral.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the bilateral filter. Both methods work on views, so that 8-bit and color
+ * images share the code.
+ *
+ * The direct filter never calls expf in its loops: the spatial weights are computed once
+ * for every offset of the window (offsets whose weight is negligible are dropped, which
+ * leaves a disc), and the range weights once for every difference of 0 to 255. For
+ * colors, exp(-(db^2 + dg^2 + dr^2) / 2 sigma^2) is the product of the weights of the
+ * three differences, so the same 256-entry table serves the three channels. The source
+ * is copied with replicated borders, so the window never needs bound checks.
+ *
+ * The bilateral grid (Paris and Durand) divides x and y by sigma_s and the value by
+ * sigma_r: each pixel adds its value and a weight of 1 to the nearest cell of this small
+ * 3D grid, the grid is blurred with [1 2 1] along its three axes, and each pixel reads
+ * back the ratio of the two sums, interpolated between the 8 cells around it.
+ *
+ * Role in the project:
+ * Provides edge-preserving denoising for 8-bit and 24/32-bit images.
+ */
+
+
+#include "bilateral.h"
+#include "parallel.h"
+#include "view.h"
+
+// Spatial weights below this fraction of the center weight are dropped
+#define BILATERAL_CUTOFF 0.01f
+
+/**
+ * t_bilateral_exact
+ * Shared state of the direct filter.
+ *
+ * Members:
+ * src (const unsigned char*): Copy of the view with radius replicated pixels on each side.
+ * srcStride (size_t): Bytes per row of the copy.
+ * view (const t_view*): Pixels to write.
+ * radius (int): Half size of the window.
+ * taps (int): Number of offsets in the window.
+ * offsets (const ptrdiff_t*): Byte offset of each tap from the center pixel.
+ * weights (const float*): Spatial weight of each tap.
+ * range (float[256]): Range weight of each absolute difference.
+ */
+typedef struct {
+    const unsigned char *src;
+    size_t srcStride;
+    const t_view *view;
+    int radius;
+    int taps;
+    const ptrdiff_t *offsets;
+    const float *weights;
+    float range[256];
+} t_bilateral_exact;
+
+/**
+ * t_bilateral_grid
+ * Shared state of the grid method. Cell (gx, gy, gz) holds components floats at
+ * ((gy * width + gx) * depth + gz) * components: the sums of the weighted values (1 for
+ * gray, blue / green / red for color), then the sum of the weights.
+ */
+typedef struct {
+    const t_view *view;
+    float *cells;
+    float *blurred;
+    int width;
+    int height;
+    int depth;
+    int components;
+    int spatial;
+    int range;
+} t_bilateral_grid;
+
+
+/**
+ * bilateral_padCopy
+ * Copies a view to a new buffer with radius replicated pixels around it.
+ *
+ * Returns:
+ * unsigned char*: The copy (rows of (width + 2 radius) pixels), or NULL on failure.
+ */
+static unsigned char *bilateral_padCopy(const t_view *view, int radius, size_t *stride) {
+    size_t pixel = view->format == VIEW_BGRA32 ? sizeof(t_pixel) : 1;
+    int width = view->width + 2 * radius;
+    *stride = (size_t)width * pixel;
+    unsigned char *copy = malloc(*stride * (view->height + 2 * radius));
+    if (!copy) return NULL;
+
+    for (int y = 0; y < view->height + 2 * radius; y++) {
+        int sy = y - radius < 0 ? 0 : (y - radius >= view->height ? view->height - 1 : y - radius);
+        const unsigned char *src = view_row(view, sy);
+        unsigned char *dst = copy + (size_t)y * *stride;
+        memcpy(dst + radius * pixel, src, view->width * pixel);
+        for (int x = 0; x < radius; x++) {
+            memcpy(dst + x * pixel, src, pixel);
+            memcpy(dst + (radius + view->width + x) * pixel, src + (view->width - 1) * pixel, pixel);
+        }
+    }
+    return copy;
+}
+
+
+/**
+ * bilateral_exactBand
+ * Direct filter of the rows [start, end).
+ */
+static void bilateral_exactBand(void *context, int start, int end) {
+    const t_bilateral_exact *job = (const t_bilateral_exact *)context;
+    const t_view *view = job->view;
+    const float *range = job->range;
+
+    for (int y = start; y < end; y++) {
+        unsigned char *out = view_row(view, y);
+        const unsigned char *row = job->src + (size_t)(y + job->radius) * job->srcStride;
+
+        if (view->format == VIEW_GRAY8) {
+            for (int x = 0; x < view->width; x++) {
+                const unsigned char *center = row + x + job->radius;
+                int value = *center;
+                float sum = 0.0f;
+                float norm = 0.0f;
+                for (int t = 0; t < job->taps; t++) {
+                    int v = center[job->offsets[t]];
+                    float w = job->weights[t] * range[abs(v - value)];
+                    sum += w * v;
+                    norm += w;
+                }
+                out[x] = (unsigned char)(sum / norm + 0.5f);
+            }
+        } else {
+            t_pixel *pixels = (t_pixel *)out;
+            for (int x = 0; x < view->width; x++) {
+                const unsigned char *center = row + (size_t)(x + job->radius) * sizeof(t_pixel);
+                int b0 = center[0];
+                int g0 = center[1];
+                int r0 = center[2];
+                float b = 0.0f;
+                float g = 0.0f;
+                float r = 0.0f;
+                float norm = 0.0f;
+                for (int t = 0; t < job->taps; t++) {
+                    const unsigned char *p = center + job->offsets[t];
+                    float w = job->weights[t] * range[abs(p[0] - b0)] * range[abs(p[1] - g0)] * range[abs(p[2] - r0)];
+                    b += w * p[0];
+                    g += w * p[1];
+                    r += w * p[2];
+                    norm += w;
+                }
+                pixels[x].blue = (unsigned char)(b / norm + 0.5f);
+                pixels[x].green = (unsigned char)(g / norm + 0.5f);
+                pixels[x].red = (unsigned char)(r / norm + 0.5f);
+            }
+        }
+    }
+}
+
+
+/**
+ * bilateral_exact
+ * Direct filter of a whole view, with a window of radius ceil(2 sigma_s).
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+static int bilateral_exact(const t_view *view, float sigmaSpatial, float sigmaRange) {
+    int radius = (int)ceilf(2.0f * sigmaSpatial);
+    int side = 2 * radius + 1;
+    t_bilateral_exact job;
+    job.view = view;
+    job.radius = radius;
+    job.src = bilateral_padCopy(view, radius, &job.srcStride);
+
+    ptrdiff_t *offsets = malloc((size_t)side * side * sizeof(ptrdiff_t));
+    float *weights = malloc((size_t)side * side * sizeof(float));
+    if (!job.src || !offsets || !weights) {
+        free((void *)job.src);
+        free(offsets);
+        free(weights);
+        return -1;
+    }
+
+    ptrdiff_t pixel = view->format == VIEW_BGRA32 ? (ptrdiff_t)sizeof(t_pixel) : 1;
+    job.taps = 0;
+    for (int dy = -radius; dy <= radius; dy++) {
+        for (int dx = -radius; dx <= radius; dx++) {
+            float w = expf(-(float)(dx * dx + dy * dy) / (2.0f * sigmaSpatial * sigmaSpatial));
+            if (w < BILATERAL_CUTOFF) continue;
+            offsets[job.taps] = dy * (ptrdiff_t)job.srcStride + dx * pixel;
+            weights[job.taps] = w;
+            job.taps++;
+        }
+    }
+    for (int d = 0; d < 256; d++) {
+        job.range[d] = expf(-(float)(d * d) / (2.0f * sigmaRange * sigmaRange));
+    }
+    job.offsets = offsets;
+    job.weights = weights;
+
+    parallel_for(view->height, 1, bilateral_exactBand, &job);
+
+    free((void *)job.src);
+    free(offsets);
+    free(weights);
+    return 0;
+}
+
+
+/**
+ * bilateral_value
+ * Range coordinate of a pixel: its gray level, or the BT.601 luma of its colors.
+ */
+static int bilateral_value(const t_view *view, const unsigned char *row, int x) {
+    if (view->format == VIEW_GRAY8) return row[x];
+    const t_pixel *p = (const t_pixel *)row + x;
+    return (29 * p->blue + 150 * p->green + 77 * p->red + 128) >> 8;
+}
+
+
+/**
+ * bilateral_splatBand
+ * Adds the pixels of the grid rows [start, end) to their nearest cell. Pixel row y goes
+ * to grid row (y + spatial / 2) / spatial + 1, so each band of grid rows owns a band of
+ * pixel rows and no two threads write the same cell.
+ */
+static void bilateral_splatBand(void *context, int start, int end) {
+    const t_bilateral_grid *grid = (const t_bilateral_grid *)context;
+    const t_view *view = grid->view;
+    int s = grid->spatial;
+    int first = (start - 1) * s - s / 2;
+    int last = (end - 1) * s - s / 2;
+    if (first < 0) first = 0;
+    if (last > view->height) last = view->height;
+
+    for (int y = first; y < last; y++) {
+        const unsigned char *row = view_row(view, y);
+        int gy = (y + s / 2) / s + 1;
+        for (int x = 0; x < view->width; x++) {
+            int gx = (x + s / 2) / s + 1;
+            int gz = (bilateral_value(view, row, x) + grid->range / 2) / grid->range + 1;
+            float *cell = grid->cells + (((size_t)gy * grid->width + gx) * grid->depth + gz) * grid->components;
+            if (view->format == VIEW_GRAY8) {
+                cell[0] += row[x];
+                cell[1] += 1.0f;
+            } else {
+                const t_pixel *p = (const t_pixel *)row + x;
+                cell[0] += p->blue;
+                cell[1] += p->green;
+                cell[2] += p->red;
+                cell[3] += 1.0f;
+            }
+        }
+    }
+}
+
+
+/**
+ * t_bilateral_blur
+ * One pass of the grid blur: src is blurred along axis (0: x, 1: y, 2: value) into dst.
+ */
+typedef struct {
+    const t_bilateral_grid *grid;
+    const float *src;
+    float *dst;
+    int axis;
+} t_bilateral_blur;
+
+
+/**
+ * bilateral_blurBand
+ * Blurs the grid rows [start, end) with [1 2 1] along one axis. Cells outside the grid
+ * count as empty; the scale of the sums does not matter since only their ratio is used.
+ */
+static void bilateral_blurBand(void *context, int start, int end) {
+    const t_bilateral_blur *blur = (const t_bilateral_blur *)context;
+    const t_bilateral_grid *grid = blur->grid;
+    int c = grid->components;
+    size_t rowSize = (size_t)grid->width * grid->depth * c;
+
+    for (int gy = start; gy < end; gy++) {
+        for (int gx = 0; gx < grid->width; gx++) {
+            for (int gz = 0; gz < grid->depth; gz++) {
+                size_t i = (((size_t)gy * grid->width + gx) * grid->depth + gz) * c;
+                const float *center = blur->src + i;
+                const float *before = NULL;
+                const float *after = NULL;
+                if (blur->axis == 0) {
+                    if (gx > 0) before = center - (size_t)grid->depth * c;
+                    if (gx < grid->width - 1) after = center + (size_t)grid->depth * c;
+                } else if (blur->axis == 1) {
+                    if (gy > 0) before = center - rowSize;
+                    if (gy < grid->height - 1) after = center + rowSize;
+                } else {
+                    if (gz > 0) before = center - c;
+                    if (gz < grid->depth - 1) after = center + c;
+                }
+                for (int k = 0; k < c; k++) {
+                    blur->dst[i + k] = 2.0f * center[k] + (before ? before[k] : 0.0f) + (after ? after[k] : 0.0f);
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * bilateral_sliceBand
+ * Reads back the rows [start, end) by trilinear interpolation of the blurred grid.
+ */
+static void bilateral_sliceBand(void *context, int start, int end) {
+    const t_bilateral_grid *grid = (const t_bilateral_grid *)context;
+    const t_view *view = grid->view;
+    int c = grid->components;
+    size_t strideX = (size_t)grid->depth * c;
+    size_t strideY = (size_t)grid->width * strideX;
+
+    for (int y = start; y < end; y++) {
+        unsigned char *row = view_row(view, y);
+        float fy = (float)y / grid->spatial + 1.0f;
+        int gy = (int)fy;
+        float ay = fy - gy;
+
+        for (int x = 0; x < view->width; x++) {
+            float fx = (float)x / grid->spatial + 1.0f;
+            float fz = (float)bilateral_value(view, row, x) / grid->range + 1.0f;
+            int gx = (int)fx;
+            int gz = (int)fz;
+            float ax = fx - gx;
+            float az = fz - gz;
+
+            const float *base = grid->blurred + gy * strideY + gx * strideX + (size_t)gz * c;
+            float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            for (int corner = 0; corner < 8; corner++) {
+                int dx = corner & 1;
+                int dy = (corner >> 1) & 1;
+                int dz = corner >> 2;
+                float w = (dx ? ax : 1.0f - ax) * (dy ? ay : 1.0f - ay) * (dz ? az : 1.0f - az);
+                const float *cell = base + dy * strideY + dx * strideX + (size_t)dz * c;
+                for (int k = 0; k < c; k++) sum[k] += w * cell[k];
+            }
+
+            float norm = sum[c - 1];
+            if (norm <= 0.0f) continue;
+            if (view->format == VIEW_GRAY8) {
+                row[x] = (unsigned char)(sum[0] / norm + 0.5f);
+            } else {
+                t_pixel *p = (t_pixel *)row + x;
+                p->blue = (unsigned char)(sum[0] / norm + 0.5f);
+                p->green = (unsigned char)(sum[1] / norm + 0.5f);
+                p->red = (unsigned char)(sum[2] / norm + 0.5f);
+            }
+        }
+    }
+}
+
+
+/**
+ * bilateral_grid
+ * Grid approximation of the filter of a whole view.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+static int bilateral_grid(const t_view *view, float sigmaSpatial, float sigmaRange) {
+    t_bilateral_grid grid;
+    grid.view = view;
+    grid.spatial = sigmaSpatial < 1.0f ? 1 : (int)lrintf(sigmaSpatial);
+    grid.range = sigmaRange < 1.0f ? 1 : (int)lrintf(sigmaRange);
+    grid.components = view->format == VIEW_GRAY8 ? 2 : 4;
+
+    // One cell of margin on each side, so that the blur and the interpolation stay inside
+    grid.width = (view->width - 1 + grid.spatial / 2) / grid.spatial + 3;
+    grid.height = (view->height - 1 + grid.spatial / 2) / grid.spatial + 3;
+    grid.depth = (255 + grid.range / 2) / grid.range + 3;
+
+    size_t count = (size_t)grid.width * grid.height * grid.depth * grid.components;
+    grid.cells = calloc(count, sizeof(float));
+    grid.blurred = malloc(count * sizeof(float));
+    if (!grid.cells || !grid.blurred) {
+        free(grid.cells);
+        free(grid.blurred);
+        return -1;
+    }
+
+    parallel_for(grid.height, 1, bilateral_splatBand, &grid);
+
+    // x: cells -> blurred, y: blurred -> cells, z: cells -> blurred
+    t_bilateral_blur blur = {&grid, grid.cells, grid.blurred, 0};
+    parallel_for(grid.height, 1, bilateral_blurBand, &blur);
+    blur = (t_bilateral_blur){&grid, grid.blurred, grid.cells, 1};
+    parallel_for(grid.height, 1, bilateral_blurBand, &blur);
+    blur = (t_bilateral_blur){&grid, grid.cells, grid.blurred, 2};
+    parallel_for(grid.height, 1, bilateral_blurBand, &blur);
+
+    parallel_for(view->height, 16, bilateral_sliceBand, &grid);
+
+    free(grid.cells);
+    free(grid.blurred);
+    return 0;
+}
+
+
+/**
+ * bilateral_run
+ * Checks the parameters and runs the chosen method on a whole image view.
+ */
+static int bilateral_run(const t_view *view, t_dirty_rows *dirty, float sigmaSpatial, float sigmaRange,
+                         t_bilateral_method method) {
+    if (!(sigmaSpatial > 0.0f) || !(sigmaRange > 0.0f)) return -1;
+    if (view->width <= 0 || view->height <= 0) return 0;
+
+    int status = method == BILATERAL_GRID ? bilateral_grid(view, sigmaSpatial, sigmaRange)
+                                          : bilateral_exact(view, sigmaSpatial, sigmaRange);
+    if (status != 0) {
+        fprintf(stderr, "Error: Unable to allocate memory for the bilateral filter.\n");
+        return -1;
+    }
+    dirty_markAll(dirty);
+    return 0;
+}
+
+
+/**
+ * bmp8_bilateral
+ * Applies a bilateral filter to an 8-bit image. Rows are processed in parallel.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify (grayscale palette).
+ * sigmaSpatial (float): Standard deviation of the spatial weights, in pixels.
+ * sigmaRange (float): Standard deviation of the range weights, in gray levels.
+ * method (t_bilateral_method): Direct filter or bilateral grid.
+ *
+ * Returns:
+ * int: 0 on success, -1 on invalid arguments or allocation failure (image unchanged).
+ */
+int bmp8_bilateral(t_bmp8 *img, float sigmaSpatial, float sigmaRange, t_bilateral_method method) {
+    if (!img || !img->data) return -1;
+    t_view view = bmp8_view(img);
+    return bilateral_run(&view, &img->dirty, sigmaSpatial, sigmaRange, method);
+}
+
+
+/**
+ * bmp24_bilateral
+ * Applies a bilateral filter to a 24/32-bit image. The range distance of two pixels is
+ * measured on their three colors; alpha is kept.
+ *
+ * Parameters:
+ * img (t_bmp24*): Image to modify.
+ * sigmaSpatial (float): Standard deviation of the spatial weights, in pixels.
+ * sigmaRange (float): Standard deviation of the range weights, in color levels.
+ * method (t_bilateral_method): Direct filter or bilateral grid.
+ *
+ * Returns:
+ * int: 0 on success, -1 on invalid arguments or allocation failure (image unchanged).
+ */
+int bmp24_bilateral(t_bmp24 *img, float sigmaSpatial, float sigmaRange, t_bilateral_method method) {
+    if (!img || !img->data) return -1;
+    t_view view = bmp24_view(img);
+    return bilateral_run(&view, &img->dirty, sigmaSpatial, sigmaRange, method);
+}
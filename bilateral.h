@@ -0,0 +1,68 @@
+/**
+ * bilateral.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the bilateral filter. Each pixel becomes an average of its
+ * neighbours weighted both by their distance (spatial sigma) and by how much their value
+ * differs from its own (range sigma), so that noise is smoothed while edges are kept.
+ * Two methods are available: the direct filter, with tabulated weights, and the
+ * bilateral grid approximation, whose cost hardly depends on the spatial sigma.
+ *
+ * Role in the project:
+ * Provides edge-preserving denoising for 8-bit and 24/32-bit images.
+ */
+
+#ifndef BILATERAL_H
+#define BILATERAL_H
+
+#include "bmp8.h"
+#include "bmp24.h"
+
+/**
+ * t_bilateral_method
+ * Way the filter is computed.
+ *
+ * BILATERAL_EXACT: direct sum over a square window of radius 2 * sigma_s, with the
+ *     spatial and range weights read from precomputed tables.
+ * BILATERAL_GRID: the pixels are accumulated in a coarse (x, y, value) grid sampled every
+ *     sigma_s pixels and sigma_r gray levels, which is blurred and then interpolated.
+ *     Color images are guided by their luma.
+ */
+typedef enum {
+    BILATERAL_EXACT,
+    BILATERAL_GRID
+} t_bilateral_method;
+
+/**
+ * bmp8_bilateral
+ * Applies a bilateral filter to an 8-bit image. Rows are processed in parallel.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify (grayscale palette).
+ * sigmaSpatial (float): Standard deviation of the spatial weights, in pixels.
+ * sigmaRange (float): Standard deviation of the range weights, in gray levels.
+ * method (t_bilateral_method): Direct filter or bilateral grid.
+ *
+ * Returns:
+ * int: 0 on success, -1 on invalid arguments or allocation failure (image unchanged).
+ */
+int bmp8_bilateral(t_bmp8 *img, float sigmaSpatial, float sigmaRange, t_bilateral_method method);
+
+/**
+ * bmp24_bilateral
+ * Applies a bilateral filter to a 24/32-bit image. The range distance of two pixels is
+ * measured on their three colors; alpha is kept.
+ *
+ * Parameters:
+ * img (t_bmp24*): Image to modify.
+ * sigmaSpatial (float): Standard deviation of the spatial weights, in pixels.
+ * sigmaRange (float): Standard deviation of the range weights, in color levels.
+ * method (t_bilateral_method): Direct filter or bilateral grid.
+ *
+ * Returns:
+ * int: 0 on success, -1 on invalid arguments or allocation failure (image unchanged).
+ */
+int bmp24_bilateral(t_bmp24 *img, float sigmaSpatial, float sigmaRange, t_bilateral_method method);
+
+#endif // BILATERAL_H
@@ -14,12 +14,45 @@
  */
 
 
+#include <fcntl.h>
+#include <unistd.h>
 #include "bmp24.h"
+#include "view.h"
+#include "kernels.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * t_channel_mask
+ * Position of one channel inside a 32-bit file pixel.
+ */
+typedef struct {
+    uint32_t mask;
+    int shift;
+    uint32_t max;
+} t_channel_mask;
+
+/**
+ * t_pixel_format
+ * Layout of the pixels of a file: 24-bit BGR, 32-bit BGRA, or arbitrary masks.
+ * Channels are in t_pixel order (blue, green, red, alpha).
+ */
+typedef struct {
+    int depth;
+    int bgra;
+    t_channel_mask channels[4];
+} t_pixel_format;
 
 
 /**
  * bmp24_allocateDataPixels
- * Allocates memory for a 2D array of pixels.
+ * Allocates memory for a 2D array of pixels. The rows are stored in one block, each one
+ * aligned on 32 bytes and BMP24_ROW_STRIDE(width) bytes after the previous one, so that
+ * the image can be described by a single pointer and stride (negative once the row
+ * pointers are reversed by bmp24_flipVertical). The address of the block is kept after
+ * the last row pointer.
  *
  * Parameters:
  * width (int): Width of the image.
@@ -29,23 +62,27 @@
  * t_pixel**: Pointer to allocated 2D pixel array.
  */
 t_pixel **bmp24_allocateDataPixels(int width, int height) {
-    t_pixel **pixels = malloc(height * sizeof(t_pixel *));
+    t_pixel **pixels = malloc((height + 1) * sizeof(t_pixel *));
     if (!pixels) {
         fprintf(stderr, "Error: Unable to allocate memory for pixel rows.\n");
         return NULL;
     }
 
+    // aligned_alloc needs a size that is a multiple of the alignment
+    size_t rowBytes = BMP24_ROW_STRIDE(width);
+    size_t blockBytes = rowBytes * (height > 0 ? height : 1);
+    if (blockBytes == 0) blockBytes = PIXEL_ALIGN;
+
+    unsigned char *block = aligned_alloc(PIXEL_ALIGN, blockBytes);
+    if (!block) {
+        fprintf(stderr, "Error: Unable to allocate memory for pixel columns.\n");
+        free(pixels);
+        return NULL;
+    }
     for (int i = 0; i < height; i++) {
-        pixels[i] = malloc(width * sizeof(t_pixel));
-        if (!pixels[i]) {
-            fprintf(stderr, "Error: Unable to allocate memory for pixel columns.\n");
-            for (int j = 0; j < i; j++) {
-                free(pixels[j]);
-            }
-            free(pixels);
-            return NULL;
-        }
+        pixels[i] = (t_pixel *)(block + (size_t)i * rowBytes);
     }
+    pixels[height] = (t_pixel *)block;
     return pixels;
 }
 
@@ -60,22 +97,58 @@ t_pixel **bmp24_allocateDataPixels(int width, int height) {
  */
 void bmp24_freeDataPixels(t_pixel **pixels, int height) {
     if (pixels) {
-        for (int i = 0; i < height; i++) {
-            free(pixels[i]);
-        }
+        free(pixels[height]);
         free(pixels);
     }
 }
 
 
+/**
+ * bmp24_rowSize
+ * Size in bytes of one padded file row.
+ */
+static uint32_t bmp24_rowSize(int width, int colorDepth) {
+    return ((uint32_t)width * (colorDepth / 8) + 3) / 4 * 4;
+}
+
+
+/**
+ * bmp24_setHeaders
+ * Fills the headers for an uncompressed (24-bit) or BI_BITFIELDS (32-bit) image of
+ * the current size. 32-bit images whose compression is BI_RGB (no alpha channel in the
+ * file) stay BI_RGB. The resolution fields are left unchanged.
+ */
+static void bmp24_setHeaders(t_bmp24 *img) {
+    int masks = img->colorDepth == 32 && img->header_info.compression != BI_RGB;
+    uint32_t infoSize = masks ? INFO_V4_SIZE : INFO_SIZE;
+    uint32_t imageSize = bmp24_rowSize(img->width, img->colorDepth) * img->height;
+
+    img->header.type = BMP_TYPE;
+    img->header.reserved1 = 0;
+    img->header.reserved2 = 0;
+    img->header.offset = HEADER_SIZE + infoSize;
+    img->header.size = img->header.offset + imageSize;
+    img->header_info.size = infoSize;
+    img->header_info.width = img->width;
+    img->header_info.height = img->height;
+    img->header_info.planes = 1;
+    img->header_info.bits = img->colorDepth;
+    img->header_info.compression = masks ? BI_BITFIELDS : BI_RGB;
+    img->header_info.imagesize = imageSize;
+    img->header_info.ncolors = 0;
+    img->header_info.importantcolors = 0;
+}
+
+
 /**
  * bmp24_allocate
  * Allocates memory for a 24-bit BMP image structure and its pixel data.
+ * The headers are filled for an uncompressed image of the given size.
  *
  * Parameters:
  * width (int): Image width.
  * height (int): Image height.
- * colorDepth (int): Color depth (usually 24).
+ * colorDepth (int): Color depth (24, or 32 for a BI_BITFIELDS image with alpha).
  *
  * Returns:
  * t_bmp24*: Pointer to allocated BMP image.
@@ -95,6 +168,13 @@ t_bmp24 *bmp24_allocate(int width, int height, int colorDepth) {
         free(img);
         return NULL;
     }
+    dirty_init(&img->dirty, height);
+
+    // Default headers, so that a freshly allocated image can be saved directly
+    img->header_info.compression = colorDepth == 32 ? BI_BITFIELDS : BI_RGB;
+    bmp24_setHeaders(img);
+    img->header_info.xresolution = 2835;
+    img->header_info.yresolution = 2835;
 
     return img;
 }
@@ -110,6 +190,7 @@ t_bmp24 *bmp24_allocate(int width, int height, int colorDepth) {
 void bmp24_free(t_bmp24 *img) {
     if (img) {
         bmp24_freeDataPixels(img->data, img->height);
+        dirty_free(&img->dirty);
         free(img);
     }
 }
@@ -152,6 +233,7 @@ void file_rawWrite(uint32_t position, void *buffer, uint32_t size, size_t n, FIL
 /**
  * bmp24_readPixelValue
  * Reads a single pixel value from file at position (x, y) into image data.
+ * The pixel is 3 bytes (BGR) or 4 bytes (BGRA) depending on the color depth.
  *
  * Parameters:
  * image (t_bmp24*): Image to store the pixel.
@@ -160,40 +242,150 @@ void file_rawWrite(uint32_t position, void *buffer, uint32_t size, size_t n, FIL
  * file (FILE*): File pointer to read from.
  */
 void bmp24_readPixelValue(t_bmp24 *image, int x, int y, FILE *file) {
-    uint8_t bgr[3];
-    fread(bgr, sizeof(uint8_t), 3, file);
-    image->data[y][x].blue = bgr[0];
-    image->data[y][x].green = bgr[1];
-    image->data[y][x].red = bgr[2];
+    uint8_t bgra[4] = {0, 0, 0, 255};
+    fread(bgra, sizeof(uint8_t), image->colorDepth == 32 ? 4 : 3, file);
+    image->data[y][x].blue = bgra[0];
+    image->data[y][x].green = bgra[1];
+    image->data[y][x].red = bgra[2];
+    image->data[y][x].alpha = bgra[3];
+}
+
+
+/**
+ * bmp24_channelMask
+ * Builds the shift and maximum value of a channel from its mask.
+ */
+static t_channel_mask bmp24_channelMask(uint32_t mask) {
+    t_channel_mask channel = {mask, 0, 0};
+    if (mask) {
+        while (!((mask >> channel.shift) & 1)) channel.shift++;
+        channel.max = mask >> channel.shift;
+    }
+    return channel;
+}
+
+
+/**
+ * bmp24_readFormat
+ * Determines the pixel layout of a file. BI_BITFIELDS masks follow the 40-byte info
+ * header; the alpha mask is only present in the larger (V3 and later) headers. The
+ * fourth byte of a 32-bit BI_RGB pixel is padding, so those files have no alpha mask.
+ */
+static void bmp24_readFormat(const t_bmp_info *info, FILE *file, t_pixel_format *format) {
+    // Red, green, blue, alpha, as stored in the file
+    uint32_t masks[4] = {0x00FF0000, 0x0000FF00, 0x000000FF, 0};
+
+    format->depth = info->bits;
+    if (info->bits == 32 && info->compression == BI_BITFIELDS) {
+        file_rawRead(BITMAP_MASKS, masks, sizeof(uint32_t), info->size >= 56 ? 4 : 3, file);
+        if (info->size < 56) masks[3] = 0;
+    }
+
+    format->channels[0] = bmp24_channelMask(masks[2]);
+    format->channels[1] = bmp24_channelMask(masks[1]);
+    format->channels[2] = bmp24_channelMask(masks[0]);
+    format->channels[3] = bmp24_channelMask(masks[3]);
+    format->bgra = info->bits == 32 && masks[0] == 0x00FF0000 && masks[1] == 0x0000FF00 &&
+                   masks[2] == 0x000000FF && (masks[3] == 0xFF000000 || masks[3] == 0);
+}
+
+
+/**
+ * bmp24_decodeRow
+ * Converts one file row into pixels.
+ */
+static void bmp24_decodeRow(const uint8_t *src, t_pixel *dst, int width, const t_pixel_format *format) {
+    if (format->bgra) {
+        // Same layout as t_pixel: only a missing alpha channel needs filling in
+        memcpy(dst, src, (size_t)width * sizeof(t_pixel));
+        if (!format->channels[3].mask) {
+            for (int x = 0; x < width; x++) dst[x].alpha = 255;
+        }
+        return;
+    }
+
+    if (format->depth == 24) {
+        for (int x = 0; x < width; x++) {
+            dst[x].blue = src[3 * x];
+            dst[x].green = src[3 * x + 1];
+            dst[x].red = src[3 * x + 2];
+            dst[x].alpha = 255;
+        }
+        return;
+    }
+
+    for (int x = 0; x < width; x++) {
+        uint32_t value = (uint32_t)src[4 * x] | (uint32_t)src[4 * x + 1] << 8 |
+                         (uint32_t)src[4 * x + 2] << 16 | (uint32_t)src[4 * x + 3] << 24;
+        uint8_t out[4];
+        for (int c = 0; c < 4; c++) {
+            const t_channel_mask *channel = &format->channels[c];
+            if (!channel->mask) {
+                // Missing alpha means opaque
+                out[c] = c == 3 ? 255 : 0;
+                continue;
+            }
+            uint32_t v = (value & channel->mask) >> channel->shift;
+            out[c] = channel->max == 255 ? (uint8_t)v : (uint8_t)(((uint64_t)v * 255 + channel->max / 2) / channel->max);
+        }
+        dst[x].blue = out[0];
+        dst[x].green = out[1];
+        dst[x].red = out[2];
+        dst[x].alpha = out[3];
+    }
+}
+
+
+/**
+ * bmp24_readRows
+ * Reads the pixel rows of a file of the given layout, from the data offset.
+ */
+static int bmp24_readRows(t_bmp24 *image, FILE *file, const t_pixel_format *format) {
+    uint32_t rowSize = bmp24_rowSize(image->width, format->depth);
+    uint8_t *row = malloc(rowSize);
+    if (!row) {
+        fprintf(stderr, "Error: Unable to allocate memory for a pixel row.\n");
+        return 0;
+    }
+
+    fseek(file, image->header.offset, SEEK_SET);
+    for (int y = image->height - 1; y >= 0; y--) {
+        if (fread(row, 1, rowSize, file) != rowSize) {
+            fprintf(stderr, "Error: Unexpected end of file while reading pixel data.\n");
+            free(row);
+            return 0;
+        }
+        bmp24_decodeRow(row, image->data[y], image->width, format);
+    }
+    free(row);
+    return 1;
 }
 
 
 /**
  * bmp24_readPixelData
- * Reads pixel data from file into the BMP image.
+ * Reads pixel data from file into the BMP image, one file row at a time.
+ * 32-bit rows with the standard BGRA layout are copied as is, other channel masks
+ * (BI_BITFIELDS) are decoded and rescaled to 8 bits.
  *
  * Parameters:
  * image (t_bmp24*): Image to fill pixel data.
  * file (FILE*): File pointer to read from.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the file ends early or a row cannot be allocated.
  */
-void bmp24_readPixelData(t_bmp24 *image, FILE *file) {
-    int width = image->width;
-    int height = image->height;
-    int padding = (4 - (width * 3) % 4) % 4;
-
-    fseek(file, image->header.offset, SEEK_SET);
-    for (int y = height - 1; y >= 0; y--) {
-        for (int x = 0; x < width; x++) {
-            bmp24_readPixelValue(image, x, y, file);
-        }
-        fseek(file, padding, SEEK_CUR);
-    }
+int bmp24_readPixelData(t_bmp24 *image, FILE *file) {
+    t_pixel_format format;
+    bmp24_readFormat(&image->header_info, file, &format);
+    return bmp24_readRows(image, file, &format);
 }
 
 
 /**
  * bmp24_writePixelValue
  * Writes a single pixel value to file from image data at position (x, y).
+ * The pixel is 3 bytes (BGR) or 4 bytes (BGRA) depending on the color depth.
  *
  * Parameters:
  * image (t_bmp24*): Image providing the pixel.
@@ -202,17 +394,39 @@ void bmp24_readPixelData(t_bmp24 *image, FILE *file) {
  * file (FILE*): File pointer to write to.
  */
 void bmp24_writePixelValue(t_bmp24 *image, int x, int y, FILE *file) {
-    uint8_t bgr[3];
-    bgr[0] = image->data[y][x].blue;
-    bgr[1] = image->data[y][x].green;
-    bgr[2] = image->data[y][x].red;
-    fwrite(bgr, sizeof(uint8_t), 3, file);
+    uint8_t bgra[4];
+    bgra[0] = image->data[y][x].blue;
+    bgra[1] = image->data[y][x].green;
+    bgra[2] = image->data[y][x].red;
+    bgra[3] = image->data[y][x].alpha;
+    fwrite(bgra, sizeof(uint8_t), image->colorDepth == 32 ? 4 : 3, file);
+}
+
+
+/**
+ * bmp24_encodeRow
+ * Converts one row of pixels into a padded file row.
+ */
+static void bmp24_encodeRow(const t_pixel *pixels, uint8_t *dst, int width, int colorDepth) {
+    if (colorDepth == 32) {
+        // Pixels are already BGRA and 32-bit rows need no padding
+        memcpy(dst, pixels, (size_t)width * sizeof(t_pixel));
+        return;
+    }
+    for (int x = 0; x < width; x++) {
+        dst[3 * x] = pixels[x].blue;
+        dst[3 * x + 1] = pixels[x].green;
+        dst[3 * x + 2] = pixels[x].red;
+    }
+    for (uint32_t i = 3 * (uint32_t)width; i < bmp24_rowSize(width, colorDepth); i++) {
+        dst[i] = 0;
+    }
 }
 
 
 /**
  * bmp24_writePixelData
- * Writes pixel data from the BMP image to the file.
+ * Writes pixel data from the BMP image to the file, one file row at a time.
  *
  * Parameters:
  * image (t_bmp24*): Image providing pixel data.
@@ -221,22 +435,73 @@ void bmp24_writePixelValue(t_bmp24 *image, int x, int y, FILE *file) {
 void bmp24_writePixelData(t_bmp24 *image, FILE *file) {
     int width = image->width;
     int height = image->height;
-    int padding = (4 - (width * 3) % 4) % 4;
-    uint8_t pad[3] = {0, 0, 0};
+    uint32_t rowSize = bmp24_rowSize(width, image->colorDepth);
 
     fseek(file, image->header.offset, SEEK_SET);
-    for (int y = height - 1; y >= 0; y--) {
-        for (int x = 0; x < width; x++) {
-            bmp24_writePixelValue(image, x, y, file);
+    if (image->colorDepth == 32) {
+        // Pixels are already BGRA and 32-bit rows need no padding
+        for (int y = height - 1; y >= 0; y--) {
+            fwrite(image->data[y], sizeof(t_pixel), width, file);
         }
-        fwrite(pad, sizeof(uint8_t), padding, file);
+        return;
+    }
+
+    uint8_t *row = malloc(rowSize);
+    if (!row) {
+        fprintf(stderr, "Error: Unable to allocate memory for a pixel row.\n");
+        return;
+    }
+    for (int y = height - 1; y >= 0; y--) {
+        bmp24_encodeRow(image->data[y], row, width, image->colorDepth);
+        fwrite(row, 1, rowSize, file);
     }
+    free(row);
+}
+
+
+/**
+ * bmp24_readHeaders
+ * Reads and validates the file header and info header of a 24-bit BMP file, or of a
+ * 32-bit one stored as BI_RGB or BI_BITFIELDS.
+ *
+ * Parameters:
+ * file (FILE*): File pointer to read from.
+ * filename (const char*): Path of the file, used in error messages.
+ * header (t_bmp_header*): Receives the file header.
+ * header_info (t_bmp_info*): Receives the info header.
+ *
+ * Returns:
+ * int: 1 if the file is a supported BMP, 0 otherwise.
+ */
+static int bmp24_readHeaders(FILE *file, const char *filename, t_bmp_header *header, t_bmp_info *header_info) {
+    file_rawRead(BITMAP_MAGIC, &header->type, sizeof(uint16_t), 1, file);
+    if (header->type != BMP_TYPE) {
+        fprintf(stderr, "Error: File %s is not a valid BMP file.\n", filename);
+        return 0;
+    }
+
+    file_rawRead(BITMAP_SIZE, &header->size, sizeof(uint32_t), 1, file);
+    file_rawRead(BITMAP_OFFSET, &header->offset, sizeof(uint32_t), 1, file);
+    file_rawRead(HEADER_SIZE, header_info, sizeof(t_bmp_info), 1, file);
+    header->reserved1 = 0;
+    header->reserved2 = 0;
+
+    if (header_info->bits == 32 && header_info->compression != BI_RGB && header_info->compression != BI_BITFIELDS) {
+        fprintf(stderr, "Error: Unsupported compression for a 32-bit BMP file.\n");
+        return 0;
+    }
+    if (header_info->bits != 24 && header_info->bits != 32) {
+        fprintf(stderr, "Error: Only 24-bit and 32-bit BMP files are supported.\n");
+        return 0;
+    }
+    return 1;
 }
 
 
 /**
  * bmp24_loadImage
- * Loads a 24-bit BMP image from a file.
+ * Loads a 24-bit BMP image from a file. 32-bit files (BI_RGB or BI_BITFIELDS)
+ * are accepted too and keep their alpha channel.
  *
  * Parameters:
  * filename (const char*): Path to the BMP file.
@@ -255,27 +520,15 @@ t_bmp24 *bmp24_loadImage(const char *filename) {
     t_bmp_header header;
     t_bmp_info header_info;
 
-    file_rawRead(BITMAP_MAGIC, &header.type, sizeof(uint16_t), 1, file);
-    if (header.type != BMP_TYPE) {
-        fprintf(stderr, "Error: File %s is not a valid BMP file.\n", filename);
+    if (!bmp24_readHeaders(file, filename, &header, &header_info)) {
         fclose(file);
         return NULL;
     }
 
-    file_rawRead(BITMAP_SIZE, &header.size, sizeof(uint32_t), 1, file);
-    file_rawRead(BITMAP_OFFSET, &header.offset, sizeof(uint32_t), 1, file);
-    file_rawRead(HEADER_SIZE, &header_info, sizeof(t_bmp_info), 1, file);
-
     int width = header_info.width;
     int height = header_info.height;
     int colorDepth = header_info.bits;
 
-    if (colorDepth != 24) {
-        fprintf(stderr, "Error: Only 24-bit BMP files are supported.\n");
-        fclose(file);
-        return NULL;
-    }
-
     t_bmp24 *image = bmp24_allocate(width, height, colorDepth);
     if (!image) {
         fclose(file);
@@ -285,7 +538,152 @@ t_bmp24 *bmp24_loadImage(const char *filename) {
     image->header = header;
     image->header_info = header_info;
 
-    bmp24_readPixelData(image, file);
+    if (!bmp24_readPixelData(image, file)) {
+        fclose(file);
+        bmp24_free(image);
+        return NULL;
+    }
+    fclose(file);
+    dirty_sync(&image->dirty, filename);
+    return image;
+}
+
+
+/**
+ * bmp24_reload
+ * Loads a BMP file into an existing image of the same width, height and depth, reusing
+ * its pixel buffer instead of allocating a new one.
+ *
+ * Parameters:
+ * image (t_bmp24*): Image to overwrite.
+ * filename (const char*): Path to the BMP file.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the file cannot be read or its size or depth differ (the image
+ *     is then unchanged), or if its pixel data ends early (the image is then partly
+ *     overwritten).
+ */
+int bmp24_reload(t_bmp24 *image, const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Unable to open file %s for reading.\n", filename);
+        return 0;
+    }
+
+    t_bmp_header header;
+    t_bmp_info header_info;
+    int ok = bmp24_readHeaders(file, filename, &header, &header_info) &&
+             header_info.width == image->header_info.width && header_info.height == image->header_info.height &&
+             header_info.bits == image->colorDepth;
+    if (ok) {
+        image->header = header;
+        image->header_info = header_info;
+        ok = bmp24_readPixelData(image, file);
+    }
+    fclose(file);
+    if (ok) dirty_sync(&image->dirty, filename);
+    return ok;
+}
+
+
+/**
+ * bmp24_loadImageScaled
+ * Loads a 24-bit BMP image downsampled by an integer factor while reading it.
+ * File rows are read and decoded one at a time and summed into a single accumulator row; every
+ * scale rows, the averages of scale x scale blocks are written to the output image.
+ * The full-resolution image is never held in memory.
+ *
+ * Parameters:
+ * filename (const char*): Path to the BMP file.
+ * scale (int): Reduction factor (1, 2, 4 or 8). Partial blocks on the edges are averaged too.
+ *
+ * Returns:
+ * t_bmp24*: Pointer to the downsampled image, or NULL on failure (including a truncated file).
+ */
+t_bmp24 *bmp24_loadImageScaled(const char *filename, int scale) {
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+        fprintf(stderr, "Error: Scale must be 1, 2, 4 or 8.\n");
+        return NULL;
+    }
+    if (scale == 1) return bmp24_loadImage(filename);
+
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Unable to open file %s for reading.\n", filename);
+        return NULL;
+    }
+
+    t_bmp_header header;
+    t_bmp_info header_info;
+    if (!bmp24_readHeaders(file, filename, &header, &header_info)) {
+        fclose(file);
+        return NULL;
+    }
+
+    int width = header_info.width;
+    int height = header_info.height;
+    int outWidth = (width + scale - 1) / scale;
+    int outHeight = (height + scale - 1) / scale;
+    uint32_t rowSize = bmp24_rowSize(width, header_info.bits);
+
+    t_pixel_format format;
+    bmp24_readFormat(&header_info, file, &format);
+
+    t_bmp24 *image = bmp24_allocate(outWidth, outHeight, header_info.bits);
+    uint8_t *row = malloc(rowSize);
+    t_pixel *pixels = malloc((size_t)width * sizeof(t_pixel));
+    uint32_t *acc = calloc((size_t)outWidth * 4, sizeof(uint32_t));
+    if (!image || !row || !pixels || !acc) {
+        fprintf(stderr, "Error: Unable to allocate memory for scaled image.\n");
+        bmp24_free(image);
+        free(row);
+        free(pixels);
+        free(acc);
+        fclose(file);
+        return NULL;
+    }
+
+    // Rows are stored bottom-up: file row i is image row height - 1 - i
+    fseek(file, header.offset, SEEK_SET);
+    int rowsInBlock = 0;
+    for (int y = height - 1; y >= 0; y--) {
+        if (fread(row, 1, rowSize, file) != (size_t)rowSize) {
+            fprintf(stderr, "Error: Unexpected end of file in %s.\n", filename);
+            bmp24_free(image);
+            image = NULL;
+            break;
+        }
+
+        bmp24_decodeRow(row, pixels, width, &format);
+        for (int x = 0; x < width; x++) {
+            uint32_t *sum = acc + (x / scale) * 4;
+            sum[0] += pixels[x].blue;
+            sum[1] += pixels[x].green;
+            sum[2] += pixels[x].red;
+            sum[3] += pixels[x].alpha;
+        }
+        rowsInBlock++;
+
+        // Flush when the next row belongs to another output row
+        if (y % scale == 0) {
+            t_pixel *out = image->data[y / scale];
+            for (int ox = 0; ox < outWidth; ox++) {
+                int columns = (ox + 1) * scale <= width ? scale : width - ox * scale;
+                uint32_t count = (uint32_t)(columns * rowsInBlock);
+                uint32_t *sum = acc + ox * 4;
+                out[ox].blue = (uint8_t)((sum[0] + count / 2) / count);
+                out[ox].green = (uint8_t)((sum[1] + count / 2) / count);
+                out[ox].red = (uint8_t)((sum[2] + count / 2) / count);
+                out[ox].alpha = (uint8_t)((sum[3] + count / 2) / count);
+            }
+            memset(acc, 0, (size_t)outWidth * 4 * sizeof(uint32_t));
+            rowsInBlock = 0;
+        }
+    }
+
+    free(row);
+    free(pixels);
+    free(acc);
     fclose(file);
     return image;
 }
@@ -293,18 +691,28 @@ t_bmp24 *bmp24_loadImage(const char *filename) {
 
 /**
  * bmp24_saveImage
- * Saves a 24-bit BMP image to a file.
+ * Saves a 24-bit BMP image to a file. 32-bit images are written as BGRA with a
+ * BITMAPV4HEADER and BI_BITFIELDS masks, so that readers keep the alpha channel, unless
+ * they were loaded from a BI_RGB file: they are then written as BI_RGB again.
  *
  * Parameters:
  * img (t_bmp24*): Image to save.
  * filename (const char*): Destination file path.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the file cannot be opened or written.
  */
-void bmp24_saveImage(t_bmp24 *img, const char *filename) {
+int bmp24_saveImage(t_bmp24 *img, const char *filename) {
     // Save a BMP image to file
     FILE *file = fopen(filename, "wb");
     if (!file) {
         fprintf(stderr, "Error: Unable to open file %s for writing.\n", filename);
-        return;
+        return -1;
+    }
+
+    if (img->colorDepth == 32) {
+        // Whatever the source layout was, 32-bit images are written as standard BGRA
+        bmp24_setHeaders(img);
     }
 
     file_rawWrite(BITMAP_MAGIC, &img->header.type, sizeof(uint16_t), 1, file);
@@ -312,74 +720,172 @@ void bmp24_saveImage(t_bmp24 *img, const char *filename) {
     file_rawWrite(BITMAP_OFFSET, &img->header.offset, sizeof(uint32_t), 1, file);
     file_rawWrite(HEADER_SIZE, &img->header_info, sizeof(t_bmp_info), 1, file);
 
+    if (img->header_info.compression == BI_BITFIELDS) {
+        // Red, green, blue and alpha masks, then the color space of the V4 header
+        uint32_t masks[4] = {0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000};
+        uint32_t colorSpace = LCS_SRGB;
+        file_rawWrite(BITMAP_MASKS, masks, sizeof(uint32_t), 4, file);
+        file_rawWrite(BITMAP_CS_TYPE, &colorSpace, sizeof(uint32_t), 1, file);
+    }
+
     bmp24_writePixelData(img, file);
-    fclose(file);
+    int ok = !ferror(file);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to write file %s.\n", filename);
+        return -1;
+    }
+    dirty_sync(&img->dirty, filename);
+    return 0;
+}
+
+
+/**
+ * bmp24_headersMatch
+ * Compares the headers stored in a file with the ones bmp24_saveImage would write.
+ */
+static int bmp24_headersMatch(t_bmp24 *img, int fd) {
+    uint8_t onDisk[HEADER_SIZE + INFO_SIZE];
+    if (pread(fd, onDisk, sizeof(onDisk), 0) != (ssize_t)sizeof(onDisk)) return 0;
+
+    if (memcmp(onDisk + BITMAP_MAGIC, &img->header.type, sizeof(uint16_t)) != 0 ||
+        memcmp(onDisk + BITMAP_SIZE, &img->header.size, sizeof(uint32_t)) != 0 ||
+        memcmp(onDisk + BITMAP_OFFSET, &img->header.offset, sizeof(uint32_t)) != 0 ||
+        memcmp(onDisk + HEADER_SIZE, &img->header_info, sizeof(t_bmp_info)) != 0) {
+        return 0;
+    }
+    if (img->header_info.compression == BI_BITFIELDS) {
+        uint32_t masks[4] = {0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000};
+        uint32_t stored[4];
+        if (pread(fd, stored, sizeof(stored), BITMAP_MASKS) != (ssize_t)sizeof(stored) ||
+            memcmp(stored, masks, sizeof(masks)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * bmp24_writeDirtyRows
+ * Writes every run of modified rows at its place in the file. File rows are stored
+ * bottom-up, so a run of image rows is one contiguous block, written in reverse order.
+ */
+static int bmp24_writeDirtyRows(t_bmp24 *img, int fd) {
+    uint32_t rowSize = bmp24_rowSize(img->width, img->colorDepth);
+    int chunkRows = rowSize < (1u << 20) ? (int)((1u << 20) / rowSize) : 1;
+    uint8_t *buffer = malloc((size_t)chunkRows * rowSize);
+    if (!buffer) return 0;
+
+    int ok = 1;
+    for (int y = 0; ok && y < img->height; y++) {
+        if (!img->dirty.rows[y]) continue;
+        int end = y;
+        while (end < img->height && end - y < chunkRows && img->dirty.rows[end]) end++;
+
+        // Image rows [y, end) are file rows [height - end, height - y)
+        int count = end - y;
+        for (int k = 0; k < count; k++) {
+            bmp24_encodeRow(img->data[end - 1 - k], buffer + (size_t)k * rowSize, img->width, img->colorDepth);
+        }
+        off_t offset = img->header.offset + (off_t)(img->height - end) * rowSize;
+        size_t bytes = (size_t)count * rowSize;
+        ok = pwrite(fd, buffer, bytes, offset) == (ssize_t)bytes;
+        y = end - 1;
+    }
+    free(buffer);
+    return ok;
+}
+
+
+/**
+ * bmp24_saveImageIncremental
+ * Saves a 24-bit BMP image, rewriting only the modified rows when the target is the file
+ * the image was loaded from or last saved to, unchanged since, with the same headers.
+ * Runs of modified rows are converted and written in place with pwrite at their padded
+ * offsets. Otherwise the whole file is written like bmp24_saveImage.
+ *
+ * Parameters:
+ * img (t_bmp24*): Image to save.
+ * filename (const char*): Destination file path.
+ *
+ * Returns:
+ * int: 1 if the file was updated in place, 0 if it was fully rewritten, -1 if it could
+ *     not be written.
+ */
+int bmp24_saveImageIncremental(t_bmp24 *img, const char *filename) {
+    if (!img || !img->data) return -1;
+
+    int fd = dirty_isSynced(&img->dirty, filename) ? open(filename, O_RDWR) : -1;
+    if (fd >= 0) {
+        // 32-bit images are always saved with normalized headers
+        if (img->colorDepth == 32) bmp24_setHeaders(img);
+
+        int done = bmp24_headersMatch(img, fd);
+        if (done && !bmp24_writeDirtyRows(img, fd)) {
+            fprintf(stderr, "Error: Unable to write rows in place, rewriting the whole file.\n");
+            done = 0;
+        }
+        close(fd);
+
+        if (done) {
+            dirty_sync(&img->dirty, filename);
+            return 1;
+        }
+    }
+
+    return bmp24_saveImage(img, filename);
 }
 
 
 /**
  * bmp24_negative
  * Applies negative effect to the image by inverting each pixel's colors.
+ * Alpha is left unchanged.
  *
  * Parameters:
  * img (t_bmp24*): Image to modify.
  */
 void bmp24_negative (t_bmp24* img) {
     //a function to inverse the colors in a 24 bit depth image
-    for (int y = 0; y<img -> height; y++) {
-        for (int x = 0; x<img -> width; x++) {
-            (img -> data[y][x]).red = 255 - (img -> data[y][x]).red;
-            (img -> data[y][x]).green = 255 - (img -> data[y][x]).green;
-            (img -> data[y][x]).blue = 255 - (img -> data[y][x]).blue;
-        }
-    }
+    t_view view = bmp24_view(img);
+    view_negative(&view);
 }
 
 
 /**
  * bmp24_grayscale
- * Converts the image to grayscale.
+ * Converts the image to grayscale (average of the three colors).
  *
  * Parameters:
  * img (t_bmp24*): Image to modify.
  */
 void bmp24_grayscale (t_bmp24* img) {
     //a function to make an image grayscale
-    for (int y = 0; y<img -> height; y++) {
-        for (int x = 0; x<img -> width; x++) {
-            //calculate the average of all 3 primary colors
-            int avgval = ((img -> data[y][x]).blue + (img -> data[y][x]).green + (img -> data[y][x]).red)/3;
-            (img -> data[y][x]).red = avgval;
-            (img -> data[y][x]).green = avgval;
-            (img -> data[y][x]).blue = avgval;
-        }
-    }
+    t_view view = bmp24_view(img);
+    view_grayscale(&view);
 }
 
 
 /**
  * bmp24_brightness
  * Adjusts the brightness of the image by adding a value to each pixel color component.
+ * Results are clamped to [0, 255].
  *
  * Parameters:
  * img (t_bmp24*): Image to modify.
  * value (int): Amount to adjust brightness by.
  */
 void bmp24_brightness (t_bmp24 * img, int value) {
-    //a function to add brightness to every pixel, uses the cap function to cap the max brightness
-    for (int y = 0; y<img -> height; y++) {
-        for (int x = 0; x<img -> width; x++) {
-            (img -> data[y][x]).red = cap((img -> data[y][x]).red,value,255);
-            (img -> data[y][x]).green = cap((img -> data[y][x]).green,value,255);
-            (img -> data[y][x]).blue = cap((img -> data[y][x]).blue,value,255);
-        }
-    }
+    //a function to add brightness to every pixel, clamped to the 8-bit range
+    t_view view = bmp24_view(img);
+    view_brightness(&view, value);
 }
 
 
 /**
  * bmp24_convolution
- * Applies a convolution kernel at pixel (x, y).
+ * Applies a convolution kernel at pixel (x, y). The alpha of the pixel is kept.
  *
  * Parameters:
  * img (t_bmp24*): Image to process.
@@ -392,11 +898,18 @@ void bmp24_brightness (t_bmp24 * img, int value) {
  * t_pixel: Resulting pixel after applying convolution.
  */
 t_pixel bmp24_convolution(t_bmp24* img, int x, int y, float** kernel, int kernelSize) {
+    int radius = kernelSize / 2;
+    t_pixel result;
+
+#ifdef __SSE2__
+    // The 4 channels of a pixel are convolved together in one float vector
+    const __m128i zero = _mm_setzero_si128();
+    __m128 sum = _mm_setzero_ps();
+#else
     float sum_red = 0.0f;
     float sum_green = 0.0f;
     float sum_blue = 0.0f;
-
-    int radius = kernelSize / 2;
+#endif
 
     for (int i = -radius; i <= radius; i++) {
         for (int j = -radius; j <= radius; j++) {
@@ -414,18 +927,33 @@ t_pixel bmp24_convolution(t_bmp24* img, int x, int y, float** kernel, int kernel
             float kernel_val = kernel[i + radius][j + radius];
 
             // Get the pixel and multiply by kernel value
+#ifdef __SSE2__
+            int packed;
+            memcpy(&packed, &img->data[ny][nx], sizeof(t_pixel));
+            __m128i pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(pixel), _mm_set1_ps(kernel_val)));
+#else
             t_pixel pixel = img->data[ny][nx];
             sum_red += pixel.red * kernel_val;
             sum_green += pixel.green * kernel_val;
             sum_blue += pixel.blue * kernel_val;
+#endif
         }
     }
 
     // Create and return the resulting pixel
-    t_pixel result;
+#ifdef __SSE2__
+    // Truncate like clamp((int)sum), then saturate to [0, 255]
+    __m128i values = _mm_cvttps_epi32(sum);
+    values = _mm_packs_epi32(values, values);
+    int packed = _mm_cvtsi128_si32(_mm_packus_epi16(values, values));
+    memcpy(&result, &packed, sizeof(t_pixel));
+#else
     result.red = clamp(sum_red);
     result.green = clamp(sum_green);
     result.blue = clamp(sum_blue);
+#endif
+    result.alpha = img->data[y][x].alpha;
 
     return result;
 }
@@ -433,36 +961,71 @@ t_pixel bmp24_convolution(t_bmp24* img, int x, int y, float** kernel, int kernel
 
 /**
  * bmp24_apply_filter
- * Applies a convolution filter to the entire image.
+ * Applies a convolution filter to the entire image. The kernel is the 3x3 one chosen
+ * with init_kernel. Edge pixels are clamped like in bmp24_convolution; rows are
+ * computed by the row function kernel_select picks.
  *
  * Parameters:
  * img (t_bmp24*): Image to modify.
- * kernelSize (int): Size of the convolution kernel.
- */
-void bmp24_apply_filter(t_bmp24* img, int kernelSize) {
-    if (kernelSize <= (img->height /2)) {
-        float** kernel = init_kernel();
-        // Create a temporary copy of the image to store results
-        t_pixel** temp = (t_pixel**)malloc(img->height * sizeof(t_pixel*));
-        for (int y = 0; y < img->height; y++) {
-            temp[y] = (t_pixel*)malloc(img->width * sizeof(t_pixel));
-            for (int x = 0; x < img->width; x++) {
-                //apply convolution to each pixel
-                temp[y][x] = bmp24_convolution(img, x, y, kernel, kernelSize);
-            }
+ */
+void bmp24_apply_filter(t_bmp24* img) {
+    float** kernel = init_kernel();
+    int size = 3;
+    int n = size / 2;
+    int padded = img->width + 2 * n;
+
+    // bmp24_convolution reads kernel[dx][dy]: transpose to the row-by-row layout
+    float weights[9];
+    for (int ky = 0; ky < size; ky++) {
+        for (int kx = 0; kx < size; kx++) {
+            weights[ky * size + kx] = kernel[kx][ky];
         }
+    }
+    free_kernel(kernel);
+    t_kernel_impl impl = kernel_select(weights, size);
 
-        // Copy the results back to the original image
-        for (int y = 0; y < img->height; y++) {
-            for (int x = 0; x < img->width; x++) {
-                img->data[y][x] = temp[y][x];
+    // Ring buffer of source rows padded with n replicated pixels on both sides, so
+    // rows can be overwritten in place
+    t_pixel *ring = malloc((size_t)size * padded * sizeof(t_pixel));
+    t_pixel *out = malloc((size_t)padded * sizeof(t_pixel));
+    if (!ring || !out) {
+        fprintf(stderr, "Error: Unable to allocate memory for the filter.\n");
+        free(ring);
+        free(out);
+        return;
+    }
+
+    int loaded = 0;
+    unsigned char *lines[3];
+    for (int y = 0; y < img->height; y++) {
+        while (loaded < img->height && loaded <= y + n) {
+            t_pixel *dst = ring + (size_t)(loaded % size) * padded + n;
+            memcpy(dst, img->data[loaded], (size_t)img->width * sizeof(t_pixel));
+            for (int k = 1; k <= n; k++) {
+                dst[-k] = dst[0];
+                dst[img->width - 1 + k] = dst[img->width - 1];
             }
-            free(temp[y]);
+            loaded++;
+        }
+        for (int k = 0; k < size; k++) {
+            int sy = y - n + k;
+            if (sy < 0) sy = 0;
+            if (sy >= img->height) sy = img->height - 1;
+            lines[k] = (unsigned char *)(ring + (size_t)(sy % size) * padded);
+        }
+
+        impl.color((unsigned char *)out, lines, padded, weights, size);
+        t_pixel *row = img->data[y];
+        for (int x = 0; x < img->width; x++) {
+            uint8_t alpha = row[x].alpha;
+            row[x] = out[x + n];
+            row[x].alpha = alpha;
         }
-        free(temp);
-    } else {
-        fprintf(stderr, "Error: KernelSize bigger than the image, try again.\n");
     }
+
+    free(ring);
+    free(out);
+    dirty_markAll(&img->dirty);
 }
 
 
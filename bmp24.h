@@ -16,6 +16,7 @@
 #define BMP24_H
 
 #include "utils.h"
+#include "dirty.h"
 
 /**
  * t_bmp_header
@@ -49,12 +50,15 @@ typedef struct {
 
 /**
  * t_pixel
- * Structure representing a pixel in 24-bit BMP format (RGB).
+ * Structure representing a pixel. Channels are stored in the BMP byte order (BGRA),
+ * so a pixel is 4 bytes: rows of 32-bit images map directly onto file rows and
+ * vector code can process 4 pixels per 128-bit register. Alpha is 255 for 24-bit images.
  */
 typedef struct {
-    uint8_t red;
-    uint8_t green;
     uint8_t blue;
+    uint8_t green;
+    uint8_t red;
+    uint8_t alpha;
 } t_pixel;
 
 /**
@@ -66,8 +70,10 @@ typedef struct {
  * header_info (t_bmp_info): BMP info header.
  * width (int): Image width.
  * height (int): Image height.
- * colorDepth (int): Bits per pixel (should be 24).
+ * colorDepth (int): Bits per pixel (24, or 32 with an alpha channel, except when the
+ *     compression in header_info is BI_RGB: the fourth byte is then padding).
  * data (t_pixel**): 2D array of pixels.
+ * dirty (t_dirty_rows): Rows modified since the last load or save (top-down order).
  */
 typedef struct {
     t_bmp_header header;
@@ -76,8 +82,15 @@ typedef struct {
     int height;
     int colorDepth;
     t_pixel **data;
+    t_dirty_rows dirty;
 } t_bmp24;
 
+// Alignment of pixel rows, enough for 256-bit loads
+#define PIXEL_ALIGN 32
+
+// Distance in bytes between two consecutive rows of pixel data
+#define BMP24_ROW_STRIDE(width) (((size_t)(width) * sizeof(t_pixel) + PIXEL_ALIGN - 1) / PIXEL_ALIGN * PIXEL_ALIGN)
+
 // Offsets for BMP header fields
 #define BITMAP_MAGIC 0x00
 #define BITMAP_SIZE 0x02
@@ -86,16 +99,23 @@ typedef struct {
 #define BITMAP_HEIGHT 0x16
 #define BITMAP_DEPTH 0x1C
 #define BITMAP_SIZE_RAW 0x22
+#define BITMAP_MASKS 0x36
+#define BITMAP_CS_TYPE 0x46
 
 // BMP constants
 #define BMP_TYPE 0x4D42
 #define HEADER_SIZE 0x0E
 #define INFO_SIZE 0x28
+#define INFO_V4_SIZE 0x6C
 #define DEFAULT_DEPTH 0x18
+#define LCS_SRGB 0x73524742
 
 /**
  * bmp24_allocateDataPixels
- * Allocates memory for a 2D array of pixels.
+ * Allocates memory for a 2D array of pixels. The rows are stored in one block, each one
+ * aligned on 32 bytes and BMP24_ROW_STRIDE(width) bytes after the previous one, so that
+ * the image can be described by a single pointer and stride. The address of the block
+ * is kept after the last row pointer.
  *
  * Parameters:
  * width (int): Width of the image.
@@ -119,11 +139,12 @@ void bmp24_freeDataPixels(t_pixel **pixels, int height);
 /**
  * bmp24_allocate
  * Allocates memory for a 24-bit BMP image structure and its pixel data.
+ * The headers are filled for an uncompressed image of the given size.
  *
  * Parameters:
  * width (int): Image width.
  * height (int): Image height.
- * colorDepth (int): Color depth (usually 24).
+ * colorDepth (int): Color depth (24, or 32 for a BI_BITFIELDS image with alpha).
  *
  * Returns:
  * t_bmp24*: Pointer to allocated BMP image.
@@ -142,6 +163,7 @@ void bmp24_free(t_bmp24 *img);
 /**
  * bmp24_readPixelValue
  * Reads a single pixel value from file at position (x, y) into image data.
+ * The pixel is 3 bytes (BGR) or 4 bytes (BGRA) depending on the color depth.
  *
  * Parameters:
  * image (t_bmp24*): Image to store the pixel.
@@ -153,17 +175,23 @@ void bmp24_readPixelValue(t_bmp24 *image, int x, int y, FILE *file);
 
 /**
  * bmp24_readPixelData
- * Reads pixel data from file into the BMP image.
+ * Reads pixel data from file into the BMP image, one file row at a time.
+ * 32-bit rows with the standard BGRA layout are copied as is, other channel masks
+ * (BI_BITFIELDS) are decoded and rescaled to 8 bits.
  *
  * Parameters:
  * image (t_bmp24*): Image to fill pixel data.
  * file (FILE*): File pointer to read from.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the file ends early or a row cannot be allocated.
  */
-void bmp24_readPixelData(t_bmp24 *image, FILE *file);
+int bmp24_readPixelData(t_bmp24 *image, FILE *file);
 
 /**
  * bmp24_writePixelValue
  * Writes a single pixel value to file from image data at position (x, y).
+ * The pixel is 3 bytes (BGR) or 4 bytes (BGRA) depending on the color depth.
  *
  * Parameters:
  * image (t_bmp24*): Image providing the pixel.
@@ -175,7 +203,7 @@ void bmp24_writePixelValue(t_bmp24 *image, int x, int y, FILE *file);
 
 /**
  * bmp24_writePixelData
- * Writes pixel data from the BMP image to the file.
+ * Writes pixel data from the BMP image to the file, one file row at a time.
  *
  * Parameters:
  * image (t_bmp24*): Image providing pixel data.
@@ -185,7 +213,8 @@ void bmp24_writePixelData(t_bmp24 *image, FILE *file);
 
 /**
  * bmp24_loadImage
- * Loads a 24-bit BMP image from a file.
+ * Loads a 24-bit BMP image from a file. 32-bit files (BI_RGB or BI_BITFIELDS)
+ * are accepted too and keep their alpha channel.
  *
  * Parameters:
  * filename (const char*): Path to the BMP file.
@@ -195,15 +224,69 @@ void bmp24_writePixelData(t_bmp24 *image, FILE *file);
  */
 t_bmp24 * bmp24_loadImage(const char *filename);
 
+/**
+ * bmp24_reload
+ * Loads a BMP file into an existing image of the same width, height and depth, reusing
+ * its pixel buffer instead of allocating a new one.
+ *
+ * Parameters:
+ * image (t_bmp24*): Image to overwrite.
+ * filename (const char*): Path to the BMP file.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the file cannot be read or its size or depth differ (the image
+ *     is then unchanged), or if its pixel data ends early (the image is then partly
+ *     overwritten).
+ */
+int bmp24_reload(t_bmp24 *image, const char *filename);
+
+/**
+ * bmp24_loadImageScaled
+ * Loads a 24-bit BMP image downsampled by an integer factor while reading it.
+ * File rows are read one at a time and summed into a single accumulator row; every
+ * scale rows, the averages of scale x scale blocks are written to the output image.
+ * The full-resolution image is never held in memory.
+ *
+ * Parameters:
+ * filename (const char*): Path to the BMP file.
+ * scale (int): Reduction factor (1, 2, 4 or 8). Partial blocks on the edges are averaged too.
+ *
+ * Returns:
+ * t_bmp24*: Pointer to the downsampled image, or NULL on failure (including a truncated file).
+ */
+t_bmp24 * bmp24_loadImageScaled(const char *filename, int scale);
+
 /**
  * bmp24_saveImage
- * Saves a 24-bit BMP image to a file.
+ * Saves a 24-bit BMP image to a file. 32-bit images are written as BGRA with a
+ * BITMAPV4HEADER and BI_BITFIELDS masks, so that readers keep the alpha channel, unless
+ * they were loaded from a BI_RGB file: they are then written as BI_RGB again.
  *
  * Parameters:
  * img (t_bmp24*): Image to save.
  * filename (const char*): Destination file path.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the file cannot be opened or written.
+ */
+int bmp24_saveImage(t_bmp24 *img, const char *filename);
+
+/**
+ * bmp24_saveImageIncremental
+ * Saves a 24-bit BMP image, rewriting only the modified rows when the target is the file
+ * the image was loaded from or last saved to, unchanged since, with the same headers.
+ * Runs of modified rows are converted and written in place with pwrite at their padded
+ * offsets. Otherwise the whole file is written like bmp24_saveImage.
+ *
+ * Parameters:
+ * img (t_bmp24*): Image to save.
+ * filename (const char*): Destination file path.
+ *
+ * Returns:
+ * int: 1 if the file was updated in place, 0 if it was fully rewritten, -1 if it could
+ *     not be written.
  */
-void bmp24_saveImage(t_bmp24 *img, const char *filename);
+int bmp24_saveImageIncremental(t_bmp24 *img, const char *filename);
 
 /**
  * file_rawRead
@@ -234,6 +317,7 @@ void file_rawWrite(uint32_t position, void *buffer, uint32_t size, size_t n, FIL
 /**
  * bmp24_negative
  * Applies negative effect to the image by inverting each pixel's colors.
+ * Alpha is left unchanged.
  *
  * Parameters:
  * img (t_bmp24*): Image to modify.
@@ -242,7 +326,7 @@ void bmp24_negative (t_bmp24* img);
 
 /**
  * bmp24_grayscale
- * Converts the image to grayscale.
+ * Converts the image to grayscale (average of the three colors).
  *
  * Parameters:
  * img (t_bmp24*): Image to modify.
@@ -252,6 +336,7 @@ void bmp24_grayscale (t_bmp24* img);
 /**
  * bmp24_brightness
  * Adjusts the brightness of the image by adding a value to each pixel color component.
+ * Results are clamped to [0, 255].
  *
  * Parameters:
  * img (t_bmp24*): Image to modify.
@@ -261,7 +346,7 @@ void bmp24_brightness (t_bmp24 * img, int value);
 
 /**
  * bmp24_convolution
- * Applies a convolution kernel at pixel (x, y).
+ * Applies a convolution kernel at pixel (x, y). The alpha of the pixel is kept.
  *
  * Parameters:
  * img (t_bmp24*): Image to process.
@@ -277,13 +362,13 @@ t_pixel bmp24_convolution(t_bmp24* img, int x, int y, float** kernel, int kernel
 
 /**
  * bmp24_apply_filter
- * Applies a convolution filter to the entire image.
+ * Applies a convolution filter to the entire image. The kernel is the 3x3 one chosen
+ * with init_kernel.
  *
  * Parameters:
  * img (t_bmp24*): Image to modify.
- * kernelSize (int): Size of the convolution kernel.
  */
-void bmp24_apply_filter(t_bmp24* img, int kernelSize);
+void bmp24_apply_filter(t_bmp24* img);
 
 /**
  * bmp24_printInfo
@@ -12,12 +12,67 @@
  */
 
 
+#include <fcntl.h>
+#include <unistd.h>
 #include "bmp8.h"
+#include "histogram.h"
+#include "view.h"
+#include "rle.h"
+
+
+/**
+ * bmp8_setHeader
+ * Rewrites the header of an image for an uncompressed 8-bit file with a 256-entry palette,
+ * matching the current width, height and data size.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image whose header is updated.
+ */
+static void bmp8_setHeader(t_bmp8 *img) {
+    // Keep the resolution already present in the header
+    unsigned int xResolution = *(unsigned int *)&img->header[38];
+    unsigned int yResolution = *(unsigned int *)&img->header[42];
+    memset(img->header, 0, sizeof(img->header));
+
+    // File header (14 bytes) followed by the info header (40 bytes)
+    img->header[0] = 'B';
+    img->header[1] = 'M';
+    *(unsigned int *)&img->header[2] = 54 + 1024 + img->dataSize;
+    *(unsigned int *)&img->header[10] = 54 + 1024;
+    *(unsigned int *)&img->header[14] = 40;
+    *(unsigned int *)&img->header[18] = img->width;
+    *(unsigned int *)&img->header[22] = img->height;
+    *(unsigned short *)&img->header[26] = 1;
+    *(unsigned short *)&img->header[28] = 8;
+    *(unsigned int *)&img->header[30] = BI_RGB;
+    *(unsigned int *)&img->header[34] = img->dataSize;
+    *(unsigned int *)&img->header[38] = xResolution;
+    *(unsigned int *)&img->header[42] = yResolution;
+    *(unsigned int *)&img->header[46] = 256;
+}
+
+
+/**
+ * bmp8_fillPalette
+ * Gives the palette entries a file does not define (from index colors on) the gray of
+ * their index, so that operations moving values past the file palette do not turn
+ * pixels black.
+ */
+static void bmp8_fillPalette(unsigned char *colorTable, unsigned int colors) {
+    for (unsigned int i = colors; i < 256; i++) {
+        colorTable[i * 4] = (unsigned char)i;
+        colorTable[i * 4 + 1] = (unsigned char)i;
+        colorTable[i * 4 + 2] = (unsigned char)i;
+        colorTable[i * 4 + 3] = 0;
+    }
+}
 
 
 /**
  * bmp8_loadImage
- * Loads an 8-bit BMP image from a file.
+ * Loads an 8-bit BMP image from a file. Uncompressed 8-bit files, BI_RLE8 files and
+ * 4-bit BI_RLE4 files are accepted; compressed data is decoded on load, so the image
+ * is always held uncompressed in memory with 8 bits per pixel.
  *
  * Parameters:
  * filename (const char*): Path to the BMP file.
@@ -32,58 +87,423 @@ t_bmp8 *bmp8_loadImage(const char *filename) {
         return NULL;
     }
 
-    t_bmp8 *img = (t_bmp8 *)malloc(sizeof(t_bmp8));
+    t_bmp8 *img = (t_bmp8 *)calloc(1, sizeof(t_bmp8));
+    if (!img) {
+        printf("Error: Unable to allocate memory for image.\n");
+        fclose(file);
+        return NULL;
+    }
 
     // Read the header
-    fread(img->header, sizeof(unsigned char), 54, file);
-
-    // Read the color table
-    fread(img->colorTable, sizeof(unsigned char), 1024, file);
+    if (fread(img->header, sizeof(unsigned char), 54, file) != 54) {
+        printf("Error: The file is too short to be a BMP image.\n");
+        free(img);
+        fclose(file);
+        return NULL;
+    }
 
-    // Extract width, height, color depth, and data size from header
+    // Extract width, height, color depth and compression from header
     img->width = *(unsigned int *)&img->header[18];
     img->height = *(unsigned int *)&img->header[22];
-    img->colorDepth = *(unsigned int *)&img->header[28];
-    img->dataSize = *(unsigned int *)&img->header[34];
-
-    if (img->colorDepth != 8) {
+    img->colorDepth = *(unsigned short *)&img->header[28];
+    unsigned int compression = *(unsigned int *)&img->header[30];
+    unsigned int fileSize = *(unsigned int *)&img->header[2];
+    unsigned int offset = *(unsigned int *)&img->header[10];
+    unsigned int infoSize = *(unsigned int *)&img->header[14];
+    unsigned int colors = *(unsigned int *)&img->header[46];
+
+    int supported = (img->colorDepth == 8 && (compression == BI_RGB || compression == BI_RLE8)) ||
+                    (img->colorDepth == 4 && compression == BI_RLE4);
+    if (!supported) {
         printf("Error: The image is not 8-bit grayscale.\n");
         free(img);
         fclose(file);
         return NULL;
     }
 
-    // Allocate memory for pixel data
-    img->data = (unsigned char *)malloc(img->dataSize);
+    // Read the color table, which follows the info header
+    if (colors == 0 || colors > (1u << img->colorDepth)) colors = 1u << img->colorDepth;
+    fseek(file, 14 + infoSize, SEEK_SET);
+    fread(img->colorTable, sizeof(unsigned char), colors * 4, file);
+    bmp8_fillPalette(img->colorTable, colors);
+
+    // Allocate memory for pixel data, rows padded to 4 bytes
+    img->dataSize = BMP8_ROW_SIZE(img->width) * img->height;
+    img->data = (unsigned char *)calloc(img->dataSize, sizeof(unsigned char));
+    if (!img->data) {
+        printf("Error: Unable to allocate memory for pixel data.\n");
+        free(img);
+        fclose(file);
+        return NULL;
+    }
+    dirty_init(&img->dirty, img->height);
 
     // Read the pixel data
-    fread(img->data, sizeof(unsigned char), img->dataSize, file);
+    fseek(file, offset, SEEK_SET);
+    if (compression == BI_RGB) {
+        fread(img->data, sizeof(unsigned char), img->dataSize, file);
+    } else {
+        unsigned int packedSize = *(unsigned int *)&img->header[34];
+        if (packedSize == 0 && fileSize > offset) packedSize = fileSize - offset;
+
+        unsigned char *packed = (unsigned char *)malloc(packedSize);
+        if (!packed) {
+            printf("Error: Unable to allocate memory for compressed data.\n");
+            bmp8_free(img);
+            fclose(file);
+            return NULL;
+        }
+        size_t read = fread(packed, sizeof(unsigned char), packedSize, file);
+        if (!rle_decode(packed, read, img->data, img->width, img->height,
+                        BMP8_ROW_SIZE(img->width), compression)) {
+            printf("Warning: Compressed data ended early, missing pixels are set to 0.\n");
+        }
+        free(packed);
+    }
+
+    // The image now lives in memory as uncompressed 8-bit data
+    img->compression = compression;
+    img->colorDepth = 8;
+    bmp8_setHeader(img);
+
+    fclose(file);
+    dirty_sync(&img->dirty, filename);
+    return img;
+}
+
+
+/**
+ * bmp8_loadImageScaled
+ * Loads an 8-bit BMP image downsampled by an integer factor while reading it.
+ * File rows are read one at a time and summed into a single accumulator row; every
+ * scale rows, the averages of scale x scale blocks are written to the output image.
+ * The full-resolution image is never held in memory. Averaging assumes a grayscale palette.
+ *
+ * Parameters:
+ * filename (const char*): Path to the BMP file.
+ * scale (int): Reduction factor (1, 2, 4 or 8). Partial blocks on the edges are averaged too.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the downsampled image, or NULL on failure (including a truncated file).
+ */
+t_bmp8 *bmp8_loadImageScaled(const char *filename, int scale) {
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+        printf("Error: Scale must be 1, 2, 4 or 8.\n");
+        return NULL;
+    }
+    if (scale == 1) return bmp8_loadImage(filename);
+
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        printf("Error opening file.\n");
+        return NULL;
+    }
+
+    unsigned char header[54];
+    if (fread(header, sizeof(unsigned char), 54, file) != 54 || *(unsigned short *)&header[28] != 8) {
+        printf("Error: The image is not 8-bit grayscale.\n");
+        fclose(file);
+        return NULL;
+    }
+    if (*(unsigned int *)&header[30] != BI_RGB) {
+        printf("Error: Scaled loading needs an uncompressed image.\n");
+        fclose(file);
+        return NULL;
+    }
+
+    unsigned int factor = (unsigned int)scale;
+    unsigned int width = *(unsigned int *)&header[18];
+    unsigned int height = *(unsigned int *)&header[22];
+    unsigned int offset = *(unsigned int *)&header[10];
+    unsigned int infoSize = *(unsigned int *)&header[14];
+    unsigned int colors = *(unsigned int *)&header[46];
+    unsigned int outWidth = (width + factor - 1) / factor;
+    unsigned int outHeight = (height + factor - 1) / factor;
+    unsigned int rowSize = BMP8_ROW_SIZE(width);
+
+    // The color table follows the info header, whatever its version, and may be short
+    unsigned char colorTable[1024] = {0};
+    if (colors == 0 || colors > 256) colors = 256;
+    fseek(file, 14 + infoSize, SEEK_SET);
+    if (fread(colorTable, sizeof(unsigned char), colors * 4, file) != colors * 4) {
+        printf("Error: Unexpected end of file.\n");
+        fclose(file);
+        return NULL;
+    }
+    bmp8_fillPalette(colorTable, colors);
+
+    t_bmp8 *img = bmp8_allocate(outWidth, outHeight);
+    unsigned char *row = (unsigned char *)malloc(rowSize);
+    unsigned int *acc = (unsigned int *)calloc(outWidth, sizeof(unsigned int));
+    if (!img || !row || !acc) {
+        printf("Error: Unable to allocate memory for scaled image.\n");
+        bmp8_free(img);
+        free(row);
+        free(acc);
+        fclose(file);
+        return NULL;
+    }
+    memcpy(img->colorTable, colorTable, sizeof(colorTable));
+
+    // Blocks are aligned on the top of the image, like bmp24_loadImageScaled
+    fseek(file, offset, SEEK_SET);
+    unsigned int rowsInBlock = 0;
+    unsigned int outStride = BMP8_ROW_SIZE(outWidth);
+    for (unsigned int i = 0; i < height; i++) {
+        if (fread(row, 1, rowSize, file) != rowSize) {
+            printf("Error: Unexpected end of file.\n");
+            bmp8_free(img);
+            img = NULL;
+            break;
+        }
+
+        for (unsigned int x = 0; x < width; x++) {
+            acc[x / factor] += row[x];
+        }
+        rowsInBlock++;
+
+        // File row i is image row height - 1 - i, flush at the top of each block
+        unsigned int y = height - 1 - i;
+        if (y % factor == 0) {
+            unsigned char *out = img->data + (size_t)(outHeight - 1 - y / factor) * outStride;
+            for (unsigned int ox = 0; ox < outWidth; ox++) {
+                unsigned int columns = (ox + 1) * factor <= width ? factor : width - ox * factor;
+                unsigned int count = columns * rowsInBlock;
+                out[ox] = (unsigned char)((acc[ox] + count / 2) / count);
+            }
+            memset(acc, 0, outWidth * sizeof(unsigned int));
+            rowsInBlock = 0;
+        }
+    }
 
+    free(row);
+    free(acc);
     fclose(file);
     return img;
 }
 
 
+/**
+ * bmp8_allocate
+ * Allocates a blank 8-bit image with a complete BMP header and a grayscale palette,
+ * so that it can be saved directly with bmp8_saveImage.
+ *
+ * Parameters:
+ * width (unsigned int): Image width in pixels.
+ * height (unsigned int): Image height in pixels.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image (pixels set to 0), or NULL on failure.
+ */
+t_bmp8 *bmp8_allocate(unsigned int width, unsigned int height) {
+    t_bmp8 *img = (t_bmp8 *)calloc(1, sizeof(t_bmp8));
+    if (!img) {
+        printf("Error: Unable to allocate memory for image.\n");
+        return NULL;
+    }
+
+    img->width = width;
+    img->height = height;
+    img->colorDepth = 8;
+    img->dataSize = BMP8_ROW_SIZE(width) * height;
+
+    img->data = (unsigned char *)calloc(img->dataSize, sizeof(unsigned char));
+    if (!img->data) {
+        printf("Error: Unable to allocate memory for pixel data.\n");
+        free(img);
+        return NULL;
+    }
+
+    dirty_init(&img->dirty, height);
+    bmp8_setHeader(img);
+    *(unsigned int *)&img->header[38] = 2835;
+    *(unsigned int *)&img->header[42] = 2835;
+
+    // Grayscale palette: entry i is (i, i, i)
+    for (int i = 0; i < 256; i++) {
+        img->colorTable[i * 4] = (unsigned char)i;
+        img->colorTable[i * 4 + 1] = (unsigned char)i;
+        img->colorTable[i * 4 + 2] = (unsigned char)i;
+        img->colorTable[i * 4 + 3] = 0;
+    }
+
+    return img;
+}
+
+
+/**
+ * bmp8_fitsRle4
+ * Checks that every pixel value is below 16, as BI_RLE4 requires.
+ */
+static int bmp8_fitsRle4(const t_bmp8 *img) {
+    unsigned int stride = BMP8_ROW_SIZE(img->width);
+    for (unsigned int y = 0; y < img->height; y++) {
+        const unsigned char *row = img->data + (size_t)y * stride;
+        for (unsigned int x = 0; x < img->width; x++) {
+            if (row[x] > 0x0F) return 0;
+        }
+    }
+    return 1;
+}
+
+
 /**
  * bmp8_saveImage
- * Saves an 8-bit BMP image to a file.
+ * Saves an 8-bit BMP image to a file, compressed like the file it was loaded from.
+ * A BI_RLE4 image whose values no longer fit in 4 bits is written as BI_RLE8.
  *
  * Parameters:
  * filename (const char*): Destination file path.
  * img (t_bmp8*): Pointer to the image to save.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the file cannot be opened or written.
+ */
+int bmp8_saveImage(const char *filename, t_bmp8 *img) {
+    if (img->compression == BI_RLE8 || img->compression == BI_RLE4) {
+        int rle4 = img->compression == BI_RLE4 && bmp8_fitsRle4(img);
+        return bmp8_saveImageCompressed(filename, img, rle4 ? BI_RLE4 : BI_RLE8);
+    }
+    return bmp8_saveImageCompressed(filename, img, BI_RGB);
+}
+
+
+/**
+ * bmp8_saveUncompressed
+ * Writes the header, the palette and the pixel rows as they are held in memory.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the file cannot be opened or written.
  */
-void bmp8_saveImage(const char *filename, t_bmp8 *img) {
+static int bmp8_saveUncompressed(const char *filename, t_bmp8 *img) {
     FILE *file = fopen(filename, "wb");
     if (!file) {
         printf("Error opening file for writing.\n");
-        return;
+        return -1;
+    }
+
+    int ok = fwrite(img->header, sizeof(unsigned char), 54, file) == 54 &&
+             fwrite(img->colorTable, sizeof(unsigned char), 1024, file) == 1024 &&
+             fwrite(img->data, sizeof(unsigned char), img->dataSize, file) == img->dataSize;
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) {
+        printf("Error writing file %s.\n", filename);
+        return -1;
     }
+    dirty_sync(&img->dirty, filename);
+    return 0;
+}
 
-    fwrite(img->header, sizeof(unsigned char), 54, file);
-    fwrite(img->colorTable, sizeof(unsigned char), 1024, file);
-    fwrite(img->data, sizeof(unsigned char), img->dataSize, file);
 
-    fclose(file);
+/**
+ * bmp8_saveImageIncremental
+ * Saves an 8-bit BMP image, rewriting only the modified rows when the target is the file
+ * the image was loaded from or last saved to, unchanged since, with the same header and
+ * palette. Runs of modified rows are written in place with pwrite. Otherwise the whole
+ * file is written like bmp8_saveImage.
+ *
+ * Parameters:
+ * filename (const char*): Destination file path.
+ * img (t_bmp8*): Pointer to the image to save.
+ *
+ * Returns:
+ * int: 1 if the file was updated in place, 0 if it was fully rewritten, -1 if it could
+ *     not be written.
+ */
+int bmp8_saveImageIncremental(const char *filename, t_bmp8 *img) {
+    if (!img || !img->data) return -1;
+
+    // A compressed file cannot be patched row by row
+    int fd = img->compression == BI_RGB && dirty_isSynced(&img->dirty, filename) ? open(filename, O_RDWR) : -1;
+    if (fd >= 0) {
+        unsigned char onDisk[54 + 1024];
+        int same = pread(fd, onDisk, sizeof(onDisk), 0) == (ssize_t)sizeof(onDisk) &&
+                   memcmp(onDisk, img->header, 54) == 0 &&
+                   memcmp(onDisk + 54, img->colorTable, 1024) == 0;
+
+        // Rows are stored in file order, so each run of modified rows is one contiguous write
+        unsigned int stride = BMP8_ROW_SIZE(img->width);
+        off_t offset = *(unsigned int *)&img->header[10];
+        for (int y = 0; same && y < (int)img->height; y++) {
+            if (!img->dirty.rows[y]) continue;
+            int end = y;
+            while (end < (int)img->height && img->dirty.rows[end]) end++;
+
+            size_t bytes = (size_t)(end - y) * stride;
+            if (pwrite(fd, img->data + (size_t)y * stride, bytes, offset + (off_t)y * stride) != (ssize_t)bytes) {
+                printf("Error writing rows in place, rewriting the whole file.\n");
+                same = 0;
+            }
+            y = end;
+        }
+        close(fd);
+
+        if (same) {
+            dirty_sync(&img->dirty, filename);
+            return 1;
+        }
+    }
+
+    return bmp8_saveImage(filename, img);
+}
+
+
+/**
+ * bmp8_saveImageCompressed
+ * Saves an 8-bit BMP image to a file with RLE compression. BI_RLE4 writes a 4-bit file
+ * with a 16-entry palette and requires every pixel value to be below 16.
+ *
+ * Parameters:
+ * filename (const char*): Destination file path.
+ * img (t_bmp8*): Pointer to the image to save.
+ * compression (unsigned int): BI_RLE8, BI_RLE4, or BI_RGB for an uncompressed file.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int bmp8_saveImageCompressed(const char *filename, t_bmp8 *img, unsigned int compression) {
+    if (!img || !img->data) return -1;
+    if (compression == BI_RGB) return bmp8_saveUncompressed(filename, img);
+    if (compression != BI_RLE8 && compression != BI_RLE4) {
+        printf("Error: Unsupported compression method.\n");
+        return -1;
+    }
+
+    size_t packedSize;
+    unsigned char *packed = rle_encode(img->data, img->width, img->height,
+                                       BMP8_ROW_SIZE(img->width), compression, &packedSize);
+    if (!packed) return -1;
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        printf("Error opening file for writing.\n");
+        free(packed);
+        return -1;
+    }
+
+    unsigned int colors = compression == BI_RLE4 ? 16 : 256;
+    unsigned char header[54];
+    memcpy(header, img->header, sizeof(header));
+    *(unsigned int *)&header[2] = 54 + colors * 4 + (unsigned int)packedSize;
+    *(unsigned int *)&header[10] = 54 + colors * 4;
+    *(unsigned short *)&header[28] = compression == BI_RLE4 ? 4 : 8;
+    *(unsigned int *)&header[30] = compression;
+    *(unsigned int *)&header[34] = (unsigned int)packedSize;
+    *(unsigned int *)&header[46] = colors;
+
+    int ok = fwrite(header, sizeof(unsigned char), 54, file) == 54 &&
+             fwrite(img->colorTable, sizeof(unsigned char), colors * 4, file) == colors * 4 &&
+             fwrite(packed, sizeof(unsigned char), packedSize, file) == packedSize;
+    free(packed);
+    if (fclose(file) != 0) ok = 0;
+
+    // A compressed file cannot be patched row by row
+    img->dirty.synced = 0;
+    if (!ok) {
+        printf("Error writing file %s.\n", filename);
+        return -1;
+    }
+    return 0;
 }
 
 
@@ -97,6 +517,7 @@ void bmp8_saveImage(const char *filename, t_bmp8 *img) {
 void bmp8_free(t_bmp8 *img) {
     if (img) {
         free(img->data);
+        dirty_free(&img->dirty);
         free(img);
     }
 }
@@ -130,9 +551,13 @@ void bmp8_printInfo(t_bmp8 *img) {
 void bmp8_negative(t_bmp8 *img) {
     if (!img || !img->data) return;
 
-    for (unsigned int i = 0; i < img->dataSize; i++) {
-        img->data[i] = 255 - img->data[i];
-    }
+    unsigned long version = img->dirty.version;
+    t_view view = bmp8_view(img);
+    view_negative(&view);
+
+    unsigned char lut[256];
+    for (int v = 0; v < 256; v++) lut[v] = (unsigned char)(255 - v);
+    bmp8_histogramRemap(img, lut, version);
 }
 
 
@@ -147,14 +572,13 @@ void bmp8_negative(t_bmp8 *img) {
 void bmp8_brightness(t_bmp8 *img, int value) {
     if (!img || !img->data) return;
 
-    for (unsigned int i = 0; i < img->dataSize; ++i) {
-        int newVal = img->data[i] + value;
-
-        if (newVal > 255) newVal = 255;
-        else if (newVal < 0) newVal = 0;
+    unsigned long version = img->dirty.version;
+    t_view view = bmp8_view(img);
+    view_brightness(&view, value);
 
-        img->data[i] = (unsigned char)newVal;
-    }
+    unsigned char lut[256];
+    for (int v = 0; v < 256; v++) lut[v] = (unsigned char)clamp(v + value);
+    bmp8_histogramRemap(img, lut, version);
 }
 
 
@@ -169,9 +593,13 @@ void bmp8_brightness(t_bmp8 *img, int value) {
 void bmp8_threshold(t_bmp8 *img, int threshold) {
     if (!img || !img->data) return;
 
-    for (unsigned int i = 0; i < img->dataSize; ++i) {
-        img->data[i] = (img->data[i] >= threshold) ? 255 : 0;
-    }
+    unsigned long version = img->dirty.version;
+    t_view view = bmp8_view(img);
+    view_threshold(&view, threshold);
+
+    unsigned char lut[256];
+    for (int v = 0; v < 256; v++) lut[v] = v >= threshold ? 255 : 0;
+    bmp8_histogramRemap(img, lut, version);
 }
 
 
@@ -184,34 +612,15 @@ void bmp8_threshold(t_bmp8 *img, int threshold) {
  * kernel (float**): 3x3 convolution kernel.
  */
 void bmp8_applyFilter(t_bmp8 *img, float **kernel) {
-    int n = 1;
-    unsigned char *tempData = (unsigned char *)malloc(img->dataSize);
-    int width = img->width;
-    int height = img->height;
-
-    for (int y = n; y < height - n; y++) {
-        for (int x = n; x < width - n; x++) {
-            float sum = 0.0;
-
-            for (int ky = -n; ky <= n; ky++) {
-                for (int kx = -n; kx <= n; kx++) {
-                    unsigned char pixel = img->data[(y + ky) * width + (x + kx)];
-                    sum += pixel * kernel[ky + n][kx + n];
-                }
-            }
-
-            if (sum < 0) sum = 0;
-            if (sum > 255) sum = 255;
-            tempData[y * width + x] = (unsigned char)sum;
+    // Kernel rows follow the stored (bottom-up) row order, as view_convolve does on gray views
+    float flat[9];
+    for (int ky = 0; ky < 3; ky++) {
+        for (int kx = 0; kx < 3; kx++) {
+            flat[ky * 3 + kx] = kernel[ky][kx];
         }
     }
 
-    for (int y = n; y < height - n; y++) {
-        for (int x = n; x < width - n; x++) {
-            img->data[y * width + x] = tempData[y * width + x];
-        }
-    }
-
-    free(tempData);
+    t_view view = bmp8_view(img);
+    view_convolve(&view, flat, 3);
     free_kernel(kernel);
-}
\ No newline at end of file
+}
@@ -16,6 +16,22 @@
 #define BMP8_H
 
 #include "utils.h"
+#include "dirty.h"
+
+/**
+ * t_histogram_cache
+ * Histogram of an 8-bit image, kept between operations.
+ *
+ * Members:
+ * counts (unsigned int[256]): Number of pixels of each value.
+ * version (unsigned long): Version of the modified-row tracker the counts correspond to.
+ * valid (int): 1 once the counts have been computed.
+ */
+typedef struct {
+    unsigned int counts[256];
+    unsigned long version;
+    int valid;
+} t_histogram_cache;
 
 /**
  * t_bmp8
@@ -29,6 +45,10 @@
  * height (unsigned int): Image height in pixels.
  * colorDepth (unsigned int): Bits per pixel (should be 8).
  * dataSize (unsigned int): Size of the pixel data in bytes.
+ * compression (unsigned int): Compression of the file the image was loaded from (BI_RGB,
+ *     BI_RLE8 or BI_RLE4), used again by bmp8_saveImage.
+ * dirty (t_dirty_rows): Rows modified since the last load or save, in stored (bottom-up) order.
+ * histogram (t_histogram_cache): Histogram of the pixels, current while its version matches dirty.
  */
 typedef struct {
     unsigned char header[54];
@@ -38,11 +58,20 @@ typedef struct {
     unsigned int height;
     unsigned int colorDepth;
     unsigned int dataSize;
+    unsigned int compression;
+    t_dirty_rows dirty;
+    t_histogram_cache histogram;
 } t_bmp8;
 
+// Size in bytes of one stored row: BMP rows are padded to a multiple of 4 bytes
+#define BMP8_ROW_SIZE(width) (((width) + 3) / 4 * 4)
+
 /**
  * bmp8_loadImage
- * Loads an 8-bit BMP image from a file.
+ * Loads an 8-bit BMP image from a file. Uncompressed 8-bit files, BI_RLE8 files and
+ * 4-bit BI_RLE4 files are accepted; compressed data is decoded on load, so the image
+ * is always held uncompressed in memory with 8 bits per pixel. The compression is
+ * remembered, so that bmp8_saveImage writes the file back in the same format.
  *
  * Parameters:
  * filename (const char*): Path to the BMP file.
@@ -52,15 +81,81 @@ typedef struct {
  */
 t_bmp8 * bmp8_loadImage(const char *filename);
 
+/**
+ * bmp8_loadImageScaled
+ * Loads an 8-bit BMP image downsampled by an integer factor while reading it.
+ * File rows are read one at a time and summed into a single accumulator row; every
+ * scale rows, the averages of scale x scale blocks are written to the output image.
+ * The full-resolution image is never held in memory. Averaging assumes a grayscale palette.
+ *
+ * Parameters:
+ * filename (const char*): Path to the BMP file.
+ * scale (int): Reduction factor (1, 2, 4 or 8). Partial blocks on the edges are averaged too.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the downsampled image, or NULL on failure (including a truncated file).
+ */
+t_bmp8 * bmp8_loadImageScaled(const char *filename, int scale);
+
+/**
+ * bmp8_allocate
+ * Allocates a blank 8-bit image with a complete BMP header and a grayscale palette,
+ * so that it can be saved directly with bmp8_saveImage.
+ *
+ * Parameters:
+ * width (unsigned int): Image width in pixels.
+ * height (unsigned int): Image height in pixels.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image (pixels set to 0), or NULL on failure.
+ */
+t_bmp8 * bmp8_allocate(unsigned int width, unsigned int height);
+
 /**
  * bmp8_saveImage
- * Saves an 8-bit BMP image to a file.
+ * Saves an 8-bit BMP image to a file, compressed like the file it was loaded from.
+ * A BI_RLE4 image whose values no longer fit in 4 bits is written as BI_RLE8.
+ *
+ * Parameters:
+ * filename (const char*): Destination file path.
+ * img (t_bmp8*): Pointer to the image to save.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the file cannot be opened or written.
+ */
+int bmp8_saveImage(const char *filename, t_bmp8 *img);
+
+/**
+ * bmp8_saveImageIncremental
+ * Saves an 8-bit BMP image, rewriting only the modified rows when the target is the file
+ * the image was loaded from or last saved to, unchanged since, with the same header and
+ * palette. Runs of modified rows are written in place with pwrite. Otherwise the whole
+ * file is written like bmp8_saveImage.
  *
  * Parameters:
  * filename (const char*): Destination file path.
  * img (t_bmp8*): Pointer to the image to save.
+ *
+ * Returns:
+ * int: 1 if the file was updated in place, 0 if it was fully rewritten, -1 if it could
+ *     not be written.
+ */
+int bmp8_saveImageIncremental(const char *filename, t_bmp8 *img);
+
+/**
+ * bmp8_saveImageCompressed
+ * Saves an 8-bit BMP image to a file with RLE compression. BI_RLE4 writes a 4-bit file
+ * with a 16-entry palette and requires every pixel value to be below 16.
+ *
+ * Parameters:
+ * filename (const char*): Destination file path.
+ * img (t_bmp8*): Pointer to the image to save.
+ * compression (unsigned int): BI_RLE8, BI_RLE4, or BI_RGB for an uncompressed file.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
  */
-void bmp8_saveImage(const char *filename, t_bmp8 *img);
+int bmp8_saveImageCompressed(const char *filename, t_bmp8 *img, unsigned int compression);
 
 /**
  * bmp8_free
@@ -0,0 +1,402 @@
+/**
+ * bmpstream.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements sequential BMP input and output on file descriptors. Input goes through a
+ * read-ahead buffer, so that narrow rows do not cost one system call each; the headers
+ * are read in two steps (the fixed part, then up to the pixel data offset it gives) and
+ * validated by probe_header. Output rows are encoded into a buffer flushed when full.
+ * The output keeps the headers of the input byte for byte: the operations change
+ * neither the size nor the layout of the pixels.
+ *
+ * Role in the project:
+ * Lets the program be used as a filter between other programs:
+ * cat in.bmp | image_processing stream --op negative | ...
+ */
+
+
+#include <errno.h>
+#include <unistd.h>
+#include "bmpstream.h"
+
+// Size of the read-ahead and write buffers
+#define BMPSTREAM_BUFFER (64 * 1024)
+
+// Largest accepted offset of the pixel data (headers, masks, palette and gaps)
+#define BMPSTREAM_MAX_HEADER (16 * 1024 * 1024)
+
+/**
+ * t_stream_writer
+ * Output side of bmpstream_process, given to the row stream as its sink.
+ */
+typedef struct {
+    int fd;
+    const t_bmp_stream *input;
+    unsigned char *buffer;
+    size_t used;
+    int failed;
+} t_stream_writer;
+
+
+/**
+ * bmpstream_u32
+ * Reads a little-endian 32-bit value.
+ */
+static uint32_t bmpstream_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+
+/**
+ * bmpstream_read
+ * Reads exactly size bytes from the stream.
+ *
+ * Returns:
+ * int: 0 on success, -1 on a read error or an early end of the stream.
+ */
+static int bmpstream_read(t_bmp_stream *stream, unsigned char *data, size_t size) {
+    while (size > 0) {
+        if (stream->start == stream->end) {
+            ssize_t n = read(stream->fd, stream->buffer, BMPSTREAM_BUFFER);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return -1;
+            stream->start = 0;
+            stream->end = (size_t)n;
+        }
+        size_t chunk = stream->end - stream->start;
+        if (chunk > size) chunk = size;
+        memcpy(data, stream->buffer + stream->start, chunk);
+        stream->start += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return 0;
+}
+
+
+/**
+ * bmpstream_writeAll
+ * Writes size bytes to a descriptor.
+ *
+ * Returns:
+ * int: 0 on success, -1 on a write error.
+ */
+static int bmpstream_writeAll(int fd, const unsigned char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+
+/**
+ * bmpstream_open
+ * Reads the headers of a BMP file from a descriptor, up to the first pixel.
+ *
+ * Parameters:
+ * fd (int): Descriptor to read from (not closed by the stream).
+ * stream (t_bmp_stream*): Receives the stream.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the headers are invalid, unsupported or truncated.
+ */
+int bmpstream_open(int fd, t_bmp_stream *stream) {
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = fd;
+    stream->buffer = malloc(BMPSTREAM_BUFFER);
+    if (!stream->buffer) {
+        fprintf(stderr, "Error: Unable to allocate memory for the input stream.\n");
+        return -1;
+    }
+
+    // File header and the size of the info header, then as much of it as the probe reads
+    unsigned char h[54];
+    if (bmpstream_read(stream, h, 18) != 0) {
+        fprintf(stderr, "Error: Input stream: truncated header.\n");
+        bmpstream_close(stream);
+        return -1;
+    }
+    uint32_t infoSize = bmpstream_u32(h + 14);
+    size_t fixed = infoSize == 12 ? 26 : sizeof(h);
+    if (infoSize < 12 || bmpstream_read(stream, h + 18, fixed - 18) != 0 ||
+        !probe_header(h, fixed, 0, &stream->probe)) {
+        fprintf(stderr, "Error: Input stream: %s.\n", stream->probe.error ? stream->probe.error : "truncated header");
+        bmpstream_close(stream);
+        return -1;
+    }
+
+    const t_bmp_probe *probe = &stream->probe;
+    int standard = probe->compression == BI_RGB;
+    if (probe->depth == 32 && probe->compression == BI_BITFIELDS && infoSize >= 56 && probe->offset >= 70) {
+        // Masks follow the 40 bytes of the info header; BGRA is the layout of t_pixel
+        standard = 1;
+    }
+    if ((probe->depth != 8 && probe->depth != 24 && probe->depth != 32) || !standard) {
+        fprintf(stderr, "Error: Input stream: only uncompressed 8, 24 and 32-bit BMP files can be streamed.\n");
+        bmpstream_close(stream);
+        return -1;
+    }
+    if (probe->offset > BMPSTREAM_MAX_HEADER) {
+        fprintf(stderr, "Error: Input stream: invalid data offset.\n");
+        bmpstream_close(stream);
+        return -1;
+    }
+
+    stream->headerSize = probe->offset;
+    stream->header = malloc(stream->headerSize);
+    if (!stream->header) {
+        fprintf(stderr, "Error: Unable to allocate memory for the input headers.\n");
+        bmpstream_close(stream);
+        return -1;
+    }
+    memcpy(stream->header, h, fixed);
+    if (bmpstream_read(stream, stream->header + fixed, stream->headerSize - fixed) != 0) {
+        fprintf(stderr, "Error: Input stream: truncated header.\n");
+        bmpstream_close(stream);
+        return -1;
+    }
+    if (probe->compression == BI_BITFIELDS &&
+        (bmpstream_u32(stream->header + 54) != 0x00FF0000 || bmpstream_u32(stream->header + 58) != 0x0000FF00 ||
+         bmpstream_u32(stream->header + 62) != 0x000000FF || bmpstream_u32(stream->header + 66) != 0xFF000000)) {
+        fprintf(stderr, "Error: Input stream: only BGRA channel masks can be streamed.\n");
+        bmpstream_close(stream);
+        return -1;
+    }
+
+    stream->width = probe->width;
+    stream->height = probe->height < 0 ? -probe->height : probe->height;
+    stream->bottomUp = probe->height > 0;
+    stream->format = probe->depth == 8 ? VIEW_GRAY8 : VIEW_BGRA32;
+    stream->rowSize = ((size_t)stream->width * probe->depth + 31) / 32 * 4;
+    return 0;
+}
+
+
+/**
+ * bmpstream_readRow
+ * Reads the next row of the file, in file order, and decodes it.
+ *
+ * Parameters:
+ * stream (t_bmp_stream*): Stream opened by bmpstream_open.
+ * row (unsigned char*): Receives width bytes (VIEW_GRAY8) or width t_pixel values.
+ *
+ * Returns:
+ * int: 0 on success, -1 on a read error or an early end of the stream.
+ */
+int bmpstream_readRow(t_bmp_stream *stream, unsigned char *row) {
+    int width = stream->width;
+    size_t pixelBytes = (size_t)width * stream->probe.depth / 8;
+    size_t padding = stream->rowSize - pixelBytes;
+
+    if (stream->probe.depth != 24) {
+        // Gray indices and BGRA pixels are stored as they are decoded
+        if (bmpstream_read(stream, row, pixelBytes) != 0) return -1;
+    } else {
+        // Decode in place from the end, where the 3-byte pixels do not overlap the 4-byte ones
+        unsigned char *packed = row + (size_t)width * sizeof(t_pixel) - pixelBytes;
+        if (bmpstream_read(stream, packed, pixelBytes) != 0) return -1;
+        t_pixel *pixels = (t_pixel *)row;
+        for (int x = 0; x < width; x++) {
+            t_pixel px = {packed[3 * x], packed[3 * x + 1], packed[3 * x + 2], 255};
+            pixels[x] = px;
+        }
+    }
+
+    unsigned char skip[4];
+    return bmpstream_read(stream, skip, padding);
+}
+
+
+/**
+ * bmpstream_close
+ * Frees the buffers of a stream. The descriptor is left open.
+ *
+ * Parameters:
+ * stream (t_bmp_stream*): Stream to close.
+ */
+void bmpstream_close(t_bmp_stream *stream) {
+    free(stream->header);
+    free(stream->buffer);
+    stream->header = NULL;
+    stream->buffer = NULL;
+}
+
+
+/**
+ * bmpstream_flush
+ * Writes the buffered output.
+ */
+static int bmpstream_flush(t_stream_writer *writer) {
+    if (writer->used && bmpstream_writeAll(writer->fd, writer->buffer, writer->used) != 0) {
+        writer->failed = 1;
+        return -1;
+    }
+    writer->used = 0;
+    return 0;
+}
+
+
+/**
+ * bmpstream_writeRow
+ * Row sink of bmpstream_process: encodes a processed row in the layout of the input.
+ */
+static int bmpstream_writeRow(void *context, const unsigned char *row) {
+    t_stream_writer *writer = context;
+    const t_bmp_stream *input = writer->input;
+    int width = input->width;
+
+    if (writer->used + input->rowSize > BMPSTREAM_BUFFER && bmpstream_flush(writer) != 0) return -1;
+
+    // A row larger than the buffer is written on its own
+    unsigned char *dst = input->rowSize > BMPSTREAM_BUFFER ? NULL : writer->buffer + writer->used;
+    unsigned char *own = dst ? NULL : malloc(input->rowSize);
+    if (!dst && !own) {
+        fprintf(stderr, "Error: Unable to allocate memory for an output row.\n");
+        writer->failed = 1;
+        return -1;
+    }
+    if (!dst) dst = own;
+
+    size_t pixelBytes = (size_t)width * input->probe.depth / 8;
+    if (input->probe.depth != 24) {
+        memcpy(dst, row, pixelBytes);
+    } else {
+        const t_pixel *pixels = (const t_pixel *)row;
+        for (int x = 0; x < width; x++) {
+            dst[3 * x] = pixels[x].blue;
+            dst[3 * x + 1] = pixels[x].green;
+            dst[3 * x + 2] = pixels[x].red;
+        }
+    }
+    memset(dst + pixelBytes, 0, input->rowSize - pixelBytes);
+
+    if (own) {
+        int result = bmpstream_writeAll(writer->fd, own, input->rowSize);
+        free(own);
+        if (result != 0) writer->failed = 1;
+        return result;
+    }
+    writer->used += input->rowSize;
+    return 0;
+}
+
+
+/**
+ * bmpstream_readView
+ * Reads every row of the file into a view of the image size, each row at its place in
+ * the image (the last file row first for a bottom-up file).
+ *
+ * Parameters:
+ * stream (t_bmp_stream*): Stream opened by bmpstream_open, before its first row.
+ * view (const t_view*): Pixels to fill, of the size and format of the stream.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the view does not match or the pixel data is truncated.
+ */
+int bmpstream_readView(t_bmp_stream *stream, const t_view *view) {
+    if (view->width != stream->width || view->height != stream->height || view->format != stream->format) {
+        fprintf(stderr, "Error: Input stream: the image does not match the destination.\n");
+        return -1;
+    }
+    for (int i = 0; i < stream->height; i++) {
+        int y = stream->bottomUp ? stream->height - 1 - i : i;
+        if (bmpstream_readRow(stream, view_row(view, y)) != 0) {
+            fprintf(stderr, "Error: Input stream: truncated pixel data (row %d of %d).\n", i, stream->height);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * bmpstream_writeView
+ * Writes the pixels of a view as a BMP file with the headers and layout of an input
+ * stream: same header bytes, depth and row order.
+ *
+ * Parameters:
+ * fd (int): Descriptor to write to.
+ * input (const t_bmp_stream*): Stream the image was read from.
+ * view (const t_view*): Pixels to write, of the size and format of the stream.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the view does not match or on a write error.
+ */
+int bmpstream_writeView(int fd, const t_bmp_stream *input, const t_view *view) {
+    if (view->width != input->width || view->height != input->height || view->format != input->format) {
+        fprintf(stderr, "Error: Output stream: the image does not match the source headers.\n");
+        return -1;
+    }
+    t_stream_writer writer = {fd, input, malloc(BMPSTREAM_BUFFER), 0, 0};
+    if (!writer.buffer) {
+        fprintf(stderr, "Error: Unable to allocate memory for the stream.\n");
+        return -1;
+    }
+
+    int ok = bmpstream_writeAll(fd, input->header, input->headerSize) == 0;
+    for (int i = 0; ok && i < input->height; i++) {
+        int y = input->bottomUp ? input->height - 1 - i : i;
+        ok = bmpstream_writeRow(&writer, view_row(view, y)) == 0;
+    }
+    if (ok) ok = bmpstream_flush(&writer) == 0;
+    if (!ok) fprintf(stderr, "Error: Unable to write the output stream.\n");
+    free(writer.buffer);
+    return ok ? 0 : -1;
+}
+
+
+/**
+ * bmpstream_process
+ * Reads a BMP file from one descriptor, runs a pipeline on it row by row and writes the
+ * result, with the headers of the input, to another descriptor.
+ *
+ * Parameters:
+ * in (int): Descriptor of the input file (for instance 0).
+ * out (int): Descriptor of the output file (for instance 1).
+ * pipeline (const t_pipeline*): Operations to run (may be empty).
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int bmpstream_process(int in, int out, const t_pipeline *pipeline) {
+    t_bmp_stream input;
+    if (bmpstream_open(in, &input) != 0) return -1;
+
+    t_stream_writer writer = {out, &input, malloc(BMPSTREAM_BUFFER), 0, 0};
+    unsigned char *row = malloc((size_t)input.width * (input.format == VIEW_GRAY8 ? 1 : sizeof(t_pixel)));
+    t_row_stream *stream = writer.buffer && row ? pipeline_streamCreate(pipeline, input.format, input.width,
+                                                                        input.height, input.bottomUp,
+                                                                        bmpstream_writeRow, &writer)
+                                                : NULL;
+    int ok = stream != NULL;
+    if (!ok && (!writer.buffer || !row)) fprintf(stderr, "Error: Unable to allocate memory for the stream.\n");
+
+    if (ok && bmpstream_writeAll(out, input.header, input.headerSize) != 0) {
+        fprintf(stderr, "Error: Unable to write the output stream.\n");
+        ok = 0;
+    }
+    for (int y = 0; ok && y < input.height; y++) {
+        if (bmpstream_readRow(&input, row) != 0) {
+            fprintf(stderr, "Error: Input stream: truncated pixel data (row %d of %d).\n", y, input.height);
+            ok = 0;
+        } else if (pipeline_streamPush(stream, row) != 0) {
+            fprintf(stderr, "Error: Unable to write the output stream.\n");
+            ok = 0;
+        }
+    }
+    if (ok && bmpstream_flush(&writer) != 0) {
+        fprintf(stderr, "Error: Unable to write the output stream.\n");
+        ok = 0;
+    }
+
+    pipeline_streamFree(stream);
+    free(row);
+    free(writer.buffer);
+    bmpstream_close(&input);
+    return ok ? 0 : -1;
+}
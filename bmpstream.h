@@ -0,0 +1,137 @@
+/**
+ * bmpstream.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring sequential BMP input and output on file descriptors. Unlike
+ * bmp8_loadImage and bmp24_loadImage, which seek to each header field and to the pixel
+ * data, a stream reads every byte once, in order, and never seeks: it works on pipes,
+ * sockets and terminals as well as on files. Rows are read, processed and written one
+ * at a time, so an image of any height goes through in constant memory and the first
+ * rows come out before the last ones are read.
+ *
+ * Supported files: 8-bit (the palette indices are processed, like bmp8), 24-bit, and
+ * 32-bit BGRA (BI_RGB, or BI_BITFIELDS with the standard masks), uncompressed.
+ *
+ * Role in the project:
+ * Lets the program be used as a filter between other programs:
+ * cat in.bmp | image_processing stream --op negative | ...
+ */
+
+#ifndef BMPSTREAM_H
+#define BMPSTREAM_H
+
+#include "pipeline.h"
+#include "probe.h"
+
+/**
+ * t_bmp_stream
+ * BMP file being read from a descriptor.
+ *
+ * Members:
+ * fd (int): Descriptor read from.
+ * probe (t_bmp_probe): Metadata from the headers.
+ * width, height (int): Image size in pixels (height is positive).
+ * bottomUp (int): Non-zero if the first row of the file is the bottom of the image.
+ * format (t_view_format): Layout of the decoded rows (VIEW_GRAY8 or VIEW_BGRA32).
+ * rowSize (size_t): Bytes per row in the file, padding included.
+ * header (unsigned char*): Every byte before the pixel data (headers, masks, palette).
+ * headerSize (size_t): Number of bytes in header.
+ * buffer (unsigned char*): Bytes read ahead from the descriptor.
+ * start, end (size_t): Unconsumed part of the buffer.
+ */
+typedef struct {
+    int fd;
+    t_bmp_probe probe;
+    int width;
+    int height;
+    int bottomUp;
+    t_view_format format;
+    size_t rowSize;
+    unsigned char *header;
+    size_t headerSize;
+    unsigned char *buffer;
+    size_t start;
+    size_t end;
+} t_bmp_stream;
+
+/**
+ * bmpstream_open
+ * Reads the headers of a BMP file from a descriptor, up to the first pixel.
+ *
+ * Parameters:
+ * fd (int): Descriptor to read from (not closed by the stream).
+ * stream (t_bmp_stream*): Receives the stream.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the headers are invalid, unsupported or truncated.
+ */
+int bmpstream_open(int fd, t_bmp_stream *stream);
+
+/**
+ * bmpstream_readRow
+ * Reads the next row of the file, in file order, and decodes it.
+ *
+ * Parameters:
+ * stream (t_bmp_stream*): Stream opened by bmpstream_open.
+ * row (unsigned char*): Receives width bytes (VIEW_GRAY8) or width t_pixel values.
+ *
+ * Returns:
+ * int: 0 on success, -1 on a read error or an early end of the stream.
+ */
+int bmpstream_readRow(t_bmp_stream *stream, unsigned char *row);
+
+/**
+ * bmpstream_close
+ * Frees the buffers of a stream. The descriptor is left open.
+ *
+ * Parameters:
+ * stream (t_bmp_stream*): Stream to close.
+ */
+void bmpstream_close(t_bmp_stream *stream);
+
+/**
+ * bmpstream_readView
+ * Reads every row of the file into a view of the image size, each row at its place in
+ * the image (the last file row first for a bottom-up file).
+ *
+ * Parameters:
+ * stream (t_bmp_stream*): Stream opened by bmpstream_open, before its first row.
+ * view (const t_view*): Pixels to fill, of the size and format of the stream.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the view does not match or the pixel data is truncated.
+ */
+int bmpstream_readView(t_bmp_stream *stream, const t_view *view);
+
+/**
+ * bmpstream_writeView
+ * Writes the pixels of a view as a BMP file with the headers and layout of an input
+ * stream: same header bytes, depth and row order.
+ *
+ * Parameters:
+ * fd (int): Descriptor to write to.
+ * input (const t_bmp_stream*): Stream the image was read from.
+ * view (const t_view*): Pixels to write, of the size and format of the stream.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the view does not match or on a write error.
+ */
+int bmpstream_writeView(int fd, const t_bmp_stream *input, const t_view *view);
+
+/**
+ * bmpstream_process
+ * Reads a BMP file from one descriptor, runs a pipeline on it row by row and writes the
+ * result, with the headers of the input, to another descriptor.
+ *
+ * Parameters:
+ * in (int): Descriptor of the input file (for instance 0).
+ * out (int): Descriptor of the output file (for instance 1).
+ * pipeline (const t_pipeline*): Operations to run (may be empty).
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int bmpstream_process(int in, int out, const t_pipeline *pipeline);
+
+#endif // BMPSTREAM_H
@@ -0,0 +1,1315 @@
+/**
+ * cli.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the command-line interface. Commands are listed in a table with their
+ * usage line, so that adding a command only takes a function and a table entry.
+ *
+ * Role in the project:
+ * Non-interactive entry point, used for scripting and batch work.
+ */
+
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "cli.h"
+#include "batch.h"
+#include "bilateral.h"
+#include "bmpstream.h"
+#include "geometry.h"
+#include "gradient.h"
+#include "histogram.h"
+#include "kernels.h"
+#include "label.h"
+#include "luma.h"
+#include "morph.h"
+#include "probe.h"
+#include "quality.h"
+#include "server.h"
+#include "shmimage.h"
+#include "stats.h"
+#include "tilecache.h"
+#include "view.h"
+
+/**
+ * t_cli_command
+ * One command of the command-line interface.
+ */
+typedef struct {
+    const char *name;
+    const char *usage;
+    const char *description;
+    int (*run)(int argc, char **argv);
+} t_cli_command;
+
+static int cli_help(int argc, char **argv);
+static int cli_probe(int argc, char **argv);
+static int cli_scan(int argc, char **argv);
+static int cli_batch(int argc, char **argv);
+static int cli_gray(int argc, char **argv);
+static int cli_crop(int argc, char **argv);
+static int cli_rotate(int argc, char **argv);
+static int cli_thumb(int argc, char **argv);
+static int cli_roi(int argc, char **argv);
+static int cli_edges(int argc, char **argv);
+static int cli_morph(int argc, char **argv);
+static int cli_bilateral(int argc, char **argv);
+static int cli_label(int argc, char **argv);
+static int cli_stats(int argc, char **argv);
+static int cli_compare(int argc, char **argv);
+static int cli_large(int argc, char **argv);
+static int cli_serve(int argc, char **argv);
+static int cli_client(int argc, char **argv);
+static int cli_shm(int argc, char **argv);
+static int cli_stream(int argc, char **argv);
+
+static const t_cli_command commands[] = {
+    {"help", "help", "List the available commands", cli_help},
+    {"probe", "probe FILE...", "Print the header metadata of BMP files without loading them", cli_probe},
+    {"scan", "scan DIR [-r] [--csv | --json]", "Catalogue the BMP files of a directory", cli_scan},
+    {"batch", "batch -o DIR [--op OP]... [OPTIONS] FILE...", "Apply operations to many files with overlapped I/O", cli_batch},
+    {"gray", "gray IN OUT [--bt709] [--op OP]...", "Convert a color image to an 8-bit grayscale image", cli_gray},
+    {"crop", "crop IN OUT X Y W H", "Save a rectangle of an image", cli_crop},
+    {"rotate", "rotate IN OUT 90|180|270|transpose|flipx|flipy", "Rotate, transpose or mirror an image", cli_rotate},
+    {"thumb", "thumb IN OUT 2|4|8", "Save a reduced copy of an image, averaged while it is read", cli_thumb},
+    {"roi", "roi IN OUT --rect X,Y,W,H... --op OP...", "Apply operations to rectangles of an image only", cli_roi},
+    {"edges", "edges IN OUT [--scharr] [--l1] [--angle FILE]", "Save the gradient magnitude (Sobel by default)", cli_edges},
+    {"morph", "morph IN OUT OP W[xH] [--threshold N|otsu]", "Erode, dilate, open, close or take the morphological gradient", cli_morph},
+    {"bilateral", "bilateral IN (OUT | --bench) [--spatial S] [--range R] [--grid]", "Edge-preserving smoothing", cli_bilateral},
+    {"label", "label IN [--threshold N|otsu] [--4] [--csv | --json]", "List the connected components of a binary image", cli_label},
+    {"stats", "stats IN [--no-histogram]", "Print the minimum, maximum, mean, deviation and histogram of each channel as JSON", cli_stats},
+    {"compare", "compare A B [--json] [--min-psnr DB] [--min-ssim S]", "Print the MSE, PSNR, SSIM and MS-SSIM between two images", cli_compare},
+    {"large", "large IN OUT [--memory MB] --op OP...", "Apply operations to an image larger than memory, tile by tile", cli_large},
+    {"serve", "serve SOCKET [--workers N]", "Run jobs received as JSON lines on a UNIX socket", cli_serve},
+    {"client", "client SOCKET [IN OUT [--op OP]... | --shutdown]", "Send jobs (JSON lines from stdin, or one from the arguments) to a server", cli_client},
+    {"shm", "shm IN OUT [--op OP]... [--server SOCKET]", "Process an image in shared memory in another process (a child, or a server)", cli_shm},
+    {"stream", "stream [--op OP]... [IN|- [OUT|-]]", "Filter a BMP file row by row, from stdin to stdout by default, in constant memory", cli_stream},
+};
+
+#define CLI_COMMAND_COUNT (int)(sizeof(commands) / sizeof(commands[0]))
+
+
+/**
+ * cli_help
+ * Prints the usage of every command.
+ */
+static int cli_help(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    printf("Usage: image_processing COMMAND [ARGS]\n");
+    printf("Without arguments, the interactive menu is started.\n\nCommands:\n");
+    for (int i = 0; i < CLI_COMMAND_COUNT; i++) {
+        printf("  %-44s %s\n", commands[i].usage, commands[i].description);
+    }
+    printf("\nOperations (--op): negative, grayscale, brightness=N, threshold=N");
+    for (int i = 0; i < kernel_presetCount(); i++) {
+        printf(", %s", kernel_preset(i)->name);
+    }
+    printf("\nBatch options: --readers N, --workers N, --writers N, --depth N\n");
+    return 0;
+}
+
+
+/**
+ * t_cli_op_type
+ * Kind of operation given with --op.
+ */
+typedef enum {
+    CLI_OP_NEGATIVE,
+    CLI_OP_GRAYSCALE,
+    CLI_OP_BRIGHTNESS,
+    CLI_OP_THRESHOLD,
+    CLI_OP_KERNEL
+} t_cli_op_type;
+
+/**
+ * t_cli_op
+ * Parsed --op argument.
+ */
+typedef struct {
+    t_cli_op_type type;
+    int value;
+    const t_kernel_preset *kernel;
+} t_cli_op;
+
+
+/**
+ * cli_parseOp
+ * Parses an operation such as "negative" or "brightness=40".
+ *
+ * Returns:
+ * int: 1 on success, 0 if the operation is unknown or malformed.
+ */
+static int cli_parseOp(const char *spec, t_cli_op *op) {
+    const char *equals = strchr(spec, '=');
+    size_t length = equals ? (size_t)(equals - spec) : strlen(spec);
+    char *end = NULL;
+    long value = equals ? strtol(equals + 1, &end, 10) : 0;
+    int hasValue = equals && end != equals + 1 && *end == '\0';
+
+    op->value = (int)value;
+    op->kernel = NULL;
+    if (length == 8 && strncmp(spec, "negative", length) == 0 && !equals) {
+        op->type = CLI_OP_NEGATIVE;
+        return 1;
+    }
+    if (length == 9 && strncmp(spec, "grayscale", length) == 0 && !equals) {
+        op->type = CLI_OP_GRAYSCALE;
+        return 1;
+    }
+    if (length == 10 && strncmp(spec, "brightness", length) == 0 && hasValue) {
+        op->type = CLI_OP_BRIGHTNESS;
+        return 1;
+    }
+    if (length == 9 && strncmp(spec, "threshold", length) == 0 && hasValue) {
+        op->type = CLI_OP_THRESHOLD;
+        return 1;
+    }
+    if (!equals && (op->kernel = kernel_findPreset(spec)) != NULL) {
+        op->type = CLI_OP_KERNEL;
+        return 1;
+    }
+    fprintf(stderr, "Error: Unknown operation %s.\n", spec);
+    return 0;
+}
+
+
+/**
+ * cli_addOp
+ * Parses an operation such as "negative", "brightness=40" or "gaussian" and queues it.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline receiving the operation.
+ * spec (const char*): Operation, in the syntax of --op.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the operation is unknown or malformed.
+ */
+int cli_addOp(t_pipeline *pipeline, const char *spec) {
+    t_cli_op op;
+    if (!cli_parseOp(spec, &op)) return 0;
+
+    switch (op.type) {
+        case CLI_OP_NEGATIVE: return pipeline_addNegative(pipeline);
+        case CLI_OP_GRAYSCALE: return pipeline_addGrayscale(pipeline);
+        case CLI_OP_BRIGHTNESS: return pipeline_addBrightness(pipeline, op.value);
+        case CLI_OP_THRESHOLD: return pipeline_addThreshold(pipeline, op.value);
+        default: {
+            float weights[9];
+            kernel_presetWeights(op.kernel, weights);
+            float *rows[3] = {weights, weights + 3, weights + 6};
+            return pipeline_addConvolution(pipeline, rows, 3);
+        }
+    }
+}
+
+
+/**
+ * cli_applyOp
+ * Runs a parsed operation on a view.
+ */
+static void cli_applyOp(const t_cli_op *op, const t_view *view) {
+    switch (op->type) {
+        case CLI_OP_NEGATIVE: view_negative(view); break;
+        case CLI_OP_GRAYSCALE: view_grayscale(view); break;
+        case CLI_OP_BRIGHTNESS: view_brightness(view, op->value); break;
+        case CLI_OP_THRESHOLD: view_threshold(view, op->value); break;
+        default: {
+            float weights[9];
+            kernel_presetWeights(op->kernel, weights);
+            view_convolve(view, weights, 3);
+            break;
+        }
+    }
+}
+
+
+/**
+ * cli_intOption
+ * Reads the positive integer following an option.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the value is missing or invalid.
+ */
+static int cli_intOption(int argc, char **argv, int *i, int *value) {
+    if (*i + 1 >= argc || (*value = atoi(argv[*i + 1])) <= 0) {
+        fprintf(stderr, "Error: %s needs a positive number.\n", argv[*i]);
+        return 0;
+    }
+    (*i)++;
+    return 1;
+}
+
+
+/**
+ * cli_probe
+ * Prints the metadata of each file given on the command line.
+ * Fails if any of them is not a valid BMP file.
+ */
+static int cli_probe(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: probe FILE...\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        t_bmp_probe probe;
+        if (!probe_file(argv[i], &probe)) status = 1;
+        probe_print(argv[i], &probe);
+    }
+    return status;
+}
+
+
+/**
+ * cli_scan
+ * Writes a CSV (default) or JSON catalogue of a directory to the standard output.
+ */
+static int cli_scan(int argc, char **argv) {
+    const char *path = NULL;
+    int recursive = 0;
+    t_probe_format format = PROBE_CSV;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0) {
+            recursive = 1;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            format = PROBE_CSV;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            format = PROBE_JSON;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: scan DIR [-r] [--csv | --json]\n");
+        return 1;
+    }
+
+    long count = probe_scan(path, recursive, format, stdout);
+    if (count < 0) return 1;
+    fprintf(stderr, "%ld files scanned.\n", count);
+    return 0;
+}
+
+
+/**
+ * cli_batch
+ * Applies a chain of operations to every input file and saves the results in a directory,
+ * then prints the per-stage utilization.
+ */
+static int cli_batch(int argc, char **argv) {
+    const char *outputDir = NULL;
+    t_batch_config config = {0, 0, 0, 0};
+    t_pipeline *pipeline = pipeline_create();
+    char **inputs = malloc(argc * sizeof(char *));
+    int count = 0;
+    int ok = pipeline && inputs;
+
+    for (int i = 1; ok && i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (strcmp(argv[i], "--op") == 0 && i + 1 < argc) {
+            ok = cli_addOp(pipeline, argv[++i]);
+        } else if (strcmp(argv[i], "--readers") == 0) {
+            ok = cli_intOption(argc, argv, &i, &config.readers);
+        } else if (strcmp(argv[i], "--workers") == 0) {
+            ok = cli_intOption(argc, argv, &i, &config.workers);
+        } else if (strcmp(argv[i], "--writers") == 0) {
+            ok = cli_intOption(argc, argv, &i, &config.writers);
+        } else if (strcmp(argv[i], "--depth") == 0) {
+            ok = cli_intOption(argc, argv, &i, &config.queueDepth);
+        } else {
+            inputs[count++] = argv[i];
+        }
+    }
+    if (ok && (!outputDir || count == 0)) {
+        fprintf(stderr, "Usage: batch -o DIR [--op OP]... [OPTIONS] FILE...\n");
+        ok = 0;
+    }
+
+    if (ok) {
+        t_batch_report report;
+        ok = batch_run(inputs, count, outputDir, pipeline, &config, &report);
+        batch_printReport(&report);
+    }
+    pipeline_free(pipeline);
+    free(inputs);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_gray
+ * Converts a 24/32-bit image to an 8-bit image (BT.601 weights unless --bt709 is given),
+ * then applies the operations to the 8-bit image before saving it.
+ */
+static int cli_gray(int argc, char **argv) {
+    const char *paths[2] = {NULL, NULL};
+    int count = 0;
+    t_luma_standard standard = LUMA_BT601;
+    t_pipeline *pipeline = pipeline_create();
+    int ok = pipeline != NULL;
+
+    for (int i = 1; ok && i < argc; i++) {
+        if (strcmp(argv[i], "--bt709") == 0) {
+            standard = LUMA_BT709;
+        } else if (strcmp(argv[i], "--op") == 0 && i + 1 < argc) {
+            ok = cli_addOp(pipeline, argv[++i]);
+        } else if (count < 2) {
+            paths[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            ok = 0;
+        }
+    }
+    if (ok && count != 2) {
+        fprintf(stderr, "Usage: gray IN OUT [--bt709] [--op OP]...\n");
+        ok = 0;
+    }
+
+    t_bmp24 *img = ok ? bmp24_loadImage(paths[0]) : NULL;
+    t_bmp8 *gray = img ? bmp24_toBmp8(img, standard) : NULL;
+    if (gray) pipeline_execute8(pipeline, gray);
+    ok = gray != NULL && bmp8_saveImage(paths[1], gray) == 0;
+
+    bmp24_free(img);
+    bmp8_free(gray);
+    pipeline_free(pipeline);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * t_cli_image
+ * Image of either bit depth loaded by a command, with a view of all its pixels.
+ */
+typedef struct {
+    t_bmp8 *gray;
+    t_bmp24 *color;
+    t_view view;
+} t_cli_image;
+
+
+/**
+ * cli_loadImage
+ * Loads an 8-bit or 24/32-bit image, depending on its header.
+ *
+ * Returns:
+ * int: 1 on success, 0 on failure.
+ */
+static int cli_loadImage(const char *path, t_cli_image *image) {
+    t_bmp_probe probe;
+    memset(image, 0, sizeof(*image));
+    if (!probe_file(path, &probe)) {
+        fprintf(stderr, "Error: %s: %s.\n", path, probe.error);
+        return 0;
+    }
+
+    if (probe.depth <= 8) {
+        image->gray = bmp8_loadImage(path);
+        if (image->gray) image->view = bmp8_view(image->gray);
+    } else {
+        image->color = bmp24_loadImage(path);
+        if (image->color) image->view = bmp24_view(image->color);
+    }
+    return image->gray || image->color;
+}
+
+
+/**
+ * cli_saveImage
+ * Saves an image loaded by cli_loadImage and releases it.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the file cannot be written.
+ */
+static int cli_saveImage(t_cli_image *image, const char *path) {
+    int saved;
+    if (image->gray) {
+        saved = bmp8_saveImage(path, image->gray) == 0;
+        bmp8_free(image->gray);
+    } else {
+        saved = bmp24_saveImage(image->color, path) == 0;
+        bmp24_free(image->color);
+    }
+    return saved;
+}
+
+
+/**
+ * cli_rectOption
+ * Reads four integers given as "X,Y,W,H".
+ *
+ * Returns:
+ * int: 1 on success, 0 if the rectangle is malformed.
+ */
+static int cli_rectOption(const char *text, int rect[4]) {
+    char extra;
+    if (sscanf(text, "%d,%d,%d,%d%c", &rect[0], &rect[1], &rect[2], &rect[3], &extra) != 4) {
+        fprintf(stderr, "Error: Rectangle %s is not X,Y,W,H.\n", text);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * cli_binarize
+ * Thresholds an image at the value given on the command line, or at the value chosen by
+ * Otsu's method if it is "otsu". Does nothing if no threshold was given.
+ */
+static void cli_binarize(t_bmp8 *img, const char *threshold) {
+    if (!threshold) return;
+    bmp8_threshold(img, strcmp(threshold, "otsu") == 0 ? bmp8_otsuThreshold(img) : atoi(threshold));
+}
+
+
+/**
+ * cli_crop
+ * Saves a rectangle of an image as a new image of the same bit depth.
+ */
+static int cli_crop(int argc, char **argv) {
+    char rect[64];
+    int values[4];
+    t_cli_image image;
+    t_view crop;
+
+    if (argc != 7) {
+        fprintf(stderr, "Usage: crop IN OUT X Y W H\n");
+        return 1;
+    }
+    snprintf(rect, sizeof(rect), "%s,%s,%s,%s", argv[3], argv[4], argv[5], argv[6]);
+    if (!cli_rectOption(rect, values) || !cli_loadImage(argv[1], &image)) return 1;
+
+    int ok = view_crop(&image.view, values[0], values[1], values[2], values[3], &crop);
+    if (ok && image.gray) {
+        t_bmp8 *result = bmp8_fromView(&crop);
+        ok = result != NULL && bmp8_saveImage(argv[2], result) == 0;
+        bmp8_free(result);
+    } else if (ok) {
+        t_bmp24 *result = bmp24_fromView(&crop, image.color->colorDepth);
+        if (result) result->header_info.compression = image.color->header_info.compression;
+        ok = result != NULL && bmp24_saveImage(result, argv[2]) == 0;
+        bmp24_free(result);
+    }
+    bmp8_free(image.gray);
+    bmp24_free(image.color);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_rotate
+ * Saves a rotated, transposed or mirrored image. Flips are done in place.
+ */
+static int cli_rotate(int argc, char **argv) {
+    static const char *names[] = {"90", "180", "270", "transpose"};
+    t_cli_image image;
+
+    if (argc != 4) {
+        fprintf(stderr, "Usage: rotate IN OUT 90|180|270|transpose|flipx|flipy\n");
+        return 1;
+    }
+    int rotation = -1;
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(argv[3], names[i]) == 0) rotation = i;
+    }
+    int flipX = strcmp(argv[3], "flipx") == 0;
+    int flipY = strcmp(argv[3], "flipy") == 0;
+    if (rotation < 0 && !flipX && !flipY) {
+        fprintf(stderr, "Error: Unknown transform %s.\n", argv[3]);
+        return 1;
+    }
+    if (!cli_loadImage(argv[1], &image)) return 1;
+
+    if (flipX || flipY) {
+        if (image.gray && flipX) {
+            bmp8_flipHorizontal(image.gray);
+        } else if (image.gray) {
+            bmp8_flipVertical(image.gray);
+        } else if (flipX) {
+            bmp24_flipHorizontal(image.color);
+        } else {
+            bmp24_flipVertical(image.color);
+        }
+        return cli_saveImage(&image, argv[2]) ? 0 : 1;
+    }
+
+    int ok;
+    if (image.gray) {
+        t_bmp8 *result = bmp8_rotate(image.gray, (t_rotation)rotation);
+        ok = result != NULL && bmp8_saveImage(argv[2], result) == 0;
+        bmp8_free(result);
+    } else {
+        t_bmp24 *result = bmp24_rotate(image.color, (t_rotation)rotation);
+        ok = result != NULL && bmp24_saveImage(result, argv[2]) == 0;
+        bmp24_free(result);
+    }
+    bmp8_free(image.gray);
+    bmp24_free(image.color);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_thumb
+ * Saves a copy of an image reduced by a factor of 2, 4 or 8. Each block of pixels is
+ * averaged while the file is read, so the full-size image is never held in memory.
+ */
+static int cli_thumb(int argc, char **argv) {
+    t_bmp_probe probe;
+
+    if (argc != 4) {
+        fprintf(stderr, "Usage: thumb IN OUT 2|4|8\n");
+        return 1;
+    }
+    int scale = atoi(argv[3]);
+    if (scale != 2 && scale != 4 && scale != 8) {
+        fprintf(stderr, "Error: The reduction factor must be 2, 4 or 8.\n");
+        return 1;
+    }
+    if (!probe_file(argv[1], &probe)) {
+        fprintf(stderr, "Error: %s: %s.\n", argv[1], probe.error);
+        return 1;
+    }
+
+    int ok;
+    if (probe.depth <= 8) {
+        t_bmp8 *result = bmp8_loadImageScaled(argv[1], scale);
+        ok = result != NULL && bmp8_saveImage(argv[2], result) == 0;
+        bmp8_free(result);
+    } else {
+        t_bmp24 *result = bmp24_loadImageScaled(argv[1], scale);
+        ok = result != NULL && bmp24_saveImage(result, argv[2]) == 0;
+        bmp24_free(result);
+    }
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_roi
+ * Applies the operations, in order, to each rectangle of an image; the other pixels
+ * are left untouched.
+ */
+static int cli_roi(int argc, char **argv) {
+    const char *paths[2] = {NULL, NULL};
+    int count = 0;
+    int (*rects)[4] = malloc(argc * sizeof(*rects));
+    t_cli_op *ops = malloc(argc * sizeof(t_cli_op));
+    int rectCount = 0;
+    int opCount = 0;
+    int ok = rects && ops;
+
+    for (int i = 1; ok && i < argc; i++) {
+        if (strcmp(argv[i], "--rect") == 0 && i + 1 < argc) {
+            ok = cli_rectOption(argv[++i], rects[rectCount++]);
+        } else if (strcmp(argv[i], "--op") == 0 && i + 1 < argc) {
+            ok = cli_parseOp(argv[++i], &ops[opCount++]);
+        } else if (count < 2) {
+            paths[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            ok = 0;
+        }
+    }
+    if (ok && (count != 2 || rectCount == 0 || opCount == 0)) {
+        fprintf(stderr, "Usage: roi IN OUT --rect X,Y,W,H... --op OP...\n");
+        ok = 0;
+    }
+
+    // Every rectangle is checked before any pixel is modified, so that OUT is only
+    // written when all of them were processed
+    t_cli_image image;
+    t_view *rois = ok ? malloc(rectCount * sizeof(t_view)) : NULL;
+    if (rois && cli_loadImage(paths[0], &image)) {
+        for (int r = 0; ok && r < rectCount; r++) {
+            ok = view_crop(&image.view, rects[r][0], rects[r][1], rects[r][2], rects[r][3], &rois[r]);
+        }
+        for (int r = 0; ok && r < rectCount; r++) {
+            for (int i = 0; i < opCount; i++) {
+                cli_applyOp(&ops[i], &rois[r]);
+            }
+        }
+        if (ok) {
+            ok = cli_saveImage(&image, paths[1]);
+        } else {
+            bmp8_free(image.gray);
+            bmp24_free(image.color);
+        }
+    } else {
+        ok = 0;
+    }
+
+    free(rois);
+    free(rects);
+    free(ops);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_edges
+ * Saves the gradient magnitude of an 8-bit image, or of the luma of a color image, as an
+ * 8-bit image, and optionally the gradient directions as a second one.
+ */
+static int cli_edges(int argc, char **argv) {
+    const char *paths[2] = {NULL, NULL};
+    const char *anglePath = NULL;
+    int count = 0;
+    t_gradient_operator op = GRADIENT_SOBEL;
+    t_gradient_norm norm = GRADIENT_L2;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scharr") == 0) {
+            op = GRADIENT_SCHARR;
+        } else if (strcmp(argv[i], "--l1") == 0) {
+            norm = GRADIENT_L1;
+        } else if (strcmp(argv[i], "--angle") == 0 && i + 1 < argc) {
+            anglePath = argv[++i];
+        } else if (count < 2) {
+            paths[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (count != 2) {
+        fprintf(stderr, "Usage: edges IN OUT [--scharr] [--l1] [--angle FILE]\n");
+        return 1;
+    }
+
+    t_cli_image image;
+    if (!cli_loadImage(paths[0], &image)) return 1;
+
+    t_bmp8 *angles = NULL;
+    t_bmp8 **orientation = anglePath ? &angles : NULL;
+    t_bmp8 *magnitude = image.gray ? bmp8_gradient(image.gray, op, norm, orientation)
+                                   : bmp24_gradient(image.color, op, norm, orientation);
+    int ok = magnitude != NULL && bmp8_saveImage(paths[1], magnitude) == 0;
+    if (ok && angles) ok = bmp8_saveImage(anglePath, angles) == 0;
+
+    bmp8_free(magnitude);
+    bmp8_free(angles);
+    bmp8_free(image.gray);
+    bmp24_free(image.color);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_morph
+ * Applies a morphological operation with a rectangular element to an 8-bit image, or to
+ * the luma of a color image, and saves the result as an 8-bit image. With --threshold
+ * (a value or "otsu"), the image is binarized first and the packed 1-bit path is used.
+ */
+static int cli_morph(int argc, char **argv) {
+    static const char *names[] = {"erode", "dilate", "open", "close", "gradient"};
+    const char *args[4] = {NULL, NULL, NULL, NULL};
+    int count = 0;
+    const char *threshold = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = argv[++i];
+        } else if (count < 4) {
+            args[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (count != 4) {
+        fprintf(stderr, "Usage: morph IN OUT OP W[xH] [--threshold N|otsu]\n");
+        return 1;
+    }
+
+    int op = -1;
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(args[2], names[i]) == 0) op = i;
+    }
+    int width = 0;
+    int height = 0;
+    int fields = sscanf(args[3], "%dx%d", &width, &height);
+    if (fields == 1) height = width;
+    if (op < 0 || fields < 1 || width < 1 || height < 1) {
+        fprintf(stderr, "Error: Expected erode, dilate, open, close or gradient and a size such as 5 or 15x3.\n");
+        return 1;
+    }
+
+    t_cli_image image;
+    if (!cli_loadImage(args[0], &image)) return 1;
+    t_bmp8 *gray = image.gray;
+    if (!gray) {
+        gray = bmp24_toBmp8(image.color, LUMA_BT601);
+        bmp24_free(image.color);
+    }
+    if (!gray) return 1;
+
+    cli_binarize(gray, threshold);
+    int ok = bmp8_morphology(gray, (t_morph_op)op, width, height) == 0 && bmp8_saveImage(args[1], gray) == 0;
+    bmp8_free(gray);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_now
+ * Monotonic time in seconds.
+ */
+static double cli_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/**
+ * cli_bilateral
+ * Applies a bilateral filter to an image. With --bench, the image is filtered by both
+ * methods for several spatial sigmas instead, and the time of each method and the PSNR
+ * of the grid result against the direct filter are printed.
+ */
+static int cli_bilateral(int argc, char **argv) {
+    const char *paths[2] = {NULL, NULL};
+    int count = 0;
+    int bench = 0;
+    float spatial = 3.0f;
+    float range = 20.0f;
+    t_bilateral_method method = BILATERAL_EXACT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--spatial") == 0 && i + 1 < argc) {
+            spatial = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            range = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--grid") == 0) {
+            method = BILATERAL_GRID;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = 1;
+        } else if (count < 2) {
+            paths[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (count != (bench ? 1 : 2) || !(spatial > 0.0f) || !(range > 0.0f)) {
+        fprintf(stderr, "Usage: bilateral IN (OUT | --bench) [--spatial S] [--range R] [--grid]\n");
+        return 1;
+    }
+
+    t_cli_image image;
+    if (!cli_loadImage(paths[0], &image)) return 1;
+
+    if (!bench) {
+        int status = image.gray ? bmp8_bilateral(image.gray, spatial, range, method)
+                                : bmp24_bilateral(image.color, spatial, range, method);
+        if (status == 0) return cli_saveImage(&image, paths[1]) ? 0 : 1;
+        bmp8_free(image.gray);
+        bmp24_free(image.color);
+        return 1;
+    }
+
+    // Both methods run on 24-bit copies so that gray and color images share the code
+    printf("%8s %12s %12s %10s\n", "sigma_s", "direct (ms)", "grid (ms)", "PSNR (dB)");
+    int ok = 1;
+    for (float sigma = 1.0f; ok && sigma <= 16.0f; sigma *= 2.0f) {
+        t_bmp24 *direct = bmp24_fromView(&image.view, DEFAULT_DEPTH);
+        t_bmp24 *grid = bmp24_fromView(&image.view, DEFAULT_DEPTH);
+        ok = direct && grid;
+
+        double start = cli_now();
+        ok = ok && bmp24_bilateral(direct, sigma, range, BILATERAL_EXACT) == 0;
+        double middle = cli_now();
+        ok = ok && bmp24_bilateral(grid, sigma, range, BILATERAL_GRID) == 0;
+        double end = cli_now();
+
+        if (ok) {
+            t_view exact = bmp24_view(direct);
+            t_view approximate = bmp24_view(grid);
+            double error = 0.0;
+            quality_mse(&exact, &approximate, &error);
+            printf("%8g %12.1f %12.1f %10.2f\n", sigma, (middle - start) * 1e3, (end - middle) * 1e3,
+                   quality_psnr(error));
+        }
+        bmp24_free(direct);
+        bmp24_free(grid);
+    }
+
+    bmp8_free(image.gray);
+    bmp24_free(image.color);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_label
+ * Writes the area, bounding box and centroid of every connected component of the
+ * non-zero pixels of an image (8-connected by default) to the standard output.
+ * Color images are converted to their luma; --threshold (a value or "otsu") binarizes
+ * the image first.
+ */
+static int cli_label(int argc, char **argv) {
+    const char *path = NULL;
+    const char *threshold = NULL;
+    int connectivity = 8;
+    t_probe_format format = PROBE_CSV;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = argv[++i];
+        } else if (strcmp(argv[i], "--4") == 0) {
+            connectivity = 4;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            format = PROBE_CSV;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            format = PROBE_JSON;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: label IN [--threshold N|otsu] [--4] [--csv | --json]\n");
+        return 1;
+    }
+
+    t_cli_image image;
+    if (!cli_loadImage(path, &image)) return 1;
+    t_bmp8 *gray = image.gray;
+    if (!gray) {
+        gray = bmp24_toBmp8(image.color, LUMA_BT601);
+        bmp24_free(image.color);
+    }
+    if (!gray) return 1;
+
+    cli_binarize(gray, threshold);
+    t_labeling *labeling = bmp8_label(gray, connectivity, 0);
+    bmp8_free(gray);
+    if (!labeling) return 1;
+
+    labeling_write(labeling, format, stdout);
+    fprintf(stderr, "%d components.\n", labeling->count);
+    labeling_free(labeling);
+    return 0;
+}
+
+
+/**
+ * cli_stats
+ * Writes the statistics of every channel of an image to the standard output as JSON.
+ */
+static int cli_stats(int argc, char **argv) {
+    const char *path = NULL;
+    int histograms = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-histogram") == 0) {
+            histograms = 0;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: stats IN [--no-histogram]\n");
+        return 1;
+    }
+
+    t_cli_image image;
+    if (!cli_loadImage(path, &image)) return 1;
+
+    t_image_stats stats;
+    if (image.gray) {
+        bmp8_stats(image.gray, &stats);
+        bmp8_free(image.gray);
+    } else {
+        bmp24_stats(image.color, &stats);
+        bmp24_free(image.color);
+    }
+    stats_writeJson(&stats, histograms, stdout);
+    return 0;
+}
+
+
+/**
+ * cli_compare
+ * Compares an image with a reference. With --min-psnr or --min-ssim, the exit status is
+ * 1 when the image is further from the reference than allowed, so that the command can
+ * gate a script.
+ */
+static int cli_compare(int argc, char **argv) {
+    const char *paths[2] = {NULL, NULL};
+    int count = 0;
+    int json = 0;
+    double minPsnr = -INFINITY;
+    double minSsim = -INFINITY;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--min-psnr") == 0 && i + 1 < argc) {
+            minPsnr = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--min-ssim") == 0 && i + 1 < argc) {
+            minSsim = strtod(argv[++i], NULL);
+        } else if (count < 2) {
+            paths[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (count != 2) {
+        fprintf(stderr, "Usage: compare A B [--json] [--min-psnr DB] [--min-ssim S]\n");
+        return 1;
+    }
+
+    t_cli_image images[2];
+    if (!cli_loadImage(paths[0], &images[0])) return 1;
+    if (!cli_loadImage(paths[1], &images[1])) {
+        bmp8_free(images[0].gray);
+        bmp24_free(images[0].color);
+        return 1;
+    }
+
+    t_quality result;
+    int ok = quality_compare(&images[0].view, &images[1].view, &result) == 0;
+    if (ok && json) {
+        quality_writeJson(&result, stdout);
+    } else if (ok) {
+        printf("MSE: %.4f\nPSNR: %.2f dB\nSSIM: %.6f\n", result.mse, result.psnr, result.ssim);
+        if (isnan(result.msssim)) printf("MS-SSIM: n/a (image smaller than %d pixels)\n", QUALITY_WINDOW << 4);
+        else printf("MS-SSIM: %.6f\n", result.msssim);
+    }
+    if (ok && (result.psnr < minPsnr || result.ssim < minSsim)) {
+        fprintf(stderr, "Error: %s is further from %s than allowed.\n", paths[1], paths[0]);
+        ok = 0;
+    }
+
+    for (int k = 0; k < 2; k++) {
+        bmp8_free(images[k].gray);
+        bmp24_free(images[k].color);
+    }
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_large
+ * Applies operations to a BMP file through the out-of-core tile cache, so that the
+ * pixels never need to fit in memory: point operations run on each tile through the tile
+ * iterator, kernels gather each tile with its neighbors.
+ */
+static int cli_large(int argc, char **argv) {
+    const char *paths[2] = {NULL, NULL};
+    int count = 0;
+    int memory = 512;
+    t_cli_op *ops = malloc(argc * sizeof(t_cli_op));
+    int opCount = 0;
+    int ok = ops != NULL;
+
+    for (int i = 1; ok && i < argc; i++) {
+        if (strcmp(argv[i], "--memory") == 0) {
+            ok = cli_intOption(argc, argv, &i, &memory);
+        } else if (strcmp(argv[i], "--op") == 0 && i + 1 < argc) {
+            ok = cli_parseOp(argv[++i], &ops[opCount++]);
+        } else if (count < 2) {
+            paths[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            ok = 0;
+        }
+    }
+    if (ok && count != 2) {
+        fprintf(stderr, "Usage: large IN OUT [--memory MB] --op OP...\n");
+        ok = 0;
+    }
+
+    t_tile_cache *cache = ok ? tilecache_open(paths[0], (size_t)memory << 20) : NULL;
+    ok = cache != NULL;
+    for (int k = 0; ok && k < opCount; k++) {
+        if (ops[k].type == CLI_OP_KERNEL) {
+            float weights[9];
+            kernel_presetWeights(ops[k].kernel, weights);
+            ok = tilecache_convolve(cache, weights, 3) == 0;
+            continue;
+        }
+        t_tile_iter iter;
+        tilecache_begin(cache, &iter, 1);
+        while (tilecache_next(&iter)) cli_applyOp(&ops[k], &iter.view);
+        ok = !cache->failed;
+    }
+    if (ok) ok = tilecache_save(cache, paths[1]) == 0;
+    if (cache) {
+        fprintf(stderr, "%lu tile loads, %lu tiles spilled to scratch (cache of %d tiles).\n", cache->reads,
+                cache->writes, cache->capacity);
+    }
+
+    tilecache_close(cache);
+    free(ops);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_serve
+ * Runs the job server until a client sends the shutdown command.
+ */
+static int cli_serve(int argc, char **argv) {
+    const char *path = NULL;
+    int workers = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--workers") == 0) {
+            if (!cli_intOption(argc, argv, &i, &workers)) return 1;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: serve SOCKET [--workers N]\n");
+        return 1;
+    }
+    return server_run(path, workers) == 0 ? 0 : 1;
+}
+
+
+/**
+ * cli_client
+ * Sends jobs to a server and prints its answers. Without paths, JSON lines are read from
+ * the standard input; with IN OUT and --op, one job is built from the arguments.
+ */
+static int cli_client(int argc, char **argv) {
+    const char *args[3] = {NULL, NULL, NULL};
+    int count = 0;
+    int stop = 0;
+    const char **ops = malloc(argc * sizeof(char *));
+    int opCount = 0;
+    if (!ops) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shutdown") == 0) {
+            stop = 1;
+        } else if (strcmp(argv[i], "--op") == 0 && i + 1 < argc) {
+            ops[opCount++] = argv[++i];
+        } else if (count < 3) {
+            args[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            free(ops);
+            return 1;
+        }
+    }
+    if ((count != 1 && count != 3) || (stop && count != 1)) {
+        fprintf(stderr, "Usage: client SOCKET [IN OUT [--op OP]... | --shutdown]\n");
+        free(ops);
+        return 1;
+    }
+
+    int errors;
+    if (count == 3) {
+        errors = server_sendJob(args[0], args[1], args[2], ops, opCount, stdout);
+    } else if (stop) {
+        char command[] = "{\"command\": \"shutdown\"}\n";
+        FILE *in = fmemopen(command, strlen(command), "r");
+        errors = in ? server_send(args[0], in, stdout) : -1;
+        if (in) fclose(in);
+    } else {
+        errors = server_send(args[0], stdin, stdout);
+    }
+    free(ops);
+    return errors == 0 ? 0 : 1;
+}
+
+
+/**
+ * cli_shmChild
+ * Body of the child process of cli_shm: maps the inherited segment, processes it in place
+ * and returns the exit status.
+ */
+static int cli_shmChild(int fd, const char **ops, int opCount) {
+    t_shm_image image;
+    if (shmimage_map(fd, &image) != 0) return 1;
+
+    t_pipeline *pipeline = pipeline_create();
+    int ok = pipeline != NULL;
+    for (int i = 0; ok && i < opCount; i++) ok = cli_addOp(pipeline, ops[i]);
+    if (ok) {
+        pipeline_optimize(pipeline);
+        ok = pipeline_applyView(pipeline, &image.view) == 0;
+    }
+    pipeline_free(pipeline);
+    shmimage_close(&image);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_shm
+ * Reads an image into shared memory, has another process apply the operations to it in
+ * place, and saves the result read back from the same memory with the headers and depth
+ * of the input. The other process is a child given an anonymous memfd, or with --server
+ * a running server given the name of a POSIX shared-memory object.
+ */
+static int cli_shm(int argc, char **argv) {
+    const char *paths[2] = {NULL, NULL};
+    const char *socketPath = NULL;
+    int count = 0;
+    const char **ops = malloc(argc * sizeof(char *));
+    int opCount = 0;
+    if (!ops) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--op") == 0 && i + 1 < argc) {
+            ops[opCount++] = argv[++i];
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (count < 2) {
+            paths[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            free(ops);
+            return 1;
+        }
+    }
+    if (count != 2) {
+        fprintf(stderr, "Usage: shm IN OUT [--op OP]... [--server SOCKET]\n");
+        free(ops);
+        return 1;
+    }
+
+    // The file is read straight into the segment; its headers are kept for the output
+    int in = open(paths[0], O_RDONLY);
+    t_bmp_stream input;
+    if (in < 0 || bmpstream_open(in, &input) != 0) {
+        if (in < 0) fprintf(stderr, "Error: Unable to open %s.\n", paths[0]);
+        if (in >= 0) close(in);
+        free(ops);
+        return 1;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "/image-processing-%ld", (long)getpid());
+    t_shm_image shared;
+    double start = cli_now();
+    int ok = shmimage_create(socketPath ? name : NULL, input.width, input.height, input.format, &shared) == 0;
+    int created = ok;
+    if (ok) ok = bmpstream_readView(&input, &shared.view) == 0;
+    close(in);
+    double filled = cli_now();
+
+    if (ok && socketPath) {
+        ok = server_sendShared(socketPath, name, ops, opCount, stdout) == 0;
+    } else if (ok) {
+        fflush(NULL);
+        pid_t child = fork();
+        if (child == 0) _exit(cli_shmChild(dup(shared.fd), ops, opCount));
+        int status = 0;
+        ok = child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (child < 0) fprintf(stderr, "Error: Unable to start the child process.\n");
+    }
+    if (created && socketPath) shm_unlink(name);
+    double processed = cli_now();
+
+    if (ok) {
+        int out = open(paths[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) fprintf(stderr, "Error: Unable to open %s.\n", paths[1]);
+        ok = out >= 0 && bmpstream_writeView(out, &input, &shared.view) == 0;
+        if (out >= 0 && close(out) != 0) ok = 0;
+        if (ok) {
+            fprintf(stderr, "Copied to shared memory in %.2f ms, processed by the %s in %.2f ms.\n",
+                    (filled - start) * 1000.0, socketPath ? "server" : "child process", (processed - filled) * 1000.0);
+        }
+    }
+
+    if (created) shmimage_close(&shared);
+    bmpstream_close(&input);
+    free(ops);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_stream
+ * Applies operations to a BMP file read and written sequentially, so that the program
+ * can sit between two others in a pipe. "-" or a missing path is the standard input or
+ * output.
+ */
+static int cli_stream(int argc, char **argv) {
+    const char *paths[2] = {"-", "-"};
+    int count = 0;
+    t_pipeline *pipeline = pipeline_create();
+    if (!pipeline) return 1;
+
+    int ok = 1;
+    for (int i = 1; ok && i < argc; i++) {
+        if (strcmp(argv[i], "--op") == 0 && i + 1 < argc) {
+            ok = cli_addOp(pipeline, argv[++i]);
+        } else if (count < 2) {
+            paths[count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unexpected argument %s.\n", argv[i]);
+            ok = 0;
+        }
+    }
+
+    int in = -1;
+    int out = -1;
+    if (ok) {
+        in = strcmp(paths[0], "-") == 0 ? STDIN_FILENO : open(paths[0], O_RDONLY);
+        out = strcmp(paths[1], "-") == 0 ? STDOUT_FILENO : open(paths[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (in < 0 || out < 0) {
+            fprintf(stderr, "Error: Unable to open %s.\n", in < 0 ? paths[0] : paths[1]);
+            ok = 0;
+        }
+    }
+    if (ok) {
+        pipeline_optimize(pipeline);
+        ok = bmpstream_process(in, out, pipeline) == 0;
+    }
+
+    if (in > STDIN_FILENO) close(in);
+    if (out > STDOUT_FILENO) close(out);
+    pipeline_free(pipeline);
+    return ok ? 0 : 1;
+}
+
+
+/**
+ * cli_run
+ * Runs the command named by argv[0] with the remaining arguments.
+ *
+ * Parameters:
+ * argc (int): Number of arguments, command name included.
+ * argv (char**): Arguments, starting with the command name.
+ *
+ * Returns:
+ * int: Exit status of the program (0 on success).
+ */
+int cli_run(int argc, char **argv) {
+    for (int i = 0; i < CLI_COMMAND_COUNT; i++) {
+        if (strcmp(argv[0], commands[i].name) == 0) {
+            return commands[i].run(argc, argv);
+        }
+    }
+    fprintf(stderr, "Error: Unknown command %s.\n", argv[0]);
+    cli_help(0, NULL);
+    return 1;
+}
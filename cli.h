@@ -0,0 +1,45 @@
+/**
+ * cli.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the command-line interface. When the program is started with
+ * arguments, the first one names a command (for example "probe" or "scan") and the
+ * interactive menus are skipped.
+ *
+ * Role in the project:
+ * Non-interactive entry point, used for scripting and batch work.
+ */
+
+#ifndef CLI_H
+#define CLI_H
+
+#include "pipeline.h"
+
+/**
+ * cli_run
+ * Runs the command named by argv[0] with the remaining arguments.
+ *
+ * Parameters:
+ * argc (int): Number of arguments, command name included.
+ * argv (char**): Arguments, starting with the command name.
+ *
+ * Returns:
+ * int: Exit status of the program (0 on success).
+ */
+int cli_run(int argc, char **argv);
+
+/**
+ * cli_addOp
+ * Parses an operation such as "negative", "brightness=40" or "gaussian" and queues it.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline receiving the operation.
+ * spec (const char*): Operation, in the syntax of --op.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the operation is unknown or malformed.
+ */
+int cli_addOp(t_pipeline *pipeline, const char *spec);
+
+#endif // CLI_H
@@ -0,0 +1,146 @@
+/**
+ * dirty.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the modified-row tracker. A file is recognised by its device and inode
+ * rather than by its path, and its size and modification time must be unchanged, so a
+ * file replaced or edited by another program is never patched in place.
+ *
+ * Role in the project:
+ * Lets an image be saved back to its file by rewriting only the rows that changed.
+ */
+
+
+#include <sys/stat.h>
+#include "dirty.h"
+
+
+/**
+ * dirty_init
+ * Sets up a tracker with every row modified and no file in sync.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker to set up.
+ * height (int): Number of rows of the image.
+ *
+ * Returns:
+ * int: 1 on success, 0 if memory could not be allocated (every save is then a full save).
+ */
+int dirty_init(t_dirty_rows *dirty, int height) {
+    memset(dirty, 0, sizeof(*dirty));
+    dirty->rows = malloc(height > 0 ? height : 1);
+    if (!dirty->rows) return 0;
+    dirty->height = height;
+    memset(dirty->rows, 1, height > 0 ? height : 1);
+    return 1;
+}
+
+
+/**
+ * dirty_free
+ * Releases the flags of a tracker.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker to release.
+ */
+void dirty_free(t_dirty_rows *dirty) {
+    free(dirty->rows);
+    dirty->rows = NULL;
+    dirty->height = 0;
+    dirty->synced = 0;
+}
+
+
+/**
+ * dirty_mark
+ * Flags the rows [first, first + count) as modified and counts one more change.
+ * Out of range rows are ignored.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker.
+ * first (int): First modified row, in the row order of the image data.
+ * count (int): Number of modified rows.
+ */
+void dirty_mark(t_dirty_rows *dirty, int first, int count) {
+    dirty->version++;
+    if (!dirty->rows) return;
+    int last = first + count;
+    if (first < 0) first = 0;
+    if (last > dirty->height) last = dirty->height;
+    if (first < last) memset(dirty->rows + first, 1, last - first);
+}
+
+
+/**
+ * dirty_markAll
+ * Flags every row as modified.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker.
+ */
+void dirty_markAll(t_dirty_rows *dirty) {
+    dirty_mark(dirty, 0, dirty->height);
+}
+
+
+/**
+ * dirty_count
+ * Counts the modified rows.
+ *
+ * Parameters:
+ * dirty (const t_dirty_rows*): Tracker.
+ *
+ * Returns:
+ * int: Number of modified rows.
+ */
+int dirty_count(const t_dirty_rows *dirty) {
+    int count = 0;
+    for (int y = 0; dirty->rows && y < dirty->height; y++) {
+        count += dirty->rows[y];
+    }
+    return count;
+}
+
+
+/**
+ * dirty_sync
+ * Records that the image now matches a file (after a load or a save) and clears every flag.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker.
+ * filename (const char*): File the image matches.
+ */
+void dirty_sync(t_dirty_rows *dirty, const char *filename) {
+    struct stat st;
+    dirty->synced = 0;
+    if (!dirty->rows || stat(filename, &st) != 0) return;
+
+    dirty->device = (uint64_t)st.st_dev;
+    dirty->inode = (uint64_t)st.st_ino;
+    dirty->size = (uint64_t)st.st_size;
+    dirty->mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    dirty->synced = 1;
+    memset(dirty->rows, 0, dirty->height > 0 ? dirty->height : 1);
+}
+
+
+/**
+ * dirty_isSynced
+ * Checks that a file is the one recorded by dirty_sync and has not been modified since.
+ *
+ * Parameters:
+ * dirty (const t_dirty_rows*): Tracker.
+ * filename (const char*): File to check.
+ *
+ * Returns:
+ * int: 1 if only the flagged rows differ between the image and the file, 0 otherwise.
+ */
+int dirty_isSynced(const t_dirty_rows *dirty, const char *filename) {
+    struct stat st;
+    if (!dirty->synced || !dirty->rows || stat(filename, &st) != 0) return 0;
+
+    return dirty->device == (uint64_t)st.st_dev && dirty->inode == (uint64_t)st.st_ino &&
+           dirty->size == (uint64_t)st.st_size &&
+           dirty->mtime == (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
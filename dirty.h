@@ -0,0 +1,121 @@
+/**
+ * dirty.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the modified-row tracker embedded in every image. It holds one
+ * flag per row and the identity (device, inode, size, modification time) of the file
+ * whose pixel rows are known to match the image outside the flagged rows.
+ *
+ * Role in the project:
+ * Lets an image be saved back to its file by rewriting only the rows that changed.
+ */
+
+#ifndef DIRTY_H
+#define DIRTY_H
+
+#include "utils.h"
+
+/**
+ * t_dirty_rows
+ * Modified rows of an image and the file they are relative to.
+ *
+ * Members:
+ * rows (unsigned char*): One flag per row, 1 if the row changed since the last load or save.
+ * height (int): Number of rows.
+ * version (unsigned long): Number of changes so far, so that caches derived from the pixels
+ *     (such as the histogram) can tell whether they are still current.
+ * synced (int): 1 if the identity fields below describe a file in sync with the image.
+ * device, inode, size (uint64_t): Identity of that file.
+ * mtime (int64_t): Modification time of that file in nanoseconds.
+ */
+typedef struct {
+    unsigned char *rows;
+    int height;
+    unsigned long version;
+    int synced;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime;
+} t_dirty_rows;
+
+/**
+ * dirty_init
+ * Sets up a tracker with every row modified and no file in sync.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker to set up.
+ * height (int): Number of rows of the image.
+ *
+ * Returns:
+ * int: 1 on success, 0 if memory could not be allocated (every save is then a full save).
+ */
+int dirty_init(t_dirty_rows *dirty, int height);
+
+/**
+ * dirty_free
+ * Releases the flags of a tracker.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker to release.
+ */
+void dirty_free(t_dirty_rows *dirty);
+
+/**
+ * dirty_mark
+ * Flags the rows [first, first + count) as modified and counts one more change.
+ * Out of range rows are ignored.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker.
+ * first (int): First modified row, in the row order of the image data.
+ * count (int): Number of modified rows.
+ */
+void dirty_mark(t_dirty_rows *dirty, int first, int count);
+
+/**
+ * dirty_markAll
+ * Flags every row as modified.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker.
+ */
+void dirty_markAll(t_dirty_rows *dirty);
+
+/**
+ * dirty_count
+ * Counts the modified rows.
+ *
+ * Parameters:
+ * dirty (const t_dirty_rows*): Tracker.
+ *
+ * Returns:
+ * int: Number of modified rows.
+ */
+int dirty_count(const t_dirty_rows *dirty);
+
+/**
+ * dirty_sync
+ * Records that the image now matches a file (after a load or a save) and clears every flag.
+ *
+ * Parameters:
+ * dirty (t_dirty_rows*): Tracker.
+ * filename (const char*): File the image matches.
+ */
+void dirty_sync(t_dirty_rows *dirty, const char *filename);
+
+/**
+ * dirty_isSynced
+ * Checks that a file is the one recorded by dirty_sync and has not been modified since.
+ *
+ * Parameters:
+ * dirty (const t_dirty_rows*): Tracker.
+ * filename (const char*): File to check.
+ *
+ * Returns:
+ * int: 1 if only the flagged rows differ between the image and the file, 0 otherwise.
+ */
+int dirty_isSynced(const t_dirty_rows *dirty, const char *filename);
+
+#endif // DIRTY_H
@@ -181,6 +181,7 @@ void bmp24_equalize(t_bmp24 *img) {
             img->data[y][x].blue = (uint8_t)b;
         }
     }
+    dirty_markAll(&img->dirty);
 
     free(hist_eq);
     free(hist);
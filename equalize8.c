@@ -13,6 +13,7 @@
 
 
 #include "equalize8.h"
+#include "histogram.h"
 
 
 /**
@@ -27,15 +28,8 @@
  */
 unsigned int * bmp8_computeHistogram(t_bmp8 * img) {
     unsigned int * histogram = (unsigned int*)calloc(256, sizeof(unsigned int));
-    int width = img->width;
-    int height = img->height;
-
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            unsigned char pixelValue = img->data[y * width + x];
-            histogram[pixelValue]++;
-        }
-    }
+    const unsigned int * cached = bmp8_histogram(img);
+    if (histogram && cached) memcpy(histogram, cached, 256 * sizeof(unsigned int));
     return histogram;
 }
 
@@ -87,11 +81,14 @@ unsigned int * bmp8_computeCDF(unsigned int * hist) {
  * img (t_bmp8*): Pointer to the BMP image to equalize.
  */
 void bmp8_equalize(t_bmp8 * img) {
-    unsigned int * hist = bmp8_computeHistogram(img);
+    unsigned int hist[256];
+    memcpy(hist, bmp8_histogram(img), sizeof(hist));
     unsigned int * hist_eq = bmp8_computeCDF(hist);
-    for (int i = 0; i < img->dataSize; i++) {
-        img->data[i] = hist_eq[img->data[i]] ;
+
+    unsigned char lut[256];
+    for (int i = 0; i < 256; i++) {
+        lut[i] = (unsigned char)hist_eq[i];
     }
+    bmp8_applyLut(img, lut);
     free(hist_eq);
-    free(hist);
-}
\ No newline at end of file
+}
@@ -0,0 +1,474 @@
+/**
+ * geometry.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the geometric transforms. A naive transpose reads the source down its
+ * columns, one cache line per pixel; here the destination is split into
+ * GEOMETRY_TILE x GEOMETRY_TILE tiles, so that the source rows of a tile are loaded once
+ * and reused for every destination row of the tile. Inside a tile, blocks of 4x4 pixels
+ * (8x8 bytes for gray) are transposed in SSE2 registers with unpack instructions.
+ *
+ * Every rotation is a transpose of a view or of a flipped view:
+ *     90 degrees clockwise = transpose of the source read bottom-up,
+ *     270 degrees = transpose written bottom-up into the destination,
+ *     180 degrees = rows copied bottom-up, then mirrored left to right.
+ *
+ * Role in the project:
+ * Provides lossless reorientation of 8-bit and 24/32-bit images.
+ */
+
+
+#include "geometry.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Side of the destination tiles of a transpose, in pixels (two 16 KB color tiles fit in L2)
+#define GEOMETRY_TILE 64
+
+// Rows mirrored per task by view_flipHorizontal
+#define GEOMETRY_FLIP_GRAIN 16
+
+
+/**
+ * transpose_tile32
+ * Transposes the pixels of a color tile: destination rows y0 to y1 - 1, columns x0 to
+ * x1 - 1, read from source rows x0 to x1 - 1, columns y0 to y1 - 1.
+ */
+static void transpose_tile32(const t_view *src, const t_view *dst, int x0, int y0, int x1, int y1) {
+    int y = y0;
+#ifdef __SSE2__
+    for (; y + 4 <= y1; y += 4) {
+        t_pixel *out0 = (t_pixel *)(dst->data + (ptrdiff_t)y * dst->stride);
+        t_pixel *out1 = (t_pixel *)((unsigned char *)out0 + dst->stride);
+        t_pixel *out2 = (t_pixel *)((unsigned char *)out1 + dst->stride);
+        t_pixel *out3 = (t_pixel *)((unsigned char *)out2 + dst->stride);
+        int x = x0;
+        for (; x + 4 <= x1; x += 4) {
+            const unsigned char *in = src->data + (ptrdiff_t)x * src->stride + (size_t)y * sizeof(t_pixel);
+            __m128i r0 = _mm_loadu_si128((const __m128i *)in);
+            __m128i r1 = _mm_loadu_si128((const __m128i *)(in + src->stride));
+            __m128i r2 = _mm_loadu_si128((const __m128i *)(in + 2 * src->stride));
+            __m128i r3 = _mm_loadu_si128((const __m128i *)(in + 3 * src->stride));
+
+            // Pairs of rows interleaved by pixel, then by pairs of pixels
+            __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+            __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+            __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+            __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+            _mm_storeu_si128((__m128i *)(out0 + x), _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128((__m128i *)(out1 + x), _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128((__m128i *)(out2 + x), _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128((__m128i *)(out3 + x), _mm_unpackhi_epi64(t2, t3));
+        }
+        for (; x < x1; x++) {
+            const t_pixel *in = (const t_pixel *)(src->data + (ptrdiff_t)x * src->stride) + y;
+            out0[x] = in[0];
+            out1[x] = in[1];
+            out2[x] = in[2];
+            out3[x] = in[3];
+        }
+    }
+#endif
+    for (; y < y1; y++) {
+        t_pixel *out = (t_pixel *)(dst->data + (ptrdiff_t)y * dst->stride);
+        for (int x = x0; x < x1; x++) {
+            out[x] = ((const t_pixel *)(src->data + (ptrdiff_t)x * src->stride))[y];
+        }
+    }
+}
+
+
+/**
+ * transpose_tile8
+ * Transposes the pixels of a gray tile (same bounds as transpose_tile32).
+ */
+static void transpose_tile8(const t_view *src, const t_view *dst, int x0, int y0, int x1, int y1) {
+    int y = y0;
+#ifdef __SSE2__
+    for (; y + 8 <= y1; y += 8) {
+        unsigned char *out = dst->data + (ptrdiff_t)y * dst->stride;
+        int x = x0;
+        for (; x + 8 <= x1; x += 8) {
+            const unsigned char *in = src->data + (ptrdiff_t)x * src->stride + y;
+            __m128i r[8];
+            for (int i = 0; i < 8; i++) {
+                r[i] = _mm_loadl_epi64((const __m128i *)(in + i * src->stride));
+            }
+
+            // Interleave bytes, then 16-bit pairs, then 32-bit quads: each 64-bit half of
+            // the result is one column of the block
+            __m128i t0 = _mm_unpacklo_epi8(r[0], r[1]);
+            __m128i t1 = _mm_unpacklo_epi8(r[2], r[3]);
+            __m128i t2 = _mm_unpacklo_epi8(r[4], r[5]);
+            __m128i t3 = _mm_unpacklo_epi8(r[6], r[7]);
+            __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+            __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+            __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+            __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+            __m128i c[4] = {_mm_unpacklo_epi32(u0, u2), _mm_unpackhi_epi32(u0, u2),
+                            _mm_unpacklo_epi32(u1, u3), _mm_unpackhi_epi32(u1, u3)};
+            for (int i = 0; i < 4; i++) {
+                _mm_storel_epi64((__m128i *)(out + (2 * i) * dst->stride + x), c[i]);
+                _mm_storel_epi64((__m128i *)(out + (2 * i + 1) * dst->stride + x), _mm_unpackhi_epi64(c[i], c[i]));
+            }
+        }
+        for (; x < x1; x++) {
+            const unsigned char *in = src->data + (ptrdiff_t)x * src->stride + y;
+            for (int i = 0; i < 8; i++) out[i * dst->stride + x] = in[i];
+        }
+    }
+#endif
+    for (; y < y1; y++) {
+        unsigned char *out = dst->data + (ptrdiff_t)y * dst->stride;
+        for (int x = x0; x < x1; x++) {
+            out[x] = src->data[(ptrdiff_t)x * src->stride + y];
+        }
+    }
+}
+
+
+/**
+ * t_transpose
+ * Shared state of a parallel transpose.
+ */
+typedef struct {
+    const t_view *src;
+    const t_view *dst;
+} t_transpose;
+
+
+/**
+ * transpose_band
+ * Transposes the bands of GEOMETRY_TILE destination rows from start to end - 1.
+ */
+static void transpose_band(void *context, int start, int end) {
+    const t_transpose *job = (const t_transpose *)context;
+    const t_view *dst = job->dst;
+    for (int band = start; band < end; band++) {
+        int y0 = band * GEOMETRY_TILE;
+        int y1 = y0 + GEOMETRY_TILE < dst->height ? y0 + GEOMETRY_TILE : dst->height;
+        for (int x0 = 0; x0 < dst->width; x0 += GEOMETRY_TILE) {
+            int x1 = x0 + GEOMETRY_TILE < dst->width ? x0 + GEOMETRY_TILE : dst->width;
+            if (dst->format == VIEW_BGRA32) {
+                transpose_tile32(job->src, dst, x0, y0, x1, y1);
+            } else {
+                transpose_tile8(job->src, dst, x0, y0, x1, y1);
+            }
+        }
+    }
+}
+
+
+/**
+ * view_transpose
+ * Writes the transpose of a view into another: pixel (x, y) of src becomes pixel (y, x)
+ * of dst. Tiles of the destination are processed in parallel.
+ *
+ * Parameters:
+ * src (const t_view*): Pixels to read.
+ * dst (const t_view*): Pixels to write, of the same format, src->height wide and
+ *     src->width high, not overlapping src.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views do not match.
+ */
+int view_transpose(const t_view *src, const t_view *dst) {
+    if (src->format != dst->format || src->width != dst->height || src->height != dst->width) {
+        fprintf(stderr, "Error: Cannot transpose a %dx%d view into a %dx%d view.\n",
+                src->width, src->height, dst->width, dst->height);
+        return -1;
+    }
+
+    t_transpose job = {src, dst};
+    parallel_for((dst->height + GEOMETRY_TILE - 1) / GEOMETRY_TILE, 1, transpose_band, &job);
+    view_touch(dst);
+    return 0;
+}
+
+
+/**
+ * flip_row32
+ * Reverses a row of pixels in place, swapping blocks of 4 pixels from both ends.
+ */
+static void flip_row32(t_pixel *row, int width) {
+    int left = 0;
+    int right = width;
+#ifdef __SSE2__
+    for (; right - left >= 8; left += 4, right -= 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(row + left));
+        __m128i b = _mm_loadu_si128((const __m128i *)(row + right - 4));
+        _mm_storeu_si128((__m128i *)(row + left), _mm_shuffle_epi32(b, 0x1B));
+        _mm_storeu_si128((__m128i *)(row + right - 4), _mm_shuffle_epi32(a, 0x1B));
+    }
+#endif
+    for (right--; left < right; left++, right--) {
+        t_pixel tmp = row[left];
+        row[left] = row[right];
+        row[right] = tmp;
+    }
+}
+
+
+#ifdef __SSE2__
+/**
+ * flip_bytes
+ * Reverses the 16 bytes of a register: 32-bit lanes, then 16-bit halves, then bytes.
+ */
+static inline __m128i flip_bytes(__m128i v) {
+    v = _mm_shuffle_epi32(v, 0x1B);
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+
+
+/**
+ * flip_row8
+ * Reverses a row of bytes in place, swapping blocks of 16 bytes from both ends.
+ */
+static void flip_row8(unsigned char *row, int width) {
+    int left = 0;
+    int right = width;
+#ifdef __SSE2__
+    for (; right - left >= 32; left += 16, right -= 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(row + left));
+        __m128i b = _mm_loadu_si128((const __m128i *)(row + right - 16));
+        _mm_storeu_si128((__m128i *)(row + left), flip_bytes(b));
+        _mm_storeu_si128((__m128i *)(row + right - 16), flip_bytes(a));
+    }
+#endif
+    for (right--; left < right; left++, right--) {
+        unsigned char tmp = row[left];
+        row[left] = row[right];
+        row[right] = tmp;
+    }
+}
+
+
+/**
+ * flip_band
+ * Mirrors rows start to end - 1 of a view.
+ */
+static void flip_band(void *context, int start, int end) {
+    const t_view *view = (const t_view *)context;
+    for (int y = start; y < end; y++) {
+        unsigned char *row = view->data + (ptrdiff_t)y * view->stride;
+        if (view->format == VIEW_BGRA32) {
+            flip_row32((t_pixel *)row, view->width);
+        } else {
+            flip_row8(row, view->width);
+        }
+    }
+}
+
+
+/**
+ * view_flipHorizontal
+ * Mirrors the pixels of a view left to right, in place.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ */
+void view_flipHorizontal(const t_view *view) {
+    parallel_for(view->height, GEOMETRY_FLIP_GRAIN, flip_band, (void *)view);
+    view_touch(view);
+}
+
+
+/**
+ * view_flipVertical
+ * Describes the same pixels upside down, without copying any of them: the view starts
+ * at the last row and its stride is negated.
+ *
+ * Parameters:
+ * view (const t_view*): Parent view.
+ *
+ * Returns:
+ * t_view: The parent view, bottom row first.
+ */
+t_view view_flipVertical(const t_view *view) {
+    t_view flipped = *view;
+    if (view->height > 0) {
+        flipped.data = view->data + (ptrdiff_t)(view->height - 1) * view->stride;
+        flipped.dirtyRow = view->dirtyRow + (view->height - 1) * view->dirtyStep;
+    }
+    flipped.stride = -view->stride;
+    flipped.dirtyStep = -view->dirtyStep;
+    return flipped;
+}
+
+
+/**
+ * geometry_rotate
+ * Writes a rotation of src into dst, whose sides are already swapped for quarter turns.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views do not match.
+ */
+static int geometry_rotate(const t_view *src, const t_view *dst, t_rotation rotation) {
+    switch (rotation) {
+        case ROTATE_90: {
+            t_view bottomUp = view_flipVertical(src);
+            return view_transpose(&bottomUp, dst);
+        }
+        case ROTATE_270: {
+            t_view bottomUp = view_flipVertical(dst);
+            return view_transpose(src, &bottomUp);
+        }
+        case ROTATE_TRANSPOSE:
+            return view_transpose(src, dst);
+        case ROTATE_180: {
+            t_view bottomUp = view_flipVertical(src);
+            size_t rowBytes = (size_t)src->width * (src->format == VIEW_BGRA32 ? sizeof(t_pixel) : 1);
+            for (int y = 0; y < dst->height; y++) {
+                memcpy(view_row(dst, y), view_row(&bottomUp, y), rowBytes);
+            }
+            view_flipHorizontal(dst);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * bmp8_rotate
+ * Creates a rotated or transposed copy of an 8-bit image. The palette is kept.
+ *
+ * Parameters:
+ * img (t_bmp8*): Source image.
+ * rotation (t_rotation): Transform to apply.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp8 *bmp8_rotate(t_bmp8 *img, t_rotation rotation) {
+    if (!img || !img->data) return NULL;
+
+    int quarter = rotation != ROTATE_180;
+    t_bmp8 *out = bmp8_allocate(quarter ? img->height : img->width, quarter ? img->width : img->height);
+    if (!out) return NULL;
+    memcpy(out->colorTable, img->colorTable, sizeof(img->colorTable));
+
+    t_view src = bmp8_view(img);
+    t_view dst = bmp8_view(out);
+    if (geometry_rotate(&src, &dst, rotation) != 0) {
+        bmp8_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+
+/**
+ * bmp24_rotate
+ * Creates a rotated or transposed copy of a 24/32-bit image. The color depth is kept and
+ * the resolutions are swapped with the sides.
+ *
+ * Parameters:
+ * img (t_bmp24*): Source image.
+ * rotation (t_rotation): Transform to apply.
+ *
+ * Returns:
+ * t_bmp24*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp24 *bmp24_rotate(t_bmp24 *img, t_rotation rotation) {
+    if (!img || !img->data) return NULL;
+
+    int quarter = rotation != ROTATE_180;
+    t_bmp24 *out = bmp24_allocate(quarter ? img->height : img->width, quarter ? img->width : img->height,
+                                  img->colorDepth);
+    if (!out) return NULL;
+    out->header_info.compression = img->header_info.compression;
+    out->header_info.xresolution = quarter ? img->header_info.yresolution : img->header_info.xresolution;
+    out->header_info.yresolution = quarter ? img->header_info.xresolution : img->header_info.yresolution;
+
+    t_view src = bmp24_view(img);
+    t_view dst = bmp24_view(out);
+    if (geometry_rotate(&src, &dst, rotation) != 0) {
+        bmp24_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+
+/**
+ * bmp8_flipHorizontal
+ * Mirrors an 8-bit image left to right, in place.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ */
+void bmp8_flipHorizontal(t_bmp8 *img) {
+    if (!img || !img->data) return;
+    t_view view = bmp8_view(img);
+    view_flipHorizontal(&view);
+}
+
+
+/**
+ * bmp24_flipHorizontal
+ * Mirrors a 24/32-bit image left to right, in place.
+ *
+ * Parameters:
+ * img (t_bmp24*): Image to modify.
+ */
+void bmp24_flipHorizontal(t_bmp24 *img) {
+    if (!img || !img->data) return;
+    t_view view = bmp24_view(img);
+    view_flipHorizontal(&view);
+}
+
+
+/**
+ * bmp8_flipVertical
+ * Mirrors an 8-bit image top to bottom, in place, by swapping its rows.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ */
+void bmp8_flipVertical(t_bmp8 *img) {
+    if (!img || !img->data) return;
+
+    // The rows share one buffer with no row pointers, so they are swapped in chunks
+    unsigned char chunk[4096];
+    size_t rowSize = BMP8_ROW_SIZE(img->width);
+    for (unsigned int y = 0; y < img->height / 2; y++) {
+        unsigned char *top = img->data + (size_t)y * rowSize;
+        unsigned char *bottom = img->data + (size_t)(img->height - 1 - y) * rowSize;
+        for (size_t x = 0; x < rowSize; x += sizeof(chunk)) {
+            size_t n = rowSize - x < sizeof(chunk) ? rowSize - x : sizeof(chunk);
+            memcpy(chunk, top + x, n);
+            memcpy(top + x, bottom + x, n);
+            memcpy(bottom + x, chunk, n);
+        }
+    }
+    dirty_markAll(&img->dirty);
+}
+
+
+/**
+ * bmp24_flipVertical
+ * Mirrors a 24/32-bit image top to bottom by reversing its row pointers: no pixel is
+ * copied. The rows stay evenly spaced, so bmp24_view still describes the image (with a
+ * negative stride).
+ *
+ * Parameters:
+ * img (t_bmp24*): Image to modify.
+ */
+void bmp24_flipVertical(t_bmp24 *img) {
+    if (!img || !img->data) return;
+
+    // The block pointer after the last row is left in place for bmp24_freeDataPixels
+    for (int top = 0, bottom = img->height - 1; top < bottom; top++, bottom--) {
+        t_pixel *row = img->data[top];
+        img->data[top] = img->data[bottom];
+        img->data[bottom] = row;
+    }
+    dirty_markAll(&img->dirty);
+}
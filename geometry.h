@@ -0,0 +1,139 @@
+/**
+ * geometry.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the geometric transforms: transpose, rotations by multiples of
+ * 90 degrees, and horizontal and vertical flips. The transpose is cache-blocked: the
+ * destination is written in square tiles whose source rows stay in cache, each tile being
+ * transposed in registers by 4x4 (color) or 8x8 (gray) blocks. The other rotations are
+ * transposes of vertically flipped views, which only reverse a stride.
+ *
+ * Role in the project:
+ * Provides lossless reorientation of 8-bit and 24/32-bit images.
+ */
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include "view.h"
+
+/**
+ * t_rotation
+ * Reorientation applied by bmp8_rotate and bmp24_rotate.
+ *
+ * ROTATE_90: quarter turn clockwise.
+ * ROTATE_180: half turn.
+ * ROTATE_270: quarter turn counterclockwise.
+ * ROTATE_TRANSPOSE: mirror along the main diagonal (the top-left pixel stays in place).
+ */
+typedef enum {
+    ROTATE_90,
+    ROTATE_180,
+    ROTATE_270,
+    ROTATE_TRANSPOSE
+} t_rotation;
+
+/**
+ * view_transpose
+ * Writes the transpose of a view into another: pixel (x, y) of src becomes pixel (y, x)
+ * of dst. Tiles of the destination are processed in parallel.
+ *
+ * Parameters:
+ * src (const t_view*): Pixels to read.
+ * dst (const t_view*): Pixels to write, of the same format, src->height wide and
+ *     src->width high, not overlapping src.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views do not match.
+ */
+int view_transpose(const t_view *src, const t_view *dst);
+
+/**
+ * view_flipHorizontal
+ * Mirrors the pixels of a view left to right, in place.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ */
+void view_flipHorizontal(const t_view *view);
+
+/**
+ * view_flipVertical
+ * Describes the same pixels upside down, without copying any of them: the view starts
+ * at the last row and its stride is negated.
+ *
+ * Parameters:
+ * view (const t_view*): Parent view.
+ *
+ * Returns:
+ * t_view: The parent view, bottom row first.
+ */
+t_view view_flipVertical(const t_view *view);
+
+/**
+ * bmp8_rotate
+ * Creates a rotated or transposed copy of an 8-bit image. The palette is kept.
+ *
+ * Parameters:
+ * img (t_bmp8*): Source image.
+ * rotation (t_rotation): Transform to apply.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp8 * bmp8_rotate(t_bmp8 *img, t_rotation rotation);
+
+/**
+ * bmp24_rotate
+ * Creates a rotated or transposed copy of a 24/32-bit image. The color depth is kept and
+ * the resolutions are swapped with the sides.
+ *
+ * Parameters:
+ * img (t_bmp24*): Source image.
+ * rotation (t_rotation): Transform to apply.
+ *
+ * Returns:
+ * t_bmp24*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp24 * bmp24_rotate(t_bmp24 *img, t_rotation rotation);
+
+/**
+ * bmp8_flipHorizontal
+ * Mirrors an 8-bit image left to right, in place.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ */
+void bmp8_flipHorizontal(t_bmp8 *img);
+
+/**
+ * bmp24_flipHorizontal
+ * Mirrors a 24/32-bit image left to right, in place.
+ *
+ * Parameters:
+ * img (t_bmp24*): Image to modify.
+ */
+void bmp24_flipHorizontal(t_bmp24 *img);
+
+/**
+ * bmp8_flipVertical
+ * Mirrors an 8-bit image top to bottom, in place, by swapping its rows.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ */
+void bmp8_flipVertical(t_bmp8 *img);
+
+/**
+ * bmp24_flipVertical
+ * Mirrors a 24/32-bit image top to bottom by reversing its row pointers: no pixel is
+ * copied. The rows stay evenly spaced, so bmp24_view still describes the image (with a
+ * negative stride).
+ *
+ * Parameters:
+ * img (t_bmp24*): Image to modify.
+ */
+void bmp24_flipVertical(t_bmp24 *img);
+
+#endif // GEOMETRY_H
@@ -0,0 +1,78 @@
+/**
+ * gradient.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the fused gradient operator. The horizontal and vertical
+ * derivatives (Sobel or Scharr) of each pixel are computed together from three source
+ * rows, and only their magnitude (and, on request, their direction) is written, in a
+ * single pass over the image.
+ *
+ * Role in the project:
+ * Provides edge detection on 8-bit images and on the luma of color images.
+ */
+
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+#include "bmp8.h"
+#include "bmp24.h"
+
+/**
+ * t_gradient_operator
+ * Derivative kernels.
+ *
+ * GRADIENT_SOBEL: smoothing weights 1, 2, 1.
+ * GRADIENT_SCHARR: smoothing weights 3, 10, 3 (more accurate direction).
+ */
+typedef enum {
+    GRADIENT_SOBEL,
+    GRADIENT_SCHARR
+} t_gradient_operator;
+
+/**
+ * t_gradient_norm
+ * Magnitude of a gradient (gx, gy).
+ *
+ * GRADIENT_L1: |gx| + |gy|.
+ * GRADIENT_L2: sqrt(gx^2 + gy^2), with a fast approximate square root.
+ */
+typedef enum {
+    GRADIENT_L1,
+    GRADIENT_L2
+} t_gradient_norm;
+
+/**
+ * bmp8_gradient
+ * Computes the gradient magnitude of an 8-bit image, saturated to 255. Edge pixels are
+ * replicated outside the image. Rows are split into bands processed in parallel.
+ *
+ * Parameters:
+ * img (const t_bmp8*): Source image (grayscale palette).
+ * op (t_gradient_operator): Derivative kernels.
+ * norm (t_gradient_norm): Magnitude formula.
+ * orientation (t_bmp8**): If not NULL, receives an image of the gradient directions:
+ *     angle atan2(gy, gx), y pointing down, mapped from [0, 2 pi) to [0, 256).
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the magnitude image, or NULL on failure.
+ */
+t_bmp8 * bmp8_gradient(const t_bmp8 *img, t_gradient_operator op, t_gradient_norm norm, t_bmp8 **orientation);
+
+/**
+ * bmp24_gradient
+ * Computes the gradient magnitude of the BT.601 luma of a color image. The luma is
+ * computed row by row inside the pass; no grayscale copy of the image is made.
+ *
+ * Parameters:
+ * img (const t_bmp24*): Source image.
+ * op (t_gradient_operator): Derivative kernels.
+ * norm (t_gradient_norm): Magnitude formula.
+ * orientation (t_bmp8**): If not NULL, receives the gradient directions (see bmp8_gradient).
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the magnitude image, or NULL on failure.
+ */
+t_bmp8 * bmp24_gradient(const t_bmp24 *img, t_gradient_operator op, t_gradient_norm norm, t_bmp8 **orientation);
+
+#endif // GRADIENT_H
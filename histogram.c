@@ -0,0 +1,251 @@
+/**
+ * histogram.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the cached histogram. The cache records the version of the modified-row
+ * tracker of the image at the time the counts were taken; every operation that changes
+ * pixels flags rows in that tracker, which increments its version, so a stale cache is
+ * detected without the operations having to know about it.
+ *
+ * Counting uses four partial histograms per band, so that runs of equal pixels do not
+ * wait on the previous increment of the same counter; the bands are added together
+ * under a lock.
+ *
+ * Role in the project:
+ * Avoids recomputing the histogram for threshold selection, statistics and equalization.
+ */
+
+
+#include <pthread.h>
+#include "histogram.h"
+#include "parallel.h"
+
+/**
+ * t_histogram_job
+ * Shared state of a histogram computation or of a lookup table pass.
+ */
+typedef struct {
+    t_bmp8 *img;
+    const unsigned char *lut;
+    unsigned int counts[256];
+    pthread_mutex_t lock;
+} t_histogram_job;
+
+
+/**
+ * histogram_countBand
+ * Counts the stored rows [start, end).
+ */
+static void histogram_countBand(void *context, int start, int end) {
+    t_histogram_job *job = (t_histogram_job *)context;
+    const t_bmp8 *img = job->img;
+    unsigned int partial[4][256] = {{0}};
+
+    for (int y = start; y < end; y++) {
+        const unsigned char *row = img->data + (size_t)y * BMP8_ROW_SIZE(img->width);
+        unsigned int x = 0;
+        for (; x + 4 <= img->width; x += 4) {
+            partial[0][row[x]]++;
+            partial[1][row[x + 1]]++;
+            partial[2][row[x + 2]]++;
+            partial[3][row[x + 3]]++;
+        }
+        for (; x < img->width; x++) partial[0][row[x]]++;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    for (int v = 0; v < 256; v++) {
+        job->counts[v] += partial[0][v] + partial[1][v] + partial[2][v] + partial[3][v];
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+
+/**
+ * bmp8_histogram
+ * Returns the histogram of an image, computing it (in parallel) only if a pixel changed
+ * since the last time.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image.
+ *
+ * Returns:
+ * const unsigned int*: 256 counts owned by the image, or NULL if img is NULL.
+ */
+const unsigned int *bmp8_histogram(t_bmp8 *img) {
+    if (!img) return NULL;
+    t_histogram_cache *cache = &img->histogram;
+    if (cache->valid && cache->version == img->dirty.version) return cache->counts;
+
+    t_histogram_job job;
+    job.img = img;
+    job.lut = NULL;
+    memset(job.counts, 0, sizeof(job.counts));
+    pthread_mutex_init(&job.lock, NULL);
+    if (img->data) parallel_for((int)img->height, 16, histogram_countBand, &job);
+    pthread_mutex_destroy(&job.lock);
+
+    memcpy(cache->counts, job.counts, sizeof(job.counts));
+    cache->version = img->dirty.version;
+    cache->valid = 1;
+    return cache->counts;
+}
+
+
+/**
+ * bmp8_histogramRemap
+ * Updates the cached histogram after a point operation. If the histogram was current
+ * before the operation, its counts are moved through the table and it is current again;
+ * otherwise nothing is done (it will be recomputed when needed).
+ *
+ * Parameters:
+ * img (t_bmp8*): Image the operation was applied to.
+ * lut (const unsigned char*): Table of the operation (new value of each of the 256 values).
+ * version (unsigned long): img->dirty.version read before the operation.
+ */
+void bmp8_histogramRemap(t_bmp8 *img, const unsigned char *lut, unsigned long version) {
+    t_histogram_cache *cache = &img->histogram;
+    if (!cache->valid || cache->version != version) return;
+
+    unsigned int counts[256] = {0};
+    for (int v = 0; v < 256; v++) counts[lut[v]] += cache->counts[v];
+    memcpy(cache->counts, counts, sizeof(counts));
+    cache->version = img->dirty.version;
+}
+
+
+/**
+ * histogram_lutBand
+ * Applies the lookup table of the job to the stored rows [start, end).
+ */
+static void histogram_lutBand(void *context, int start, int end) {
+    t_histogram_job *job = (t_histogram_job *)context;
+    t_bmp8 *img = job->img;
+
+    for (int y = start; y < end; y++) {
+        unsigned char *row = img->data + (size_t)y * BMP8_ROW_SIZE(img->width);
+        for (unsigned int x = 0; x < img->width; x++) row[x] = job->lut[row[x]];
+    }
+}
+
+
+/**
+ * bmp8_applyLut
+ * Replaces every pixel value by its entry in a lookup table, in parallel, and updates
+ * the cached histogram.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ * lut (const unsigned char*): New value of each of the 256 values.
+ */
+void bmp8_applyLut(t_bmp8 *img, const unsigned char *lut) {
+    if (!img || !img->data || !lut) return;
+
+    t_histogram_job job;
+    job.img = img;
+    job.lut = lut;
+    parallel_for((int)img->height, 16, histogram_lutBand, &job);
+
+    unsigned long version = img->dirty.version;
+    dirty_markAll(&img->dirty);
+    bmp8_histogramRemap(img, lut, version);
+}
+
+
+/**
+ * bmp8_otsuThreshold
+ * Chooses the threshold that maximizes the variance between the dark and bright classes
+ * of the histogram (Otsu's method).
+ *
+ * Parameters:
+ * img (t_bmp8*): Image.
+ *
+ * Returns:
+ * int: Threshold to pass to bmp8_threshold (values at or above it are foreground).
+ */
+int bmp8_otsuThreshold(t_bmp8 *img) {
+    const unsigned int *hist = bmp8_histogram(img);
+    if (!hist) return 128;
+
+    double total = 0.0;
+    double sum = 0.0;
+    for (int v = 0; v < 256; v++) {
+        total += hist[v];
+        sum += (double)v * hist[v];
+    }
+
+    // Dark class: values 0 .. k; between-class variance up to the constant factor 1 / total^2
+    double weight = 0.0;
+    double darkSum = 0.0;
+    double best = -1.0;
+    int threshold = 128;
+    for (int k = 0; k < 255; k++) {
+        weight += hist[k];
+        darkSum += (double)k * hist[k];
+        double bright = total - weight;
+        if (weight == 0.0 || bright == 0.0) continue;
+
+        double difference = darkSum / weight - (sum - darkSum) / bright;
+        double variance = weight * bright * difference * difference;
+        if (variance > best) {
+            best = variance;
+            threshold = k + 1;
+        }
+    }
+    return threshold;
+}
+
+
+/**
+ * bmp8_percentileStretch
+ * Stretches the contrast linearly so that the low percentile of the pixels becomes 0
+ * and the high percentile becomes 255; values outside are clipped.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ * low (double): Lower percentile (0 to 100), e.g. 1.
+ * high (double): Upper percentile (0 to 100), e.g. 99.
+ */
+void bmp8_percentileStretch(t_bmp8 *img, double low, double high) {
+    const unsigned int *hist = bmp8_histogram(img);
+    if (!hist || !img->data || low < 0.0 || high > 100.0 || low >= high) return;
+
+    double total = (double)img->width * img->height;
+    double lowCount = total * low / 100.0;
+    double highCount = total * high / 100.0;
+
+    // first: darkest value with more than lowCount pixels at or below it; last: same with highCount
+    int first = -1;
+    int last = 255;
+    double cumulative = 0.0;
+    for (int v = 0; v < 256; v++) {
+        cumulative += hist[v];
+        if (first < 0 && cumulative > lowCount) first = v;
+        if (cumulative >= highCount) {
+            last = v;
+            break;
+        }
+    }
+    if (first < 0 || last <= first) return;
+
+    unsigned char lut[256];
+    for (int v = 0; v < 256; v++) {
+        if (v <= first) lut[v] = 0;
+        else if (v >= last) lut[v] = 255;
+        else lut[v] = (unsigned char)(((v - first) * 510 / (last - first) + 1) / 2);
+    }
+    bmp8_applyLut(img, lut);
+}
+
+
+/**
+ * bmp8_autoLevels
+ * Stretches the contrast so that the darkest pixel becomes 0 and the brightest 255.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ */
+void bmp8_autoLevels(t_bmp8 *img) {
+    bmp8_percentileStretch(img, 0.0, 100.0);
+}
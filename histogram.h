@@ -0,0 +1,93 @@
+/**
+ * histogram.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the cached histogram of 8-bit images and the automatic operations
+ * built on it. The histogram is stored in the image and stays valid until a pixel changes;
+ * point operations (negative, brightness, threshold, lookup tables) move the counts
+ * through their table instead of invalidating them, so a chain of point operations never
+ * rescans the image. Otsu thresholding, auto-levels and percentile stretch then only
+ * cost 256 steps on top of the lookup table pass.
+ *
+ * Role in the project:
+ * Avoids recomputing the histogram for threshold selection, statistics and equalization.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "bmp8.h"
+
+/**
+ * bmp8_histogram
+ * Returns the histogram of an image, computing it (in parallel) only if a pixel changed
+ * since the last time.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image.
+ *
+ * Returns:
+ * const unsigned int*: 256 counts owned by the image, or NULL if img is NULL.
+ */
+const unsigned int * bmp8_histogram(t_bmp8 *img);
+
+/**
+ * bmp8_histogramRemap
+ * Updates the cached histogram after a point operation. If the histogram was current
+ * before the operation, its counts are moved through the table and it is current again;
+ * otherwise nothing is done (it will be recomputed when needed).
+ *
+ * Parameters:
+ * img (t_bmp8*): Image the operation was applied to.
+ * lut (const unsigned char*): Table of the operation (new value of each of the 256 values).
+ * version (unsigned long): img->dirty.version read before the operation.
+ */
+void bmp8_histogramRemap(t_bmp8 *img, const unsigned char *lut, unsigned long version);
+
+/**
+ * bmp8_applyLut
+ * Replaces every pixel value by its entry in a lookup table, in parallel, and updates
+ * the cached histogram.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ * lut (const unsigned char*): New value of each of the 256 values.
+ */
+void bmp8_applyLut(t_bmp8 *img, const unsigned char *lut);
+
+/**
+ * bmp8_otsuThreshold
+ * Chooses the threshold that maximizes the variance between the dark and bright classes
+ * of the histogram (Otsu's method).
+ *
+ * Parameters:
+ * img (t_bmp8*): Image.
+ *
+ * Returns:
+ * int: Threshold to pass to bmp8_threshold (values at or above it are foreground).
+ */
+int bmp8_otsuThreshold(t_bmp8 *img);
+
+/**
+ * bmp8_percentileStretch
+ * Stretches the contrast linearly so that the low percentile of the pixels becomes 0
+ * and the high percentile becomes 255; values outside are clipped.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ * low (double): Lower percentile (0 to 100), e.g. 1.
+ * high (double): Upper percentile (0 to 100), e.g. 99.
+ */
+void bmp8_percentileStretch(t_bmp8 *img, double low, double high);
+
+/**
+ * bmp8_autoLevels
+ * Stretches the contrast so that the darkest pixel becomes 0 and the brightest 255.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify.
+ */
+void bmp8_autoLevels(t_bmp8 *img);
+
+#endif // HISTOGRAM_H
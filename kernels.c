@@ -0,0 +1,320 @@
+/**
+ * kernels.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the convolution row functions. The generic and size-specialized versions
+ * are generated from the same macro, the size being either the run-time argument or a
+ * constant the compiler unrolls. The presets are listed once in KERNEL_PRESETS; that
+ * list generates, for each preset, a gray and a color row function whose taps are
+ * written out with their integer weights (a zero weight expands to 0 and disappears),
+ * and the table used to match kernels and names.
+ *
+ * Role in the project:
+ * Provides the fast inner loops of every whole-image and region convolution.
+ */
+
+
+#include "kernels.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Largest difference between a kernel weight and a preset weight still matching it
+#define KERNEL_EPSILON 1e-6f
+
+
+/**
+ * kernel_saturate
+ * Clamps a value to [0, 255] (local to this file so that it can be inlined).
+ */
+static int kernel_saturate(int value) {
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+
+/**
+ * KERNEL_GRAY_ROW
+ * Defines a gray row function for a kernel size SIZE (a constant, or the size argument).
+ */
+#define KERNEL_GRAY_ROW(NAME, SIZE) \
+static void NAME(unsigned char *out, unsigned char *const *lines, int width, \
+                 const float *kernel, int size) { \
+    (void)size; \
+    const int n = (SIZE) / 2; \
+    for (int x = n; x < width - n; x++) { \
+        float sum = 0.0f; \
+        for (int ky = 0; ky < (SIZE); ky++) { \
+            const unsigned char *line = lines[ky] + x - n; \
+            const float *weights = kernel + ky * (SIZE); \
+            for (int kx = 0; kx < (SIZE); kx++) { \
+                sum += line[kx] * weights[kx]; \
+            } \
+        } \
+        out[x] = (unsigned char)kernel_saturate((int)sum); \
+    } \
+}
+
+#ifdef __SSE2__
+/**
+ * KERNEL_COLOR_ROW
+ * Defines a color row function for a kernel size SIZE. The 4 channels of a pixel are
+ * convolved together in one float vector.
+ */
+#define KERNEL_COLOR_ROW(NAME, SIZE) \
+static void NAME(unsigned char *out, unsigned char *const *lines, int width, \
+                 const float *kernel, int size) { \
+    (void)size; \
+    const int n = (SIZE) / 2; \
+    const __m128i zero = _mm_setzero_si128(); \
+    for (int x = n; x < width - n; x++) { \
+        __m128 sum = _mm_setzero_ps(); \
+        for (int ky = 0; ky < (SIZE); ky++) { \
+            const unsigned char *line = lines[ky] + (size_t)(x - n) * 4; \
+            const float *weights = kernel + ky * (SIZE); \
+            for (int kx = 0; kx < (SIZE); kx++) { \
+                int packed; \
+                memcpy(&packed, line + kx * 4, sizeof(packed)); \
+                __m128i pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero); \
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(pixel), _mm_set1_ps(weights[kx]))); \
+            } \
+        } \
+        __m128i values = _mm_cvttps_epi32(sum); \
+        values = _mm_packs_epi32(values, values); \
+        int packed = _mm_cvtsi128_si32(_mm_packus_epi16(values, values)); \
+        memcpy(out + (size_t)x * 4, &packed, sizeof(packed)); \
+    } \
+}
+#else
+#define KERNEL_COLOR_ROW(NAME, SIZE) \
+static void NAME(unsigned char *out, unsigned char *const *lines, int width, \
+                 const float *kernel, int size) { \
+    (void)size; \
+    const int n = (SIZE) / 2; \
+    for (int i = n * 4; i < (width - n) * 4; i++) { \
+        float sum = 0.0f; \
+        for (int ky = 0; ky < (SIZE); ky++) { \
+            const unsigned char *line = lines[ky] + i - n * 4; \
+            const float *weights = kernel + ky * (SIZE); \
+            for (int kx = 0; kx < (SIZE); kx++) { \
+                sum += line[kx * 4] * weights[kx]; \
+            } \
+        } \
+        out[i] = (unsigned char)kernel_saturate((int)sum); \
+    } \
+}
+#endif
+
+KERNEL_GRAY_ROW(kernel_grayAny, size)
+KERNEL_GRAY_ROW(kernel_gray3, 3)
+KERNEL_GRAY_ROW(kernel_gray5, 5)
+KERNEL_GRAY_ROW(kernel_gray7, 7)
+KERNEL_COLOR_ROW(kernel_colorAny, size)
+KERNEL_COLOR_ROW(kernel_color3, 3)
+KERNEL_COLOR_ROW(kernel_color5, 5)
+KERNEL_COLOR_ROW(kernel_color7, 7)
+
+
+/**
+ * KERNEL_PRESETS
+ * Named 3x3 kernels: name, divisor, then the nine integer weights row by row.
+ */
+#define KERNEL_PRESETS(X) \
+    X(box, 9, 1, 1, 1, 1, 1, 1, 1, 1, 1) \
+    X(gaussian, 16, 1, 2, 1, 2, 4, 2, 1, 2, 1) \
+    X(outline, 1, -1, -1, -1, -1, 8, -1, -1, -1, -1) \
+    X(emboss, 1, -2, -1, 0, -1, 1, 1, 0, 1, 2) \
+    X(sharpen, 1, 0, -1, 0, -1, 5, -1, 0, -1, 0)
+
+// One tap of a preset: a zero weight expands to a constant 0 the compiler drops
+#define KERNEL_TAP(KY, KX, W, CHANNELS) ((W) ? (W) * lines[KY][i + ((KX) - 1) * (CHANNELS)] : 0)
+
+#define KERNEL_SUM3(CHANNELS, W00, W01, W02, W10, W11, W12, W20, W21, W22) \
+    (KERNEL_TAP(0, 0, W00, CHANNELS) + KERNEL_TAP(0, 1, W01, CHANNELS) + KERNEL_TAP(0, 2, W02, CHANNELS) + \
+     KERNEL_TAP(1, 0, W10, CHANNELS) + KERNEL_TAP(1, 1, W11, CHANNELS) + KERNEL_TAP(1, 2, W12, CHANNELS) + \
+     KERNEL_TAP(2, 0, W20, CHANNELS) + KERNEL_TAP(2, 1, W21, CHANNELS) + KERNEL_TAP(2, 2, W22, CHANNELS))
+
+#ifdef __SSE2__
+/**
+ * KERNEL_TAP16
+ * Adds one tap to the 16-bit sums of 16 bytes. Zero weights generate no code, weights
+ * of 1 and -1 no multiplication. The weights of the presets are small enough for the
+ * sums to fit in 16 bits.
+ */
+#define KERNEL_TAP16(KY, KX, W, CHANNELS) \
+    if ((W) != 0) { \
+        __m128i v = _mm_loadu_si128((const __m128i *)(lines[KY] + i + ((KX) - 1) * (CHANNELS))); \
+        __m128i vlo = _mm_unpacklo_epi8(v, zero); \
+        __m128i vhi = _mm_unpackhi_epi8(v, zero); \
+        if ((W) == 1) { \
+            lo = _mm_add_epi16(lo, vlo); \
+            hi = _mm_add_epi16(hi, vhi); \
+        } else if ((W) == -1) { \
+            lo = _mm_sub_epi16(lo, vlo); \
+            hi = _mm_sub_epi16(hi, vhi); \
+        } else { \
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(vlo, _mm_set1_epi16(W))); \
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(vhi, _mm_set1_epi16(W))); \
+        } \
+    }
+
+#define KERNEL_SUM16(CHANNELS, W00, W01, W02, W10, W11, W12, W20, W21, W22) \
+    KERNEL_TAP16(0, 0, W00, CHANNELS) KERNEL_TAP16(0, 1, W01, CHANNELS) KERNEL_TAP16(0, 2, W02, CHANNELS) \
+    KERNEL_TAP16(1, 0, W10, CHANNELS) KERNEL_TAP16(1, 1, W11, CHANNELS) KERNEL_TAP16(1, 2, W12, CHANNELS) \
+    KERNEL_TAP16(2, 0, W20, CHANNELS) KERNEL_TAP16(2, 1, W21, CHANNELS) KERNEL_TAP16(2, 2, W22, CHANNELS)
+
+/**
+ * KERNEL_PRESET_SIMD
+ * Computes 16 output bytes per iteration. Presets with a divisor have non-negative
+ * weights, and sum / divisor is exact as (sum * ceil(65536 / divisor)) >> 16 for the
+ * divisors used (up to 16). packus then clamps to [0, 255].
+ */
+#define KERNEL_PRESET_SIMD(CHANNELS, DIVISOR, ...) \
+    const __m128i zero = _mm_setzero_si128(); \
+    const __m128i reciprocal = _mm_set1_epi16((short)((65536 + (DIVISOR) - 1) / (DIVISOR))); \
+    for (; i + 16 <= end; i += 16) { \
+        __m128i lo = zero; \
+        __m128i hi = zero; \
+        KERNEL_SUM16(CHANNELS, __VA_ARGS__) \
+        if ((DIVISOR) > 1) { \
+            lo = _mm_mulhi_epu16(lo, reciprocal); \
+            hi = _mm_mulhi_epu16(hi, reciprocal); \
+        } \
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi)); \
+    }
+#else
+#define KERNEL_PRESET_SIMD(CHANNELS, DIVISOR, ...)
+#endif
+
+/**
+ * KERNEL_PRESET_ROW
+ * Defines a row function for a preset, working on each byte of the row
+ * (CHANNELS bytes per pixel) with integer arithmetic.
+ */
+#define KERNEL_PRESET_ROW(NAME, CHANNELS, DIVISOR, ...) \
+static void NAME(unsigned char *out, unsigned char *const *lines, int width, \
+                 const float *kernel, int size) { \
+    (void)kernel; \
+    (void)size; \
+    int i = (CHANNELS); \
+    int end = (width - 1) * (CHANNELS); \
+    KERNEL_PRESET_SIMD(CHANNELS, DIVISOR, __VA_ARGS__) \
+    for (; i < end; i++) { \
+        int sum = KERNEL_SUM3(CHANNELS, __VA_ARGS__); \
+        out[i] = (unsigned char)kernel_saturate(sum / (DIVISOR)); \
+    } \
+}
+
+#define KERNEL_PRESET_ROWS(NAME, DIVISOR, ...) \
+    KERNEL_PRESET_ROW(kernel_##NAME##Gray, 1, DIVISOR, __VA_ARGS__) \
+    KERNEL_PRESET_ROW(kernel_##NAME##Color, 4, DIVISOR, __VA_ARGS__)
+
+#define KERNEL_PRESET_ENTRY(NAME, DIVISOR, ...) \
+    {#NAME, DIVISOR, {__VA_ARGS__}, kernel_##NAME##Gray, kernel_##NAME##Color},
+
+KERNEL_PRESETS(KERNEL_PRESET_ROWS)
+
+static const t_kernel_preset presets[] = {
+    KERNEL_PRESETS(KERNEL_PRESET_ENTRY)
+};
+
+#define KERNEL_PRESET_COUNT (int)(sizeof(presets) / sizeof(presets[0]))
+
+
+/**
+ * kernel_select
+ * Finds the fastest row functions computing a kernel: the preset with the same weights,
+ * otherwise the version specialized for its size, otherwise the generic version.
+ *
+ * Parameters:
+ * kernel (const float*): size x size weights, row by row.
+ * size (int): Odd kernel size.
+ *
+ * Returns:
+ * t_kernel_impl: Selected row functions.
+ */
+t_kernel_impl kernel_select(const float *kernel, int size) {
+    if (size == 3) {
+        for (int p = 0; p < KERNEL_PRESET_COUNT; p++) {
+            int match = 1;
+            for (int i = 0; i < 9 && match; i++) {
+                float weight = (float)presets[p].weights[i] / presets[p].divisor;
+                match = fabsf(kernel[i] - weight) <= KERNEL_EPSILON;
+            }
+            if (match) {
+                t_kernel_impl impl = {presets[p].gray, presets[p].color, presets[p].name};
+                return impl;
+            }
+        }
+    }
+
+    t_kernel_impl impl;
+    switch (size) {
+        case 3: impl = (t_kernel_impl){kernel_gray3, kernel_color3, "3x3"}; break;
+        case 5: impl = (t_kernel_impl){kernel_gray5, kernel_color5, "5x5"}; break;
+        case 7: impl = (t_kernel_impl){kernel_gray7, kernel_color7, "7x7"}; break;
+        default: impl = (t_kernel_impl){kernel_grayAny, kernel_colorAny, "generic"}; break;
+    }
+    return impl;
+}
+
+
+/**
+ * kernel_presetCount
+ * Number of named presets.
+ *
+ * Returns:
+ * int: Number of presets.
+ */
+int kernel_presetCount(void) {
+    return KERNEL_PRESET_COUNT;
+}
+
+
+/**
+ * kernel_preset
+ * Named preset by index.
+ *
+ * Parameters:
+ * index (int): Index in [0, kernel_presetCount()).
+ *
+ * Returns:
+ * const t_kernel_preset*: The preset, or NULL if the index is out of range.
+ */
+const t_kernel_preset *kernel_preset(int index) {
+    return index >= 0 && index < KERNEL_PRESET_COUNT ? &presets[index] : NULL;
+}
+
+
+/**
+ * kernel_findPreset
+ * Named preset by name.
+ *
+ * Parameters:
+ * name (const char*): Name of the preset.
+ *
+ * Returns:
+ * const t_kernel_preset*: The preset, or NULL if there is none with this name.
+ */
+const t_kernel_preset *kernel_findPreset(const char *name) {
+    for (int p = 0; p < KERNEL_PRESET_COUNT; p++) {
+        if (strcmp(presets[p].name, name) == 0) return &presets[p];
+    }
+    return NULL;
+}
+
+
+/**
+ * kernel_presetWeights
+ * Floating-point weights of a preset (integer weights divided by the divisor).
+ *
+ * Parameters:
+ * preset (const t_kernel_preset*): Preset.
+ * weights (float[9]): Receives the weights, row by row.
+ */
+void kernel_presetWeights(const t_kernel_preset *preset, float weights[9]) {
+    for (int i = 0; i < 9; i++) {
+        weights[i] = (float)preset->weights[i] / preset->divisor;
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ * kernels.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the convolution row functions. A row function computes one
+ * output row from the kernelSize source rows around it. Besides the generic version,
+ * versions are generated at compile time for 3x3, 5x5 and 7x7 kernels (constant loop
+ * bounds, fully unrolled) and for each named preset (integer weights written in the
+ * code, zero weights removed, a single division at the end). kernel_select picks the
+ * most specialized version matching a kernel.
+ *
+ * Role in the project:
+ * Provides the fast inner loops of every whole-image and region convolution.
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "utils.h"
+
+/**
+ * t_kernel_row
+ * Computes the pixels x in [size / 2, width - size / 2) of an output row.
+ * Color rows hold t_pixel values; their alpha bytes are filtered too and must be
+ * restored by the caller.
+ *
+ * Parameters:
+ * out (unsigned char*): Output row.
+ * lines (unsigned char* const*): The size source rows centered on the output row, top first.
+ * width (int): Width of the rows in pixels.
+ * kernel (const float*): size x size weights, row by row (unused by the presets).
+ * size (int): Kernel size (unused by the specialized versions).
+ */
+typedef void (*t_kernel_row)(unsigned char *out, unsigned char *const *lines, int width,
+                             const float *kernel, int size);
+
+/**
+ * t_kernel_impl
+ * Row functions selected for a kernel.
+ *
+ * Members:
+ * gray (t_kernel_row): Version for one byte per pixel.
+ * color (t_kernel_row): Version for t_pixel rows.
+ * name (const char*): Preset name, "NxN" for a size-specialized version or "generic".
+ */
+typedef struct {
+    t_kernel_row gray;
+    t_kernel_row color;
+    const char *name;
+} t_kernel_impl;
+
+/**
+ * t_kernel_preset
+ * Named 3x3 kernel with integer weights.
+ *
+ * Members:
+ * name (const char*): Name of the kernel (box, gaussian, outline, emboss, sharpen).
+ * divisor (int): The kernel is weights / divisor.
+ * weights (int[9]): Integer weights, row by row.
+ * gray, color (t_kernel_row): Row functions generated for this kernel.
+ */
+typedef struct {
+    const char *name;
+    int divisor;
+    int weights[9];
+    t_kernel_row gray;
+    t_kernel_row color;
+} t_kernel_preset;
+
+/**
+ * kernel_select
+ * Finds the fastest row functions computing a kernel: the preset with the same weights,
+ * otherwise the version specialized for its size, otherwise the generic version.
+ *
+ * Parameters:
+ * kernel (const float*): size x size weights, row by row.
+ * size (int): Odd kernel size.
+ *
+ * Returns:
+ * t_kernel_impl: Selected row functions.
+ */
+t_kernel_impl kernel_select(const float *kernel, int size);
+
+/**
+ * kernel_presetCount
+ * Number of named presets.
+ *
+ * Returns:
+ * int: Number of presets.
+ */
+int kernel_presetCount(void);
+
+/**
+ * kernel_preset
+ * Named preset by index.
+ *
+ * Parameters:
+ * index (int): Index in [0, kernel_presetCount()).
+ *
+ * Returns:
+ * const t_kernel_preset*: The preset, or NULL if the index is out of range.
+ */
+const t_kernel_preset * kernel_preset(int index);
+
+/**
+ * kernel_findPreset
+ * Named preset by name.
+ *
+ * Parameters:
+ * name (const char*): Name of the preset.
+ *
+ * Returns:
+ * const t_kernel_preset*: The preset, or NULL if there is none with this name.
+ */
+const t_kernel_preset * kernel_findPreset(const char *name);
+
+/**
+ * kernel_presetWeights
+ * Floating-point weights of a preset (integer weights divided by the divisor).
+ *
+ * Parameters:
+ * preset (const t_kernel_preset*): Preset.
+ * weights (float[9]): Receives the weights, row by row.
+ */
+void kernel_presetWeights(const t_kernel_preset *preset, float weights[9]);
+
+#endif // KERNELS_H
@@ -0,0 +1,506 @@
+/**
+ * label.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the connected-component labeling. The image is cut into one band of rows
+ * per thread. Inside a band, each row is split into runs of foreground pixels, and each
+ * run takes the label of the runs of the previous row that it touches; when it touches
+ * runs of different labels, these labels are joined in a union-find table local to the
+ * band (the smaller label becomes the root). The area, bounding box and coordinate sums
+ * of each run are added to its label on the fly, so the measures need no second pass.
+ *
+ * The bands are then joined: the local labels are numbered one after another in a global
+ * table, and the runs of the first row of each band are joined with the touching runs of
+ * the last row of the band above. The roots of the global table, in increasing order,
+ * become the components, and the measures of every label are added to its component.
+ *
+ * Role in the project:
+ * Counts and measures the blobs (particles, defects...) of a thresholded image.
+ */
+
+
+#include <stdint.h>
+#include "label.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * t_label_run
+ * Foreground pixels start .. end (included) of a row, with the label they were given.
+ */
+typedef struct {
+    int start;
+    int end;
+    unsigned int label;
+} t_label_run;
+
+/**
+ * t_label_stats
+ * Measures accumulated for one label.
+ */
+typedef struct {
+    unsigned int area;
+    int left;
+    int top;
+    int right;
+    int bottom;
+    unsigned long long sumX;
+    unsigned long long sumY;
+} t_label_stats;
+
+/**
+ * t_label_band
+ * Rows [first, last) of the image and the labels created for them. Label 0 is unused.
+ *
+ * Members:
+ * parent (unsigned int*): Union-find table of the local labels.
+ * stats (t_label_stats*): Measures of each local label.
+ * count (unsigned int): Number of local labels.
+ * capacity (unsigned int): Allocated size of parent and stats.
+ * offset (unsigned int): Global number of local label 0.
+ * firstRuns, lastRuns (t_label_run*): Runs of the first and last rows, for the joining.
+ */
+typedef struct {
+    int first;
+    int last;
+    unsigned int *parent;
+    t_label_stats *stats;
+    unsigned int count;
+    unsigned int capacity;
+    unsigned int offset;
+    t_label_run *firstRuns;
+    t_label_run *lastRuns;
+    int firstCount;
+    int lastCount;
+    int failed;
+} t_label_band;
+
+/**
+ * t_label_job
+ * Shared state of a labeling.
+ */
+typedef struct {
+    const t_bmp8 *img;
+    int reach;
+    unsigned int *labels;
+    t_label_band *bands;
+    const unsigned int *global;
+} t_label_job;
+
+
+/**
+ * label_runs
+ * Splits a row into runs of non-zero pixels. With SSE2, 16 background or 16 foreground
+ * pixels are skipped per comparison.
+ *
+ * Returns:
+ * int: Number of runs written to runs (at most (width + 1) / 2).
+ */
+static int label_runs(const unsigned char *row, int width, t_label_run *runs) {
+    int count = 0;
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+#endif
+
+    while (x < width) {
+#ifdef __SSE2__
+        while (x + 16 <= width) {
+            unsigned int background = (unsigned int)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(row + x)), zero));
+            if (background != 0xFFFF) {
+                x += __builtin_ctz(~background);
+                break;
+            }
+            x += 16;
+        }
+#endif
+        while (x < width && !row[x]) x++;
+        if (x >= width) break;
+
+        int start = x;
+#ifdef __SSE2__
+        while (x + 16 <= width) {
+            unsigned int background = (unsigned int)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(row + x)), zero));
+            if (background != 0) {
+                x += __builtin_ctz(background);
+                break;
+            }
+            x += 16;
+        }
+#endif
+        while (x < width && row[x]) x++;
+        runs[count].start = start;
+        runs[count].end = x - 1;
+        runs[count].label = 0;
+        count++;
+    }
+    return count;
+}
+
+
+/**
+ * label_find
+ * Root of a label, halving the path on the way.
+ */
+static unsigned int label_find(unsigned int *parent, unsigned int label) {
+    while (parent[label] != label) {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+
+/**
+ * label_union
+ * Joins the sets of two labels under the smaller root.
+ *
+ * Returns:
+ * unsigned int: The root of the joined set.
+ */
+static unsigned int label_union(unsigned int *parent, unsigned int a, unsigned int b) {
+    a = label_find(parent, a);
+    b = label_find(parent, b);
+    if (a < b) {
+        parent[b] = a;
+        return a;
+    }
+    parent[a] = b;
+    return b;
+}
+
+
+/**
+ * label_new
+ * Creates a local label, growing the tables of the band when needed.
+ *
+ * Returns:
+ * unsigned int: The new label, or 0 on allocation failure.
+ */
+static unsigned int label_new(t_label_band *band) {
+    if (band->count + 1 >= band->capacity) {
+        unsigned int capacity = band->capacity * 2;
+        unsigned int *parent = realloc(band->parent, capacity * sizeof(unsigned int));
+        if (parent) band->parent = parent;
+        t_label_stats *stats = parent ? realloc(band->stats, capacity * sizeof(t_label_stats)) : NULL;
+        if (!stats) return 0;
+        band->stats = stats;
+        band->capacity = capacity;
+    }
+
+    unsigned int label = ++band->count;
+    band->parent[label] = label;
+    band->stats[label] = (t_label_stats){0, INT32_MAX, INT32_MAX, -1, -1, 0, 0};
+    return label;
+}
+
+
+/**
+ * label_band
+ * First pass on the band indices [start, end): labels the runs of each band.
+ */
+static void label_band(void *context, int start, int end) {
+    t_label_job *job = (t_label_job *)context;
+    const t_bmp8 *img = job->img;
+    int width = (int)img->width;
+    int maxRuns = (width + 1) / 2;
+
+    for (int b = start; b < end; b++) {
+        t_label_band *band = &job->bands[b];
+        t_label_run *runs = malloc(2 * (size_t)maxRuns * sizeof(t_label_run));
+        band->capacity = 1024;
+        band->parent = malloc(band->capacity * sizeof(unsigned int));
+        band->stats = malloc(band->capacity * sizeof(t_label_stats));
+        band->firstRuns = malloc((size_t)maxRuns * sizeof(t_label_run));
+        if (!runs || !band->parent || !band->stats || !band->firstRuns) {
+            band->failed = 1;
+            free(runs);
+            continue;
+        }
+
+        t_label_run *previous = runs;
+        t_label_run *current = runs + maxRuns;
+        int previousCount = 0;
+
+        for (int y = band->first; y < band->last && !band->failed; y++) {
+            const unsigned char *row = img->data + (size_t)(img->height - 1 - y) * BMP8_ROW_SIZE(width);
+            int count = label_runs(row, width, current);
+
+            // Runs of the previous row before j end too far left to touch this run or the next ones
+            int j = 0;
+            for (int i = 0; i < count; i++) {
+                t_label_run *run = &current[i];
+                int low = run->start - job->reach;
+                int high = run->end + job->reach;
+                while (j < previousCount && previous[j].end < low) j++;
+
+                unsigned int label = 0;
+                for (int k = j; k < previousCount && previous[k].start <= high; k++) {
+                    label = label ? label_union(band->parent, label, previous[k].label)
+                                  : label_find(band->parent, previous[k].label);
+                }
+                if (!label && !(label = label_new(band))) {
+                    band->failed = 1;
+                    break;
+                }
+                run->label = label;
+
+                t_label_stats *stats = &band->stats[label];
+                unsigned int length = (unsigned int)(run->end - run->start + 1);
+                stats->area += length;
+                if (run->start < stats->left) stats->left = run->start;
+                if (run->end > stats->right) stats->right = run->end;
+                if (y < stats->top) stats->top = y;
+                if (y > stats->bottom) stats->bottom = y;
+                stats->sumX += (unsigned long long)(run->start + run->end) * length / 2;
+                stats->sumY += (unsigned long long)y * length;
+
+                if (job->labels) {
+                    unsigned int *out = job->labels + (size_t)y * width;
+                    for (int x = run->start; x <= run->end; x++) out[x] = label;
+                }
+            }
+
+            if (y == band->first) {
+                memcpy(band->firstRuns, current, (size_t)count * sizeof(t_label_run));
+                band->firstCount = count;
+            }
+            t_label_run *swap = previous;
+            previous = current;
+            current = swap;
+            previousCount = count;
+        }
+
+        // Keep the runs of the last row for the joining
+        band->lastRuns = malloc((size_t)(previousCount ? previousCount : 1) * sizeof(t_label_run));
+        if (band->lastRuns) {
+            memcpy(band->lastRuns, previous, (size_t)previousCount * sizeof(t_label_run));
+            band->lastCount = previousCount;
+        } else {
+            band->failed = 1;
+        }
+        free(runs);
+    }
+}
+
+
+/**
+ * label_relabelBand
+ * Replaces the local labels of the band indices [start, end) by component numbers.
+ */
+static void label_relabelBand(void *context, int start, int end) {
+    t_label_job *job = (t_label_job *)context;
+    size_t width = job->img->width;
+
+    for (int b = start; b < end; b++) {
+        const t_label_band *band = &job->bands[b];
+        unsigned int *labels = job->labels + (size_t)band->first * width;
+        size_t count = (size_t)(band->last - band->first) * width;
+        for (size_t i = 0; i < count; i++) {
+            if (labels[i]) labels[i] = job->global[band->offset + labels[i]];
+        }
+    }
+}
+
+
+/**
+ * label_join
+ * Numbers the local labels globally, joins the bands at their boundaries and turns the
+ * global roots into components.
+ *
+ * Returns:
+ * unsigned int*: Component number of every global label, or NULL on allocation failure.
+ */
+static unsigned int *label_join(t_label_job *job, int bandCount, int *components) {
+    unsigned int total = 0;
+    for (int b = 0; b < bandCount; b++) {
+        job->bands[b].offset = total;
+        total += job->bands[b].count;
+    }
+
+    unsigned int *global = malloc(((size_t)total + 1) * sizeof(unsigned int));
+    if (!global) return NULL;
+    global[0] = 0;
+    for (int b = 0; b < bandCount; b++) {
+        const t_label_band *band = &job->bands[b];
+        for (unsigned int l = 1; l <= band->count; l++) {
+            global[band->offset + l] = band->offset + label_find(band->parent, l);
+        }
+    }
+
+    for (int b = 1; b < bandCount; b++) {
+        const t_label_band *above = &job->bands[b - 1];
+        const t_label_band *band = &job->bands[b];
+        int j = 0;
+        for (int i = 0; i < band->firstCount; i++) {
+            const t_label_run *run = &band->firstRuns[i];
+            while (j < above->lastCount && above->lastRuns[j].end < run->start - job->reach) j++;
+            for (int k = j; k < above->lastCount && above->lastRuns[k].start <= run->end + job->reach; k++) {
+                label_union(global, band->offset + run->label, above->offset + above->lastRuns[k].label);
+            }
+        }
+    }
+
+    // A parent is always smaller than its children: when g is reached, its parent already
+    // holds the component number of the set
+    unsigned int count = 0;
+    for (unsigned int g = 1; g <= total; g++) {
+        global[g] = global[g] == g ? ++count : global[global[g]];
+    }
+    *components = (int)count;
+    return global;
+}
+
+
+/**
+ * bmp8_label
+ * Finds the connected components of the non-zero pixels of an 8-bit image. Bands of rows
+ * are labeled in parallel with run-length union-find, then joined at their boundaries.
+ *
+ * Parameters:
+ * img (const t_bmp8*): Binary image (for instance the output of bmp8_threshold).
+ * connectivity (int): 4 (sides only) or 8 (sides and corners).
+ * keepLabels (int): Non-zero to also return the label of every pixel.
+ *
+ * Returns:
+ * t_labeling*: Pointer to the result, or NULL on invalid arguments or allocation failure.
+ */
+t_labeling *bmp8_label(const t_bmp8 *img, int connectivity, int keepLabels) {
+    if (!img || !img->data || (connectivity != 4 && connectivity != 8)) return NULL;
+
+    int height = (int)img->height;
+    int bandCount = parallel_threadCount();
+    if (bandCount > height) bandCount = height;
+    if (bandCount < 1) bandCount = 1;
+
+    t_labeling *labeling = calloc(1, sizeof(t_labeling));
+    t_label_band *bands = calloc(bandCount, sizeof(t_label_band));
+    t_label_job job = {img, connectivity == 8 ? 1 : 0, NULL, bands, NULL};
+    int ok = labeling && bands;
+    if (ok && keepLabels) {
+        job.labels = calloc((size_t)img->width * (height ? height : 1), sizeof(unsigned int));
+        ok = job.labels != NULL;
+    }
+
+    if (ok) {
+        for (int b = 0; b < bandCount; b++) {
+            bands[b].first = (int)((long long)height * b / bandCount);
+            bands[b].last = (int)((long long)height * (b + 1) / bandCount);
+        }
+        parallel_for(bandCount, 1, label_band, &job);
+        for (int b = 0; b < bandCount; b++) ok = ok && !bands[b].failed;
+    }
+
+    unsigned int *global = ok ? label_join(&job, bandCount, &labeling->count) : NULL;
+    ok = ok && global;
+    if (ok) {
+        labeling->width = (int)img->width;
+        labeling->height = height;
+        labeling->components = malloc((labeling->count ? labeling->count : 1) * sizeof(t_component));
+        t_label_stats *totals = calloc(labeling->count ? labeling->count : 1, sizeof(t_label_stats));
+        ok = labeling->components && totals;
+
+        for (int b = 0; ok && b < bandCount; b++) {
+            for (unsigned int l = 1; l <= bands[b].count; l++) {
+                const t_label_stats *s = &bands[b].stats[l];
+                t_label_stats *t = &totals[global[bands[b].offset + l] - 1];
+                if (t->area == 0) {
+                    *t = *s;
+                    continue;
+                }
+                t->area += s->area;
+                t->sumX += s->sumX;
+                t->sumY += s->sumY;
+                if (s->left < t->left) t->left = s->left;
+                if (s->right > t->right) t->right = s->right;
+                if (s->top < t->top) t->top = s->top;
+                if (s->bottom > t->bottom) t->bottom = s->bottom;
+            }
+        }
+        for (int c = 0; ok && c < labeling->count; c++) {
+            const t_label_stats *t = &totals[c];
+            labeling->components[c] = (t_component){t->area, t->left, t->top, t->right, t->bottom,
+                                                    (double)t->sumX / t->area, (double)t->sumY / t->area};
+        }
+        free(totals);
+
+        if (ok && job.labels) {
+            job.global = global;
+            parallel_for(bandCount, 1, label_relabelBand, &job);
+            labeling->labels = job.labels;
+            job.labels = NULL;
+        }
+    }
+
+    for (int b = 0; bands && b < bandCount; b++) {
+        free(bands[b].parent);
+        free(bands[b].stats);
+        free(bands[b].firstRuns);
+        free(bands[b].lastRuns);
+    }
+    free(bands);
+    free(global);
+    free(job.labels);
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to allocate memory for the labeling.\n");
+        labeling_free(labeling);
+        return NULL;
+    }
+    return labeling;
+}
+
+
+/**
+ * labeling_write
+ * Writes one record per component: id, area, bounding box and centroid.
+ *
+ * Parameters:
+ * labeling (const t_labeling*): Result of bmp8_label.
+ * format (t_probe_format): PROBE_CSV or PROBE_JSON.
+ * out (FILE*): Destination stream.
+ */
+void labeling_write(const t_labeling *labeling, t_probe_format format, FILE *out) {
+    if (format == PROBE_CSV) {
+        fputs("id,area,left,top,right,bottom,centroid_x,centroid_y\n", out);
+    } else {
+        fputs("[\n", out);
+    }
+
+    for (int i = 0; i < labeling->count; i++) {
+        const t_component *c = &labeling->components[i];
+        if (format == PROBE_CSV) {
+            fprintf(out, "%d,%u,%d,%d,%d,%d,%.2f,%.2f\n", i + 1, c->area, c->left, c->top, c->right, c->bottom,
+                    c->centroidX, c->centroidY);
+        } else {
+            fprintf(out, "%s  {\"id\": %d, \"area\": %u, \"left\": %d, \"top\": %d, \"right\": %d, \"bottom\": %d, "
+                         "\"centroid_x\": %.2f, \"centroid_y\": %.2f}",
+                    i ? ",\n" : "", i + 1, c->area, c->left, c->top, c->right, c->bottom, c->centroidX, c->centroidY);
+        }
+    }
+
+    if (format == PROBE_JSON) {
+        fputs(labeling->count ? "\n]\n" : "]\n", out);
+    }
+}
+
+
+/**
+ * labeling_free
+ * Frees a labeling and its arrays.
+ *
+ * Parameters:
+ * labeling (t_labeling*): Result of bmp8_label (may be NULL).
+ */
+void labeling_free(t_labeling *labeling) {
+    if (labeling) {
+        free(labeling->components);
+        free(labeling->labels);
+        free(labeling);
+    }
+}
@@ -0,0 +1,95 @@
+/**
+ * label.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the connected-component labeling of binary images. Every group
+ * of touching foreground (non-zero) pixels becomes one component, described by its area,
+ * bounding box and centroid, all measured during the labeling pass.
+ *
+ * Role in the project:
+ * Counts and measures the blobs (particles, defects...) of a thresholded image.
+ */
+
+#ifndef LABEL_H
+#define LABEL_H
+
+#include <stdio.h>
+#include "bmp8.h"
+#include "probe.h"
+
+/**
+ * t_component
+ * Measures of one connected component. Coordinates are in pixels, y pointing down.
+ *
+ * Members:
+ * area (unsigned int): Number of pixels.
+ * left, top, right, bottom (int): Bounding box, bounds included.
+ * centroidX, centroidY (double): Mean position of the pixels.
+ */
+typedef struct {
+    unsigned int area;
+    int left;
+    int top;
+    int right;
+    int bottom;
+    double centroidX;
+    double centroidY;
+} t_component;
+
+/**
+ * t_labeling
+ * Result of a labeling. Components are numbered from 1, in the order of their first
+ * pixel (top to bottom, left to right).
+ *
+ * Members:
+ * width, height (int): Size of the image.
+ * count (int): Number of components.
+ * components (t_component*): Component k is components[k - 1].
+ * labels (unsigned int*): If requested, width * height labels, row by row from the top
+ *     (0 for background pixels); NULL otherwise.
+ */
+typedef struct {
+    int width;
+    int height;
+    int count;
+    t_component *components;
+    unsigned int *labels;
+} t_labeling;
+
+/**
+ * bmp8_label
+ * Finds the connected components of the non-zero pixels of an 8-bit image. Bands of rows
+ * are labeled in parallel with run-length union-find, then joined at their boundaries.
+ *
+ * Parameters:
+ * img (const t_bmp8*): Binary image (for instance the output of bmp8_threshold).
+ * connectivity (int): 4 (sides only) or 8 (sides and corners).
+ * keepLabels (int): Non-zero to also return the label of every pixel.
+ *
+ * Returns:
+ * t_labeling*: Pointer to the result, or NULL on invalid arguments or allocation failure.
+ */
+t_labeling * bmp8_label(const t_bmp8 *img, int connectivity, int keepLabels);
+
+/**
+ * labeling_write
+ * Writes one record per component: id, area, bounding box and centroid.
+ *
+ * Parameters:
+ * labeling (const t_labeling*): Result of bmp8_label.
+ * format (t_probe_format): PROBE_CSV or PROBE_JSON.
+ * out (FILE*): Destination stream.
+ */
+void labeling_write(const t_labeling *labeling, t_probe_format format, FILE *out);
+
+/**
+ * labeling_free
+ * Frees a labeling and its arrays.
+ *
+ * Parameters:
+ * labeling (t_labeling*): Result of bmp8_label (may be NULL).
+ */
+void labeling_free(t_labeling *labeling);
+
+#endif // LABEL_H
@@ -0,0 +1,142 @@
+/**
+ * luma.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the luma conversion. Weights are scaled to 15-bit fixed point so that they
+ * sum to exactly 32768: white stays 255 and no division is needed. With SSE2, sixteen
+ * pixels are converted per iteration with multiply-add instructions on 16-bit lanes.
+ *
+ * Role in the project:
+ * Turns a 24/32-bit image into a single-channel image, so that the 8-bit operations
+ * (threshold, equalization...) run on a third of the data.
+ */
+
+
+#include "luma.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Fixed-point precision of the weights
+#define LUMA_BITS 15
+
+/**
+ * t_luma_weights
+ * Weights of the blue, green and red channels, summing to 1 << LUMA_BITS.
+ */
+typedef struct {
+    int blue;
+    int green;
+    int red;
+} t_luma_weights;
+
+static const t_luma_weights weights[] = {
+    {3735, 19235, 9798},    // BT.601: 0.114, 0.587, 0.299
+    {2366, 23436, 6966},    // BT.709: 0.0722, 0.7152, 0.2126
+};
+
+/**
+ * t_luma_job
+ * Shared state of a conversion.
+ */
+typedef struct {
+    const t_bmp24 *src;
+    t_bmp8 *dst;
+    t_luma_weights weights;
+} t_luma_job;
+
+
+/**
+ * luma_row
+ * Converts one row of pixels to luma values.
+ */
+static void luma_row(const t_pixel *src, unsigned char *dst, int width, t_luma_weights w) {
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i coef = _mm_set_epi16(0, (short)w.red, (short)w.green, (short)w.blue,
+                                       0, (short)w.red, (short)w.green, (short)w.blue);
+    const __m128i round = _mm_set1_epi32(1 << (LUMA_BITS - 1));
+    __m128i luma[4];
+    for (; x + 16 <= width; x += 16) {
+        for (int i = 0; i < 4; i++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + x + 4 * i));
+
+            // b * wb + g * wg and r * wr per pixel, then add the two halves of each 64-bit lane
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), coef);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), coef);
+            lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+            hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+            __m128i sum = _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0)),
+                                             _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0)));
+            luma[i] = _mm_srli_epi32(_mm_add_epi32(sum, round), LUMA_BITS);
+        }
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(luma[0], luma[1]),
+                                         _mm_packs_epi32(luma[2], luma[3]));
+        _mm_storeu_si128((__m128i *)(dst + x), bytes);
+    }
+#endif
+    for (; x < width; x++) {
+        int sum = src[x].blue * w.blue + src[x].green * w.green + src[x].red * w.red;
+        dst[x] = (unsigned char)((sum + (1 << (LUMA_BITS - 1))) >> LUMA_BITS);
+    }
+}
+
+
+/**
+ * luma_band
+ * Converts the source rows [start, end). bmp24 rows are stored top-down and bmp8
+ * rows bottom-up, so image row y goes to stored row height - 1 - y.
+ */
+static void luma_band(void *context, int start, int end) {
+    t_luma_job *job = (t_luma_job *)context;
+    size_t stride = BMP8_ROW_SIZE(job->dst->width);
+
+    for (int y = start; y < end; y++) {
+        unsigned char *dst = job->dst->data + (size_t)(job->src->height - 1 - y) * stride;
+        luma_row(job->src->data[y], dst, job->src->width, job->weights);
+    }
+}
+
+
+/**
+ * bmp24_toBmp8
+ * Creates an 8-bit image with a grayscale palette holding the luma of a color image.
+ * Rows are converted in parallel; the alpha channel of 32-bit images is ignored.
+ *
+ * Parameters:
+ * img (const t_bmp24*): Source image.
+ * standard (t_luma_standard): Color weights.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp8 * bmp24_toBmp8(const t_bmp24 *img, t_luma_standard standard) {
+    if (!img || standard < LUMA_BT601 || standard > LUMA_BT709) return NULL;
+
+    t_bmp8 *gray = bmp8_allocate(img->width, img->height);
+    if (!gray) return NULL;
+
+    t_luma_job job = {img, gray, weights[standard]};
+    parallel_for(img->height, 16, luma_band, &job);
+    return gray;
+}
+
+
+/**
+ * luma_convertRow
+ * Converts one row of pixels to luma values, for operators that consume the luma of
+ * a color image row by row without building the whole 8-bit image.
+ *
+ * Parameters:
+ * src (const t_pixel*): Source pixels.
+ * dst (unsigned char*): Receives width luma values.
+ * width (int): Number of pixels.
+ * standard (t_luma_standard): Color weights.
+ */
+void luma_convertRow(const t_pixel *src, unsigned char *dst, int width, t_luma_standard standard) {
+    luma_row(src, dst, width, weights[standard == LUMA_BT709 ? LUMA_BT709 : LUMA_BT601]);
+}
@@ -0,0 +1,60 @@
+/**
+ * luma.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the conversion of color images to native 8-bit grayscale images.
+ * The luma of each pixel is a weighted sum of its three colors (ITU-R BT.601 or BT.709
+ * weights) computed in fixed point, instead of the plain average of bmp24_grayscale.
+ *
+ * Role in the project:
+ * Turns a 24/32-bit image into a single-channel image, so that the 8-bit operations
+ * (threshold, equalization...) run on a third of the data.
+ */
+
+#ifndef LUMA_H
+#define LUMA_H
+
+#include "bmp8.h"
+#include "bmp24.h"
+
+/**
+ * t_luma_standard
+ * Set of color weights used to compute the luma.
+ *
+ * LUMA_BT601: 0.299 R + 0.587 G + 0.114 B (standard definition video, JPEG).
+ * LUMA_BT709: 0.2126 R + 0.7152 G + 0.0722 B (HD video, sRGB primaries).
+ */
+typedef enum {
+    LUMA_BT601,
+    LUMA_BT709
+} t_luma_standard;
+
+/**
+ * bmp24_toBmp8
+ * Creates an 8-bit image with a grayscale palette holding the luma of a color image.
+ * Rows are converted in parallel; the alpha channel of 32-bit images is ignored.
+ *
+ * Parameters:
+ * img (const t_bmp24*): Source image.
+ * standard (t_luma_standard): Color weights.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp8 * bmp24_toBmp8(const t_bmp24 *img, t_luma_standard standard);
+
+/**
+ * luma_convertRow
+ * Converts one row of pixels to luma values, for operators that consume the luma of
+ * a color image row by row without building the whole 8-bit image.
+ *
+ * Parameters:
+ * src (const t_pixel*): Source pixels.
+ * dst (unsigned char*): Receives width luma values.
+ * width (int): Number of pixels.
+ * standard (t_luma_standard): Color weights.
+ */
+void luma_convertRow(const t_pixel *src, unsigned char *dst, int width, t_luma_standard standard);
+
+#endif // LUMA_H
@@ -6,23 +6,33 @@
  * This is the entry point of the project. It initializes the application by
  * calling the main menu function from the utils module. The main function
  * serves to start the program's user interface and handle the initial user
- * interactions.
+ * interactions. When arguments are given, they are run as a command instead.
  *
  * Role in the project:
- * Acts as the launcher for the application, directing the flow to the main menu.
+ * Acts as the launcher for the application, directing the flow to the main menu
+ * or to the command-line interface.
  */
 
 #include "utils.h"
+#include "cli.h"
 
 /**
  * main
  *
- * Starts the application by invoking the main menu.
+ * Starts the application by invoking the main menu, or runs a command when the
+ * program is given arguments.
+ *
+ * Parameters:
+ * argc (int): Number of arguments.
+ * argv (char**): Arguments; argv[1] names the command.
  *
  * Returns:
  * 0 - Indicates successful execution of the program.
  */
-int main() {
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        return cli_run(argc - 1, argv + 1);
+    }
     main_menu();  // Call to display and handle the main menu interface
     return 0;
 }
@@ -0,0 +1,468 @@
+/**
+ * morph.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the morphological operations. A rectangular element is separable, so an
+ * erosion (or dilation) is a vertical pass followed by a horizontal pass, each computing
+ * the minimum (or maximum) of a sliding window of k values. The van Herk / Gil-Werman
+ * algorithm cuts the line into blocks of k values and computes running minimums forward
+ * and backward inside each block: every window then spans at most two blocks, and its
+ * minimum is the combination of one backward and one forward value, so a pixel costs
+ * three comparisons whatever k is.
+ *
+ * The vertical pass works on whole rows at a time (one SSE2 instruction combines 16
+ * bytes), on strips of columns processed in parallel. Binary images are packed to one
+ * bit per pixel: the vertical pass then combines 64 pixels per AND / OR, and the
+ * horizontal window is computed with log2(k) shifted ANDs of the packed row.
+ *
+ * Role in the project:
+ * Cleans up thresholded images: removes specks, fills holes and extracts outlines.
+ */
+
+
+#include <stdint.h>
+#include "morph.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Number of bytes of each row handled by one unit of the vertical pass
+#define MORPH_STRIP 256
+
+/**
+ * t_morph_combine
+ * Operation combining two values: minimum / maximum of gray levels, AND / OR of packed bits.
+ */
+typedef enum {
+    MORPH_MIN,
+    MORPH_MAX,
+    MORPH_AND,
+    MORPH_OR
+} t_morph_combine;
+
+/**
+ * t_morph_plane
+ * Rows of pixels processed by a pass: gray levels (one byte per pixel) or packed bits
+ * (one bit per pixel, bit x & 63 of word x / 64).
+ */
+typedef struct {
+    unsigned char *data;
+    size_t stride;
+    size_t bytes;
+    int width;
+    int rows;
+    int packed;
+} t_morph_plane;
+
+/**
+ * t_morph_pass
+ * Shared state of one vertical or horizontal pass. Output row / column x receives the
+ * combination of the source values x - before to x - before + size - 1.
+ */
+typedef struct {
+    const t_morph_plane *src;
+    const t_morph_plane *dst;
+    int size;
+    int before;
+    int dilate;
+    int failed;
+} t_morph_pass;
+
+
+/**
+ * morph_combine
+ * dst[i] = a[i] combined with b[i] for n bytes. dst may be a or b.
+ */
+static void morph_combine(unsigned char *dst, const unsigned char *a, const unsigned char *b, size_t n,
+                          t_morph_combine mode) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i r;
+        switch (mode) {
+            case MORPH_MIN: r = _mm_min_epu8(va, vb); break;
+            case MORPH_MAX: r = _mm_max_epu8(va, vb); break;
+            case MORPH_AND: r = _mm_and_si128(va, vb); break;
+            default: r = _mm_or_si128(va, vb); break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), r);
+    }
+#endif
+    for (; i < n; i++) {
+        switch (mode) {
+            case MORPH_MIN: dst[i] = a[i] < b[i] ? a[i] : b[i]; break;
+            case MORPH_MAX: dst[i] = a[i] > b[i] ? a[i] : b[i]; break;
+            case MORPH_AND: dst[i] = a[i] & b[i]; break;
+            default: dst[i] = a[i] | b[i]; break;
+        }
+    }
+}
+
+
+/**
+ * morph_verticalBand
+ * Vertical pass on the column strips [start, end). For each block of k rows starting at
+ * base, h[j] combines rows base + j .. base + k - 1 and g[j] rows base + k .. base + k + j,
+ * so output row base + j is h[j] combined with g[j - 1]. Rows outside the image read as
+ * the neutral value of the operation.
+ */
+static void morph_verticalBand(void *context, int start, int end) {
+    t_morph_pass *pass = (t_morph_pass *)context;
+    const t_morph_plane *src = pass->src;
+    const t_morph_plane *dst = pass->dst;
+    size_t first = (size_t)start * MORPH_STRIP;
+    size_t last = (size_t)end * MORPH_STRIP < src->bytes ? (size_t)end * MORPH_STRIP : src->bytes;
+    size_t length = last - first;
+    int k = pass->size;
+    int rows = src->rows;
+    t_morph_combine mode = src->packed ? (pass->dilate ? MORPH_OR : MORPH_AND)
+                                       : (pass->dilate ? MORPH_MAX : MORPH_MIN);
+
+    unsigned char *buffer = malloc((2 * (size_t)k + 1) * length);
+    if (!buffer) {
+        pass->failed = 1;
+        return;
+    }
+    unsigned char *h = buffer;
+    unsigned char *g = buffer + (size_t)k * length;
+    unsigned char *neutral = buffer + 2 * (size_t)k * length;
+    memset(neutral, pass->dilate ? 0x00 : 0xFF, length);
+
+// Source row i of the padded sequence, and output row y
+#define MORPH_SRC(i) ((i) - pass->before >= 0 && (i) - pass->before < rows \
+                      ? src->data + (size_t)((i) - pass->before) * src->stride + first : neutral)
+#define MORPH_DST(y) (dst->data + (size_t)(y) * dst->stride + first)
+
+    for (int base = 0; base < rows; base += k) {
+        int count = rows - base < k ? rows - base : k;
+
+        memcpy(h + (size_t)(k - 1) * length, MORPH_SRC(base + k - 1), length);
+        for (int j = k - 2; j >= 0; j--) {
+            morph_combine(h + (size_t)j * length, MORPH_SRC(base + j), h + (size_t)(j + 1) * length, length, mode);
+        }
+        memcpy(MORPH_DST(base), h, length);
+        if (count == 1) continue;
+
+        memcpy(g, MORPH_SRC(base + k), length);
+        for (int j = 1; j < count - 1; j++) {
+            morph_combine(g + (size_t)j * length, g + (size_t)(j - 1) * length, MORPH_SRC(base + k + j), length, mode);
+        }
+        for (int j = 1; j < count; j++) {
+            morph_combine(MORPH_DST(base + j), h + (size_t)j * length, g + (size_t)(j - 1) * length, length, mode);
+        }
+    }
+
+#undef MORPH_SRC
+#undef MORPH_DST
+    free(buffer);
+}
+
+
+/**
+ * MORPH_LINE
+ * Generates the horizontal van Herk pass on one row of gray levels. buffer holds three
+ * arrays of width + k - 1 bytes: the padded row, and its forward and backward running
+ * values inside blocks of k.
+ */
+#define MORPH_LINE(NAME, OP, NEUTRAL)                                                         \
+static void NAME(const unsigned char *src, unsigned char *dst, int width, int k, int before,  \
+                 unsigned char *buffer) {                                                     \
+    int m = width + k - 1;                                                                    \
+    unsigned char *p = buffer;                                                                \
+    unsigned char *g = buffer + m;                                                            \
+    unsigned char *h = buffer + 2 * m;                                                        \
+    memset(p, NEUTRAL, before);                                                               \
+    memcpy(p + before, src, width);                                                           \
+    memset(p + before + width, NEUTRAL, k - 1 - before);                                      \
+                                                                                              \
+    for (int base = 0; base < m; base += k) {                                                 \
+        int stop = base + k < m ? base + k : m;                                               \
+        g[base] = p[base];                                                                    \
+        for (int i = base + 1; i < stop; i++) g[i] = OP(g[i - 1], p[i]);                      \
+        h[stop - 1] = p[stop - 1];                                                            \
+        for (int i = stop - 2; i >= base; i--) h[i] = OP(h[i + 1], p[i]);                     \
+    }                                                                                         \
+    for (int x = 0; x < width; x++) dst[x] = OP(h[x], g[x + k - 1]);                          \
+}
+
+#define MORPH_MIN_OP(a, b) ((a) < (b) ? (a) : (b))
+#define MORPH_MAX_OP(a, b) ((a) > (b) ? (a) : (b))
+
+MORPH_LINE(morph_lineMin, MORPH_MIN_OP, 0xFF)
+MORPH_LINE(morph_lineMax, MORPH_MAX_OP, 0x00)
+
+
+/**
+ * morph_shift
+ * Shifts a packed row of srcWords words into dstWords words: dst pixel x = src pixel
+ * x + shift (shift may be negative). Pixels outside the source read as fill.
+ */
+static void morph_shift(uint64_t *dst, int dstWords, const uint64_t *src, int srcWords, int shift, uint64_t fill) {
+    int distance = shift < 0 ? -shift : shift;
+    int q = distance >> 6;
+    int r = distance & 63;
+
+    for (int i = 0; i < dstWords; i++) {
+        if (shift >= 0) {
+            uint64_t lo = i + q < srcWords ? src[i + q] : fill;
+            uint64_t hi = i + q + 1 < srcWords ? src[i + q + 1] : fill;
+            dst[i] = r ? (lo >> r) | (hi << (64 - r)) : lo;
+        } else {
+            uint64_t hi = i - q >= 0 && i - q < srcWords ? src[i - q] : fill;
+            uint64_t lo = i - q - 1 >= 0 && i - q - 1 < srcWords ? src[i - q - 1] : fill;
+            dst[i] = r ? (hi << r) | (lo >> (64 - r)) : hi;
+        }
+    }
+}
+
+
+/**
+ * morph_bitLine
+ * Horizontal pass on one packed row. The row is first copied to a, widened by k - 1
+ * pixels, so that bit x + before of a holds pixel x. a[x] is then doubled to cover
+ * pixels x .. x + len - 1 by combining it with itself shifted by len, and a last,
+ * overlapping shift reaches exactly k pixels: a[x] is then the output pixel x.
+ * a and t hold (width + k + 62) / 64 words.
+ */
+static void morph_bitLine(const uint64_t *src, uint64_t *dst, int width, int k, int before, int dilate,
+                          uint64_t *a, uint64_t *t) {
+    int words = (width + 63) / 64;
+    int wide = (width + k - 1 + 63) / 64;
+    uint64_t fill = dilate ? 0 : ~(uint64_t)0;
+    size_t bytes = (size_t)wide * sizeof(uint64_t);
+    t_morph_combine mode = dilate ? MORPH_OR : MORPH_AND;
+
+    memcpy(t, src, (size_t)words * sizeof(uint64_t));
+    if (width & 63) {
+        // Bits past the end of the row act like pixels outside the image
+        uint64_t mask = ((uint64_t)1 << (width & 63)) - 1;
+        t[words - 1] = dilate ? t[words - 1] & mask : t[words - 1] | ~mask;
+    }
+    morph_shift(a, wide, t, words, -before, fill);
+
+    int len = 1;
+    for (; len * 2 <= k; len *= 2) {
+        morph_shift(t, wide, a, wide, len, fill);
+        morph_combine((unsigned char *)a, (unsigned char *)a, (unsigned char *)t, bytes, mode);
+    }
+    if (len < k) {
+        morph_shift(t, wide, a, wide, k - len, fill);
+        morph_combine((unsigned char *)a, (unsigned char *)a, (unsigned char *)t, bytes, mode);
+    }
+    memcpy(dst, a, (size_t)words * sizeof(uint64_t));
+}
+
+
+/**
+ * morph_horizontalBand
+ * Horizontal pass on the rows [start, end).
+ */
+static void morph_horizontalBand(void *context, int start, int end) {
+    t_morph_pass *pass = (t_morph_pass *)context;
+    const t_morph_plane *src = pass->src;
+    const t_morph_plane *dst = pass->dst;
+    int k = pass->size;
+
+    size_t wide = ((size_t)src->width + k - 1 + 63) / 64 * sizeof(uint64_t);
+    size_t size = src->packed ? 2 * wide : 3 * ((size_t)src->width + k - 1);
+    unsigned char *buffer = malloc(size);
+    if (!buffer) {
+        pass->failed = 1;
+        return;
+    }
+
+    for (int y = start; y < end; y++) {
+        const unsigned char *in = src->data + (size_t)y * src->stride;
+        unsigned char *out = dst->data + (size_t)y * dst->stride;
+        if (src->packed) {
+            morph_bitLine((const uint64_t *)in, (uint64_t *)out, src->width, k, pass->before, pass->dilate,
+                          (uint64_t *)buffer, (uint64_t *)(buffer + wide));
+        } else if (pass->dilate) {
+            morph_lineMax(in, out, src->width, k, pass->before, buffer);
+        } else {
+            morph_lineMin(in, out, src->width, k, pass->before, buffer);
+        }
+    }
+
+    free(buffer);
+}
+
+
+/**
+ * morph_apply
+ * Erodes or dilates a plane in place with a width x height element, using tmp (same
+ * layout) for the result of the vertical pass. Planes hold the rows of an 8-bit image in
+ * stored (bottom-up) order, so the vertical anchor is counted from the bottom.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+static int morph_apply(t_morph_plane *plane, t_morph_plane *tmp, int width, int height, int dilate) {
+    int anchorX = width / 2;
+    int anchorY = height / 2;
+
+    // Dilation uses the reflected element, so that opening and closing are idempotent
+    t_morph_pass vertical = {plane, tmp, height, dilate ? anchorY : height - 1 - anchorY, dilate, 0};
+    int strips = (int)((plane->bytes + MORPH_STRIP - 1) / MORPH_STRIP);
+    parallel_for(strips, 1, morph_verticalBand, &vertical);
+
+    t_morph_pass horizontal = {tmp, plane, width, dilate ? width - 1 - anchorX : anchorX, dilate, 0};
+    parallel_for(plane->rows, 16, morph_horizontalBand, &horizontal);
+
+    return vertical.failed || horizontal.failed ? -1 : 0;
+}
+
+
+/**
+ * morph_packBand
+ * Packs the image rows [start, end) of context[0] (a t_bmp8) into the plane context[1].
+ */
+static void morph_packBand(void *context, int start, int end) {
+    const t_bmp8 *img = ((void **)context)[0];
+    const t_morph_plane *plane = ((void **)context)[1];
+    int width = plane->width;
+
+    for (int y = start; y < end; y++) {
+        const unsigned char *src = img->data + (size_t)y * BMP8_ROW_SIZE(img->width);
+        uint64_t *dst = (uint64_t *)(plane->data + (size_t)y * plane->stride);
+        for (int w = 0; w * 64 < width; w++) {
+            int base = w * 64;
+            uint64_t bits = 0;
+#ifdef __SSE2__
+            if (base + 64 <= width) {
+                // The sign bit of each byte is set for 255 and clear for 0
+                for (int i = 3; i >= 0; i--) {
+                    __m128i v = _mm_loadu_si128((const __m128i *)(src + base + 16 * i));
+                    bits = (bits << 16) | (uint64_t)(unsigned int)_mm_movemask_epi8(v);
+                }
+                dst[w] = bits;
+                continue;
+            }
+#endif
+            for (int j = 0; j < 64 && base + j < width; j++) {
+                if (src[base + j]) bits |= (uint64_t)1 << j;
+            }
+            dst[w] = bits;
+        }
+    }
+}
+
+
+/**
+ * morph_unpackBand
+ * Writes the packed rows [start, end) of context[1] back to the image context[0] as 0 / 255.
+ */
+static void morph_unpackBand(void *context, int start, int end) {
+    t_bmp8 *img = ((void **)context)[0];
+    const t_morph_plane *plane = ((void **)context)[1];
+
+    for (int y = start; y < end; y++) {
+        const uint64_t *src = (const uint64_t *)(plane->data + (size_t)y * plane->stride);
+        unsigned char *dst = img->data + (size_t)y * BMP8_ROW_SIZE(img->width);
+        for (int x = 0; x < plane->width; x++) {
+            dst[x] = (unsigned char)(0 - ((src[x >> 6] >> (x & 63)) & 1));
+        }
+    }
+}
+
+
+/**
+ * morph_isBinary
+ * Checks whether every pixel of an image is 0 or 255.
+ */
+static int morph_isBinary(const t_bmp8 *img) {
+    for (unsigned int y = 0; y < img->height; y++) {
+        const unsigned char *row = img->data + (size_t)y * BMP8_ROW_SIZE(img->width);
+        int other = 0;
+        for (unsigned int x = 0; x < img->width; x++) {
+            // 0 and 255 are the only values v for which (unsigned char)(v + 1) <= 1
+            other |= (unsigned char)(row[x] + 1) > 1;
+        }
+        if (other) return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * bmp8_morphology
+ * Applies a morphological operation with a width x height rectangle anchored at its
+ * center (pixel width / 2, height / 2 from the top-left corner). Pixels outside the
+ * image are ignored. Binary images use the packed 1-bit path automatically.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify (grayscale palette).
+ * op (t_morph_op): Operation.
+ * width (int): Width of the element in pixels (at least 1).
+ * height (int): Height of the element in pixels (at least 1).
+ *
+ * Returns:
+ * int: 0 on success, -1 on invalid arguments or allocation failure.
+ */
+int bmp8_morphology(t_bmp8 *img, t_morph_op op, int width, int height) {
+    if (!img || !img->data || width < 1 || height < 1 || op < MORPH_ERODE || op > MORPH_GRADIENT) return -1;
+    if (img->width == 0 || img->height == 0) return 0;
+
+    int packed = morph_isBinary(img);
+    t_morph_plane plane;
+    plane.width = (int)img->width;
+    plane.rows = (int)img->height;
+    plane.packed = packed;
+    plane.bytes = packed ? (size_t)(plane.width + 63) / 64 * sizeof(uint64_t) : (size_t)plane.width;
+    plane.stride = packed ? plane.bytes : BMP8_ROW_SIZE(img->width);
+
+    // Gray levels are processed in the image itself, packed bits in a plane of their own
+    size_t planeSize = plane.stride * plane.rows;
+    int planes = (packed ? 2 : 1) + (op == MORPH_GRADIENT ? 1 : 0);
+    unsigned char *buffer = malloc(planes * planeSize);
+    if (!buffer) {
+        fprintf(stderr, "Error: Unable to allocate memory for the morphological operation.\n");
+        return -1;
+    }
+    plane.data = packed ? buffer + planeSize : img->data;
+    t_morph_plane tmp = plane;
+    tmp.data = buffer;
+    t_morph_plane eroded = plane;
+    eroded.data = buffer + (planes - 1) * planeSize;
+
+    void *context[2] = {img, &plane};
+    if (packed) parallel_for(plane.rows, 16, morph_packBand, context);
+
+    int status = 0;
+    switch (op) {
+        case MORPH_ERODE:
+            status = morph_apply(&plane, &tmp, width, height, 0);
+            break;
+        case MORPH_DILATE:
+            status = morph_apply(&plane, &tmp, width, height, 1);
+            break;
+        case MORPH_OPEN:
+            status = morph_apply(&plane, &tmp, width, height, 0) | morph_apply(&plane, &tmp, width, height, 1);
+            break;
+        case MORPH_CLOSE:
+            status = morph_apply(&plane, &tmp, width, height, 1) | morph_apply(&plane, &tmp, width, height, 0);
+            break;
+        case MORPH_GRADIENT:
+            memcpy(eroded.data, plane.data, planeSize);
+            status = morph_apply(&eroded, &tmp, width, height, 0) | morph_apply(&plane, &tmp, width, height, 1);
+            for (size_t i = 0; i < planeSize; i++) {
+                plane.data[i] = packed ? plane.data[i] & ~eroded.data[i] : plane.data[i] - eroded.data[i];
+            }
+            break;
+    }
+
+    if (packed && status == 0) parallel_for(plane.rows, 16, morph_unpackBand, context);
+    free(buffer);
+    if (status != 0) {
+        fprintf(stderr, "Error: Unable to allocate memory for the morphological operation.\n");
+        return -1;
+    }
+
+    dirty_markAll(&img->dirty);
+    return 0;
+}
@@ -0,0 +1,55 @@
+/**
+ * morph.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the morphological operations on 8-bit images with rectangular
+ * structuring elements. Erosion and dilation use the van Herk / Gil-Werman algorithm,
+ * whose cost per pixel does not depend on the size of the element; binary images (only
+ * the values 0 and 255) are processed packed, 64 pixels per machine word.
+ *
+ * Role in the project:
+ * Cleans up thresholded images: removes specks, fills holes and extracts outlines.
+ */
+
+#ifndef MORPH_H
+#define MORPH_H
+
+#include "bmp8.h"
+
+/**
+ * t_morph_op
+ * Morphological operation.
+ *
+ * MORPH_ERODE: minimum over the element (shrinks bright regions).
+ * MORPH_DILATE: maximum over the element (grows bright regions).
+ * MORPH_OPEN: erosion then dilation (removes bright details smaller than the element).
+ * MORPH_CLOSE: dilation then erosion (fills dark details smaller than the element).
+ * MORPH_GRADIENT: dilation minus erosion (outlines of the regions).
+ */
+typedef enum {
+    MORPH_ERODE,
+    MORPH_DILATE,
+    MORPH_OPEN,
+    MORPH_CLOSE,
+    MORPH_GRADIENT
+} t_morph_op;
+
+/**
+ * bmp8_morphology
+ * Applies a morphological operation with a width x height rectangle anchored at its
+ * center (pixel width / 2, height / 2 from the top-left corner). Pixels outside the
+ * image are ignored. Binary images use the packed 1-bit path automatically.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image to modify (grayscale palette).
+ * op (t_morph_op): Operation.
+ * width (int): Width of the element in pixels (at least 1).
+ * height (int): Height of the element in pixels (at least 1).
+ *
+ * Returns:
+ * int: 0 on success, -1 on invalid arguments or allocation failure (image unchanged).
+ */
+int bmp8_morphology(t_bmp8 *img, t_morph_op op, int width, int height);
+
+#endif // MORPH_H
@@ -0,0 +1,110 @@
+/**
+ * parallel.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements band splitting of a range over POSIX threads.
+ *
+ * Role in the project:
+ * Shared threading utility for the image processing modules.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "parallel.h"
+
+// Upper bound on the number of threads started by one parallel_for call
+#define PARALLEL_MAX_THREADS 64
+
+
+/**
+ * t_parallel_band
+ * Arguments of one worker thread.
+ */
+typedef struct {
+    t_parallel_fn fn;
+    void *context;
+    int start;
+    int end;
+} t_parallel_band;
+
+
+/**
+ * parallel_threadCount
+ * Returns the number of worker threads to use: the IMGPROC_THREADS environment variable
+ * if set, otherwise the number of online processors.
+ *
+ * Returns:
+ * int: Number of threads (at least 1).
+ */
+int parallel_threadCount() {
+    const char *env = getenv("IMGPROC_THREADS");
+    long count = env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) count = 1;
+    if (count > PARALLEL_MAX_THREADS) count = PARALLEL_MAX_THREADS;
+    return (int)count;
+}
+
+
+/**
+ * parallel_worker
+ * Thread entry point: runs the work function on its band.
+ */
+static void *parallel_worker(void *arg) {
+    t_parallel_band *band = arg;
+    band->fn(band->context, band->start, band->end);
+    return NULL;
+}
+
+
+/**
+ * parallel_for
+ * Splits [0, count) into at most parallel_threadCount() bands and runs fn on each band in
+ * its own thread. Band boundaries are multiples of grain, so work units never straddle two
+ * threads. Runs inline when there is a single band or when threads cannot be created.
+ *
+ * Parameters:
+ * count (int): Size of the range.
+ * grain (int): Alignment of band boundaries (1 for no constraint).
+ * fn (t_parallel_fn): Work function.
+ * context (void*): Pointer passed to every call of fn.
+ */
+void parallel_for(int count, int grain, t_parallel_fn fn, void *context) {
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+
+    int units = (count + grain - 1) / grain;
+    int threads = parallel_threadCount();
+    if (threads > units) threads = units;
+    if (threads <= 1) {
+        fn(context, 0, count);
+        return;
+    }
+
+    pthread_t ids[PARALLEL_MAX_THREADS];
+    t_parallel_band bands[PARALLEL_MAX_THREADS];
+    int started[PARALLEL_MAX_THREADS];
+
+    for (int i = 0; i < threads; i++) {
+        int start = (int)((long long)units * i / threads) * grain;
+        int end = (int)((long long)units * (i + 1) / threads) * grain;
+        if (end > count) end = count;
+        bands[i].fn = fn;
+        bands[i].context = context;
+        bands[i].start = start;
+        bands[i].end = end;
+        // Band 0 runs on the calling thread
+        started[i] = i > 0 && pthread_create(&ids[i], NULL, parallel_worker, &bands[i]) == 0;
+    }
+
+    fn(context, bands[0].start, bands[0].end);
+    for (int i = 1; i < threads; i++) {
+        if (started[i]) {
+            pthread_join(ids[i], NULL);
+        } else {
+            fn(context, bands[i].start, bands[i].end);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+/**
+ * parallel.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring a small helper to split a range of work (usually image rows)
+ * into contiguous bands processed by several POSIX threads.
+ *
+ * Role in the project:
+ * Shared threading utility for the image processing modules.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/**
+ * t_parallel_fn
+ * Work function called on one band [start, end) of the range.
+ */
+typedef void (*t_parallel_fn)(void *context, int start, int end);
+
+/**
+ * parallel_threadCount
+ * Returns the number of worker threads to use: the IMGPROC_THREADS environment variable
+ * if set, otherwise the number of online processors.
+ *
+ * Returns:
+ * int: Number of threads (at least 1).
+ */
+int parallel_threadCount();
+
+/**
+ * parallel_for
+ * Splits [0, count) into at most parallel_threadCount() bands and runs fn on each band in
+ * its own thread. Band boundaries are multiples of grain, so work units never straddle two
+ * threads. Runs inline when there is a single band or when threads cannot be created.
+ *
+ * Parameters:
+ * count (int): Size of the range.
+ * grain (int): Alignment of band boundaries (1 for no constraint).
+ * fn (t_parallel_fn): Work function.
+ * context (void*): Pointer passed to every call of fn.
+ */
+void parallel_for(int count, int grain, t_parallel_fn fn, void *context);
+
+#endif // PARALLEL_H
@@ -0,0 +1,1028 @@
+/**
+ * pipeline.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the deferred processing pipeline. Operations that change nothing are
+ * dropped from the recorded chain and negatives are moved ahead of the convolutions they
+ * commute with exactly; the chain is then split into passes. Each pass reads the
+ * image once: point operations before the convolution are applied as rows are loaded
+ * into a small ring buffer, point operations after it are applied as results are written
+ * back in place.
+ *
+ * Role in the project:
+ * Reduces a chain of N operations to roughly one memory pass per convolution.
+ */
+
+
+#include "pipeline.h"
+#include "histogram.h"
+#include "kernels.h"
+
+// Largest sum of absolute kernel weights times 255 for which float sums of pixels stay
+// exact integers (2^24)
+#define PIPELINE_EXACT_SUM (1 << 24)
+
+/**
+ * t_point_chain
+ * Fused chain of point operations: pre lookup table, optional channel average, post lookup table.
+ */
+typedef struct {
+    unsigned char pre[256];
+    int grayscale;
+    unsigned char post[256];
+} t_point_chain;
+
+/**
+ * t_pass
+ * One pass over the image: point chain on read, optional convolution, point chain on write.
+ */
+typedef struct {
+    t_point_chain in;
+    const t_op *conv;
+    t_point_chain out;
+} t_pass;
+
+
+/**
+ * pipeline_create
+ * Allocates an empty pipeline.
+ *
+ * Returns:
+ * t_pipeline*: Pointer to the new pipeline, or NULL on failure.
+ */
+t_pipeline *pipeline_create() {
+    t_pipeline *pipeline = calloc(1, sizeof(t_pipeline));
+    if (!pipeline) {
+        fprintf(stderr, "Error: Unable to allocate memory for pipeline.\n");
+        return NULL;
+    }
+    return pipeline;
+}
+
+
+/**
+ * pipeline_free
+ * Frees a pipeline and every recorded operation.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to free.
+ */
+void pipeline_free(t_pipeline *pipeline) {
+    if (pipeline) {
+        pipeline_clear(pipeline);
+        free(pipeline->ops);
+        free(pipeline);
+    }
+}
+
+
+/**
+ * pipeline_clear
+ * Removes every recorded operation, keeping the pipeline usable.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to clear.
+ */
+void pipeline_clear(t_pipeline *pipeline) {
+    if (!pipeline) return;
+
+    for (int i = 0; i < pipeline->count; i++) {
+        free(pipeline->ops[i].kernel);
+    }
+    pipeline->count = 0;
+}
+
+
+/**
+ * pipeline_push
+ * Appends an operation, growing the array if needed.
+ *
+ * Returns:
+ * t_op*: Pointer to the new (zeroed) operation, or NULL on allocation failure.
+ */
+static t_op *pipeline_push(t_pipeline *pipeline, t_op_type type) {
+    if (!pipeline) return NULL;
+
+    if (pipeline->count == pipeline->capacity) {
+        int capacity = pipeline->capacity ? pipeline->capacity * 2 : 8;
+        t_op *ops = realloc(pipeline->ops, capacity * sizeof(t_op));
+        if (!ops) {
+            fprintf(stderr, "Error: Unable to allocate memory for pipeline operations.\n");
+            return NULL;
+        }
+        pipeline->ops = ops;
+        pipeline->capacity = capacity;
+    }
+
+    t_op *op = &pipeline->ops[pipeline->count++];
+    memset(op, 0, sizeof(t_op));
+    op->type = type;
+    return op;
+}
+
+
+/**
+ * pipeline_addNegative
+ * Records a negative operation.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addNegative(t_pipeline *pipeline) {
+    return pipeline_push(pipeline, OP_NEGATIVE) != NULL;
+}
+
+
+/**
+ * pipeline_addBrightness
+ * Records a brightness adjustment.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ * value (int): Amount to add to each channel (positive or negative).
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addBrightness(t_pipeline *pipeline, int value) {
+    t_op *op = pipeline_push(pipeline, OP_BRIGHTNESS);
+    if (!op) return 0;
+    op->value = value;
+    return 1;
+}
+
+
+/**
+ * pipeline_addThreshold
+ * Records a threshold operation.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ * threshold (int): Threshold value (0-255).
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addThreshold(t_pipeline *pipeline, int threshold) {
+    t_op *op = pipeline_push(pipeline, OP_THRESHOLD);
+    if (!op) return 0;
+    op->value = threshold;
+    return 1;
+}
+
+
+/**
+ * pipeline_addGrayscale
+ * Records a grayscale conversion (no effect on 8-bit images).
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addGrayscale(t_pipeline *pipeline) {
+    return pipeline_push(pipeline, OP_GRAYSCALE) != NULL;
+}
+
+
+/**
+ * pipeline_addConvolution
+ * Records a convolution. The kernel weights are copied, so the caller keeps ownership of kernel.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ * kernel (float**): Square convolution kernel.
+ * kernelSize (int): Side of the kernel (odd).
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addConvolution(t_pipeline *pipeline, float **kernel, int kernelSize) {
+    if (!kernel || kernelSize <= 0 || kernelSize % 2 == 0) {
+        fprintf(stderr, "Error: Convolution kernels must have an odd size.\n");
+        return 0;
+    }
+
+    float *weights = malloc(kernelSize * kernelSize * sizeof(float));
+    if (!weights) {
+        fprintf(stderr, "Error: Unable to allocate memory for kernel.\n");
+        return 0;
+    }
+    for (int i = 0; i < kernelSize; i++) {
+        for (int j = 0; j < kernelSize; j++) {
+            weights[i * kernelSize + j] = kernel[i][j];
+        }
+    }
+
+    t_op *op = pipeline_push(pipeline, OP_CONVOLUTION);
+    if (!op) {
+        free(weights);
+        return 0;
+    }
+    op->kernelSize = kernelSize;
+    op->kernel = weights;
+    return 1;
+}
+
+
+/**
+ * kernel_isIdentity
+ * Checks that a kernel is 1 at its center and 0 elsewhere. Such a convolution returns
+ * every pixel unchanged, whatever the border rule.
+ */
+static int kernel_isIdentity(const t_op *op) {
+    int center = op->kernelSize * op->kernelSize / 2;
+    for (int i = 0; i < op->kernelSize * op->kernelSize; i++) {
+        if (op->kernel[i] != (i == center ? 1.0f : 0.0f)) return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * kernel_commutesWithNegative
+ * Checks that a kernel has integer weights summing to exactly 1 (sharpen, emboss).
+ * Sums of pixels are then exact integers, conv(255 - p) = 255 - conv(p), and clamping
+ * to [0, 255] is symmetric around 127.5, so negating before or after the convolution
+ * gives the same bytes. Pixels the convolution leaves alone get the negative either way.
+ */
+static int kernel_commutesWithNegative(const t_op *op) {
+    float sum = 0.0f;
+    float magnitude = 0.0f;
+    for (int i = 0; i < op->kernelSize * op->kernelSize; i++) {
+        float weight = op->kernel[i];
+        if (weight < -PIPELINE_EXACT_SUM || weight > PIPELINE_EXACT_SUM) return 0;
+        if (weight != (float)(int)weight) return 0;
+        sum += weight;
+        magnitude += weight < 0 ? -weight : weight;
+    }
+    return sum == 1.0f && magnitude * 255.0f < PIPELINE_EXACT_SUM;
+}
+
+
+/**
+ * pipeline_optimize
+ * Rewrites the recorded chain so it can run in fewer passes, without changing a single
+ * output byte. Operations that leave every pixel unchanged (a brightness of 0, an
+ * identity kernel) are dropped. A negative is moved ahead of the convolutions it
+ * commutes with (see kernel_commutesWithNegative), so it joins the point operations
+ * read before them, and two negatives that end up next to each other cancel out.
+ * Convolutions are not merged and other point operations are not moved: truncation
+ * and clamping after each step make such rewrites inexact.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to optimize.
+ */
+void pipeline_optimize(t_pipeline *pipeline) {
+    if (!pipeline) return;
+
+    t_op *ops = pipeline->ops;
+    int count = 0;
+    for (int i = 0; i < pipeline->count; i++) {
+        t_op op = ops[i];
+        int noop = (op.type == OP_BRIGHTNESS && op.value == 0) ||
+                   (op.type == OP_CONVOLUTION && kernel_isIdentity(&op));
+        if (noop) {
+            free(op.kernel);
+            continue;
+        }
+        if (op.type != OP_NEGATIVE) {
+            ops[count++] = op;
+            continue;
+        }
+
+        int at = count;
+        while (at > 0 && ops[at - 1].type == OP_CONVOLUTION && kernel_commutesWithNegative(&ops[at - 1])) {
+            at--;
+        }
+        if (at > 0 && ops[at - 1].type == OP_NEGATIVE) {
+            memmove(&ops[at - 1], &ops[at], (count - at) * sizeof(t_op));
+            count--;
+            continue;
+        }
+        memmove(&ops[at + 1], &ops[at], (count - at) * sizeof(t_op));
+        ops[at] = op;
+        count++;
+    }
+    pipeline->count = count;
+}
+
+
+/**
+ * chain_reset
+ * Sets a point chain to the identity.
+ */
+static void chain_reset(t_point_chain *chain) {
+    for (int i = 0; i < 256; i++) {
+        chain->pre[i] = (unsigned char)i;
+        chain->post[i] = (unsigned char)i;
+    }
+    chain->grayscale = 0;
+}
+
+
+/**
+ * chain_add
+ * Composes a point operation at the end of a chain.
+ */
+static void chain_add(t_point_chain *chain, const t_op *op) {
+    if (op->type == OP_GRAYSCALE) {
+        chain->grayscale = 1;
+        return;
+    }
+
+    // Once the channels are averaged, later operations apply to the average
+    unsigned char *lut = chain->grayscale ? chain->post : chain->pre;
+    for (int i = 0; i < 256; i++) {
+        int v = lut[i];
+        switch (op->type) {
+            case OP_NEGATIVE: v = 255 - v; break;
+            case OP_BRIGHTNESS: v = clamp(v + op->value); break;
+            case OP_THRESHOLD: v = (v >= op->value) ? 255 : 0; break;
+            default: break;
+        }
+        lut[i] = (unsigned char)v;
+    }
+}
+
+
+/**
+ * chain_apply
+ * Applies a point chain to one 24-bit pixel.
+ */
+static t_pixel chain_apply(const t_point_chain *chain, t_pixel px) {
+    px.red = chain->pre[px.red];
+    px.green = chain->pre[px.green];
+    px.blue = chain->pre[px.blue];
+    if (chain->grayscale) {
+        uint8_t avg = chain->post[(px.red + px.green + px.blue) / 3];
+        px.red = avg;
+        px.green = avg;
+        px.blue = avg;
+    }
+    return px;
+}
+
+
+/**
+ * chain_table
+ * Collapses a chain to a single table, valid for single-channel images.
+ */
+static void chain_table(const t_point_chain *chain, unsigned char table[256]) {
+    for (int i = 0; i < 256; i++) {
+        table[i] = chain->post[chain->pre[i]];
+    }
+}
+
+
+/**
+ * pipeline_buildPasses
+ * Splits an optimized chain into passes, each holding at most one convolution.
+ *
+ * Returns:
+ * int: Number of passes written to passes (which must hold count + 1 entries).
+ */
+static int pipeline_buildPasses(const t_pipeline *pipeline, t_pass *passes) {
+    int n = 0;
+    t_pass *current = &passes[0];
+    chain_reset(&current->in);
+    chain_reset(&current->out);
+    current->conv = NULL;
+    int used = 0;
+
+    for (int i = 0; i < pipeline->count; i++) {
+        const t_op *op = &pipeline->ops[i];
+        if (op->type == OP_CONVOLUTION) {
+            if (current->conv) {
+                current = &passes[++n];
+                chain_reset(&current->in);
+                chain_reset(&current->out);
+            }
+            current->conv = op;
+        } else {
+            chain_add(current->conv ? &current->out : &current->in, op);
+        }
+        used = 1;
+    }
+    return used ? n + 1 : 0;
+}
+
+
+/**
+ * pipeline_print
+ * Optimizes the chain, then prints the operations and the number of passes they will take.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to display.
+ */
+void pipeline_print(t_pipeline *pipeline) {
+    if (!pipeline || pipeline->count == 0) {
+        printf("Pipeline is empty.\n");
+        return;
+    }
+
+    pipeline_optimize(pipeline);
+    printf("Pending operations (optimized):\n");
+    for (int i = 0; i < pipeline->count; i++) {
+        t_op *op = &pipeline->ops[i];
+        switch (op->type) {
+            case OP_NEGATIVE: printf("%d. Negative\n", i + 1); break;
+            case OP_BRIGHTNESS: printf("%d. Brightness %+d\n", i + 1, op->value); break;
+            case OP_THRESHOLD: printf("%d. Threshold %d\n", i + 1, op->value); break;
+            case OP_GRAYSCALE: printf("%d. Grayscale\n", i + 1); break;
+            case OP_CONVOLUTION: printf("%d. Convolution %dx%d\n", i + 1, op->kernelSize, op->kernelSize); break;
+        }
+    }
+
+    t_pass *passes = malloc((pipeline->count + 1) * sizeof(t_pass));
+    if (passes) {
+        printf("Passes over the image: %d\n", pipeline_buildPasses(pipeline, passes));
+        free(passes);
+    }
+}
+
+
+/**
+ * pass_run8
+ * Runs one pass on 8-bit rows. Like bmp8_applyFilter, the convolution leaves a border
+ * of kernelSize / 2 pixels untouched by the kernel (point operations still apply there).
+ */
+static int pass_run8(const t_pass *pass, const t_view *img) {
+    int width = img->width;
+    int height = img->height;
+    ptrdiff_t stride = img->stride;
+    unsigned char in[256];
+    unsigned char out[256];
+    chain_table(&pass->in, in);
+    chain_table(&pass->out, out);
+
+    if (!pass->conv) {
+        for (int y = 0; y < height; y++) {
+            unsigned char *row = img->data + y * stride;
+            for (int x = 0; x < width; x++) {
+                row[x] = out[in[row[x]]];
+            }
+        }
+        return 1;
+    }
+
+    int size = pass->conv->kernelSize;
+    int n = size / 2;
+    const float *kernel = pass->conv->kernel;
+    t_kernel_impl impl = kernel_select(kernel, size);
+
+    // Ring buffer holding the transformed source rows y - n .. y + n
+    unsigned char *ring = malloc((size_t)size * width);
+    unsigned char **lines = malloc((size_t)size * sizeof(unsigned char *));
+    if (!ring || !lines) {
+        fprintf(stderr, "Error: Unable to allocate memory for pipeline pass.\n");
+        free(ring);
+        free(lines);
+        return 0;
+    }
+
+    int loaded = 0;
+    for (int y = 0; y < height; y++) {
+        while (loaded < height && loaded <= y + n) {
+            unsigned char *src = img->data + loaded * stride;
+            unsigned char *dst = ring + (size_t)(loaded % size) * width;
+            for (int x = 0; x < width; x++) {
+                dst[x] = in[src[x]];
+            }
+            loaded++;
+        }
+
+        unsigned char *cur = ring + (size_t)(y % size) * width;
+        unsigned char *row = img->data + y * stride;
+        if (y < n || y >= height - n) {
+            for (int x = 0; x < width; x++) row[x] = out[cur[x]];
+            continue;
+        }
+
+        // The row function writes columns n .. width - n - 1; the others keep the source
+        for (int k = 0; k < size; k++) {
+            lines[k] = ring + (size_t)((y - n + k) % size) * width;
+        }
+        impl.gray(row, lines, width, kernel, size);
+        for (int x = 0; x < width; x++) {
+            row[x] = out[x < n || x >= width - n ? cur[x] : row[x]];
+        }
+    }
+
+    free(ring);
+    free(lines);
+    return 1;
+}
+
+
+/**
+ * pass_row24
+ * Returns row y of a BGRA view.
+ */
+static t_pixel * pass_row24(const t_view *img, int y) {
+    return (t_pixel *)(img->data + y * img->stride);
+}
+
+
+/**
+ * pass_run24
+ * Runs one pass on BGRA rows. Edge pixels are clamped like in bmp24_apply_filter.
+ */
+static int pass_run24(const t_pass *pass, const t_view *img) {
+    int width = img->width;
+    int height = img->height;
+
+    if (!pass->conv) {
+        for (int y = 0; y < height; y++) {
+            t_pixel *row = pass_row24(img, y);
+            for (int x = 0; x < width; x++) {
+                row[x] = chain_apply(&pass->out, chain_apply(&pass->in, row[x]));
+            }
+        }
+        return 1;
+    }
+
+    int size = pass->conv->kernelSize;
+    int n = size / 2;
+    int padded = width + 2 * n;
+    const float *kernel = pass->conv->kernel;
+    t_kernel_impl impl = kernel_select(kernel, size);
+
+    // Ring buffer of transformed rows, padded with n replicated pixels on both sides
+    t_pixel *ring = malloc((size_t)size * padded * sizeof(t_pixel));
+    t_pixel *conv = malloc((size_t)padded * sizeof(t_pixel));
+    unsigned char **lines = malloc((size_t)size * sizeof(unsigned char *));
+    if (!ring || !conv || !lines) {
+        fprintf(stderr, "Error: Unable to allocate memory for pipeline pass.\n");
+        free(ring);
+        free(conv);
+        free(lines);
+        return 0;
+    }
+
+    int loaded = 0;
+    for (int y = 0; y < height; y++) {
+        int last = y + n < height ? y + n : height - 1;
+        while (loaded <= last) {
+            t_pixel *dst = ring + (size_t)(loaded % size) * padded + n;
+            for (int x = 0; x < width; x++) {
+                dst[x] = chain_apply(&pass->in, pass_row24(img, loaded)[x]);
+            }
+            for (int k = 1; k <= n; k++) {
+                dst[-k] = dst[0];
+                dst[width - 1 + k] = dst[width - 1];
+            }
+            loaded++;
+        }
+
+        for (int k = 0; k < size; k++) {
+            int sy = y - n + k;
+            if (sy < 0) sy = 0;
+            if (sy >= height) sy = height - 1;
+            lines[k] = (unsigned char *)(ring + (size_t)(sy % size) * padded);
+        }
+        impl.color((unsigned char *)conv, lines, padded, kernel, size);
+
+        t_pixel *row = pass_row24(img, y);
+        for (int x = 0; x < width; x++) {
+            t_pixel result = conv[x + n];
+            result.alpha = row[x].alpha;
+            row[x] = chain_apply(&pass->out, result);
+        }
+    }
+
+    free(ring);
+    free(conv);
+    free(lines);
+    return 1;
+}
+
+
+/**
+ * pipeline_apply8
+ * Runs the operations of the pipeline, as they are, on an 8-bit image.
+ * The pipeline is neither optimized nor cleared, so it can be shared by several threads.
+ *
+ * Parameters:
+ * pipeline (const t_pipeline*): Pipeline to run.
+ * img (t_bmp8*): Image to modify.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+int pipeline_apply8(const t_pipeline *pipeline, t_bmp8 *img) {
+    if (!pipeline || !img || !img->data || pipeline->count == 0) return 0;
+
+    t_pass *passes = malloc((pipeline->count + 1) * sizeof(t_pass));
+    if (!passes) {
+        fprintf(stderr, "Error: Unable to allocate memory for pipeline passes.\n");
+        return -1;
+    }
+
+    // Rows in storage order, so that kernels are oriented like in bmp8_applyFilter
+    t_view rows = {img->data, (int)img->width, (int)img->height, BMP8_ROW_SIZE(img->width), VIEW_GRAY8, NULL, 0, 1};
+    int count = pipeline_buildPasses(pipeline, passes);
+    unsigned long version = img->dirty.version;
+    int completed = 1;
+    for (int i = 0; i < count; i++) {
+        if (!pass_run8(&passes[i], &rows)) {
+            completed = 0;
+            break;
+        }
+    }
+    dirty_markAll(&img->dirty);
+
+    // Without convolution the whole pipeline is one table, which also carries the histogram
+    int pointOnly = completed;
+    unsigned char lut[256];
+    for (int v = 0; v < 256; v++) lut[v] = (unsigned char)v;
+    for (int i = 0; i < count && pointOnly; i++) {
+        unsigned char in[256];
+        unsigned char out[256];
+        chain_table(&passes[i].in, in);
+        chain_table(&passes[i].out, out);
+        for (int v = 0; v < 256; v++) lut[v] = out[in[lut[v]]];
+        pointOnly = passes[i].conv == NULL;
+    }
+    if (pointOnly) bmp8_histogramRemap(img, lut, version);
+
+    free(passes);
+    return completed ? 0 : -1;
+}
+
+
+/**
+ * pipeline_apply24
+ * Runs the operations of the pipeline, as they are, on a 24-bit image.
+ * The pipeline is neither optimized nor cleared, so it can be shared by several threads.
+ *
+ * Parameters:
+ * pipeline (const t_pipeline*): Pipeline to run.
+ * img (t_bmp24*): Image to modify.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+int pipeline_apply24(const t_pipeline *pipeline, t_bmp24 *img) {
+    if (!pipeline || !img || !img->data || pipeline->count == 0) return 0;
+
+    t_pass *passes = malloc((pipeline->count + 1) * sizeof(t_pass));
+    if (!passes) {
+        fprintf(stderr, "Error: Unable to allocate memory for pipeline passes.\n");
+        return -1;
+    }
+
+    t_view rows = bmp24_view(img);
+    int count = pipeline_buildPasses(pipeline, passes);
+    int completed = 1;
+    for (int i = 0; i < count && completed; i++) {
+        completed = pass_run24(&passes[i], &rows);
+    }
+    dirty_markAll(&img->dirty);
+
+    free(passes);
+    return completed ? 0 : -1;
+}
+
+
+/**
+ * pipeline_applyView
+ * Runs the operations of the pipeline, as they are, on the pixels of a view, in place.
+ * Gray views are processed like 8-bit images (kernels see the rows bottom-up) and BGRA
+ * views like 24-bit images (kernels see the rows top-down).
+ *
+ * Parameters:
+ * pipeline (const t_pipeline*): Pipeline to run.
+ * view (const t_view*): Pixels to modify.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+int pipeline_applyView(const t_pipeline *pipeline, const t_view *view) {
+    if (!pipeline || !view || !view->data || pipeline->count == 0) return 0;
+
+    t_pass *passes = malloc((pipeline->count + 1) * sizeof(t_pass));
+    if (!passes) {
+        fprintf(stderr, "Error: Unable to allocate memory for pipeline passes.\n");
+        return -1;
+    }
+
+    // Gray rows bottom-up, in the storage order pipeline_apply8 uses
+    t_view rows = *view;
+    if (view->format == VIEW_GRAY8 && view->height > 0) {
+        rows.data = view_row(view, view->height - 1);
+        rows.stride = -view->stride;
+    }
+    int count = pipeline_buildPasses(pipeline, passes);
+    int completed = 1;
+    for (int i = 0; i < count && completed; i++) {
+        completed = view->format == VIEW_GRAY8 ? pass_run8(&passes[i], &rows) : pass_run24(&passes[i], &rows);
+    }
+    if (view->dirty && view->height > 0) {
+        int last = view->dirtyRow + (view->height - 1) * view->dirtyStep;
+        dirty_mark(view->dirty, view->dirtyStep > 0 ? view->dirtyRow : last, view->height);
+    }
+
+    free(passes);
+    return completed ? 0 : -1;
+}
+
+
+/**
+ * t_stream_stage
+ * State of one pass of a row stream. A pass with a convolution keeps the last
+ * kernelSize rows it received (after its input chain) and emits row y once row y + n has
+ * arrived, n being half the kernel size.
+ */
+typedef struct {
+    t_pass pass;
+    unsigned char in[256];
+    unsigned char out[256];
+    float *kernel;
+    t_kernel_impl impl;
+    int size;
+    int n;
+    unsigned char *ring;
+    unsigned char **lines;
+    unsigned char *conv;
+    unsigned char *row;
+    int received;
+    int emitted;
+} t_stream_stage;
+
+/**
+ * t_row_stream
+ * Passes of a pipeline run on rows arriving one at a time.
+ */
+struct t_row_stream {
+    t_view_format format;
+    int width;
+    int height;
+    int bottomUp;
+    int count;
+    t_stream_stage *stages;
+    t_row_sink sink;
+    void *context;
+};
+
+
+/**
+ * stream_rowBytes
+ * Bytes of one row of a stage ring (color rows are padded with n pixels on both sides).
+ */
+static size_t stream_rowBytes(const t_row_stream *stream, int n) {
+    if (stream->format == VIEW_GRAY8) return (size_t)stream->width;
+    return (size_t)(stream->width + 2 * n) * sizeof(t_pixel);
+}
+
+
+/**
+ * stream_emit
+ * Computes row y of a stage with a convolution into stage->row, like pass_run8 (border
+ * left to the point operations) or pass_run24 (edges clamped).
+ */
+static void stream_emit(const t_row_stream *stream, t_stream_stage *stage, int y) {
+    int width = stream->width;
+    int height = stream->height;
+    int size = stage->size;
+    int n = stage->n;
+    size_t rowBytes = stream_rowBytes(stream, n);
+
+    if (stream->format == VIEW_GRAY8) {
+        const unsigned char *cur = stage->ring + (size_t)(y % size) * rowBytes;
+        unsigned char *row = stage->row;
+        if (y < n || y >= height - n) {
+            for (int x = 0; x < width; x++) row[x] = stage->out[cur[x]];
+            return;
+        }
+        for (int k = 0; k < size; k++) {
+            stage->lines[k] = stage->ring + (size_t)((y - n + k) % size) * rowBytes;
+        }
+        stage->impl.gray(row, stage->lines, width, stage->kernel, size);
+        for (int x = 0; x < width; x++) {
+            row[x] = stage->out[x < n || x >= width - n ? cur[x] : row[x]];
+        }
+        return;
+    }
+
+    // Kernel rows are given from the top of the image down, like in pass_run24, so that
+    // bottom-up files give the same rounding
+    for (int k = 0; k < size; k++) {
+        int sy = stream->bottomUp ? y + n - k : y + k - n;
+        if (sy < 0) sy = 0;
+        if (sy >= height) sy = height - 1;
+        stage->lines[k] = stage->ring + (size_t)(sy % size) * rowBytes;
+    }
+    stage->impl.color(stage->conv, stage->lines, width + 2 * n, stage->kernel, size);
+
+    const t_pixel *cur = (const t_pixel *)(stage->ring + (size_t)(y % size) * rowBytes) + n;
+    const t_pixel *conv = (const t_pixel *)stage->conv + n;
+    t_pixel *row = (t_pixel *)stage->row;
+    for (int x = 0; x < width; x++) {
+        t_pixel result = conv[x];
+        result.alpha = cur[x].alpha;
+        row[x] = chain_apply(&stage->pass.out, result);
+    }
+}
+
+
+/**
+ * stream_feed
+ * Gives the next row to stage k, and the rows it can then emit to the following stages.
+ * After the last stage, rows go to the sink.
+ */
+static int stream_feed(t_row_stream *stream, int k, const unsigned char *row) {
+    if (k == stream->count) return stream->sink(stream->context, row);
+
+    t_stream_stage *stage = &stream->stages[k];
+    int width = stream->width;
+    int n = stage->n;
+
+    if (!stage->kernel) {
+        if (stream->format == VIEW_GRAY8) {
+            for (int x = 0; x < width; x++) stage->row[x] = stage->out[stage->in[row[x]]];
+        } else {
+            const t_pixel *src = (const t_pixel *)row;
+            t_pixel *dst = (t_pixel *)stage->row;
+            for (int x = 0; x < width; x++) dst[x] = chain_apply(&stage->pass.out, chain_apply(&stage->pass.in, src[x]));
+        }
+        return stream_feed(stream, k + 1, stage->row);
+    }
+
+    // The slot of row received - size is free: that row was emitted before this one arrived
+    unsigned char *slot = stage->ring + (size_t)(stage->received % stage->size) * stream_rowBytes(stream, n);
+    if (stream->format == VIEW_GRAY8) {
+        for (int x = 0; x < width; x++) slot[x] = stage->in[row[x]];
+    } else {
+        const t_pixel *src = (const t_pixel *)row;
+        t_pixel *dst = (t_pixel *)slot + n;
+        for (int x = 0; x < width; x++) dst[x] = chain_apply(&stage->pass.in, src[x]);
+        for (int i = 1; i <= n; i++) {
+            dst[-i] = dst[0];
+            dst[width - 1 + i] = dst[width - 1];
+        }
+    }
+    stage->received++;
+
+    while (stage->emitted < stream->height) {
+        int needed = stage->emitted + n + 1 < stream->height ? stage->emitted + n + 1 : stream->height;
+        if (stage->received < needed) break;
+        stream_emit(stream, stage, stage->emitted);
+        stage->emitted++;
+        if (stream_feed(stream, k + 1, stage->row) != 0) return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * pipeline_streamCreate
+ * Prepares the operations of the pipeline, as they are, to run on rows given one at a
+ * time, top to bottom in the order of the file. Only the rows a convolution still needs
+ * are kept, so the memory used does not depend on the height of the image. The results
+ * match pipeline_apply8 and pipeline_apply24 on the whole image.
+ *
+ * Parameters:
+ * pipeline (const t_pipeline*): Pipeline to run (must outlive the stream).
+ * format (t_view_format): Layout of the rows (bytes, or t_pixel values).
+ * width, height (int): Image size in pixels.
+ * bottomUp (int): Non-zero if the rows arrive from the bottom of the image (color
+ *     kernels then read the rows in reverse, so that they see the image the right way up).
+ * sink (t_row_sink): Receives each processed row, in the order the rows arrived.
+ * context (void*): Passed to the sink.
+ *
+ * Returns:
+ * t_row_stream*: Pointer to the stream, or NULL on allocation failure.
+ */
+t_row_stream *pipeline_streamCreate(const t_pipeline *pipeline, t_view_format format, int width, int height,
+                                    int bottomUp, t_row_sink sink, void *context) {
+    t_row_stream *stream = calloc(1, sizeof(t_row_stream));
+    t_pass *passes = pipeline ? malloc((pipeline->count + 1) * sizeof(t_pass)) : NULL;
+    if (!stream || !passes) {
+        fprintf(stderr, "Error: Unable to allocate memory for the row stream.\n");
+        free(stream);
+        free(passes);
+        return NULL;
+    }
+    stream->format = format;
+    stream->width = width;
+    stream->height = height;
+    stream->bottomUp = bottomUp;
+    stream->sink = sink;
+    stream->context = context;
+    stream->count = pipeline_buildPasses(pipeline, passes);
+    stream->stages = calloc(stream->count ? stream->count : 1, sizeof(t_stream_stage));
+    int ok = stream->stages != NULL;
+
+    for (int i = 0; ok && i < stream->count; i++) {
+        t_stream_stage *stage = &stream->stages[i];
+        stage->pass = passes[i];
+        chain_table(&stage->pass.in, stage->in);
+        chain_table(&stage->pass.out, stage->out);
+
+        int n = 0;
+        if (stage->pass.conv) {
+            stage->size = stage->pass.conv->kernelSize;
+            n = stage->n = stage->size / 2;
+            stage->kernel = malloc((size_t)stage->size * stage->size * sizeof(float));
+            stage->ring = malloc((size_t)stage->size * stream_rowBytes(stream, n));
+            stage->lines = malloc((size_t)stage->size * sizeof(unsigned char *));
+            stage->conv = malloc(stream_rowBytes(stream, n));
+            ok = stage->kernel && stage->ring && stage->lines && stage->conv;
+            if (ok) memcpy(stage->kernel, stage->pass.conv->kernel, (size_t)stage->size * stage->size * sizeof(float));
+            stage->impl = kernel_select(stage->pass.conv->kernel, stage->size);
+        }
+        stage->row = malloc(stream_rowBytes(stream, n));
+        ok = ok && stage->row;
+    }
+    free(passes);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to allocate memory for the row stream.\n");
+        pipeline_streamFree(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+
+/**
+ * pipeline_streamPush
+ * Gives the next row to a stream. Processed rows are given to the sink as soon as they
+ * are known: a pass with a kernel of size k holds back k / 2 rows, and the last rows
+ * come out when the last row is pushed.
+ *
+ * Parameters:
+ * stream (t_row_stream*): Stream.
+ * row (const unsigned char*): Pixels of the row (not modified).
+ *
+ * Returns:
+ * int: 0 on success, -1 if the sink failed.
+ */
+int pipeline_streamPush(t_row_stream *stream, const unsigned char *row) {
+    return stream_feed(stream, 0, row);
+}
+
+
+/**
+ * pipeline_streamFree
+ * Frees a row stream.
+ *
+ * Parameters:
+ * stream (t_row_stream*): Stream to free (may be NULL).
+ */
+void pipeline_streamFree(t_row_stream *stream) {
+    if (!stream) return;
+    for (int i = 0; stream->stages && i < stream->count; i++) {
+        free(stream->stages[i].kernel);
+        free(stream->stages[i].ring);
+        free(stream->stages[i].lines);
+        free(stream->stages[i].conv);
+        free(stream->stages[i].row);
+    }
+    free(stream->stages);
+    free(stream);
+}
+
+
+/**
+ * pipeline_execute8
+ * Optimizes and runs the pipeline on an 8-bit image, then clears it.
+ * Adjacent point operations are fused into one lookup table and applied while the
+ * convolution reads or writes its rows, so each pass touches the image only once.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to run.
+ * img (t_bmp8*): Image to modify.
+ */
+void pipeline_execute8(t_pipeline *pipeline, t_bmp8 *img) {
+    if (!pipeline || !img || !img->data || pipeline->count == 0) return;
+
+    pipeline_optimize(pipeline);
+    pipeline_apply8(pipeline, img);
+    pipeline_clear(pipeline);
+}
+
+
+/**
+ * pipeline_execute24
+ * Optimizes and runs the pipeline on a 24-bit image, then clears it.
+ * Adjacent point operations are fused into one lookup table and applied while the
+ * convolution reads or writes its rows, so each pass touches the image only once.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to run.
+ * img (t_bmp24*): Image to modify.
+ */
+void pipeline_execute24(t_pipeline *pipeline, t_bmp24 *img) {
+    if (!pipeline || !img || !img->data || pipeline->count == 0) return;
+
+    pipeline_optimize(pipeline);
+    pipeline_apply24(pipeline, img);
+    pipeline_clear(pipeline);
+}
@@ -0,0 +1,314 @@
+/**
+ * pipeline.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring a deferred processing pipeline for 8-bit and 24-bit BMP images.
+ * Operations are recorded instead of being applied immediately, then the chain is
+ * optimized (removal of operations without effect, negatives moved ahead of the
+ * convolutions they commute with, fusion of point operations)
+ * and executed in as few passes over the image as possible.
+ *
+ * Role in the project:
+ * Lets the menus queue several operations and run them all at once when the image is saved.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "bmp8.h"
+#include "bmp24.h"
+#include "view.h"
+
+/**
+ * t_op_type
+ * Kind of operation recorded in a pipeline.
+ */
+typedef enum {
+    OP_NEGATIVE,
+    OP_BRIGHTNESS,
+    OP_THRESHOLD,
+    OP_GRAYSCALE,
+    OP_CONVOLUTION
+} t_op_type;
+
+/**
+ * t_op
+ * Structure representing one recorded operation.
+ *
+ * Members:
+ * type (t_op_type): Kind of operation.
+ * value (int): Brightness offset or threshold value, unused otherwise.
+ * kernelSize (int): Side of the square kernel (convolution only).
+ * kernel (float*): kernelSize * kernelSize weights stored row by row (convolution only).
+ */
+typedef struct {
+    t_op_type type;
+    int value;
+    int kernelSize;
+    float *kernel;
+} t_op;
+
+/**
+ * t_pipeline
+ * Structure representing an ordered list of deferred operations.
+ *
+ * Members:
+ * ops (t_op*): Recorded operations, in application order.
+ * count (int): Number of recorded operations.
+ * capacity (int): Allocated number of operations.
+ */
+typedef struct {
+    t_op *ops;
+    int count;
+    int capacity;
+} t_pipeline;
+
+/**
+ * pipeline_create
+ * Allocates an empty pipeline.
+ *
+ * Returns:
+ * t_pipeline*: Pointer to the new pipeline, or NULL on failure.
+ */
+t_pipeline * pipeline_create();
+
+/**
+ * pipeline_free
+ * Frees a pipeline and every recorded operation.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to free.
+ */
+void pipeline_free(t_pipeline *pipeline);
+
+/**
+ * pipeline_clear
+ * Removes every recorded operation, keeping the pipeline usable.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to clear.
+ */
+void pipeline_clear(t_pipeline *pipeline);
+
+/**
+ * pipeline_addNegative
+ * Records a negative operation.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addNegative(t_pipeline *pipeline);
+
+/**
+ * pipeline_addBrightness
+ * Records a brightness adjustment.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ * value (int): Amount to add to each channel (positive or negative).
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addBrightness(t_pipeline *pipeline, int value);
+
+/**
+ * pipeline_addThreshold
+ * Records a threshold operation.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ * threshold (int): Threshold value (0-255).
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addThreshold(t_pipeline *pipeline, int threshold);
+
+/**
+ * pipeline_addGrayscale
+ * Records a grayscale conversion (no effect on 8-bit images).
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addGrayscale(t_pipeline *pipeline);
+
+/**
+ * pipeline_addConvolution
+ * Records a convolution. The kernel weights are copied, so the caller keeps ownership of kernel.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to extend.
+ * kernel (float**): Square convolution kernel.
+ * kernelSize (int): Side of the kernel (odd).
+ *
+ * Returns:
+ * int: 1 on success, 0 on allocation failure.
+ */
+int pipeline_addConvolution(t_pipeline *pipeline, float **kernel, int kernelSize);
+
+/**
+ * pipeline_optimize
+ * Rewrites the recorded chain so it can run in fewer passes, without changing a single
+ * output byte. Operations that leave every pixel unchanged (a brightness of 0, an
+ * identity kernel) are dropped. A negative is moved ahead of the convolutions with
+ * integer weights summing to 1 (sharpen, emboss), with which it commutes exactly, and
+ * two negatives that end up next to each other cancel out. Convolutions are not merged
+ * and other point operations are not moved: truncation and clamping after each step
+ * make such rewrites inexact.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to optimize.
+ */
+void pipeline_optimize(t_pipeline *pipeline);
+
+/**
+ * pipeline_print
+ * Optimizes the chain, then prints the operations and the number of passes they will take.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to display.
+ */
+void pipeline_print(t_pipeline *pipeline);
+
+/**
+ * pipeline_apply8
+ * Runs the operations of the pipeline, as they are, on an 8-bit image.
+ * The pipeline is neither optimized nor cleared, so it can be shared by several threads.
+ *
+ * Parameters:
+ * pipeline (const t_pipeline*): Pipeline to run.
+ * img (t_bmp8*): Image to modify.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+int pipeline_apply8(const t_pipeline *pipeline, t_bmp8 *img);
+
+/**
+ * pipeline_apply24
+ * Runs the operations of the pipeline, as they are, on a 24-bit image.
+ * The pipeline is neither optimized nor cleared, so it can be shared by several threads.
+ *
+ * Parameters:
+ * pipeline (const t_pipeline*): Pipeline to run.
+ * img (t_bmp24*): Image to modify.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+int pipeline_apply24(const t_pipeline *pipeline, t_bmp24 *img);
+
+/**
+ * pipeline_applyView
+ * Runs the operations of the pipeline, as they are, on the pixels of a view, in place.
+ * Gray views are processed like 8-bit images (kernels see the rows bottom-up) and BGRA
+ * views like 24-bit images (kernels see the rows top-down).
+ *
+ * Parameters:
+ * pipeline (const t_pipeline*): Pipeline to run.
+ * view (const t_view*): Pixels to modify.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+int pipeline_applyView(const t_pipeline *pipeline, const t_view *view);
+
+/**
+ * t_row_sink
+ * Receives the processed rows of a row stream, one at a time.
+ *
+ * Parameters:
+ * context (void*): Context given to pipeline_streamCreate.
+ * row (const unsigned char*): Pixels of the row, valid until the function returns.
+ *
+ * Returns:
+ * int: 0 to continue, -1 to stop the stream (for instance on a write error).
+ */
+typedef int (*t_row_sink)(void *context, const unsigned char *row);
+
+/**
+ * t_row_stream
+ * Pipeline prepared to run on rows arriving one at a time (see pipeline_streamCreate).
+ */
+typedef struct t_row_stream t_row_stream;
+
+/**
+ * pipeline_streamCreate
+ * Prepares the operations of the pipeline, as they are, to run on rows given one at a
+ * time, top to bottom in the order of the file. Only the rows a convolution still needs
+ * are kept, so the memory used does not depend on the height of the image. The results
+ * match pipeline_apply8 and pipeline_apply24 on the whole image.
+ *
+ * Parameters:
+ * pipeline (const t_pipeline*): Pipeline to run (must outlive the stream).
+ * format (t_view_format): Layout of the rows (bytes, or t_pixel values).
+ * width, height (int): Image size in pixels.
+ * bottomUp (int): Non-zero if the rows arrive from the bottom of the image (color
+ *     kernels then read the rows in reverse, so that they see the image the right way up).
+ * sink (t_row_sink): Receives each processed row, in the order the rows arrived.
+ * context (void*): Passed to the sink.
+ *
+ * Returns:
+ * t_row_stream*: Pointer to the stream, or NULL on allocation failure.
+ */
+t_row_stream * pipeline_streamCreate(const t_pipeline *pipeline, t_view_format format, int width, int height,
+                                     int bottomUp, t_row_sink sink, void *context);
+
+/**
+ * pipeline_streamPush
+ * Gives the next row to a stream. Processed rows are given to the sink as soon as they
+ * are known: a pass with a kernel of size k holds back k / 2 rows, and the last rows
+ * come out when the last row is pushed.
+ *
+ * Parameters:
+ * stream (t_row_stream*): Stream.
+ * row (const unsigned char*): Pixels of the row (not modified).
+ *
+ * Returns:
+ * int: 0 on success, -1 if the sink failed.
+ */
+int pipeline_streamPush(t_row_stream *stream, const unsigned char *row);
+
+/**
+ * pipeline_streamFree
+ * Frees a row stream.
+ *
+ * Parameters:
+ * stream (t_row_stream*): Stream to free (may be NULL).
+ */
+void pipeline_streamFree(t_row_stream *stream);
+
+/**
+ * pipeline_execute8
+ * Optimizes and runs the pipeline on an 8-bit image, then clears it.
+ * Adjacent point operations are fused into one lookup table and applied while the
+ * convolution reads or writes its rows, so each pass touches the image only once.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to run.
+ * img (t_bmp8*): Image to modify.
+ */
+void pipeline_execute8(t_pipeline *pipeline, t_bmp8 *img);
+
+/**
+ * pipeline_execute24
+ * Optimizes and runs the pipeline on a 24-bit image, then clears it.
+ * Adjacent point operations are fused into one lookup table and applied while the
+ * convolution reads or writes its rows, so each pass touches the image only once.
+ *
+ * Parameters:
+ * pipeline (t_pipeline*): Pipeline to run.
+ * img (t_bmp24*): Image to modify.
+ */
+void pipeline_execute24(t_pipeline *pipeline, t_bmp24 *img);
+
+#endif // PIPELINE_H
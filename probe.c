@@ -0,0 +1,458 @@
+/**
+ * probe.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the header-only BMP probe and the parallel directory scanner.
+ * Each probe costs one open, one fstat and one 54-byte read, so scanning is bound by
+ * the number of files rather than by their size. The directory walk is sequential,
+ * the probes are split over threads and the records are written in path order.
+ *
+ * Role in the project:
+ * Lets large collections of BMP files be catalogued without loading any pixel data.
+ */
+
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "probe.h"
+#include "parallel.h"
+
+// File header (14 bytes) followed by a BITMAPINFOHEADER (40 bytes)
+#define PROBE_HEADER_SIZE 54
+// Size of the OS/2 BITMAPCOREHEADER
+#define PROBE_CORE_SIZE 12
+// Files probed per work unit of the scanner
+#define PROBE_GRAIN 16
+
+
+/**
+ * t_path_list
+ * Growable list of file paths.
+ */
+typedef struct {
+    char **paths;
+    long count;
+    long capacity;
+} t_path_list;
+
+/**
+ * t_probe_job
+ * Shared state of a parallel scan.
+ */
+typedef struct {
+    char **paths;
+    t_bmp_probe *probes;
+} t_probe_job;
+
+
+/**
+ * probe_u16 / probe_u32
+ * Little-endian reads from a header buffer.
+ */
+static uint32_t probe_u16(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static uint32_t probe_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+
+/**
+ * probe_file
+ * Reads and validates the headers of a BMP file with a single read.
+ * The palette size is derived from the header; pixel data is never read.
+ *
+ * Parameters:
+ * filename (const char*): Path to the BMP file.
+ * probe (t_bmp_probe*): Receives the metadata. probe->error is set on failure.
+ *
+ * Returns:
+ * int: 1 if the file is a valid BMP, 0 otherwise.
+ */
+int probe_file(const char *filename, t_bmp_probe *probe) {
+    unsigned char h[PROBE_HEADER_SIZE];
+    memset(probe, 0, sizeof(*probe));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        probe->error = "cannot open file";
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        probe->error = "cannot stat file";
+        return 0;
+    }
+    ssize_t n = read(fd, h, sizeof(h));
+    close(fd);
+    return probe_header(h, n > 0 ? (size_t)n : 0, (uint64_t)st.st_size, probe);
+}
+
+
+/**
+ * probe_header
+ * Validates the headers of a BMP file already read into memory.
+ *
+ * Parameters:
+ * h (const unsigned char*): First bytes of the file.
+ * n (size_t): Number of bytes in h (54 are enough, 26 for an OS/2 header).
+ * fileSize (uint64_t): Size of the file in bytes, or 0 if unknown (a stream): the checks
+ *     against the file size are then skipped.
+ * probe (t_bmp_probe*): Receives the metadata. probe->error is set on failure.
+ *
+ * Returns:
+ * int: 1 if the headers are valid, 0 otherwise.
+ */
+int probe_header(const unsigned char *h, size_t n, uint64_t fileSize, t_bmp_probe *probe) {
+    memset(probe, 0, sizeof(*probe));
+    probe->fileSize = fileSize;
+
+    if (n < 14 + PROBE_CORE_SIZE) {
+        probe->error = "truncated header";
+        return 0;
+    }
+    if (h[0] != 'B' || h[1] != 'M') {
+        probe->error = "not a BMP file";
+        return 0;
+    }
+
+    uint32_t infoSize = probe_u32(h + 14);
+    uint32_t planes;
+    uint32_t paletteEntry;
+    probe->offset = probe_u32(h + 10);
+
+    if (infoSize == PROBE_CORE_SIZE) {
+        // OS/2 header: 16-bit dimensions, no compression, 3-byte palette entries
+        probe->width = (int32_t)probe_u16(h + 18);
+        probe->height = (int32_t)probe_u16(h + 20);
+        planes = probe_u16(h + 22);
+        probe->depth = (uint16_t)probe_u16(h + 24);
+        probe->compression = BI_RGB;
+        paletteEntry = 3;
+    } else if (infoSize >= 40 && n >= PROBE_HEADER_SIZE) {
+        probe->width = (int32_t)probe_u32(h + 18);
+        probe->height = (int32_t)probe_u32(h + 22);
+        planes = probe_u16(h + 26);
+        probe->depth = (uint16_t)probe_u16(h + 28);
+        probe->compression = probe_u32(h + 30);
+        probe->colors = probe_u32(h + 46);
+        paletteEntry = 4;
+    } else {
+        probe->error = n < PROBE_HEADER_SIZE ? "truncated header" : "unsupported info header";
+        return 0;
+    }
+
+    uint16_t d = probe->depth;
+    if (planes != 1) {
+        probe->error = "invalid plane count";
+        return 0;
+    }
+    if (d != 1 && d != 4 && d != 8 && d != 16 && d != 24 && d != 32) {
+        probe->error = "unsupported bit depth";
+        return 0;
+    }
+    if (probe->width <= 0 || probe->height == 0 || probe->height == INT32_MIN) {
+        probe->error = "invalid dimensions";
+        return 0;
+    }
+
+    // Palettes are only used up to 8 bits; 0 means the maximum
+    if (d <= 8) {
+        if (probe->colors == 0) probe->colors = 1u << d;
+        if (probe->colors > (1u << d)) {
+            probe->error = "invalid palette size";
+            return 0;
+        }
+    }
+
+    uint64_t minOffset = 14 + (uint64_t)infoSize + (uint64_t)probe->colors * paletteEntry;
+    if (probe->compression == BI_BITFIELDS && infoSize == 40) minOffset += 12;
+    if (probe->offset < minOffset) {
+        probe->error = "invalid data offset";
+        return 0;
+    }
+    if (fileSize && probe->offset > fileSize) {
+        probe->error = "truncated file";
+        return 0;
+    }
+
+    // Uncompressed data has a known size
+    if (fileSize && (probe->compression == BI_RGB || probe->compression == BI_BITFIELDS)) {
+        uint64_t rowSize = ((uint64_t)probe->width * d + 31) / 32 * 4;
+        uint64_t rows = probe->height < 0 ? (uint64_t)(-(int64_t)probe->height) : (uint64_t)probe->height;
+        if (probe->offset + rowSize * rows > probe->fileSize) {
+            probe->error = "truncated pixel data";
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * probe_compressionName
+ * Returns the name of a BMP compression method.
+ *
+ * Parameters:
+ * compression (uint32_t): Compression field of the info header.
+ *
+ * Returns:
+ * const char*: Name such as "BI_RGB", or "unknown".
+ */
+const char *probe_compressionName(uint32_t compression) {
+    switch (compression) {
+        case BI_RGB: return "BI_RGB";
+        case BI_RLE8: return "BI_RLE8";
+        case BI_RLE4: return "BI_RLE4";
+        case BI_BITFIELDS: return "BI_BITFIELDS";
+        case 4: return "BI_JPEG";
+        case 5: return "BI_PNG";
+        default: return "unknown";
+    }
+}
+
+
+/**
+ * probe_print
+ * Prints the metadata of a probed file to the console.
+ *
+ * Parameters:
+ * filename (const char*): Path of the file.
+ * probe (const t_bmp_probe*): Metadata returned by probe_file.
+ */
+void probe_print(const char *filename, const t_bmp_probe *probe) {
+    printf("%s:\n", filename);
+    if (probe->error) {
+        printf("Invalid BMP file: %s\n", probe->error);
+        return;
+    }
+    printf("Width: %d px\n", probe->width);
+    printf("Height: %d px%s\n", probe->height < 0 ? -probe->height : probe->height,
+           probe->height < 0 ? " (top-down)" : "");
+    printf("Color Depth: %u bits\n", probe->depth);
+    printf("Compression: %s\n", probe_compressionName(probe->compression));
+    if (probe->colors) printf("Palette: %u colors\n", probe->colors);
+    printf("File Size: %llu bytes\n", (unsigned long long)probe->fileSize);
+}
+
+
+/**
+ * probe_addPath
+ * Appends a copy of a path to the list.
+ */
+static int probe_addPath(t_path_list *list, const char *path) {
+    if (list->count == list->capacity) {
+        long capacity = list->capacity ? list->capacity * 2 : 256;
+        char **paths = realloc(list->paths, capacity * sizeof(char *));
+        if (!paths) return 0;
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    char *copy = strdup(path);
+    if (!copy) return 0;
+    list->paths[list->count++] = copy;
+    return 1;
+}
+
+
+/**
+ * probe_isBmpName
+ * Returns 1 if the file name ends with .bmp (any case).
+ */
+static int probe_isBmpName(const char *name) {
+    size_t length = strlen(name);
+    return length > 4 && strcasecmp(name + length - 4, ".bmp") == 0;
+}
+
+
+/**
+ * probe_collect
+ * Walks a directory and adds its .bmp files to the list. Symbolic links to
+ * directories are not followed, so the walk always terminates.
+ */
+static int probe_collect(const char *path, int recursive, t_path_list *list) {
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+
+    struct dirent *entry;
+    char child[4096];
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+        if (snprintf(child, sizeof(child), "%s/%s", path, name) >= (int)sizeof(child)) continue;
+
+        // d_type saves a stat per entry on file systems that fill it
+        int isDir = entry->d_type == DT_DIR;
+        int isFile = entry->d_type == DT_REG;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+            struct stat st;
+            if (lstat(child, &st) != 0) continue;
+            if (S_ISLNK(st.st_mode) && stat(child, &st) == 0) {
+                isFile = S_ISREG(st.st_mode);
+            } else {
+                isDir = S_ISDIR(st.st_mode);
+                isFile = S_ISREG(st.st_mode);
+            }
+        }
+
+        if (isDir && recursive) {
+            probe_collect(child, recursive, list);
+        } else if (isFile && probe_isBmpName(name)) {
+            if (!probe_addPath(list, child)) {
+                closedir(dir);
+                return 0;
+            }
+        }
+    }
+    closedir(dir);
+    return 1;
+}
+
+
+/**
+ * probe_comparePaths
+ * qsort comparator on path strings.
+ */
+static int probe_comparePaths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+
+/**
+ * probe_scanBand
+ * Probes the files [start, end) of a scan.
+ */
+static void probe_scanBand(void *context, int start, int end) {
+    t_probe_job *job = context;
+    for (int i = start; i < end; i++) {
+        probe_file(job->paths[i], &job->probes[i]);
+    }
+}
+
+
+/**
+ * probe_writeString
+ * Writes a string as a CSV field or a JSON string, escaped as needed.
+ */
+static void probe_writeString(FILE *out, const char *s, t_probe_format format) {
+    if (format == PROBE_CSV) {
+        if (!strpbrk(s, ",\"\r\n")) {
+            fputs(s, out);
+            return;
+        }
+        fputc('"', out);
+        for (; *s; s++) {
+            if (*s == '"') fputc('"', out);
+            fputc(*s, out);
+        }
+        fputc('"', out);
+        return;
+    }
+
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+
+/**
+ * probe_writeRecord
+ * Writes the record of one file.
+ */
+static void probe_writeRecord(FILE *out, const char *path, const t_bmp_probe *p, t_probe_format format, int first) {
+    if (format == PROBE_CSV) {
+        probe_writeString(out, path, format);
+        if (p->error) {
+            fprintf(out, ",%llu,,,,,,", (unsigned long long)p->fileSize);
+            probe_writeString(out, p->error, format);
+        } else {
+            fprintf(out, ",%llu,%d,%d,%u,%s,%u,ok", (unsigned long long)p->fileSize, p->width, p->height,
+                    p->depth, probe_compressionName(p->compression), p->colors);
+        }
+        fputc('\n', out);
+        return;
+    }
+
+    fputs(first ? "  {\"path\": " : ",\n  {\"path\": ", out);
+    probe_writeString(out, path, format);
+    fprintf(out, ", \"file_size\": %llu, ", (unsigned long long)p->fileSize);
+    if (p->error) {
+        fputs("\"valid\": false, \"error\": ", out);
+        probe_writeString(out, p->error, format);
+        fputc('}', out);
+    } else {
+        fprintf(out, "\"valid\": true, \"width\": %d, \"height\": %d, \"depth\": %u, "
+                     "\"compression\": \"%s\", \"colors\": %u}",
+                p->width, p->height, p->depth, probe_compressionName(p->compression), p->colors);
+    }
+}
+
+
+/**
+ * probe_scan
+ * Lists the .bmp files of a directory, probes them in parallel and writes one record
+ * per file, sorted by path. Invalid files are listed too, with the reason.
+ *
+ * Parameters:
+ * path (const char*): Directory to scan.
+ * recursive (int): Non-zero to descend into subdirectories.
+ * format (t_probe_format): PROBE_CSV or PROBE_JSON.
+ * out (FILE*): Destination stream.
+ *
+ * Returns:
+ * long: Number of files listed, or -1 if the directory cannot be read.
+ */
+long probe_scan(const char *path, int recursive, t_probe_format format, FILE *out) {
+    t_path_list list = {NULL, 0, 0};
+    if (!probe_collect(path, recursive, &list)) {
+        fprintf(stderr, "Error: Unable to read directory %s.\n", path);
+        for (long i = 0; i < list.count; i++) free(list.paths[i]);
+        free(list.paths);
+        return -1;
+    }
+    qsort(list.paths, list.count, sizeof(char *), probe_comparePaths);
+
+    t_bmp_probe *probes = calloc(list.count ? list.count : 1, sizeof(t_bmp_probe));
+    if (!probes) {
+        fprintf(stderr, "Error: Unable to allocate memory for %ld probes.\n", list.count);
+        for (long i = 0; i < list.count; i++) free(list.paths[i]);
+        free(list.paths);
+        return -1;
+    }
+
+    t_probe_job job = {list.paths, probes};
+    parallel_for((int)list.count, PROBE_GRAIN, probe_scanBand, &job);
+
+    if (format == PROBE_CSV) {
+        fputs("path,file_size,width,height,depth,compression,colors,status\n", out);
+    } else {
+        fputs("[\n", out);
+    }
+    for (long i = 0; i < list.count; i++) {
+        probe_writeRecord(out, list.paths[i], &probes[i], format, i == 0);
+    }
+    if (format == PROBE_JSON) {
+        fputs(list.count ? "\n]\n" : "]\n", out);
+    }
+
+    for (long i = 0; i < list.count; i++) free(list.paths[i]);
+    free(list.paths);
+    free(probes);
+    return list.count;
+}
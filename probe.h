@@ -0,0 +1,121 @@
+/**
+ * probe.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the header-only BMP probe and the directory scanner.
+ * A probe reads the 54 bytes of the file and info headers (nothing else), validates
+ * them against the file size and returns the image metadata.
+ *
+ * Role in the project:
+ * Lets large collections of BMP files be catalogued without loading any pixel data.
+ */
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#include "utils.h"
+
+/**
+ * t_bmp_probe
+ * Metadata of a BMP file, as read from its headers.
+ *
+ * Members:
+ * fileSize (uint64_t): Size of the file on disk in bytes.
+ * width (int32_t): Image width in pixels.
+ * height (int32_t): Image height in pixels (negative for top-down files).
+ * depth (uint16_t): Bits per pixel.
+ * compression (uint32_t): Compression method (BI_RGB, BI_RLE8, ...).
+ * colors (uint32_t): Number of palette entries.
+ * offset (uint32_t): Offset of the pixel data.
+ * error (const char*): NULL if the headers are valid, otherwise the reason they are not.
+ */
+typedef struct {
+    uint64_t fileSize;
+    int32_t width;
+    int32_t height;
+    uint16_t depth;
+    uint32_t compression;
+    uint32_t colors;
+    uint32_t offset;
+    const char *error;
+} t_bmp_probe;
+
+/**
+ * t_probe_format
+ * Output format of the directory scanner.
+ */
+typedef enum {
+    PROBE_CSV,
+    PROBE_JSON
+} t_probe_format;
+
+/**
+ * probe_file
+ * Reads and validates the headers of a BMP file with a single read.
+ * The palette size is derived from the header; pixel data is never read.
+ *
+ * Parameters:
+ * filename (const char*): Path to the BMP file.
+ * probe (t_bmp_probe*): Receives the metadata. probe->error is set on failure.
+ *
+ * Returns:
+ * int: 1 if the file is a valid BMP, 0 otherwise.
+ */
+int probe_file(const char *filename, t_bmp_probe *probe);
+
+/**
+ * probe_header
+ * Validates the headers of a BMP file already read into memory.
+ *
+ * Parameters:
+ * h (const unsigned char*): First bytes of the file.
+ * n (size_t): Number of bytes in h (54 are enough, 26 for an OS/2 header).
+ * fileSize (uint64_t): Size of the file in bytes, or 0 if unknown (a stream): the checks
+ *     against the file size are then skipped.
+ * probe (t_bmp_probe*): Receives the metadata. probe->error is set on failure.
+ *
+ * Returns:
+ * int: 1 if the headers are valid, 0 otherwise.
+ */
+int probe_header(const unsigned char *h, size_t n, uint64_t fileSize, t_bmp_probe *probe);
+
+/**
+ * probe_compressionName
+ * Returns the name of a BMP compression method.
+ *
+ * Parameters:
+ * compression (uint32_t): Compression field of the info header.
+ *
+ * Returns:
+ * const char*: Name such as "BI_RGB", or "unknown".
+ */
+const char * probe_compressionName(uint32_t compression);
+
+/**
+ * probe_print
+ * Prints the metadata of a probed file to the console.
+ *
+ * Parameters:
+ * filename (const char*): Path of the file.
+ * probe (const t_bmp_probe*): Metadata returned by probe_file.
+ */
+void probe_print(const char *filename, const t_bmp_probe *probe);
+
+/**
+ * probe_scan
+ * Lists the .bmp files of a directory, probes them in parallel and writes one record
+ * per file, sorted by path. Invalid files are listed too, with the reason.
+ *
+ * Parameters:
+ * path (const char*): Directory to scan.
+ * recursive (int): Non-zero to descend into subdirectories.
+ * format (t_probe_format): PROBE_CSV or PROBE_JSON.
+ * out (FILE*): Destination stream.
+ *
+ * Returns:
+ * long: Number of files listed, or -1 if the directory cannot be read.
+ */
+long probe_scan(const char *path, int recursive, t_probe_format format, FILE *out);
+
+#endif // PROBE_H
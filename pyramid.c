@@ -0,0 +1,468 @@
+/**
+ * pyramid.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the image pyramid builder. Both bit depths are handled through a common
+ * row-pointer view of each level, with the number of channels as a parameter.
+ * The 2x2 box reduction cascades through all levels while streaming over the source
+ * (a row of level l + 1 is produced as soon as its two parent rows exist), so each band
+ * of the source is read once and the small levels stay in cache. The 5-tap binomial
+ * reduction needs a 2-row halo and therefore runs level by level.
+ *
+ * Role in the project:
+ * Fast generation of preview and thumbnail levels.
+ */
+
+
+#include "pyramid.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * t_plane
+ * Row-pointer view of one level.
+ */
+typedef struct {
+    unsigned char **rows;
+    int width;
+    int height;
+} t_plane;
+
+/**
+ * t_reduce
+ * Shared state of a pyramid computation. failed is set by a worker that cannot
+ * allocate its buffer.
+ */
+typedef struct {
+    t_plane *planes;
+    int levels;
+    int channels;
+    int current;
+    int failed;
+} t_reduce;
+
+
+/**
+ * reduce_boxRow
+ * Averages 2x2 blocks of two source rows into one destination row, with rounding.
+ */
+static void reduce_boxRow(const unsigned char *r0, const unsigned char *r1, unsigned char *dst,
+                          int outWidth, int channels) {
+    int x = 0;
+
+#ifdef __SSE2__
+    if (channels == 1) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i low16 = _mm_set1_epi32(0xFFFF);
+        const __m128i two = _mm_set1_epi32(2);
+
+        // 16 source pixels per row give 8 destination pixels
+        for (; x + 8 <= outWidth; x += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(r0 + 2 * x));
+            __m128i b = _mm_loadu_si128((const __m128i *)(r1 + 2 * x));
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+            // Add horizontal neighbors: low and high halves of each 32-bit lane
+            __m128i sumLo = _mm_add_epi32(_mm_and_si128(lo, low16), _mm_srli_epi32(lo, 16));
+            __m128i sumHi = _mm_add_epi32(_mm_and_si128(hi, low16), _mm_srli_epi32(hi, 16));
+            sumLo = _mm_srli_epi32(_mm_add_epi32(sumLo, two), 2);
+            sumHi = _mm_srli_epi32(_mm_add_epi32(sumHi, two), 2);
+
+            __m128i packed = _mm_packs_epi32(sumLo, sumHi);
+            _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(packed, packed));
+        }
+    } else if (channels == 4) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+
+        // 4 source pixels per row give 2 destination pixels
+        for (; x + 2 <= outWidth; x += 2) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(r0 + 8 * x));
+            __m128i b = _mm_loadu_si128((const __m128i *)(r1 + 8 * x));
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+            // Each 64-bit half holds one pixel: add the halves of each pair
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+            _mm_storel_epi64((__m128i *)(dst + 4 * x), _mm_packus_epi16(sum, sum));
+        }
+    }
+#endif
+
+    for (; x < outWidth; x++) {
+        const unsigned char *a = r0 + 2 * x * channels;
+        const unsigned char *b = r1 + 2 * x * channels;
+        for (int c = 0; c < channels; c++) {
+            dst[x * channels + c] = (unsigned char)((a[c] + a[c + channels] + b[c] + b[c + channels] + 2) >> 2);
+        }
+    }
+}
+
+
+/**
+ * reduce_boxCascade
+ * Computes row r of level l + 1 (l >= 0) from level l, then climbs to the next level
+ * whenever this row completes a pair.
+ */
+static void reduce_boxCascade(t_reduce *reduce, int l, int r) {
+    while (l < reduce->levels) {
+        t_plane *src = &reduce->planes[l];
+        t_plane *dst = &reduce->planes[l + 1];
+        reduce_boxRow(src->rows[2 * r], src->rows[2 * r + 1], dst->rows[r], dst->width, reduce->channels);
+
+        // Row r of level l + 1 completes a pair for level l + 2 only when it is odd
+        l++;
+        if (l >= reduce->levels || !(r & 1) || (r >> 1) >= reduce->planes[l + 1].height) break;
+        r >>= 1;
+    }
+}
+
+
+/**
+ * reduce_boxBand
+ * Worker: streams a band of level-1 rows and cascades every level above it.
+ * Bands start on multiples of 2^(levels - 1), so pairs never straddle two bands.
+ */
+static void reduce_boxBand(void *context, int start, int end) {
+    t_reduce *reduce = context;
+    for (int r = start; r < end; r++) {
+        reduce_boxCascade(reduce, 0, r);
+    }
+}
+
+
+/**
+ * reduce_binomialRows
+ * Worker: computes rows [start, end) of level current + 1 with the separable
+ * [1 4 6 4 1] / 16 filter, sampling every other pixel. Edges are clamped.
+ */
+static void reduce_binomialRows(void *context, int start, int end) {
+    t_reduce *reduce = context;
+    const t_plane *src = &reduce->planes[reduce->current];
+    const t_plane *dst = &reduce->planes[reduce->current + 1];
+    int channels = reduce->channels;
+    int rowLength = src->width * channels;
+    static const int taps[5] = {1, 4, 6, 4, 1};
+
+    int *column = malloc(rowLength * sizeof(int));
+    if (!column) {
+        reduce->failed = 1;
+        return;
+    }
+
+    for (int y = start; y < end; y++) {
+        const unsigned char *lines[5];
+        for (int k = 0; k < 5; k++) {
+            int sy = 2 * y + k - 2;
+            if (sy < 0) sy = 0;
+            if (sy >= src->height) sy = src->height - 1;
+            lines[k] = src->rows[sy];
+        }
+
+        // Vertical pass over the whole source row
+        for (int i = 0; i < rowLength; i++) {
+            column[i] = lines[0][i] + 4 * lines[1][i] + 6 * lines[2][i] + 4 * lines[3][i] + lines[4][i];
+        }
+
+        // Horizontal pass at even positions only
+        unsigned char *out = dst->rows[y];
+        for (int x = 0; x < dst->width; x++) {
+            for (int c = 0; c < channels; c++) {
+                int sum = 0;
+                for (int k = 0; k < 5; k++) {
+                    int sx = 2 * x + k - 2;
+                    if (sx < 0) sx = 0;
+                    if (sx >= src->width) sx = src->width - 1;
+                    sum += taps[k] * column[sx * channels + c];
+                }
+                out[x * channels + c] = (unsigned char)((sum + 128) >> 8);
+            }
+        }
+    }
+
+    free(column);
+}
+
+
+/**
+ * reduce_run
+ * Fills planes[1..levels] from planes[0] with the chosen filter.
+ * Returns 1 on success, 0 if a worker could not allocate its buffer.
+ */
+static int reduce_run(t_reduce *reduce, t_pyramid_filter filter) {
+    if (filter == PYRAMID_BOX) {
+        parallel_for(reduce->planes[1].height, 1 << (reduce->levels - 1), reduce_boxBand, reduce);
+        return 1;
+    }
+
+    for (reduce->current = 0; !reduce->failed && reduce->current < reduce->levels; reduce->current++) {
+        parallel_for(reduce->planes[reduce->current + 1].height, 1, reduce_binomialRows, reduce);
+    }
+    return !reduce->failed;
+}
+
+
+/**
+ * pyramid_levelCount
+ * Number of levels that fit below a width x height image, capped at maxLevels.
+ */
+static int pyramid_levelCount(int width, int height, int maxLevels) {
+    int count = 0;
+    while (count < maxLevels && width >= 2 && height >= 2) {
+        width /= 2;
+        height /= 2;
+        count++;
+    }
+    return count;
+}
+
+
+/**
+ * plane_fromBmp8
+ * Builds the row-pointer view of an 8-bit image.
+ */
+static int plane_fromBmp8(t_plane *plane, t_bmp8 *img) {
+    int stride = BMP8_ROW_SIZE(img->width);
+    plane->width = img->width;
+    plane->height = img->height;
+    plane->rows = malloc(img->height * sizeof(unsigned char *));
+    if (!plane->rows) return 0;
+    for (unsigned int y = 0; y < img->height; y++) {
+        plane->rows[y] = img->data + (size_t)y * stride;
+    }
+    return 1;
+}
+
+
+/**
+ * plane_fromBmp24
+ * Builds the row-pointer view of a 24-bit image.
+ */
+static int plane_fromBmp24(t_plane *plane, t_bmp24 *img) {
+    plane->width = img->width;
+    plane->height = img->height;
+    plane->rows = malloc(img->height * sizeof(unsigned char *));
+    if (!plane->rows) return 0;
+    for (int y = 0; y < img->height; y++) {
+        plane->rows[y] = (unsigned char *)img->data[y];
+    }
+    return 1;
+}
+
+
+/**
+ * pyramid_build8
+ * Builds the downsampled levels of an 8-bit image. With the box filter, all levels are
+ * produced in one streaming pass over the source; with the binomial filter, level by level.
+ * Rows are processed by several threads in both cases.
+ *
+ * Parameters:
+ * img (t_bmp8*): Source image.
+ * maxLevels (int): Maximum number of levels (stops earlier once a side would drop below 1).
+ * filter (t_pyramid_filter): Reduction filter.
+ *
+ * Returns:
+ * t_pyramid8*: Pointer to the pyramid, or NULL on failure.
+ */
+t_pyramid8 *pyramid_build8(t_bmp8 *img, int maxLevels, t_pyramid_filter filter) {
+    if (!img || !img->data) return NULL;
+
+    int count = pyramid_levelCount(img->width, img->height, maxLevels);
+    if (count == 0) {
+        fprintf(stderr, "Error: Image is too small to build a pyramid.\n");
+        return NULL;
+    }
+
+    t_pyramid8 *pyramid = calloc(1, sizeof(t_pyramid8));
+    t_plane *planes = calloc(count + 1, sizeof(t_plane));
+    if (!pyramid || !planes || !(pyramid->levels = calloc(count, sizeof(t_bmp8 *)))) {
+        fprintf(stderr, "Error: Unable to allocate memory for pyramid.\n");
+        free(planes);
+        pyramid_free8(pyramid);
+        return NULL;
+    }
+
+    int ok = plane_fromBmp8(&planes[0], img);
+    unsigned int width = img->width;
+    unsigned int height = img->height;
+    for (int l = 0; ok && l < count; l++) {
+        width /= 2;
+        height /= 2;
+        pyramid->levels[l] = bmp8_allocate(width, height);
+        ok = pyramid->levels[l] && plane_fromBmp8(&planes[l + 1], pyramid->levels[l]);
+        pyramid->count = l + 1;
+    }
+
+    if (ok) {
+        t_reduce reduce = {planes, count, 1, 0, 0};
+        ok = reduce_run(&reduce, filter);
+    }
+
+    for (int l = 0; l <= count; l++) {
+        free(planes[l].rows);
+    }
+    free(planes);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to allocate memory for pyramid levels.\n");
+        pyramid_free8(pyramid);
+        return NULL;
+    }
+    return pyramid;
+}
+
+
+/**
+ * pyramid_build24
+ * Builds the downsampled levels of a 24-bit image. With the box filter, all levels are
+ * produced in one streaming pass over the source; with the binomial filter, level by level.
+ * Rows are processed by several threads in both cases.
+ *
+ * Parameters:
+ * img (t_bmp24*): Source image.
+ * maxLevels (int): Maximum number of levels (stops earlier once a side would drop below 1).
+ * filter (t_pyramid_filter): Reduction filter.
+ *
+ * Returns:
+ * t_pyramid24*: Pointer to the pyramid, or NULL on failure.
+ */
+t_pyramid24 *pyramid_build24(t_bmp24 *img, int maxLevels, t_pyramid_filter filter) {
+    if (!img || !img->data) return NULL;
+
+    int count = pyramid_levelCount(img->width, img->height, maxLevels);
+    if (count == 0) {
+        fprintf(stderr, "Error: Image is too small to build a pyramid.\n");
+        return NULL;
+    }
+
+    t_pyramid24 *pyramid = calloc(1, sizeof(t_pyramid24));
+    t_plane *planes = calloc(count + 1, sizeof(t_plane));
+    if (!pyramid || !planes || !(pyramid->levels = calloc(count, sizeof(t_bmp24 *)))) {
+        fprintf(stderr, "Error: Unable to allocate memory for pyramid.\n");
+        free(planes);
+        pyramid_free24(pyramid);
+        return NULL;
+    }
+
+    int ok = plane_fromBmp24(&planes[0], img);
+    int width = img->width;
+    int height = img->height;
+    for (int l = 0; ok && l < count; l++) {
+        width /= 2;
+        height /= 2;
+        pyramid->levels[l] = bmp24_allocate(width, height, img->colorDepth);
+        if (pyramid->levels[l]) pyramid->levels[l]->header_info.compression = img->header_info.compression;
+        ok = pyramid->levels[l] && plane_fromBmp24(&planes[l + 1], pyramid->levels[l]);
+        pyramid->count = l + 1;
+    }
+
+    if (ok) {
+        t_reduce reduce = {planes, count, (int)sizeof(t_pixel), 0, 0};
+        ok = reduce_run(&reduce, filter);
+    }
+
+    for (int l = 0; l <= count; l++) {
+        free(planes[l].rows);
+    }
+    free(planes);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to allocate memory for pyramid levels.\n");
+        pyramid_free24(pyramid);
+        return NULL;
+    }
+    return pyramid;
+}
+
+
+/**
+ * pyramid_save8
+ * Saves every level as <prefix>_<level>.bmp (levels numbered from 1).
+ *
+ * Parameters:
+ * pyramid (t_pyramid8*): Pyramid to save.
+ * prefix (const char*): Output path prefix.
+ *
+ * Returns:
+ * int: 0 on success, -1 as soon as a level cannot be saved.
+ */
+int pyramid_save8(t_pyramid8 *pyramid, const char *prefix) {
+    if (!pyramid) return -1;
+
+    char filename[512];
+    for (int l = 0; l < pyramid->count; l++) {
+        snprintf(filename, sizeof(filename), "%s_%d.bmp", prefix, l + 1);
+        if (bmp8_saveImage(filename, pyramid->levels[l]) != 0) return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * pyramid_save24
+ * Saves every level as <prefix>_<level>.bmp (levels numbered from 1).
+ *
+ * Parameters:
+ * pyramid (t_pyramid24*): Pyramid to save.
+ * prefix (const char*): Output path prefix.
+ *
+ * Returns:
+ * int: 0 on success, -1 as soon as a level cannot be saved.
+ */
+int pyramid_save24(t_pyramid24 *pyramid, const char *prefix) {
+    if (!pyramid) return -1;
+
+    char filename[512];
+    for (int l = 0; l < pyramid->count; l++) {
+        snprintf(filename, sizeof(filename), "%s_%d.bmp", prefix, l + 1);
+        if (bmp24_saveImage(pyramid->levels[l], filename) != 0) return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * pyramid_free8
+ * Frees an 8-bit pyramid and all its levels.
+ *
+ * Parameters:
+ * pyramid (t_pyramid8*): Pyramid to free.
+ */
+void pyramid_free8(t_pyramid8 *pyramid) {
+    if (pyramid) {
+        if (pyramid->levels) {
+            for (int l = 0; l < pyramid->count; l++) {
+                bmp8_free(pyramid->levels[l]);
+            }
+        }
+        free(pyramid->levels);
+        free(pyramid);
+    }
+}
+
+
+/**
+ * pyramid_free24
+ * Frees a 24-bit pyramid and all its levels.
+ *
+ * Parameters:
+ * pyramid (t_pyramid24*): Pyramid to free.
+ */
+void pyramid_free24(t_pyramid24 *pyramid) {
+    if (pyramid) {
+        if (pyramid->levels) {
+            for (int l = 0; l < pyramid->count; l++) {
+                bmp24_free(pyramid->levels[l]);
+            }
+        }
+        free(pyramid->levels);
+        free(pyramid);
+    }
+}
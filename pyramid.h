@@ -0,0 +1,132 @@
+/**
+ * pyramid.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring an image pyramid (mipmap) builder for 8-bit and 24-bit BMP images.
+ * Each level is half the width and height of the previous one, reduced either with a
+ * 2x2 box filter or with a 5-tap binomial filter.
+ *
+ * Role in the project:
+ * Produces preview and thumbnail levels of an image in one call; every level is a regular
+ * t_bmp8 / t_bmp24 that can be saved with bmp8_saveImage / bmp24_saveImage.
+ */
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include "bmp8.h"
+#include "bmp24.h"
+
+/**
+ * t_pyramid_filter
+ * Reduction filter used between two levels.
+ */
+typedef enum {
+    PYRAMID_BOX,
+    PYRAMID_BINOMIAL
+} t_pyramid_filter;
+
+/**
+ * t_pyramid8
+ * Structure holding the levels of an 8-bit pyramid.
+ *
+ * Members:
+ * count (int): Number of levels.
+ * levels (t_bmp8**): levels[0] is half the size of the source, levels[i + 1] half of levels[i].
+ */
+typedef struct {
+    int count;
+    t_bmp8 **levels;
+} t_pyramid8;
+
+/**
+ * t_pyramid24
+ * Structure holding the levels of a 24-bit pyramid.
+ *
+ * Members:
+ * count (int): Number of levels.
+ * levels (t_bmp24**): levels[0] is half the size of the source, levels[i + 1] half of levels[i].
+ */
+typedef struct {
+    int count;
+    t_bmp24 **levels;
+} t_pyramid24;
+
+/**
+ * pyramid_build8
+ * Builds the downsampled levels of an 8-bit image. With the box filter, all levels are
+ * produced in one streaming pass over the source; with the binomial filter, level by level.
+ * Rows are processed by several threads in both cases.
+ *
+ * Parameters:
+ * img (t_bmp8*): Source image.
+ * maxLevels (int): Maximum number of levels (stops earlier once a side would drop below 1).
+ * filter (t_pyramid_filter): Reduction filter.
+ *
+ * Returns:
+ * t_pyramid8*: Pointer to the pyramid, or NULL on failure.
+ */
+t_pyramid8 * pyramid_build8(t_bmp8 *img, int maxLevels, t_pyramid_filter filter);
+
+/**
+ * pyramid_build24
+ * Builds the downsampled levels of a 24-bit image. With the box filter, all levels are
+ * produced in one streaming pass over the source; with the binomial filter, level by level.
+ * Rows are processed by several threads in both cases.
+ *
+ * Parameters:
+ * img (t_bmp24*): Source image.
+ * maxLevels (int): Maximum number of levels (stops earlier once a side would drop below 1).
+ * filter (t_pyramid_filter): Reduction filter.
+ *
+ * Returns:
+ * t_pyramid24*: Pointer to the pyramid, or NULL on failure.
+ */
+t_pyramid24 * pyramid_build24(t_bmp24 *img, int maxLevels, t_pyramid_filter filter);
+
+/**
+ * pyramid_save8
+ * Saves every level as <prefix>_<level>.bmp (levels numbered from 1).
+ *
+ * Parameters:
+ * pyramid (t_pyramid8*): Pyramid to save.
+ * prefix (const char*): Output path prefix.
+ *
+ * Returns:
+ * int: 0 on success, -1 as soon as a level cannot be saved.
+ */
+int pyramid_save8(t_pyramid8 *pyramid, const char *prefix);
+
+/**
+ * pyramid_save24
+ * Saves every level as <prefix>_<level>.bmp (levels numbered from 1).
+ *
+ * Parameters:
+ * pyramid (t_pyramid24*): Pyramid to save.
+ * prefix (const char*): Output path prefix.
+ *
+ * Returns:
+ * int: 0 on success, -1 as soon as a level cannot be saved.
+ */
+int pyramid_save24(t_pyramid24 *pyramid, const char *prefix);
+
+/**
+ * pyramid_free8
+ * Frees an 8-bit pyramid and all its levels.
+ *
+ * Parameters:
+ * pyramid (t_pyramid8*): Pyramid to free.
+ */
+void pyramid_free8(t_pyramid8 *pyramid);
+
+/**
+ * pyramid_free24
+ * Frees a 24-bit pyramid and all its levels.
+ *
+ * Parameters:
+ * pyramid (t_pyramid24*): Pyramid to free.
+ */
+void pyramid_free24(t_pyramid24 *pyramid);
+
+#endif // PYRAMID_H
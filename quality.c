@@ -0,0 +1,621 @@
+/**
+ * quality.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the quality metrics. The squared error is summed row by row (16 bytes at a
+ * time with SSE2, the alpha bytes masked out) in parallel bands. SSIM needs, for every
+ * window, the sums of x, y, x^2, y^2 and xy: each band keeps these sums per column over
+ * the 7 rows of its current window row and updates them by one row in and one row out,
+ * then slides a 7-column sum along the row, so the cost per pixel does not depend on the
+ * window size and no image-sized integral table is allocated. The sums are exact
+ * integers, and so are the numerators and denominators derived from them; only the final
+ * division is done in floating point.
+ *
+ * Role in the project:
+ * Checks that fast or approximate processing paths stay close to a reference result.
+ */
+
+
+#include <math.h>
+#include <pthread.h>
+#include "quality.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// (0.01 * 255)^2 and (0.03 * 255)^2
+#define QUALITY_C1 6.5025
+#define QUALITY_C2 58.5225
+
+// Weight of each MS-SSIM scale, finest first
+static const double quality_weights[QUALITY_SCALES] = {0.0448, 0.2856, 0.3001, 0.2363, 0.1333};
+
+/**
+ * t_quality_job
+ * Shared state of a parallel pass over two views: error sum, or SSIM and contrast-
+ * structure sums.
+ */
+typedef struct {
+    const t_view *a;
+    const t_view *b;
+    int channels;
+    int pixelSize;
+    uint64_t error;
+    double ssim;
+    double cs;
+    int failed;
+    pthread_mutex_t lock;
+} t_quality_job;
+
+/**
+ * t_quality_halve
+ * Source and destination of a 2x2 reduction.
+ */
+typedef struct {
+    const t_view *src;
+    const t_view *dst;
+    int pixelSize;
+} t_quality_halve;
+
+
+/**
+ * quality_check
+ * Checks that two views can be compared and are at least minSide pixels on each side.
+ *
+ * Returns:
+ * int: 0 if they can, -1 otherwise.
+ */
+static int quality_check(const t_view *a, const t_view *b, int minSide) {
+    if (!a || !b || !a->data || !b->data) return -1;
+    if (a->width != b->width || a->height != b->height || a->format != b->format) {
+        fprintf(stderr, "Error: Images of different sizes or depths cannot be compared.\n");
+        return -1;
+    }
+    if (a->width < minSide || a->height < minSide) {
+        fprintf(stderr, "Error: Images must be at least %d pixels on each side.\n", minSide);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * quality_job
+ * Initializes a job over two views.
+ */
+static void quality_job(t_quality_job *job, const t_view *a, const t_view *b) {
+    memset(job, 0, sizeof(*job));
+    job->a = a;
+    job->b = b;
+    job->channels = a->format == VIEW_BGRA32 ? 3 : 1;
+    job->pixelSize = a->format == VIEW_BGRA32 ? (int)sizeof(t_pixel) : 1;
+    pthread_mutex_init(&job->lock, NULL);
+}
+
+
+/**
+ * quality_rowError
+ * Sum of the squared differences of two rows of bytes. With skipAlpha, every fourth
+ * byte is left out.
+ */
+static uint64_t quality_rowError(const uint8_t *a, const uint8_t *b, size_t bytes, int skipAlpha) {
+    uint64_t total = 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = skipAlpha ? _mm_set1_epi32(0x00FFFFFF) : _mm_set1_epi32(-1);
+    while (i + 16 <= bytes) {
+        // Each step adds at most 4 * 255^2 to a 32-bit lane: flush well before overflow
+        __m128i sum = zero;
+        size_t stop = bytes - i > 4096 * 16 ? i + 4096 * 16 : bytes;
+        for (; i + 16 <= stop; i += 16) {
+            __m128i va = _mm_and_si128(_mm_loadu_si128((const __m128i *)(a + i)), mask);
+            __m128i vb = _mm_and_si128(_mm_loadu_si128((const __m128i *)(b + i)), mask);
+            __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+            __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(low, low));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(high, high));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, sum);
+        total += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+    for (; i < bytes; i++) {
+        if (skipAlpha && i % 4 == 3) continue;
+        int d = a[i] - b[i];
+        total += (uint64_t)(d * d);
+    }
+    return total;
+}
+
+
+/**
+ * quality_errorBand
+ * Adds the squared error of the rows [start, end) to the job.
+ */
+static void quality_errorBand(void *context, int start, int end) {
+    t_quality_job *job = context;
+    size_t bytes = (size_t)job->a->width * job->pixelSize;
+    uint64_t error = 0;
+    for (int y = start; y < end; y++) {
+        error += quality_rowError(view_row(job->a, y), view_row(job->b, y), bytes, job->channels == 3);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    job->error += error;
+    pthread_mutex_unlock(&job->lock);
+}
+
+
+/**
+ * quality_slideRow
+ * Moves the column sums of a channel down by one row: row out (if not negative) is taken
+ * out and row in is added. Unsigned arithmetic wraps, so a removal always undoes the
+ * matching addition exactly.
+ */
+static void quality_slideRow(const t_quality_job *job, int channel, int out, int in, uint32_t *sums[5]) {
+    static const uint8_t zeros[16] = {0};
+    int width = job->a->width;
+    int step = job->pixelSize;
+    const uint8_t *a = view_row(job->a, in) + channel;
+    const uint8_t *b = view_row(job->b, in) + channel;
+    const uint8_t *oa = out >= 0 ? view_row(job->a, out) + channel : zeros;
+    const uint8_t *ob = out >= 0 ? view_row(job->b, out) + channel : zeros;
+    int outStep = out >= 0 ? step : 0;
+    int x = 0;
+
+#ifdef __SSE2__
+    // Each 32-bit lane holds one sample below 256, so madd_epi16 squares it exactly
+    if (out >= 0 && step == (int)sizeof(t_pixel)) {
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        a -= channel;
+        b -= channel;
+        oa -= channel;
+        ob -= channel;
+        __m128i shift = _mm_cvtsi32_si128(8 * channel);
+        for (; x + 4 <= width; x += 4) {
+            __m128i va = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(a + 4 * x)), shift), mask);
+            __m128i vb = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(b + 4 * x)), shift), mask);
+            __m128i wa = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(oa + 4 * x)), shift), mask);
+            __m128i wb = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(ob + 4 * x)), shift), mask);
+            __m128i delta[5] = {
+                _mm_sub_epi32(va, wa),
+                _mm_sub_epi32(vb, wb),
+                _mm_sub_epi32(_mm_madd_epi16(va, va), _mm_madd_epi16(wa, wa)),
+                _mm_sub_epi32(_mm_madd_epi16(vb, vb), _mm_madd_epi16(wb, wb)),
+                _mm_sub_epi32(_mm_madd_epi16(va, vb), _mm_madd_epi16(wa, wb))
+            };
+            for (int k = 0; k < 5; k++) {
+                __m128i *sum = (__m128i *)(sums[k] + x);
+                _mm_storeu_si128(sum, _mm_add_epi32(_mm_loadu_si128(sum), delta[k]));
+            }
+        }
+        a += channel;
+        b += channel;
+        oa += channel;
+        ob += channel;
+    }
+#endif
+
+    for (; x < width; x++) {
+        uint32_t va = a[x * step];
+        uint32_t vb = b[x * step];
+        uint32_t wa = oa[x * outStep];
+        uint32_t wb = ob[x * outStep];
+        sums[0][x] += va - wa;
+        sums[1][x] += vb - wb;
+        sums[2][x] += va * va - wa * wa;
+        sums[3][x] += vb * vb - wb * wb;
+        sums[4][x] += va * vb - wa * wb;
+    }
+}
+
+
+#ifdef __SSE2__
+/**
+ * quality_times49
+ * Multiplies 32-bit lanes by QUALITY_WINDOW^2 = 49 = 64 - 16 + 1 (SSE2 has no 32-bit
+ * multiplication).
+ */
+static __m128i quality_times49(__m128i v) {
+    return _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(v, 6), _mm_slli_epi32(v, 4)), v);
+}
+#endif
+
+
+/**
+ * quality_windowRow
+ * Adds up the SSIM and contrast-structure terms of the count windows of a row, from the
+ * column sums. The window sums are below 49 * 255^2, so the numerators and denominators
+ * are computed exactly as integers; the index itself is computed in float with one
+ * division per window (r = 1 / (lden * cden), SSIM = lnum * cnum * r, cs = cnum * lden * r).
+ */
+static void quality_windowRow(uint32_t *sums[5], int count, double *ssim, double *cs) {
+    const int32_t n = QUALITY_WINDOW * QUALITY_WINDOW;
+    const float c1 = (float)(QUALITY_C1 * n * n);
+    const float c2 = (float)(QUALITY_C2 * n * n);
+    double totalSsim = 0.0;
+    double totalCs = 0.0;
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128 one = _mm_set1_ps(1.0f);
+    while (x + 4 <= count) {
+        // Partial sums stay in float for at most 64 steps, then go to double
+        __m128 sumSsim = _mm_setzero_ps();
+        __m128 sumCs = _mm_setzero_ps();
+        int stop = count - x > 256 ? x + 256 : count;
+        for (; x + 4 <= stop; x += 4) {
+            __m128i s[5];
+            for (int k = 0; k < 5; k++) {
+                __m128i total = _mm_loadu_si128((const __m128i *)(sums[k] + x));
+                for (int i = 1; i < QUALITY_WINDOW; i++) {
+                    total = _mm_add_epi32(total, _mm_loadu_si128((const __m128i *)(sums[k] + x + i)));
+                }
+                s[k] = total;
+            }
+
+            // Sums of x and y fit in 16 bits, so madd_epi16 multiplies them exactly
+            __m128i xy = _mm_madd_epi16(s[0], s[1]);
+            __m128i xx = _mm_madd_epi16(s[0], s[0]);
+            __m128i yy = _mm_madd_epi16(s[1], s[1]);
+            __m128 ln = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(xy, xy)), _mm_set1_ps(c1));
+            __m128 ld = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(xx, yy)), _mm_set1_ps(c1));
+            __m128i covariance = _mm_sub_epi32(quality_times49(s[4]), xy);
+            __m128 cn = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(covariance, covariance)), _mm_set1_ps(c2));
+            __m128i variances = _mm_add_epi32(_mm_sub_epi32(quality_times49(s[2]), xx),
+                                              _mm_sub_epi32(quality_times49(s[3]), yy));
+            __m128 cd = _mm_add_ps(_mm_cvtepi32_ps(variances), _mm_set1_ps(c2));
+
+            __m128 r = _mm_div_ps(one, _mm_mul_ps(ld, cd));
+            sumSsim = _mm_add_ps(sumSsim, _mm_mul_ps(_mm_mul_ps(ln, cn), r));
+            sumCs = _mm_add_ps(sumCs, _mm_mul_ps(_mm_mul_ps(cn, ld), r));
+        }
+        float lanes[8];
+        _mm_storeu_ps(lanes, sumSsim);
+        _mm_storeu_ps(lanes + 4, sumCs);
+        totalSsim += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        totalCs += (double)lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    }
+#endif
+
+    for (; x < count; x++) {
+        int32_t s[5] = {0, 0, 0, 0, 0};
+        for (int i = 0; i < QUALITY_WINDOW; i++) {
+            for (int k = 0; k < 5; k++) s[k] += (int32_t)sums[k][x + i];
+        }
+        int32_t xy = s[0] * s[1];
+        float ln = (float)(2 * xy) + c1;
+        float ld = (float)(s[0] * s[0] + s[1] * s[1]) + c1;
+        float cn = (float)(2 * (n * s[4] - xy)) + c2;
+        float cd = (float)(n * s[2] - s[0] * s[0] + n * s[3] - s[1] * s[1]) + c2;
+        float r = 1.0f / (ld * cd);
+        totalSsim += ln * cn * r;
+        totalCs += cn * ld * r;
+    }
+    *ssim += totalSsim;
+    *cs += totalCs;
+}
+
+
+/**
+ * quality_ssimBand
+ * Adds the SSIM and contrast-structure terms of the windows whose top row is in
+ * [start, end) to the job.
+ */
+static void quality_ssimBand(void *context, int start, int end) {
+    t_quality_job *job = context;
+    int width = job->a->width;
+    int count = width - QUALITY_WINDOW + 1;
+
+    uint32_t *memory = malloc((size_t)width * 5 * sizeof(uint32_t));
+    if (!memory) {
+        pthread_mutex_lock(&job->lock);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->lock);
+        return;
+    }
+    uint32_t *sums[5];
+    for (int k = 0; k < 5; k++) sums[k] = memory + (size_t)k * width;
+
+    double ssim = 0.0;
+    double cs = 0.0;
+    for (int channel = 0; channel < job->channels; channel++) {
+        memset(memory, 0, (size_t)width * 5 * sizeof(uint32_t));
+        for (int y = start; y < start + QUALITY_WINDOW; y++) quality_slideRow(job, channel, -1, y, sums);
+
+        for (int y = start; y < end; y++) {
+            quality_windowRow(sums, count, &ssim, &cs);
+            if (y + 1 < end) quality_slideRow(job, channel, y, y + QUALITY_WINDOW, sums);
+        }
+    }
+    free(memory);
+
+    pthread_mutex_lock(&job->lock);
+    job->ssim += ssim;
+    job->cs += cs;
+    pthread_mutex_unlock(&job->lock);
+}
+
+
+/**
+ * quality_windows
+ * Mean SSIM and mean contrast-structure term over every window and channel.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+static int quality_windows(const t_view *a, const t_view *b, double *ssim, double *cs) {
+    t_quality_job job;
+    quality_job(&job, a, b);
+    int rows = a->height - QUALITY_WINDOW + 1;
+    parallel_for(rows, 32, quality_ssimBand, &job);
+    pthread_mutex_destroy(&job.lock);
+    if (job.failed) {
+        fprintf(stderr, "Error: Unable to allocate memory for SSIM.\n");
+        return -1;
+    }
+
+    double windows = (double)rows * (a->width - QUALITY_WINDOW + 1) * job.channels;
+    *ssim = job.ssim / windows;
+    if (cs) *cs = job.cs / windows;
+    return 0;
+}
+
+
+/**
+ * quality_halveBand
+ * Averages the 2x2 blocks of the source into the output rows [start, end).
+ */
+static void quality_halveBand(void *context, int start, int end) {
+    const t_quality_halve *halve = context;
+    size_t bytes = (size_t)halve->dst->width * halve->pixelSize;
+    int step = halve->pixelSize;
+    for (int y = start; y < end; y++) {
+        const uint8_t *top = view_row(halve->src, 2 * y);
+        const uint8_t *bottom = view_row(halve->src, 2 * y + 1);
+        uint8_t *out = view_row(halve->dst, y);
+        for (size_t i = 0; i < bytes; i++) {
+            size_t left = (i / step) * 2 * step + i % step;
+            out[i] = (uint8_t)((top[left] + top[left + step] + bottom[left] + bottom[left + step] + 2) / 4);
+        }
+    }
+}
+
+
+/**
+ * quality_halve
+ * Describes in dst a new image half the size of src (odd last rows and columns dropped),
+ * each pixel the rounded mean of a 2x2 block.
+ *
+ * Returns:
+ * unsigned char*: Pixels of dst, to free, or NULL on allocation failure.
+ */
+static unsigned char *quality_halve(const t_view *src, t_view *dst) {
+    t_quality_halve halve = {src, dst, src->format == VIEW_BGRA32 ? (int)sizeof(t_pixel) : 1};
+    unsigned char *pixels = malloc((size_t)(src->width / 2) * (src->height / 2) * halve.pixelSize);
+    if (!pixels) {
+        fprintf(stderr, "Error: Unable to allocate memory for MS-SSIM.\n");
+        return NULL;
+    }
+
+    t_view view = {pixels, src->width / 2, src->height / 2, (ptrdiff_t)(src->width / 2) * halve.pixelSize,
+                   src->format, NULL, 0, 1};
+    *dst = view;
+    parallel_for(dst->height, 32, quality_halveBand, &halve);
+    return pixels;
+}
+
+
+/**
+ * quality_multiScale
+ * Finishes MS-SSIM from the contrast-structure term of the full-size images.
+ *
+ * Returns:
+ * int: 0 on success, -1 on allocation failure.
+ */
+static int quality_multiScale(const t_view *a, const t_view *b, double cs, double *msssim) {
+    t_view views[2] = {*a, *b};
+    unsigned char *owned[2] = {NULL, NULL};
+    double result = pow(cs > 0.0 ? cs : 0.0, quality_weights[0]);
+    int ok = 1;
+
+    for (int scale = 1; ok && scale < QUALITY_SCALES; scale++) {
+        for (int k = 0; ok && k < 2; k++) {
+            t_view half;
+            unsigned char *pixels = quality_halve(&views[k], &half);
+            free(owned[k]);
+            owned[k] = pixels;
+            views[k] = half;
+            ok = pixels != NULL;
+        }
+
+        // Negative terms are clipped, as the weighted product needs non-negative factors
+        double ssim;
+        ok = ok && quality_windows(&views[0], &views[1], &ssim, &cs) == 0;
+        double term = scale + 1 < QUALITY_SCALES ? cs : ssim;
+        result *= pow(term > 0.0 ? term : 0.0, quality_weights[scale]);
+    }
+
+    free(owned[0]);
+    free(owned[1]);
+    if (ok) *msssim = result;
+    return ok ? 0 : -1;
+}
+
+
+/**
+ * quality_mse
+ * Computes the mean squared error between two views in one parallel pass.
+ *
+ * Parameters:
+ * a, b (const t_view*): Views of the same size and format.
+ * mse (double*): Receives the error.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views differ in size or format.
+ */
+int quality_mse(const t_view *a, const t_view *b, double *mse) {
+    if (quality_check(a, b, 1) != 0) return -1;
+
+    t_quality_job job;
+    quality_job(&job, a, b);
+    parallel_for(a->height, 16, quality_errorBand, &job);
+    pthread_mutex_destroy(&job.lock);
+    *mse = (double)job.error / ((double)a->width * a->height * job.channels);
+    return 0;
+}
+
+
+/**
+ * quality_psnr
+ * Converts a mean squared error of 8-bit samples to a peak signal-to-noise ratio.
+ *
+ * Parameters:
+ * mse (double): Mean squared error.
+ *
+ * Returns:
+ * double: PSNR in dB, INFINITY if mse is 0.
+ */
+double quality_psnr(double mse) {
+    return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+
+/**
+ * quality_ssim
+ * Computes the mean SSIM between two views.
+ *
+ * Parameters:
+ * a, b (const t_view*): Views of the same size and format, at least QUALITY_WINDOW pixels
+ *     on each side.
+ * ssim (double*): Receives the index, between -1 and 1.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views differ or are too small, or on allocation failure.
+ */
+int quality_ssim(const t_view *a, const t_view *b, double *ssim) {
+    if (quality_check(a, b, QUALITY_WINDOW) != 0) return -1;
+    return quality_windows(a, b, ssim, NULL);
+}
+
+
+/**
+ * quality_msssim
+ * Computes the MS-SSIM between two views.
+ *
+ * Parameters:
+ * a, b (const t_view*): Views of the same size and format, at least
+ *     QUALITY_WINDOW << (QUALITY_SCALES - 1) pixels on each side.
+ * msssim (double*): Receives the index, between 0 and 1.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views differ or are too small, or on allocation failure.
+ */
+int quality_msssim(const t_view *a, const t_view *b, double *msssim) {
+    if (quality_check(a, b, QUALITY_WINDOW << (QUALITY_SCALES - 1)) != 0) return -1;
+
+    double ssim;
+    double cs;
+    if (quality_windows(a, b, &ssim, &cs) != 0) return -1;
+    return quality_multiScale(a, b, cs, msssim);
+}
+
+
+/**
+ * quality_compare
+ * Computes every metric between two views. MS-SSIM is NAN for images too small for it.
+ *
+ * Parameters:
+ * a, b (const t_view*): Views of the same size and format.
+ * result (t_quality*): Receives the metrics.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views differ or are smaller than the SSIM window, or on
+ *     allocation failure.
+ */
+int quality_compare(const t_view *a, const t_view *b, t_quality *result) {
+    if (quality_check(a, b, QUALITY_WINDOW) != 0) return -1;
+
+    double cs;
+    if (quality_mse(a, b, &result->mse) != 0 || quality_windows(a, b, &result->ssim, &cs) != 0) return -1;
+    result->psnr = quality_psnr(result->mse);
+
+    // The first scale of MS-SSIM is the full-size pass already done
+    result->msssim = NAN;
+    int side = QUALITY_WINDOW << (QUALITY_SCALES - 1);
+    if (a->width >= side && a->height >= side) {
+        return quality_multiScale(a, b, cs, &result->msssim);
+    }
+    return 0;
+}
+
+
+/**
+ * bmp8_quality
+ * Compares two 8-bit images.
+ *
+ * Parameters:
+ * a, b (t_bmp8*): Images of the same size.
+ * result (t_quality*): Receives the metrics.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure (see quality_compare).
+ */
+int bmp8_quality(t_bmp8 *a, t_bmp8 *b, t_quality *result) {
+    if (!a || !b || !result) return -1;
+    t_view va = bmp8_view(a);
+    t_view vb = bmp8_view(b);
+    return quality_compare(&va, &vb, result);
+}
+
+
+/**
+ * bmp24_quality
+ * Compares two 24-bit images on their red, green and blue channels.
+ *
+ * Parameters:
+ * a, b (t_bmp24*): Images of the same size.
+ * result (t_quality*): Receives the metrics.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure (see quality_compare).
+ */
+int bmp24_quality(t_bmp24 *a, t_bmp24 *b, t_quality *result) {
+    if (!a || !b || !result) return -1;
+    t_view va = bmp24_view(a);
+    t_view vb = bmp24_view(b);
+    return quality_compare(&va, &vb, result);
+}
+
+
+/**
+ * quality_writeNumber
+ * Writes a number, or null if it is infinite or undefined.
+ */
+static void quality_writeNumber(FILE *out, const char *name, double value, int last) {
+    if (isfinite(value)) fprintf(out, "  \"%s\": %.6f%s\n", name, value, last ? "" : ",");
+    else fprintf(out, "  \"%s\": null%s\n", name, last ? "" : ",");
+}
+
+
+/**
+ * quality_writeJson
+ * Writes the metrics as a JSON object (infinite or undefined values as null).
+ *
+ * Parameters:
+ * result (const t_quality*): Metrics to write.
+ * out (FILE*): Destination stream.
+ */
+void quality_writeJson(const t_quality *result, FILE *out) {
+    fputs("{\n", out);
+    quality_writeNumber(out, "mse", result->mse, 0);
+    quality_writeNumber(out, "psnr", result->psnr, 0);
+    quality_writeNumber(out, "ssim", result->ssim, 0);
+    quality_writeNumber(out, "msssim", result->msssim, 1);
+    fputs("}\n", out);
+}
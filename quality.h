@@ -0,0 +1,152 @@
+/**
+ * quality.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring full-reference image quality metrics between two images of the
+ * same size and layout: mean squared error, peak signal-to-noise ratio, structural
+ * similarity (SSIM) and its multi-scale version (MS-SSIM). Color images are compared on
+ * their red, green and blue channels; alpha is ignored.
+ *
+ * SSIM uses a 7x7 uniform window (every window lying inside the image), the constants
+ * C1 = (0.01 * 255)^2 and C2 = (0.03 * 255)^2, and population variances. MS-SSIM uses
+ * five scales, each half the size of the previous one, with the weights of Wang,
+ * Simoncelli and Bovik (2003).
+ *
+ * Role in the project:
+ * Checks that fast or approximate processing paths stay close to a reference result.
+ */
+
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include <stdio.h>
+#include "view.h"
+
+// Side of the SSIM window in pixels
+#define QUALITY_WINDOW 7
+
+// Number of MS-SSIM scales (the images must be QUALITY_WINDOW << 4 pixels on each side)
+#define QUALITY_SCALES 5
+
+/**
+ * t_quality
+ * Result of a comparison.
+ *
+ * Members:
+ * mse (double): Mean squared error over all channels.
+ * psnr (double): Peak signal-to-noise ratio in dB (INFINITY for identical images).
+ * ssim (double): Mean SSIM over all windows and channels (1 for identical images).
+ * msssim (double): MS-SSIM, or NAN if the images are too small for five scales.
+ */
+typedef struct {
+    double mse;
+    double psnr;
+    double ssim;
+    double msssim;
+} t_quality;
+
+/**
+ * quality_mse
+ * Computes the mean squared error between two views in one parallel pass.
+ *
+ * Parameters:
+ * a, b (const t_view*): Views of the same size and format.
+ * mse (double*): Receives the error.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views differ in size or format.
+ */
+int quality_mse(const t_view *a, const t_view *b, double *mse);
+
+/**
+ * quality_psnr
+ * Converts a mean squared error of 8-bit samples to a peak signal-to-noise ratio.
+ *
+ * Parameters:
+ * mse (double): Mean squared error.
+ *
+ * Returns:
+ * double: PSNR in dB, INFINITY if mse is 0.
+ */
+double quality_psnr(double mse);
+
+/**
+ * quality_ssim
+ * Computes the mean SSIM between two views.
+ *
+ * Parameters:
+ * a, b (const t_view*): Views of the same size and format, at least QUALITY_WINDOW pixels
+ *     on each side.
+ * ssim (double*): Receives the index, between -1 and 1.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views differ or are too small, or on allocation failure.
+ */
+int quality_ssim(const t_view *a, const t_view *b, double *ssim);
+
+/**
+ * quality_msssim
+ * Computes the MS-SSIM between two views.
+ *
+ * Parameters:
+ * a, b (const t_view*): Views of the same size and format, at least
+ *     QUALITY_WINDOW << (QUALITY_SCALES - 1) pixels on each side.
+ * msssim (double*): Receives the index, between 0 and 1.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views differ or are too small, or on allocation failure.
+ */
+int quality_msssim(const t_view *a, const t_view *b, double *msssim);
+
+/**
+ * quality_compare
+ * Computes every metric between two views. MS-SSIM is NAN for images too small for it.
+ *
+ * Parameters:
+ * a, b (const t_view*): Views of the same size and format.
+ * result (t_quality*): Receives the metrics.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the views differ or are smaller than the SSIM window, or on
+ *     allocation failure.
+ */
+int quality_compare(const t_view *a, const t_view *b, t_quality *result);
+
+/**
+ * bmp8_quality
+ * Compares two 8-bit images.
+ *
+ * Parameters:
+ * a, b (t_bmp8*): Images of the same size.
+ * result (t_quality*): Receives the metrics.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure (see quality_compare).
+ */
+int bmp8_quality(t_bmp8 *a, t_bmp8 *b, t_quality *result);
+
+/**
+ * bmp24_quality
+ * Compares two 24-bit images on their red, green and blue channels.
+ *
+ * Parameters:
+ * a, b (t_bmp24*): Images of the same size.
+ * result (t_quality*): Receives the metrics.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure (see quality_compare).
+ */
+int bmp24_quality(t_bmp24 *a, t_bmp24 *b, t_quality *result);
+
+/**
+ * quality_writeJson
+ * Writes the metrics as a JSON object (infinite or undefined values as null).
+ *
+ * Parameters:
+ * result (const t_quality*): Metrics to write.
+ * out (FILE*): Destination stream.
+ */
+void quality_writeJson(const t_quality *result, FILE *out);
+
+#endif // QUALITY_H
@@ -0,0 +1,62 @@
+/**
+ * resize.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the resampling functions for 8-bit and 24-bit BMP images.
+ * Resizing is separable (horizontal pass, then vertical pass) with filter weights
+ * precomputed once per output column and per output row in fixed point.
+ *
+ * Role in the project:
+ * Provides high-quality resizing (bilinear, bicubic, Lanczos) for both bit depths.
+ */
+
+#ifndef RESIZE_H
+#define RESIZE_H
+
+#include "bmp8.h"
+#include "bmp24.h"
+
+/**
+ * t_resize_filter
+ * Interpolation filter used for resampling.
+ */
+typedef enum {
+    RESIZE_BILINEAR,
+    RESIZE_BICUBIC,
+    RESIZE_LANCZOS
+} t_resize_filter;
+
+/**
+ * bmp8_resize
+ * Creates a resized copy of an 8-bit image. When shrinking, the filter footprint is
+ * widened by the scale factor so that every source pixel contributes (area-aware).
+ *
+ * Parameters:
+ * img (t_bmp8*): Source image.
+ * width (int): Target width in pixels.
+ * height (int): Target height in pixels.
+ * filter (t_resize_filter): Interpolation filter.
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp8 * bmp8_resize(t_bmp8 *img, int width, int height, t_resize_filter filter);
+
+/**
+ * bmp24_resize
+ * Creates a resized copy of a 24-bit image. When shrinking, the filter footprint is
+ * widened by the scale factor so that every source pixel contributes (area-aware).
+ *
+ * Parameters:
+ * img (t_bmp24*): Source image.
+ * width (int): Target width in pixels.
+ * height (int): Target height in pixels.
+ * filter (t_resize_filter): Interpolation filter.
+ *
+ * Returns:
+ * t_bmp24*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp24 * bmp24_resize(t_bmp24 *img, int width, int height, t_resize_filter filter);
+
+#endif // RESIZE_H
@@ -0,0 +1,225 @@
+/**
+ * rle.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the BI_RLE8 / BI_RLE4 run-length codecs of the BMP format.
+ * Data is a sequence of byte pairs: (count, value) is an encoded run of count pixels;
+ * (0, 0) ends a line, (0, 1) ends the bitmap, (0, 2, dx, dy) moves the cursor and
+ * (0, n, ...) with n >= 3 is an absolute run of n pixels padded to an even byte count.
+ *
+ * Role in the project:
+ * Lets 8-bit images be read from and written to RLE-compressed BMP files.
+ */
+
+
+#include "rle.h"
+
+// Shortest repeat worth an encoded run when it interrupts an absolute run
+#define RLE_MIN_RUN 3
+
+
+/**
+ * rle_decode
+ * Decodes BI_RLE8 or BI_RLE4 data into an 8-bit index buffer. Encoded runs are expanded
+ * with memset and absolute runs are copied in bulk (RLE8) or unpacked two pixels per
+ * byte (RLE4). Pixels skipped by delta escapes, or not covered by the data, are left
+ * unchanged. Writes never go past the given rectangle, even for corrupt input.
+ *
+ * Parameters:
+ * src (const unsigned char*): Compressed data.
+ * size (size_t): Size of the compressed data in bytes.
+ * dst (unsigned char*): Destination buffer, one byte per pixel, rows in file order.
+ * width (unsigned int): Image width in pixels.
+ * height (unsigned int): Image height in pixels.
+ * stride (unsigned int): Distance in bytes between two destination rows.
+ * compression (unsigned int): BI_RLE8 or BI_RLE4.
+ *
+ * Returns:
+ * int: 1 if the end-of-bitmap marker was reached, 0 if the data ended early.
+ */
+int rle_decode(const unsigned char *src, size_t size, unsigned char *dst,
+               unsigned int width, unsigned int height, unsigned int stride, unsigned int compression) {
+    const unsigned char *p = src;
+    const unsigned char *end = src + size;
+    int rle4 = compression == BI_RLE4;
+    unsigned int x = 0;
+    unsigned int y = 0;
+
+    while (end - p >= 2) {
+        unsigned int count = p[0];
+        unsigned int value = p[1];
+        p += 2;
+
+        if (count > 0) {
+            // Encoded run, clipped to the current row
+            if (y < height && x < width) {
+                unsigned char *out = dst + (size_t)y * stride + x;
+                unsigned int n = x + count > width ? width - x : count;
+                unsigned int hi = value >> 4;
+                unsigned int lo = value & 0x0F;
+
+                if (!rle4 || hi == lo) {
+                    memset(out, rle4 ? hi : value, n);
+                } else {
+                    for (unsigned int i = 0; i < n; i++) {
+                        out[i] = (unsigned char)((i & 1) ? lo : hi);
+                    }
+                }
+            }
+            x += count;
+            continue;
+        }
+
+        switch (value) {
+            case 0:
+                x = 0;
+                y++;
+                break;
+            case 1:
+                return 1;
+            case 2:
+                if (end - p < 2) return 0;
+                x += p[0];
+                y += p[1];
+                p += 2;
+                break;
+            default: {
+                // Absolute run of value pixels, padded to a 16-bit boundary
+                size_t bytes = rle4 ? (value + 1) / 2 : value;
+                if ((size_t)(end - p) < bytes) return 0;
+
+                if (y < height && x < width) {
+                    unsigned char *out = dst + (size_t)y * stride + x;
+                    unsigned int n = x + value > width ? width - x : value;
+                    if (!rle4) {
+                        memcpy(out, p, n);
+                    } else {
+                        for (unsigned int i = 0; i < n; i++) {
+                            out[i] = (unsigned char)((i & 1) ? p[i / 2] & 0x0F : p[i / 2] >> 4);
+                        }
+                    }
+                }
+                x += value;
+                p += bytes + (bytes & 1);
+                if (p > end) p = end;
+            }
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * rle_runLength
+ * Number of identical pixels starting at row[i], capped at limit.
+ */
+static unsigned int rle_runLength(const unsigned char *row, unsigned int i, unsigned int width, unsigned int limit) {
+    unsigned int n = 1;
+    while (i + n < width && n < limit && row[i + n] == row[i]) {
+        n++;
+    }
+    return n;
+}
+
+
+/**
+ * rle_encode
+ * Encodes an 8-bit index buffer as BI_RLE8 or BI_RLE4 data. Repeated values become
+ * encoded runs, other stretches of at least 3 pixels become absolute runs.
+ * For BI_RLE4 every index must be below 16.
+ *
+ * Parameters:
+ * src (const unsigned char*): Source buffer, one byte per pixel, rows in file order.
+ * width (unsigned int): Image width in pixels.
+ * height (unsigned int): Image height in pixels.
+ * stride (unsigned int): Distance in bytes between two source rows.
+ * compression (unsigned int): BI_RLE8 or BI_RLE4.
+ * size (size_t*): Receives the size of the compressed data.
+ *
+ * Returns:
+ * unsigned char*: Newly allocated compressed data (to free), or NULL on failure.
+ */
+unsigned char *rle_encode(const unsigned char *src, unsigned int width, unsigned int height,
+                          unsigned int stride, unsigned int compression, size_t *size) {
+    int rle4 = compression == BI_RLE4;
+
+    // Worst case is two bytes per pixel plus one end-of-line marker per row
+    size_t capacity = (size_t)height * (2 * (size_t)width + 2) + 2;
+    unsigned char *out = malloc(capacity);
+    if (!out) {
+        fprintf(stderr, "Error: Unable to allocate memory for RLE data.\n");
+        return NULL;
+    }
+
+    size_t n = 0;
+    for (unsigned int y = 0; y < height; y++) {
+        const unsigned char *row = src + (size_t)y * stride;
+        unsigned int i = 0;
+
+        if (rle4) {
+            for (unsigned int x = 0; x < width; x++) {
+                if (row[x] > 0x0F) {
+                    fprintf(stderr, "Error: RLE4 needs pixel values below 16.\n");
+                    free(out);
+                    return NULL;
+                }
+            }
+        }
+
+        while (i < width) {
+            unsigned int run = rle_runLength(row, i, width, 255);
+            if (run >= RLE_MIN_RUN) {
+                out[n++] = (unsigned char)run;
+                out[n++] = rle4 ? (unsigned char)(row[i] << 4 | row[i]) : row[i];
+                i += run;
+                continue;
+            }
+
+            // Collect pixels until the next repeat worth an encoded run
+            unsigned int j = i;
+            while (j < width && j - i < 255 && rle_runLength(row, j, width, RLE_MIN_RUN) < RLE_MIN_RUN) {
+                j++;
+            }
+            unsigned int literal = j - i;
+
+            if (literal < 3) {
+                // Absolute runs need at least 3 pixels, emit short encoded runs instead
+                for (unsigned int k = 0; k < literal; k++) {
+                    out[n++] = 1;
+                    out[n++] = rle4 ? (unsigned char)(row[i + k] << 4 | row[i + k]) : row[i + k];
+                }
+            } else {
+                out[n++] = 0;
+                out[n++] = (unsigned char)literal;
+                size_t bytes;
+                if (rle4) {
+                    bytes = (literal + 1) / 2;
+                    for (size_t b = 0; b < bytes; b++) {
+                        unsigned char hi = row[i + 2 * b];
+                        unsigned char lo = 2 * b + 1 < literal ? row[i + 2 * b + 1] : 0;
+                        out[n + b] = (unsigned char)(hi << 4 | lo);
+                    }
+                } else {
+                    bytes = literal;
+                    memcpy(out + n, row + i, literal);
+                }
+                n += bytes;
+                if (bytes & 1) out[n++] = 0;
+            }
+            i = j;
+        }
+
+        // End of line, or end of bitmap after the last row
+        out[n++] = 0;
+        out[n++] = y + 1 < height ? 0 : 1;
+    }
+
+    if (height == 0) {
+        out[n++] = 0;
+        out[n++] = 1;
+    }
+
+    *size = n;
+    return out;
+}
@@ -0,0 +1,60 @@
+/**
+ * rle.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the run-length codecs used by compressed BMP files
+ * (BI_RLE8 for 8-bit images, BI_RLE4 for 4-bit images).
+ *
+ * Role in the project:
+ * Lets 8-bit images be read from and written to RLE-compressed BMP files.
+ */
+
+#ifndef RLE_H
+#define RLE_H
+
+#include "utils.h"
+
+/**
+ * rle_decode
+ * Decodes BI_RLE8 or BI_RLE4 data into an 8-bit index buffer. Encoded runs are expanded
+ * with memset and absolute runs are copied in bulk (RLE8) or unpacked two pixels per
+ * byte (RLE4). Pixels skipped by delta escapes, or not covered by the data, are left
+ * unchanged. Writes never go past the given rectangle, even for corrupt input.
+ *
+ * Parameters:
+ * src (const unsigned char*): Compressed data.
+ * size (size_t): Size of the compressed data in bytes.
+ * dst (unsigned char*): Destination buffer, one byte per pixel, rows in file order.
+ * width (unsigned int): Image width in pixels.
+ * height (unsigned int): Image height in pixels.
+ * stride (unsigned int): Distance in bytes between two destination rows.
+ * compression (unsigned int): BI_RLE8 or BI_RLE4.
+ *
+ * Returns:
+ * int: 1 if the end-of-bitmap marker was reached, 0 if the data ended early.
+ */
+int rle_decode(const unsigned char *src, size_t size, unsigned char *dst,
+               unsigned int width, unsigned int height, unsigned int stride, unsigned int compression);
+
+/**
+ * rle_encode
+ * Encodes an 8-bit index buffer as BI_RLE8 or BI_RLE4 data. Repeated values become
+ * encoded runs, other stretches of at least 3 pixels become absolute runs.
+ * For BI_RLE4 every index must be below 16.
+ *
+ * Parameters:
+ * src (const unsigned char*): Source buffer, one byte per pixel, rows in file order.
+ * width (unsigned int): Image width in pixels.
+ * height (unsigned int): Image height in pixels.
+ * stride (unsigned int): Distance in bytes between two source rows.
+ * compression (unsigned int): BI_RLE8 or BI_RLE4.
+ * size (size_t*): Receives the size of the compressed data.
+ *
+ * Returns:
+ * unsigned char*: Newly allocated compressed data (to free), or NULL on failure.
+ */
+unsigned char * rle_encode(const unsigned char *src, unsigned int width, unsigned int height,
+                           unsigned int stride, unsigned int compression, size_t *size);
+
+#endif // RLE_H
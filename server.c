@@ -0,0 +1,891 @@
+/**
+ * server.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the job server. The main thread accepts connections; each connection gets a
+ * reader thread that parses its JSON lines into jobs (the operation chain is parsed and
+ * optimized there) and appends them to a shared queue, protected by a mutex and a
+ * condition variable. Worker threads take jobs from the queue, run them and write the
+ * answer to the connection under its own lock. A connection is closed when its reader
+ * has reached the end of the stream and its last job has been answered. The shutdown
+ * command closes the listening socket; the workers finish the queued jobs and stop.
+ *
+ * Role in the project:
+ * Avoids the process start and allocator warm-up of one program run per image when
+ * images arrive one by one from another program.
+ */
+
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+#include "cli.h"
+#include "parallel.h"
+#include "probe.h"
+#include "shmimage.h"
+
+#define SERVER_MAX_WORKERS 64
+#define SERVER_BACKLOG 16
+
+/**
+ * t_server_conn
+ * One client connection, shared by its reader thread and the workers answering its jobs.
+ */
+typedef struct {
+    struct t_server *server;
+    int fd;
+    int reading;
+    int pending;
+    pthread_mutex_t lock;
+} t_server_conn;
+
+/**
+ * t_server_job
+ * One parsed job, waiting in the queue or running.
+ */
+typedef struct t_server_job {
+    struct t_server_job *next;
+    t_server_conn *conn;
+    char *id;
+    char *input;
+    char *output;
+    char *shm;
+    t_pipeline *pipeline;
+    double queued;
+} t_server_job;
+
+/**
+ * t_server
+ * Shared state of the server: the job queue and the listening socket.
+ */
+typedef struct t_server {
+    int listenFd;
+    int stopping;
+    long served;
+    t_server_job *head;
+    t_server_job *tail;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+} t_server;
+
+
+/**
+ * server_now
+ * Monotonic time in seconds.
+ */
+static double server_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/**
+ * json_skipSpace
+ * Moves past white space.
+ */
+static void json_skipSpace(const char **p) {
+    while (**p == ' ' || **p == '\t' || **p == '\r' || **p == '\n') (*p)++;
+}
+
+
+/**
+ * json_parseString
+ * Reads a JSON string starting at its opening quote. Escapes are decoded; \u escapes
+ * outside ASCII are replaced by '?'.
+ *
+ * Returns:
+ * char*: Newly allocated string, or NULL if the string is malformed.
+ */
+static char *json_parseString(const char **p) {
+    if (**p != '"') return NULL;
+    const char *s = *p + 1;
+    char *out = malloc(strlen(s) + 1);
+    if (!out) return NULL;
+
+    size_t n = 0;
+    while (*s && *s != '"') {
+        if (*s != '\\') {
+            out[n++] = *s++;
+            continue;
+        }
+        s++;
+        switch (*s) {
+            case 'n': out[n++] = '\n'; break;
+            case 't': out[n++] = '\t'; break;
+            case 'r': out[n++] = '\r'; break;
+            case 'b': out[n++] = '\b'; break;
+            case 'f': out[n++] = '\f'; break;
+            case 'u': {
+                // Exactly four hex digits; the checks stop at the first non-digit, so they
+                // never read past the end of the string
+                unsigned int code = 0;
+                for (int i = 1; i <= 4; i++) {
+                    if (!isxdigit((unsigned char)s[i])) {
+                        free(out);
+                        return NULL;
+                    }
+                }
+                sscanf(s + 1, "%4x", &code);
+                out[n++] = code < 128 ? (char)code : '?';
+                s += 4;
+                break;
+            }
+            case '\0': free(out); return NULL;
+            default: out[n++] = *s; break;
+        }
+        s++;
+    }
+    if (*s != '"') {
+        free(out);
+        return NULL;
+    }
+    out[n] = '\0';
+    *p = s + 1;
+    return out;
+}
+
+
+/**
+ * json_skipValue
+ * Moves past a string, number, literal or array of them.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the value is malformed.
+ */
+static int json_skipValue(const char **p) {
+    if (**p == '"') {
+        char *text = json_parseString(p);
+        free(text);
+        return text != NULL;
+    }
+    if (**p == '[') {
+        (*p)++;
+        json_skipSpace(p);
+        if (**p == ']') {
+            (*p)++;
+            return 1;
+        }
+        while (1) {
+            json_skipSpace(p);
+            if (!json_skipValue(p)) return 0;
+            json_skipSpace(p);
+            if (**p == ']') {
+                (*p)++;
+                return 1;
+            }
+            if (**p != ',') return 0;
+            (*p)++;
+        }
+    }
+    const char *start = *p;
+    while (**p && strchr(",}] \t\r\n", **p) == NULL) (*p)++;
+    return *p > start;
+}
+
+
+/**
+ * json_isNumber
+ * Checks that the characters from start to end form a JSON number.
+ */
+static int json_isNumber(const char *start, const char *end) {
+    const char *c = start;
+    if (c < end && *c == '-') c++;
+    if (c < end && *c == '0') {
+        c++;
+    } else {
+        if (c == end || !isdigit((unsigned char)*c)) return 0;
+        while (c < end && isdigit((unsigned char)*c)) c++;
+    }
+    if (c < end && *c == '.') {
+        c++;
+        if (c == end || !isdigit((unsigned char)*c)) return 0;
+        while (c < end && isdigit((unsigned char)*c)) c++;
+    }
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        c++;
+        if (c < end && (*c == '+' || *c == '-')) c++;
+        if (c == end || !isdigit((unsigned char)*c)) return 0;
+        while (c < end && isdigit((unsigned char)*c)) c++;
+    }
+    return c == end;
+}
+
+
+/**
+ * json_writeString
+ * Writes a string as a JSON string literal.
+ */
+static void json_writeString(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') fprintf(out, "\\%c", *c);
+        else if (*c < 0x20) fprintf(out, "\\u%04x", *c);
+        else fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+
+/**
+ * server_parseOps
+ * Reads the array of operations of a job into its pipeline.
+ *
+ * Returns:
+ * const char*: NULL on success, otherwise the reason of the failure.
+ */
+static const char *server_parseOps(const char **p, t_server_job *job) {
+    if (**p != '[') return "\"ops\" must be an array of strings";
+    (*p)++;
+    json_skipSpace(p);
+    if (**p == ']') {
+        (*p)++;
+        return NULL;
+    }
+    while (1) {
+        json_skipSpace(p);
+        char *op = json_parseString(p);
+        if (!op) return "\"ops\" must be an array of strings";
+        int ok = cli_addOp(job->pipeline, op);
+        free(op);
+        if (!ok) return "unknown operation";
+        json_skipSpace(p);
+        if (**p == ']') {
+            (*p)++;
+            return NULL;
+        }
+        if (**p != ',') return "malformed \"ops\" array";
+        (*p)++;
+    }
+}
+
+
+/**
+ * server_parseJob
+ * Parses one JSON line into a job. The id, if any, is kept as raw JSON to be echoed.
+ *
+ * Returns:
+ * const char*: NULL on success, otherwise the reason of the failure.
+ */
+static const char *server_parseJob(const char *line, t_server_job *job, int *stop) {
+    const char *p = line;
+    json_skipSpace(&p);
+    if (*p != '{') return "expected a JSON object";
+    p++;
+    json_skipSpace(&p);
+
+    while (*p != '}') {
+        char *key = json_parseString(&p);
+        if (!key) return "malformed key";
+        json_skipSpace(&p);
+        if (*p != ':') {
+            free(key);
+            return "expected ':'";
+        }
+        p++;
+        json_skipSpace(&p);
+
+        const char *error = NULL;
+        const char *start = p;
+        if (strcmp(key, "input") == 0 || strcmp(key, "output") == 0 || strcmp(key, "shm") == 0) {
+            char **field = key[0] == 'i' ? &job->input : key[0] == 'o' ? &job->output : &job->shm;
+            free(*field);
+            *field = json_parseString(&p);
+            if (!*field) error = "paths must be strings";
+        } else if (strcmp(key, "ops") == 0) {
+            error = server_parseOps(&p, job);
+        } else if (strcmp(key, "command") == 0) {
+            char *command = json_parseString(&p);
+            if (command && strcmp(command, "shutdown") == 0) *stop = 1;
+            else error = "unknown command";
+            free(command);
+        } else if (!json_skipValue(&p)) {
+            error = "malformed value";
+        } else if (strcmp(key, "id") == 0) {
+            // The id is echoed verbatim in the answer, so it must be valid JSON on its own
+            if (*start != '"' && !json_isNumber(start, p)) {
+                error = "\"id\" must be a string or a number";
+            } else {
+                free(job->id);
+                job->id = strndup(start, p - start);
+            }
+        }
+        free(key);
+        if (error) return error;
+
+        json_skipSpace(&p);
+        if (*p == ',') {
+            p++;
+            json_skipSpace(&p);
+        } else if (*p != '}') {
+            return "expected ',' or '}'";
+        }
+    }
+    if (!*stop && !job->shm && (!job->input || !job->output)) return "\"input\" and \"output\", or \"shm\", are required";
+    return NULL;
+}
+
+
+/**
+ * server_freeJob
+ * Frees a job and its pipeline.
+ */
+static void server_freeJob(t_server_job *job) {
+    free(job->id);
+    free(job->input);
+    free(job->output);
+    free(job->shm);
+    pipeline_free(job->pipeline);
+    free(job);
+}
+
+
+/**
+ * server_answer
+ * Sends one line to a client. Errors (the client left) are ignored.
+ */
+static void server_answer(t_server_conn *conn, const char *text, size_t length) {
+    pthread_mutex_lock(&conn->lock);
+    while (length > 0) {
+        ssize_t sent = send(conn->fd, text, length, MSG_NOSIGNAL);
+        if (sent <= 0) break;
+        text += sent;
+        length -= (size_t)sent;
+    }
+    pthread_mutex_unlock(&conn->lock);
+}
+
+
+/**
+ * server_answerError
+ * Sends the answer of a job that could not be run.
+ */
+static void server_answerError(t_server_conn *conn, const char *id, const char *error) {
+    char *text = NULL;
+    size_t length = 0;
+    FILE *out = open_memstream(&text, &length);
+    if (!out) return;
+    fprintf(out, "{\"id\": %s, \"status\": \"error\", \"error\": ", id ? id : "null");
+    json_writeString(out, error);
+    fputs("}\n", out);
+    fclose(out);
+    server_answer(conn, text, length);
+    free(text);
+}
+
+
+/**
+ * server_release
+ * Drops one reference to a connection (its reader or one of its jobs) and closes it
+ * when the last one is gone.
+ */
+static void server_release(t_server_conn *conn, int reader) {
+    pthread_mutex_lock(&conn->lock);
+    if (reader) conn->reading = 0;
+    else conn->pending--;
+    int done = !conn->reading && conn->pending == 0;
+    pthread_mutex_unlock(&conn->lock);
+
+    if (done) {
+        close(conn->fd);
+        pthread_mutex_destroy(&conn->lock);
+        free(conn);
+    }
+}
+
+
+/**
+ * server_stop
+ * Stops accepting connections; the workers stop once the queue is empty.
+ */
+static void server_stop(t_server *server) {
+    pthread_mutex_lock(&server->lock);
+    server->stopping = 1;
+    pthread_cond_broadcast(&server->notEmpty);
+    pthread_mutex_unlock(&server->lock);
+    shutdown(server->listenFd, SHUT_RDWR);
+}
+
+
+/**
+ * server_reader
+ * Reads the JSON lines of a connection and queues its jobs.
+ */
+static void *server_reader(void *arg) {
+    t_server_conn *conn = arg;
+    t_server *server = conn->server;
+    int fd = dup(conn->fd);
+    FILE *in = fd >= 0 ? fdopen(fd, "r") : NULL;
+    char *line = NULL;
+    size_t capacity = 0;
+
+    while (in && getline(&line, &capacity, in) > 0) {
+        const char *p = line;
+        json_skipSpace(&p);
+        if (!*p) continue;
+
+        t_server_job *job = calloc(1, sizeof(t_server_job));
+        if (job) job->pipeline = pipeline_create();
+        if (!job || !job->pipeline) {
+            server_answerError(conn, NULL, "out of memory");
+            if (job) server_freeJob(job);
+            continue;
+        }
+
+        int stop = 0;
+        const char *error = server_parseJob(line, job, &stop);
+        if (error || stop) {
+            if (error) {
+                server_answerError(conn, job->id, error);
+            } else {
+                const char *text = "{\"status\": \"ok\", \"shutdown\": true}\n";
+                server_answer(conn, text, strlen(text));
+                server_stop(server);
+            }
+            server_freeJob(job);
+            continue;
+        }
+
+        pipeline_optimize(job->pipeline);
+        job->conn = conn;
+        job->queued = server_now();
+        pthread_mutex_lock(&conn->lock);
+        conn->pending++;
+        pthread_mutex_unlock(&conn->lock);
+
+        pthread_mutex_lock(&server->lock);
+        if (server->tail) server->tail->next = job;
+        else server->head = job;
+        server->tail = job;
+        pthread_cond_signal(&server->notEmpty);
+        pthread_mutex_unlock(&server->lock);
+    }
+
+    free(line);
+    if (in) fclose(in);
+    else if (fd >= 0) close(fd);
+    server_release(conn, 1);
+    return NULL;
+}
+
+
+/**
+ * server_pop
+ * Takes the oldest job, waiting while the queue is empty.
+ *
+ * Returns:
+ * t_server_job*: The job, or NULL once the server stops and the queue is empty.
+ */
+static t_server_job *server_pop(t_server *server) {
+    pthread_mutex_lock(&server->lock);
+    while (!server->head && !server->stopping) {
+        pthread_cond_wait(&server->notEmpty, &server->lock);
+    }
+    t_server_job *job = server->head;
+    if (job) {
+        server->head = job->next;
+        if (!server->head) server->tail = NULL;
+        server->served++;
+    }
+    pthread_mutex_unlock(&server->lock);
+    return job;
+}
+
+
+/**
+ * server_runShared
+ * Runs a job on an image in shared memory: the segment is mapped, processed in place and
+ * unmapped, so the pixels are neither read from nor written to a file.
+ */
+static void server_runShared(t_server_job *job, double start) {
+    t_shm_image image;
+    if (shmimage_open(job->shm, &image) != 0) {
+        server_answerError(job->conn, job->id, "cannot map the shared-memory image");
+        return;
+    }
+    double mapped = server_now();
+    int ok = pipeline_applyView(job->pipeline, &image.view) == 0;
+    double processed = server_now();
+    int width = image.view.width;
+    int height = image.view.height;
+    shmimage_close(&image);
+    if (!ok) {
+        server_answerError(job->conn, job->id, "not enough memory to process the image");
+        return;
+    }
+
+    char *text = NULL;
+    size_t length = 0;
+    FILE *out = open_memstream(&text, &length);
+    if (!out) return;
+    fprintf(out, "{\"id\": %s, \"status\": \"ok\", \"shm\": ", job->id ? job->id : "null");
+    json_writeString(out, job->shm);
+    fprintf(out, ", \"width\": %d, \"height\": %d, \"queue_ms\": %.3f, \"map_ms\": %.3f, \"process_ms\": %.3f, "
+                 "\"total_ms\": %.3f}\n",
+            width, height, (start - job->queued) * 1000.0, (mapped - start) * 1000.0, (processed - mapped) * 1000.0,
+            (server_now() - job->queued) * 1000.0);
+    fclose(out);
+    server_answer(job->conn, text, length);
+    free(text);
+}
+
+
+/**
+ * server_worker
+ * Runs queued jobs. The last 24-bit image is kept, and the next image of the same size
+ * and depth is read into its buffer instead of a new allocation.
+ */
+static void *server_worker(void *arg) {
+    t_server *server = arg;
+    t_bmp24 *buffer = NULL;
+    t_server_job *job;
+
+    while ((job = server_pop(server)) != NULL) {
+        double start = server_now();
+        t_bmp_probe probe;
+        t_bmp8 *gray = NULL;
+        t_bmp24 *color = NULL;
+        int reused = 0;
+
+        if (job->shm) {
+            server_runShared(job, start);
+            server_release(job->conn, 0);
+            server_freeJob(job);
+            continue;
+        }
+        if (!probe_file(job->input, &probe)) {
+            server_answerError(job->conn, job->id, probe.error);
+            server_release(job->conn, 0);
+            server_freeJob(job);
+            continue;
+        }
+        if (probe.depth <= 8) {
+            gray = bmp8_loadImage(job->input);
+        } else {
+            int height = probe.height < 0 ? -probe.height : probe.height;
+            if (buffer && buffer->width == probe.width && buffer->height == height &&
+                buffer->colorDepth == probe.depth && bmp24_reload(buffer, job->input)) {
+                reused = 1;
+            } else {
+                bmp24_free(buffer);
+                buffer = bmp24_loadImage(job->input);
+            }
+            color = buffer;
+        }
+        double loaded = server_now();
+        if (!gray && !color) {
+            server_answerError(job->conn, job->id, "cannot load the input image");
+            server_release(job->conn, 0);
+            server_freeJob(job);
+            continue;
+        }
+
+        int ok = (gray ? pipeline_apply8(job->pipeline, gray) : pipeline_apply24(job->pipeline, color)) == 0;
+        double processed = server_now();
+        if (!ok) {
+            server_answerError(job->conn, job->id, "not enough memory to process the image");
+            bmp8_free(gray);
+            server_release(job->conn, 0);
+            server_freeJob(job);
+            continue;
+        }
+
+        ok = (gray ? bmp8_saveImage(job->output, gray) : bmp24_saveImage(color, job->output)) == 0;
+        double saved = server_now();
+        if (!ok) {
+            server_answerError(job->conn, job->id, "cannot write the output image");
+            bmp8_free(gray);
+            server_release(job->conn, 0);
+            server_freeJob(job);
+            continue;
+        }
+
+        char *text = NULL;
+        size_t length = 0;
+        FILE *out = open_memstream(&text, &length);
+        if (out) {
+            fprintf(out, "{\"id\": %s, \"status\": \"ok\", \"output\": ", job->id ? job->id : "null");
+            json_writeString(out, job->output);
+            fprintf(out, ", \"width\": %d, \"height\": %d, \"reused\": %s, \"queue_ms\": %.3f, \"load_ms\": %.3f, "
+                         "\"process_ms\": %.3f, \"save_ms\": %.3f, \"total_ms\": %.3f}\n",
+                    gray ? (int)gray->width : color->width, gray ? (int)gray->height : color->height,
+                    reused ? "true" : "false", (start - job->queued) * 1000.0, (loaded - start) * 1000.0,
+                    (processed - loaded) * 1000.0, (saved - processed) * 1000.0, (saved - job->queued) * 1000.0);
+            fclose(out);
+            server_answer(job->conn, text, length);
+            free(text);
+        }
+
+        bmp8_free(gray);
+        server_release(job->conn, 0);
+        server_freeJob(job);
+    }
+
+    bmp24_free(buffer);
+    return NULL;
+}
+
+
+/**
+ * server_address
+ * Fills a UNIX socket address.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the path is too long.
+ */
+static int server_address(const char *socketPath, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "Error: Socket path %s is too long.\n", socketPath);
+        return 0;
+    }
+    strcpy(address->sun_path, socketPath);
+    return 1;
+}
+
+
+/**
+ * server_connect
+ * Connects to a server socket.
+ *
+ * Returns:
+ * int: The connected descriptor, or -1.
+ */
+static int server_connect(const char *socketPath) {
+    struct sockaddr_un address;
+    if (!server_address(socketPath, &address)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+
+/**
+ * server_run
+ * Serves jobs on a UNIX domain socket until a shutdown command is received.
+ *
+ * Parameters:
+ * socketPath (const char*): Path of the socket (a stale socket file is replaced).
+ * workers (int): Number of worker threads (0 for parallel_threadCount()).
+ *
+ * Returns:
+ * int: 0 after a shutdown command, -1 if the socket cannot be set up.
+ */
+int server_run(const char *socketPath, int workers) {
+    struct sockaddr_un address;
+    if (!socketPath || !server_address(socketPath, &address)) return -1;
+
+    // A socket file nobody answers on is left over from a previous server
+    int other = server_connect(socketPath);
+    if (other >= 0) {
+        close(other);
+        fprintf(stderr, "Error: A server is already listening on %s.\n", socketPath);
+        return -1;
+    }
+    unlink(socketPath);
+
+    t_server server;
+    memset(&server, 0, sizeof(server));
+    server.listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server.listenFd < 0 || bind(server.listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(server.listenFd, SERVER_BACKLOG) != 0) {
+        fprintf(stderr, "Error: Unable to listen on %s.\n", socketPath);
+        if (server.listenFd >= 0) close(server.listenFd);
+        return -1;
+    }
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.notEmpty, NULL);
+
+    if (workers <= 0) workers = parallel_threadCount();
+    if (workers > SERVER_MAX_WORKERS) workers = SERVER_MAX_WORKERS;
+    pthread_t threads[SERVER_MAX_WORKERS];
+    int started = 0;
+    while (started < workers && pthread_create(&threads[started], NULL, server_worker, &server) == 0) started++;
+    fprintf(stderr, "Listening on %s with %d workers.\n", socketPath, started);
+
+    while (1) {
+        int fd = accept(server.listenFd, NULL, NULL);
+        pthread_mutex_lock(&server.lock);
+        int stopping = server.stopping;
+        pthread_mutex_unlock(&server.lock);
+        if (fd < 0) {
+            if (!stopping && errno == EINTR) continue;
+            if (!stopping) fprintf(stderr, "Error: Unable to accept connections.\n");
+            break;
+        }
+        if (stopping) {
+            close(fd);
+            break;
+        }
+
+        t_server_conn *conn = calloc(1, sizeof(t_server_conn));
+        pthread_t reader;
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->server = &server;
+        conn->fd = fd;
+        conn->reading = 1;
+        pthread_mutex_init(&conn->lock, NULL);
+        if (pthread_create(&reader, NULL, server_reader, conn) != 0) {
+            close(fd);
+            pthread_mutex_destroy(&conn->lock);
+            free(conn);
+            continue;
+        }
+        pthread_detach(reader);
+    }
+
+    server_stop(&server);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    close(server.listenFd);
+    unlink(socketPath);
+    fprintf(stderr, "Served %ld jobs.\n", server.served);
+
+    pthread_mutex_destroy(&server.lock);
+    pthread_cond_destroy(&server.notEmpty);
+    return 0;
+}
+
+
+/**
+ * server_send
+ * Sends JSON lines to a server and copies its answers to out, one per job sent.
+ *
+ * Parameters:
+ * socketPath (const char*): Path of the server socket.
+ * jobs (FILE*): Stream of JSON lines to send (for instance stdin).
+ * out (FILE*): Stream receiving the answers.
+ *
+ * Returns:
+ * int: Number of answers reporting an error, or -1 if the server cannot be reached.
+ */
+int server_send(const char *socketPath, FILE *jobs, FILE *out) {
+    int fd = server_connect(socketPath);
+    if (fd < 0) {
+        fprintf(stderr, "Error: No server is listening on %s.\n", socketPath);
+        return -1;
+    }
+
+    // Send everything first: the server reads while its workers answer
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, jobs)) > 0) {
+        const char *text = line;
+        while (length > 0) {
+            ssize_t sent = send(fd, text, length, MSG_NOSIGNAL);
+            if (sent <= 0) break;
+            text += sent;
+            length -= sent;
+        }
+        if (line[strlen(line) - 1] != '\n') send(fd, "\n", 1, MSG_NOSIGNAL);
+    }
+    shutdown(fd, SHUT_WR);
+
+    int errors = 0;
+    FILE *in = fdopen(fd, "r");
+    if (!in) {
+        close(fd);
+        free(line);
+        return -1;
+    }
+    while (getline(&line, &capacity, in) > 0) {
+        fputs(line, out);
+        if (strstr(line, "\"status\": \"error\"")) errors++;
+    }
+    fflush(out);
+    fclose(in);
+    free(line);
+    return errors;
+}
+
+
+/**
+ * server_sendLine
+ * Ends a job being written with its operations, sends it and copies the answer to out.
+ */
+static int server_sendLine(const char *socketPath, FILE *job, char **line, size_t *length, const char **ops,
+                           int opCount, FILE *out) {
+    fputs(", \"ops\": [", job);
+    for (int i = 0; i < opCount; i++) {
+        if (i) fputs(", ", job);
+        json_writeString(job, ops[i]);
+    }
+    fputs("]}\n", job);
+    fclose(job);
+
+    FILE *in = fmemopen(*line, *length, "r");
+    int result = in ? server_send(socketPath, in, out) : -1;
+    if (in) fclose(in);
+    free(*line);
+    return result;
+}
+
+
+/**
+ * server_sendJob
+ * Sends one job built from its paths and operations, and copies the answer to out.
+ *
+ * Parameters:
+ * socketPath (const char*): Path of the server socket.
+ * input (const char*): Image to process.
+ * output (const char*): Path of the result.
+ * ops (const char**): Operations, in the syntax of --op.
+ * opCount (int): Number of operations.
+ * out (FILE*): Stream receiving the answer.
+ *
+ * Returns:
+ * int: 0 if the job succeeded, 1 if it failed, -1 if the server cannot be reached.
+ */
+int server_sendJob(const char *socketPath, const char *input, const char *output, const char **ops, int opCount,
+                   FILE *out) {
+    char *line = NULL;
+    size_t length = 0;
+    FILE *job = open_memstream(&line, &length);
+    if (!job) return -1;
+
+    fputs("{\"input\": ", job);
+    json_writeString(job, input);
+    fputs(", \"output\": ", job);
+    json_writeString(job, output);
+    return server_sendLine(socketPath, job, &line, &length, ops, opCount, out);
+}
+
+
+/**
+ * server_sendShared
+ * Sends one job on an image in shared memory, and copies the answer to out. When the
+ * answer arrives, the segment holds the result.
+ *
+ * Parameters:
+ * socketPath (const char*): Path of the server socket.
+ * name (const char*): Name of the POSIX shared-memory object holding the image.
+ * ops (const char**): Operations, in the syntax of --op.
+ * opCount (int): Number of operations.
+ * out (FILE*): Stream receiving the answer.
+ *
+ * Returns:
+ * int: 0 if the job succeeded, 1 if it failed, -1 if the server cannot be reached.
+ */
+int server_sendShared(const char *socketPath, const char *name, const char **ops, int opCount, FILE *out) {
+    char *line = NULL;
+    size_t length = 0;
+    FILE *job = open_memstream(&line, &length);
+    if (!job) return -1;
+
+    fputs("{\"shm\": ", job);
+    json_writeString(job, name);
+    return server_sendLine(socketPath, job, &line, &length, ops, opCount, out);
+}
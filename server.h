@@ -0,0 +1,92 @@
+/**
+ * server.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the job server and its client. The server listens on a local
+ * UNIX domain socket and reads jobs as JSON lines, one object per line:
+ *
+ *     {"id": 1, "input": "in.bmp", "output": "out.bmp", "ops": ["negative", "brightness=20"]}
+ *
+ * ("id" is optional and echoed back; {"command": "shutdown"} stops the server.) A job
+ * may name a shared-memory image instead of files, {"shm": "/name", "ops": [...]}: the
+ * image is then processed in place in the segment (see shmimage.h). Jobs run
+ * on a pool of worker threads that live as long as the server, each keeping its last
+ * 24-bit image so that the next image of the same size is read into the same buffer.
+ * Every job is answered by one JSON line giving its status and its latency split into
+ * queueing, loading, processing and saving time. Several jobs can be sent on one
+ * connection without waiting; answers come back in completion order.
+ *
+ * Role in the project:
+ * Avoids the process start and allocator warm-up of one program run per image when
+ * images arrive one by one from another program.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+
+/**
+ * server_run
+ * Serves jobs on a UNIX domain socket until a shutdown command is received.
+ *
+ * Parameters:
+ * socketPath (const char*): Path of the socket (a stale socket file is replaced).
+ * workers (int): Number of worker threads (0 for parallel_threadCount()).
+ *
+ * Returns:
+ * int: 0 after a shutdown command, -1 if the socket cannot be set up.
+ */
+int server_run(const char *socketPath, int workers);
+
+/**
+ * server_send
+ * Sends JSON lines to a server and copies its answers to out, one per job sent.
+ *
+ * Parameters:
+ * socketPath (const char*): Path of the server socket.
+ * jobs (FILE*): Stream of JSON lines to send (for instance stdin).
+ * out (FILE*): Stream receiving the answers.
+ *
+ * Returns:
+ * int: Number of answers reporting an error, or -1 if the server cannot be reached.
+ */
+int server_send(const char *socketPath, FILE *jobs, FILE *out);
+
+/**
+ * server_sendJob
+ * Sends one job built from its paths and operations, and copies the answer to out.
+ *
+ * Parameters:
+ * socketPath (const char*): Path of the server socket.
+ * input (const char*): Image to process.
+ * output (const char*): Path of the result.
+ * ops (const char**): Operations, in the syntax of --op.
+ * opCount (int): Number of operations.
+ * out (FILE*): Stream receiving the answer.
+ *
+ * Returns:
+ * int: 0 if the job succeeded, 1 if it failed, -1 if the server cannot be reached.
+ */
+int server_sendJob(const char *socketPath, const char *input, const char *output, const char **ops, int opCount,
+                   FILE *out);
+
+/**
+ * server_sendShared
+ * Sends one job on an image in shared memory, and copies the answer to out. When the
+ * answer arrives, the segment holds the result.
+ *
+ * Parameters:
+ * socketPath (const char*): Path of the server socket.
+ * name (const char*): Name of the POSIX shared-memory object holding the image.
+ * ops (const char**): Operations, in the syntax of --op.
+ * opCount (int): Number of operations.
+ * out (FILE*): Stream receiving the answer.
+ *
+ * Returns:
+ * int: 0 if the job succeeded, 1 if it failed, -1 if the server cannot be reached.
+ */
+int server_sendShared(const char *socketPath, const char *name, const char **ops, int opCount, FILE *out);
+
+#endif // SERVER_H
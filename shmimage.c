@@ -0,0 +1,230 @@
+/**
+ * shmimage.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements images held in shared memory. Rows are padded to 64 bytes so that every row
+ * starts on a cache line, and the whole segment is mapped shared, so writes of one
+ * process are the pixels the other reads. A mapped segment is checked before use: the
+ * descriptor comes from another process and must describe pixels inside the segment.
+ *
+ * Role in the project:
+ * Zero-copy handoff of images between the server (or a child process) and the program
+ * that produces and consumes them.
+ */
+
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmimage.h"
+
+#define SHMIMAGE_ALIGN 64
+
+
+/**
+ * shmimage_pixelSize
+ * Bytes per pixel of a layout.
+ */
+static int shmimage_pixelSize(int format) {
+    return format == VIEW_BGRA32 ? (int)sizeof(t_pixel) : 1;
+}
+
+
+/**
+ * shmimage_describe
+ * Fills the view of a mapped segment from its header.
+ */
+static void shmimage_describe(t_shm_image *image) {
+    t_shm_header *header = image->header;
+    t_view view = {image->base + header->dataOffset, header->width, header->height, header->stride,
+                   (t_view_format)header->format, NULL, 0, 1};
+    image->view = view;
+}
+
+
+/**
+ * shmimage_create
+ * Creates a segment for an image and maps it. The pixels are zero.
+ *
+ * Parameters:
+ * name (const char*): Name of a new POSIX shared-memory object ("/name"), or NULL for an
+ *     anonymous memfd, shared by passing or inheriting its descriptor.
+ * width, height (int): Image size in pixels.
+ * format (t_view_format): Pixel layout.
+ * image (t_shm_image*): Receives the mapped segment.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure (an existing object of the same name is not replaced).
+ */
+int shmimage_create(const char *name, int width, int height, t_view_format format, t_shm_image *image) {
+    memset(image, 0, sizeof(*image));
+    image->fd = -1;
+    if (width <= 0 || height <= 0 || (format != VIEW_GRAY8 && format != VIEW_BGRA32)) {
+        fprintf(stderr, "Error: Invalid shared image size or format.\n");
+        return -1;
+    }
+
+    uint64_t stride = ((uint64_t)width * shmimage_pixelSize(format) + SHMIMAGE_ALIGN - 1) / SHMIMAGE_ALIGN * SHMIMAGE_ALIGN;
+    uint64_t size = sizeof(t_shm_header) + stride * (uint64_t)height;
+    if (stride > INT32_MAX || size > (uint64_t)SIZE_MAX || size > (uint64_t)INT64_MAX) {
+        fprintf(stderr, "Error: Shared image too large.\n");
+        return -1;
+    }
+
+    image->fd = name ? shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600) : memfd_create("image", 0);
+    if (image->fd < 0) {
+        fprintf(stderr, "Error: Unable to create shared memory %s: %s.\n", name ? name : "(memfd)", strerror(errno));
+        return -1;
+    }
+    if (ftruncate(image->fd, (off_t)size) != 0) {
+        fprintf(stderr, "Error: Unable to size shared memory: %s.\n", strerror(errno));
+        close(image->fd);
+        if (name) shm_unlink(name);
+        image->fd = -1;
+        return -1;
+    }
+
+    image->base = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, image->fd, 0);
+    if (image->base == MAP_FAILED) {
+        fprintf(stderr, "Error: Unable to map shared memory: %s.\n", strerror(errno));
+        close(image->fd);
+        if (name) shm_unlink(name);
+        image->fd = -1;
+        image->base = NULL;
+        return -1;
+    }
+
+    image->size = (size_t)size;
+    image->header = (t_shm_header *)image->base;
+    image->header->magic = SHMIMAGE_MAGIC;
+    image->header->dataOffset = sizeof(t_shm_header);
+    image->header->width = width;
+    image->header->height = height;
+    image->header->format = format;
+    image->header->stride = (int32_t)stride;
+    image->header->size = size;
+    shmimage_describe(image);
+    return 0;
+}
+
+
+/**
+ * shmimage_map
+ * Maps an existing segment from its descriptor and checks its header.
+ *
+ * Parameters:
+ * fd (int): Descriptor of the segment, owned by the image on success.
+ * image (t_shm_image*): Receives the mapped segment.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the segment cannot be mapped or its header is invalid.
+ */
+int shmimage_map(int fd, t_shm_image *image) {
+    memset(image, 0, sizeof(*image));
+    image->fd = -1;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(t_shm_header) || (uint64_t)info.st_size > SIZE_MAX) {
+        fprintf(stderr, "Error: Shared memory too small for an image descriptor.\n");
+        return -1;
+    }
+
+    size_t size = (size_t)info.st_size;
+    unsigned char *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Error: Unable to map shared memory: %s.\n", strerror(errno));
+        return -1;
+    }
+
+    // Copy the header once, so that the checks and the view agree even if it changes
+    t_shm_header header;
+    memcpy(&header, base, sizeof(header));
+    uint64_t rowBytes = header.width > 0 ? (uint64_t)header.width * shmimage_pixelSize(header.format) : 0;
+    if (header.magic != SHMIMAGE_MAGIC || (header.format != VIEW_GRAY8 && header.format != VIEW_BGRA32) ||
+        header.width <= 0 || header.height <= 0 || header.stride <= 0 || (uint64_t)header.stride < rowBytes ||
+        header.dataOffset < sizeof(t_shm_header) || header.dataOffset % sizeof(t_pixel) != 0 ||
+        header.dataOffset + (uint64_t)header.stride * (uint64_t)header.height > size) {
+        fprintf(stderr, "Error: Invalid shared image descriptor.\n");
+        munmap(base, size);
+        return -1;
+    }
+
+    image->fd = fd;
+    image->base = base;
+    image->size = size;
+    image->header = (t_shm_header *)base;
+    t_view view = {base + header.dataOffset, header.width, header.height, header.stride,
+                   (t_view_format)header.format, NULL, 0, 1};
+    image->view = view;
+    return 0;
+}
+
+
+/**
+ * shmimage_open
+ * Opens a named POSIX shared-memory object and maps it.
+ *
+ * Parameters:
+ * name (const char*): Name of the object ("/name").
+ * image (t_shm_image*): Receives the mapped segment.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int shmimage_open(const char *name, t_shm_image *image) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        memset(image, 0, sizeof(*image));
+        image->fd = -1;
+        fprintf(stderr, "Error: Unable to open shared memory %s: %s.\n", name, strerror(errno));
+        return -1;
+    }
+    if (shmimage_map(fd, image) != 0) {
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * shmimage_close
+ * Unmaps a segment and closes its descriptor. A named object stays until shm_unlink.
+ *
+ * Parameters:
+ * image (t_shm_image*): Segment to close.
+ */
+void shmimage_close(t_shm_image *image) {
+    if (image->base) munmap(image->base, image->size);
+    if (image->fd >= 0) close(image->fd);
+    image->base = NULL;
+    image->header = NULL;
+    image->fd = -1;
+}
+
+
+/**
+ * shmimage_fromView
+ * Creates a segment holding a copy of the pixels of a view.
+ *
+ * Parameters:
+ * name (const char*): Name of the object, or NULL for a memfd (see shmimage_create).
+ * view (const t_view*): Pixels to copy.
+ * image (t_shm_image*): Receives the mapped segment.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int shmimage_fromView(const char *name, const t_view *view, t_shm_image *image) {
+    if (shmimage_create(name, view->width, view->height, view->format, image) != 0) return -1;
+
+    size_t rowBytes = (size_t)view->width * shmimage_pixelSize(view->format);
+    for (int y = 0; y < view->height; y++) {
+        memcpy(view_row(&image->view, y), view_row(view, y), rowBytes);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * shmimage.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring images held in shared memory. A segment (a named POSIX
+ * shared-memory object or an anonymous memfd) starts with a small descriptor giving the
+ * size, pixel layout and row stride, followed by the raw pixels, top row first. Two
+ * processes mapping the same segment see the same pixels: one fills it, the other
+ * processes it in place, and the result is read back from the same memory with no file,
+ * no copy and no serialization in between.
+ *
+ * Role in the project:
+ * Zero-copy handoff of images between the server (or a child process) and the program
+ * that produces and consumes them.
+ */
+
+#ifndef SHMIMAGE_H
+#define SHMIMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "view.h"
+
+// "SHMI" in little-endian order, at the start of every segment
+#define SHMIMAGE_MAGIC 0x494D4853u
+
+/**
+ * t_shm_header
+ * Descriptor at the start of a segment (64 bytes, so the pixels start on a cache line).
+ * Every field is written by the creator of the segment and only read afterwards.
+ *
+ * Members:
+ * magic (uint32_t): SHMIMAGE_MAGIC.
+ * dataOffset (uint32_t): Offset of the first pixel from the start of the segment.
+ * width, height (int32_t): Image size in pixels.
+ * format (int32_t): Pixel layout, a t_view_format value (VIEW_GRAY8 or VIEW_BGRA32).
+ * stride (int32_t): Bytes from one row to the next.
+ * size (uint64_t): Size of the segment in bytes.
+ * reserved (uint32_t[8]): Zero.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t dataOffset;
+    int32_t width;
+    int32_t height;
+    int32_t format;
+    int32_t stride;
+    uint64_t size;
+    uint32_t reserved[8];
+} t_shm_header;
+
+/**
+ * t_shm_image
+ * Segment mapped in the current process.
+ *
+ * Members:
+ * fd (int): Descriptor of the segment.
+ * base (unsigned char*): Start of the mapping (the descriptor).
+ * size (size_t): Size of the mapping.
+ * header (t_shm_header*): Descriptor of the segment.
+ * view (t_view): View of every pixel of the segment.
+ */
+typedef struct {
+    int fd;
+    unsigned char *base;
+    size_t size;
+    t_shm_header *header;
+    t_view view;
+} t_shm_image;
+
+/**
+ * shmimage_create
+ * Creates a segment for an image and maps it. The pixels are zero.
+ *
+ * Parameters:
+ * name (const char*): Name of a new POSIX shared-memory object ("/name"), or NULL for an
+ *     anonymous memfd, shared by passing or inheriting its descriptor.
+ * width, height (int): Image size in pixels.
+ * format (t_view_format): Pixel layout.
+ * image (t_shm_image*): Receives the mapped segment.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure (an existing object of the same name is not replaced).
+ */
+int shmimage_create(const char *name, int width, int height, t_view_format format, t_shm_image *image);
+
+/**
+ * shmimage_map
+ * Maps an existing segment from its descriptor and checks its header.
+ *
+ * Parameters:
+ * fd (int): Descriptor of the segment, owned by the image on success.
+ * image (t_shm_image*): Receives the mapped segment.
+ *
+ * Returns:
+ * int: 0 on success, -1 if the segment cannot be mapped or its header is invalid.
+ */
+int shmimage_map(int fd, t_shm_image *image);
+
+/**
+ * shmimage_open
+ * Opens a named POSIX shared-memory object and maps it.
+ *
+ * Parameters:
+ * name (const char*): Name of the object ("/name").
+ * image (t_shm_image*): Receives the mapped segment.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int shmimage_open(const char *name, t_shm_image *image);
+
+/**
+ * shmimage_close
+ * Unmaps a segment and closes its descriptor. A named object stays until shm_unlink.
+ *
+ * Parameters:
+ * image (t_shm_image*): Segment to close.
+ */
+void shmimage_close(t_shm_image *image);
+
+/**
+ * shmimage_fromView
+ * Creates a segment holding a copy of the pixels of a view.
+ *
+ * Parameters:
+ * name (const char*): Name of the object, or NULL for a memfd (see shmimage_create).
+ * view (const t_view*): Pixels to copy.
+ * image (t_shm_image*): Receives the mapped segment.
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int shmimage_fromView(const char *name, const t_view *view, t_shm_image *image);
+
+#endif // SHMIMAGE_H
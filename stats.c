@@ -0,0 +1,190 @@
+/**
+ * stats.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the per-channel statistics. Bands of rows are counted in parallel into
+ * private histograms (two per channel, for alternate pixels, so that runs of equal pixels
+ * do not wait on the previous increment of the same counter) which are added together
+ * under a lock. Minimum, maximum, mean and variance then come from the histograms: they
+ * are exact, and the pixels are read only once.
+ *
+ * Role in the project:
+ * Quality checks on processed images (exposure, clipping, contrast) without several
+ * passes over the pixels.
+ */
+
+
+#include <pthread.h>
+#include "stats.h"
+#include "histogram.h"
+#include "parallel.h"
+
+/**
+ * t_stats_job
+ * Shared state of the counting pass over a 24-bit image (counts in BGRA byte order).
+ */
+typedef struct {
+    const t_bmp24 *img;
+    unsigned int counts[4][256];
+    pthread_mutex_t lock;
+} t_stats_job;
+
+
+/**
+ * stats_countBand
+ * Counts the channels of the rows [start, end).
+ */
+static void stats_countBand(void *context, int start, int end) {
+    t_stats_job *job = (t_stats_job *)context;
+    int width = job->img->width;
+    unsigned int partial[2][4][256] = {{{0}}};
+
+    for (int y = start; y < end; y++) {
+        const uint8_t *row = (const uint8_t *)job->img->data[y];
+        int x = 0;
+        for (; x + 2 <= width; x += 2, row += 8) {
+            partial[0][0][row[0]]++;
+            partial[0][1][row[1]]++;
+            partial[0][2][row[2]]++;
+            partial[0][3][row[3]]++;
+            partial[1][0][row[4]]++;
+            partial[1][1][row[5]]++;
+            partial[1][2][row[6]]++;
+            partial[1][3][row[7]]++;
+        }
+        if (x < width) {
+            partial[0][0][row[0]]++;
+            partial[0][1][row[1]]++;
+            partial[0][2][row[2]]++;
+            partial[0][3][row[3]]++;
+        }
+    }
+
+    pthread_mutex_lock(&job->lock);
+    for (int c = 0; c < 4; c++) {
+        for (int v = 0; v < 256; v++) {
+            job->counts[c][v] += partial[0][c][v] + partial[1][c][v];
+        }
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+
+/**
+ * stats_fromHistogram
+ * Fills a channel from its histogram.
+ */
+static void stats_fromHistogram(t_channel_stats *channel, const char *name, const unsigned int *histogram) {
+    channel->name = name;
+    memcpy(channel->histogram, histogram, sizeof(channel->histogram));
+
+    double count = 0.0;
+    double sum = 0.0;
+    channel->min = -1;
+    channel->max = 0;
+    for (int v = 0; v < 256; v++) {
+        if (!histogram[v]) continue;
+        if (channel->min < 0) channel->min = v;
+        channel->max = v;
+        count += histogram[v];
+        sum += (double)v * histogram[v];
+    }
+    if (channel->min < 0) channel->min = 0;
+    channel->mean = count > 0.0 ? sum / count : 0.0;
+
+    // Centered second moment: no cancellation, unlike sum of squares minus squared sum
+    double squares = 0.0;
+    for (int v = channel->min; v <= channel->max; v++) {
+        double d = v - channel->mean;
+        squares += d * d * histogram[v];
+    }
+    channel->variance = count > 0.0 ? squares / count : 0.0;
+    channel->stddev = sqrt(channel->variance);
+}
+
+
+/**
+ * bmp8_stats
+ * Computes the statistics of an 8-bit image. The histogram cached in the image is used
+ * when it is current.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image.
+ * stats (t_image_stats*): Receives the statistics.
+ *
+ * Returns:
+ * int: 0 on success, -1 if an argument is NULL.
+ */
+int bmp8_stats(t_bmp8 *img, t_image_stats *stats) {
+    if (!img || !stats) return -1;
+
+    stats->width = (int)img->width;
+    stats->height = (int)img->height;
+    stats->channelCount = 1;
+    stats_fromHistogram(&stats->channels[0], "gray", bmp8_histogram(img));
+    return 0;
+}
+
+
+/**
+ * bmp24_stats
+ * Computes the statistics of the red, green and blue channels of a 24-bit image (and of
+ * the alpha channel for a 32-bit image) in one parallel pass.
+ *
+ * Parameters:
+ * img (const t_bmp24*): Image.
+ * stats (t_image_stats*): Receives the statistics.
+ *
+ * Returns:
+ * int: 0 on success, -1 if an argument is NULL.
+ */
+int bmp24_stats(const t_bmp24 *img, t_image_stats *stats) {
+    if (!img || !stats) return -1;
+
+    t_stats_job job;
+    job.img = img;
+    memset(job.counts, 0, sizeof(job.counts));
+    pthread_mutex_init(&job.lock, NULL);
+    if (img->data) parallel_for(img->height, 16, stats_countBand, &job);
+    pthread_mutex_destroy(&job.lock);
+
+    stats->width = img->width;
+    stats->height = img->height;
+    stats->channelCount = img->colorDepth == 32 ? 4 : 3;
+    stats_fromHistogram(&stats->channels[0], "red", job.counts[2]);
+    stats_fromHistogram(&stats->channels[1], "green", job.counts[1]);
+    stats_fromHistogram(&stats->channels[2], "blue", job.counts[0]);
+    stats_fromHistogram(&stats->channels[3], "alpha", job.counts[3]);
+    return 0;
+}
+
+
+/**
+ * stats_writeJson
+ * Writes the statistics as a JSON object.
+ *
+ * Parameters:
+ * stats (const t_image_stats*): Statistics to write.
+ * histograms (int): Non-zero to include the 256 counts of each channel.
+ * out (FILE*): Destination stream.
+ */
+void stats_writeJson(const t_image_stats *stats, int histograms, FILE *out) {
+    fprintf(out, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"channels\": [\n", stats->width, stats->height);
+
+    for (int c = 0; c < stats->channelCount; c++) {
+        const t_channel_stats *channel = &stats->channels[c];
+        fprintf(out, "    {\"name\": \"%s\", \"min\": %d, \"max\": %d, \"mean\": %.4f, \"variance\": %.4f, \"stddev\": %.4f",
+                channel->name, channel->min, channel->max, channel->mean, channel->variance, channel->stddev);
+        if (histograms) {
+            fputs(", \"histogram\": [", out);
+            for (int v = 0; v < 256; v++) {
+                fprintf(out, v ? ", %u" : "%u", channel->histogram[v]);
+            }
+            fputc(']', out);
+        }
+        fputs(c + 1 < stats->channelCount ? "},\n" : "}\n", out);
+    }
+
+    fputs("  ]\n}\n", out);
+}
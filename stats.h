@@ -0,0 +1,100 @@
+/**
+ * stats.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring the per-channel statistics of an image: minimum, maximum, mean,
+ * variance, standard deviation and histogram, all gathered in a single pass. The pass
+ * only builds the histograms; every other statistic is derived exactly from them in 256
+ * steps per channel.
+ *
+ * Role in the project:
+ * Quality checks on processed images (exposure, clipping, contrast) without several
+ * passes over the pixels.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "bmp8.h"
+#include "bmp24.h"
+
+/**
+ * t_channel_stats
+ * Statistics of one channel.
+ *
+ * Members:
+ * name (const char*): Channel name ("gray", "red", "green", "blue" or "alpha").
+ * min, max (int): Smallest and largest value (0 and 0 for an empty image).
+ * mean (double): Mean value.
+ * variance (double): Variance over all pixels (population variance).
+ * stddev (double): Standard deviation.
+ * histogram (unsigned int[256]): Number of pixels of each value.
+ */
+typedef struct {
+    const char *name;
+    int min;
+    int max;
+    double mean;
+    double variance;
+    double stddev;
+    unsigned int histogram[256];
+} t_channel_stats;
+
+/**
+ * t_image_stats
+ * Statistics of all channels of an image.
+ *
+ * Members:
+ * width, height (int): Size of the image.
+ * channelCount (int): 1 for 8-bit images, 3 for 24-bit images, 4 for 32-bit images.
+ * channels (t_channel_stats[4]): Statistics of each channel, in RGBA order.
+ */
+typedef struct {
+    int width;
+    int height;
+    int channelCount;
+    t_channel_stats channels[4];
+} t_image_stats;
+
+/**
+ * bmp8_stats
+ * Computes the statistics of an 8-bit image. The histogram cached in the image is used
+ * when it is current.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image.
+ * stats (t_image_stats*): Receives the statistics.
+ *
+ * Returns:
+ * int: 0 on success, -1 if an argument is NULL.
+ */
+int bmp8_stats(t_bmp8 *img, t_image_stats *stats);
+
+/**
+ * bmp24_stats
+ * Computes the statistics of the red, green and blue channels of a 24-bit image (and of
+ * the alpha channel for a 32-bit image) in one parallel pass.
+ *
+ * Parameters:
+ * img (const t_bmp24*): Image.
+ * stats (t_image_stats*): Receives the statistics.
+ *
+ * Returns:
+ * int: 0 on success, -1 if an argument is NULL.
+ */
+int bmp24_stats(const t_bmp24 *img, t_image_stats *stats);
+
+/**
+ * stats_writeJson
+ * Writes the statistics as a JSON object.
+ *
+ * Parameters:
+ * stats (const t_image_stats*): Statistics to write.
+ * histograms (int): Non-zero to include the 256 counts of each channel.
+ * out (FILE*): Destination stream.
+ */
+void stats_writeJson(const t_image_stats *stats, int histograms, FILE *out);
+
+#endif // STATS_H
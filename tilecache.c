@@ -0,0 +1,729 @@
+/**
+ * tilecache.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements the out-of-core tile cache. Slots are taken from one block of the size of
+ * the budget and chained from the most to the least recently used; a miss takes a free
+ * slot or the least recently used one, whose tile is first written to the scratch file
+ * if it was modified. Tiles that were never modified are read from the source file in
+ * runs: a band of TILECACHE_SIZE rows is contiguous in the file, so one read per row
+ * fills a whole run of tiles, and posix_fadvise asks the kernel to fetch the next band
+ * while the current one is processed. The scratch file holds tiles at fixed offsets in
+ * the memory layout, so reading one back is a single pread.
+ *
+ * Role in the project:
+ * Processes images bigger than the available memory where bmp24_loadImage cannot
+ * allocate the pixels.
+ */
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tilecache.h"
+#include "probe.h"
+
+// Size of the rows buffer of tilecache_save
+#define TILECACHE_SAVE_BYTES (8u << 20)
+
+
+/**
+ * tilecache_io
+ * Reads or writes a whole buffer at an offset, retrying short transfers.
+ *
+ * Returns:
+ * int: 1 on success, 0 on error or end of file.
+ */
+static int tilecache_io(int fd, unsigned char *buffer, size_t bytes, off_t offset, int write) {
+    while (bytes > 0) {
+        ssize_t done = write ? pwrite(fd, buffer, bytes, offset) : pread(fd, buffer, bytes, offset);
+        if (done <= 0) return 0;
+        buffer += done;
+        bytes -= (size_t)done;
+        offset += done;
+    }
+    return 1;
+}
+
+
+/**
+ * tilecache_tileBytes
+ * Returns the size of a tile in memory.
+ */
+static size_t tilecache_tileBytes(const t_tile_cache *cache) {
+    return (size_t)TILECACHE_SIZE * TILECACHE_SIZE * cache->pixelSize;
+}
+
+
+/**
+ * tilecache_slot
+ * Returns the pixels of a slot.
+ */
+static unsigned char *tilecache_slot(const t_tile_cache *cache, int slot) {
+    return cache->memory + (size_t)slot * tilecache_tileBytes(cache);
+}
+
+
+/**
+ * tilecache_fileRow
+ * Returns the offset in the file of the first pixel of image row y (top-down).
+ */
+static off_t tilecache_fileRow(const t_tile_cache *cache, int y) {
+    int row = cache->bottomUp ? cache->height - 1 - y : y;
+    return cache->offset + (off_t)row * (off_t)cache->fileStride;
+}
+
+
+/**
+ * tilecache_checkMasks
+ * Returns 1 if a 32-bit BI_BITFIELDS file uses the byte layout blue, green, red, alpha.
+ */
+static int tilecache_checkMasks(int fd) {
+    unsigned char masks[12];
+    if (!tilecache_io(fd, masks, sizeof(masks), BITMAP_MASKS, 0)) return 0;
+    uint32_t red = masks[0] | masks[1] << 8 | masks[2] << 16 | (uint32_t)masks[3] << 24;
+    uint32_t green = masks[4] | masks[5] << 8 | masks[6] << 16 | (uint32_t)masks[7] << 24;
+    uint32_t blue = masks[8] | masks[9] << 8 | masks[10] << 16 | (uint32_t)masks[11] << 24;
+    return red == 0x00FF0000 && green == 0x0000FF00 && blue == 0x000000FF;
+}
+
+
+/**
+ * tilecache_open
+ * Opens an uncompressed 8, 24 or 32-bit BMP file without loading its pixels.
+ *
+ * Parameters:
+ * filename (const char*): Path of the file.
+ * budget (size_t): Memory given to the tile cache in bytes (at least 8 tiles).
+ *
+ * Returns:
+ * t_tile_cache*: Pointer to the cache, or NULL on failure.
+ */
+t_tile_cache *tilecache_open(const char *filename, size_t budget) {
+    t_bmp_probe probe;
+    if (!probe_file(filename, &probe)) {
+        fprintf(stderr, "Error: %s: %s.\n", filename, probe.error);
+        return NULL;
+    }
+    int supported = (probe.depth == 8 || probe.depth == 24 || probe.depth == 32) &&
+                    (probe.compression == BI_RGB || (probe.depth == 32 && probe.compression == BI_BITFIELDS));
+    if (!supported) {
+        fprintf(stderr, "Error: %s: only uncompressed 8, 24 and 32-bit files can be processed out of core.\n", filename);
+        return NULL;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Unable to open file %s.\n", filename);
+        return NULL;
+    }
+    if (probe.compression == BI_BITFIELDS && !tilecache_checkMasks(fd)) {
+        fprintf(stderr, "Error: %s: unsupported channel masks.\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    t_tile_cache *cache = calloc(1, sizeof(t_tile_cache));
+    if (!cache) {
+        fprintf(stderr, "Error: Unable to allocate memory for tile cache.\n");
+        close(fd);
+        return NULL;
+    }
+    cache->source = fd;
+    cache->scratch = -1;
+    cache->width = probe.width;
+    cache->height = probe.height < 0 ? -probe.height : probe.height;
+    cache->bottomUp = probe.height > 0;
+    cache->fileBytes = probe.depth / 8;
+    cache->format = probe.depth == 8 ? VIEW_GRAY8 : VIEW_BGRA32;
+    cache->pixelSize = probe.depth == 8 ? 1 : 4;
+    cache->offset = probe.offset;
+    cache->fileStride = ((size_t)cache->width * cache->fileBytes + 3) / 4 * 4;
+    cache->tilesX = (cache->width + TILECACHE_SIZE - 1) / TILECACHE_SIZE;
+    cache->tilesY = (cache->height + TILECACHE_SIZE - 1) / TILECACHE_SIZE;
+
+    if ((uint64_t)cache->offset + (uint64_t)cache->fileStride * cache->height > probe.fileSize) {
+        fprintf(stderr, "Error: %s: truncated pixel data.\n", filename);
+        tilecache_close(cache);
+        return NULL;
+    }
+
+    size_t capacity = budget / tilecache_tileBytes(cache);
+    if (capacity < 8) {
+        fprintf(stderr, "Error: A tile cache needs at least %zu KB.\n", 8 * tilecache_tileBytes(cache) >> 10);
+        tilecache_close(cache);
+        return NULL;
+    }
+    if (capacity > (size_t)cache->tilesX * cache->tilesY) capacity = (size_t)cache->tilesX * cache->tilesY;
+    if (capacity < 8) capacity = 8;
+    cache->capacity = (int)capacity;
+    cache->readahead = cache->capacity / 4 < 64 ? cache->capacity / 4 : 64;
+    cache->newest = -1;
+    cache->oldest = -1;
+
+    int count = cache->tilesX * cache->tilesY;
+    cache->inScratch = calloc(count, sizeof(unsigned char));
+    cache->slotOf = malloc(count * sizeof(int));
+    cache->memory = malloc(capacity * tilecache_tileBytes(cache));
+    cache->slotTile = malloc(capacity * sizeof(int));
+    cache->slotDirty = calloc(capacity, sizeof(unsigned char));
+    cache->newer = malloc(capacity * sizeof(int));
+    cache->older = malloc(capacity * sizeof(int));
+    if (!cache->inScratch || !cache->slotOf || !cache->memory || !cache->slotTile || !cache->slotDirty ||
+        !cache->newer || !cache->older) {
+        fprintf(stderr, "Error: Unable to allocate memory for tile cache.\n");
+        tilecache_close(cache);
+        return NULL;
+    }
+    for (int t = 0; t < count; t++) cache->slotOf[t] = -1;
+    return cache;
+}
+
+
+/**
+ * tilecache_close
+ * Closes the files of a cache and frees it. Unsaved modifications are lost.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Cache to close (may be NULL).
+ */
+void tilecache_close(t_tile_cache *cache) {
+    if (!cache) return;
+    if (cache->source >= 0) close(cache->source);
+    if (cache->scratch >= 0) close(cache->scratch);
+    free(cache->inScratch);
+    free(cache->slotOf);
+    free(cache->memory);
+    free(cache->slotTile);
+    free(cache->slotDirty);
+    free(cache->newer);
+    free(cache->older);
+    free(cache);
+}
+
+
+/**
+ * tilecache_unlink
+ * Removes a slot from the recency list.
+ */
+static void tilecache_unlink(t_tile_cache *cache, int slot) {
+    int newer = cache->newer[slot];
+    int older = cache->older[slot];
+    if (newer >= 0) cache->older[newer] = older;
+    else cache->newest = older;
+    if (older >= 0) cache->newer[older] = newer;
+    else cache->oldest = newer;
+}
+
+
+/**
+ * tilecache_pushNewest
+ * Puts a slot (not in the list) at the most recently used end.
+ */
+static void tilecache_pushNewest(t_tile_cache *cache, int slot) {
+    cache->newer[slot] = -1;
+    cache->older[slot] = cache->newest;
+    if (cache->newest >= 0) cache->newer[cache->newest] = slot;
+    else cache->oldest = slot;
+    cache->newest = slot;
+}
+
+
+/**
+ * tilecache_openScratch
+ * Creates the scratch file in $TMPDIR (or /tmp). It is unlinked at once, so it
+ * disappears with the process.
+ */
+static int tilecache_openScratch(t_tile_cache *cache) {
+    const char *dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/imgproc-tiles-XXXXXX", dir && *dir ? dir : "/tmp");
+    cache->scratch = mkstemp(path);
+    if (cache->scratch < 0) {
+        fprintf(stderr, "Error: Unable to create a scratch file in %s.\n", dir && *dir ? dir : "/tmp");
+        return 0;
+    }
+    unlink(path);
+    return 1;
+}
+
+
+/**
+ * tilecache_takeSlot
+ * Returns a slot for a new tile, at the most recently used end of the list: a free one,
+ * or the least recently used one after saving its tile if it was modified.
+ *
+ * Returns:
+ * int: The slot, or -1 if the evicted tile could not be saved.
+ */
+static int tilecache_takeSlot(t_tile_cache *cache) {
+    int slot;
+    if (cache->used < cache->capacity) {
+        slot = cache->used++;
+    } else {
+        slot = cache->oldest;
+        int tile = cache->slotTile[slot];
+        if (tile >= 0 && cache->slotDirty[slot]) {
+            size_t bytes = tilecache_tileBytes(cache);
+            if ((cache->scratch < 0 && !tilecache_openScratch(cache)) ||
+                !tilecache_io(cache->scratch, tilecache_slot(cache, slot), bytes, (off_t)tile * (off_t)bytes, 1)) {
+                fprintf(stderr, "Error: Unable to write to the scratch file.\n");
+                cache->failed = 1;
+                return -1;
+            }
+            cache->inScratch[tile] = 1;
+            cache->writes++;
+        }
+        if (tile >= 0) cache->slotOf[tile] = -1;
+        tilecache_unlink(cache, slot);
+    }
+    cache->slotDirty[slot] = 0;
+    cache->slotTile[slot] = -1;
+    tilecache_pushNewest(cache, slot);
+    return slot;
+}
+
+
+/**
+ * tilecache_loadRun
+ * Loads tile (tileX, tileY) from the source file, together with the next tiles of its
+ * band that are neither cached nor in the scratch file (up to readahead tiles), with one
+ * read per image row. When a band is entered, the kernel is asked to read the next one.
+ *
+ * Returns:
+ * int: 1 on success, 0 on error.
+ */
+static int tilecache_loadRun(t_tile_cache *cache, int tileX, int tileY) {
+    int first = tileY * cache->tilesX + tileX;
+    int count = 1;
+    while (count < cache->readahead && tileX + count < cache->tilesX &&
+           cache->slotOf[first + count] < 0 && !cache->inScratch[first + count]) {
+        count++;
+    }
+
+    int x0 = tileX * TILECACHE_SIZE;
+    int y0 = tileY * TILECACHE_SIZE;
+    int span = cache->width - x0 < count * TILECACHE_SIZE ? cache->width - x0 : count * TILECACHE_SIZE;
+    int rows = cache->height - y0 < TILECACHE_SIZE ? cache->height - y0 : TILECACHE_SIZE;
+    unsigned char *line = malloc((size_t)span * cache->fileBytes);
+    if (!line) {
+        fprintf(stderr, "Error: Unable to allocate memory for tile cache.\n");
+        return 0;
+    }
+
+    // Take the slots in reverse order, so the requested tile ends up the most recent
+    int slots[64];
+    for (int i = count - 1; i >= 0; i--) {
+        slots[i] = tilecache_takeSlot(cache);
+        if (slots[i] < 0) {
+            free(line);
+            return 0;
+        }
+        cache->slotTile[slots[i]] = first + i;
+        cache->slotOf[first + i] = slots[i];
+        if (x0 + (i + 1) * TILECACHE_SIZE > cache->width || rows < TILECACHE_SIZE) {
+            memset(tilecache_slot(cache, slots[i]), 0, tilecache_tileBytes(cache));
+        }
+    }
+
+    int ok = 1;
+    size_t tileRow = (size_t)TILECACHE_SIZE * cache->pixelSize;
+    for (int y = 0; ok && y < rows; y++) {
+        ok = tilecache_io(cache->source, line, (size_t)span * cache->fileBytes,
+                          tilecache_fileRow(cache, y0 + y) + (off_t)x0 * cache->fileBytes, 0);
+        for (int i = 0; ok && i < count; i++) {
+            int start = i * TILECACHE_SIZE;
+            int end = start + TILECACHE_SIZE < span ? start + TILECACHE_SIZE : span;
+            unsigned char *dst = tilecache_slot(cache, slots[i]) + (size_t)y * tileRow;
+            const unsigned char *src = line + (size_t)start * cache->fileBytes;
+            if (cache->fileBytes == cache->pixelSize) {
+                memcpy(dst, src, (size_t)(end - start) * cache->pixelSize);
+            } else {
+                for (int x = start; x < end; x++, src += 3, dst += 4) {
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                    dst[3] = 255;
+                }
+            }
+        }
+    }
+    free(line);
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to read the pixels of the source file.\n");
+        cache->failed = 1;
+        for (int i = 0; i < count; i++) {
+            cache->slotOf[first + i] = -1;
+            cache->slotTile[slots[i]] = -1;
+        }
+        return 0;
+    }
+    cache->reads += count;
+
+#ifdef POSIX_FADV_WILLNEED
+    if (tileX == 0 && tileY + 1 < cache->tilesY) {
+        int next = y0 + TILECACHE_SIZE;
+        int last = next + TILECACHE_SIZE < cache->height ? next + TILECACHE_SIZE - 1 : cache->height - 1;
+        off_t start = tilecache_fileRow(cache, cache->bottomUp ? last : next);
+        posix_fadvise(cache->source, start, (off_t)(last - next + 1) * (off_t)cache->fileStride, POSIX_FADV_WILLNEED);
+    }
+#endif
+    return 1;
+}
+
+
+/**
+ * tilecache_tile
+ * Returns the pixels of a tile, loading it if needed. Rows are TILECACHE_SIZE pixels
+ * apart, top row first. The pointer is valid until the next call on the cache.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Cache.
+ * tileX, tileY (int): Position of the tile, in tiles.
+ * modify (int): Non-zero if the caller modifies the pixels.
+ *
+ * Returns:
+ * unsigned char*: Pixels of the tile, or NULL on an I/O error.
+ */
+unsigned char *tilecache_tile(t_tile_cache *cache, int tileX, int tileY, int modify) {
+    if (!cache || tileX < 0 || tileY < 0 || tileX >= cache->tilesX || tileY >= cache->tilesY) return NULL;
+
+    int tile = tileY * cache->tilesX + tileX;
+    int slot = cache->slotOf[tile];
+    if (slot >= 0) {
+        if (cache->newest != slot) {
+            tilecache_unlink(cache, slot);
+            tilecache_pushNewest(cache, slot);
+        }
+    } else if (cache->inScratch[tile]) {
+        size_t bytes = tilecache_tileBytes(cache);
+        slot = tilecache_takeSlot(cache);
+        if (slot < 0) return NULL;
+        if (!tilecache_io(cache->scratch, tilecache_slot(cache, slot), bytes, (off_t)tile * (off_t)bytes, 0)) {
+            fprintf(stderr, "Error: Unable to read from the scratch file.\n");
+            cache->failed = 1;
+            return NULL;
+        }
+        cache->slotTile[slot] = tile;
+        cache->slotOf[tile] = slot;
+        cache->reads++;
+    } else {
+        if (!tilecache_loadRun(cache, tileX, tileY)) return NULL;
+        slot = cache->slotOf[tile];
+    }
+
+    if (modify) cache->slotDirty[slot] = 1;
+    return tilecache_slot(cache, slot);
+}
+
+
+/**
+ * tilecache_begin
+ * Starts a walk over all the tiles of a cache.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Cache to walk.
+ * iter (t_tile_iter*): Receives the position.
+ * modify (int): Non-zero if the tiles are modified through the view.
+ */
+void tilecache_begin(t_tile_cache *cache, t_tile_iter *iter, int modify) {
+    memset(iter, 0, sizeof(*iter));
+    iter->cache = cache;
+    iter->modify = modify;
+}
+
+
+/**
+ * tilecache_next
+ * Moves to the next tile and describes it in iter->view.
+ *
+ * Parameters:
+ * iter (t_tile_iter*): Position started by tilecache_begin.
+ *
+ * Returns:
+ * int: 1 if a tile is available, 0 at the end of the walk or on an I/O error.
+ */
+int tilecache_next(t_tile_iter *iter) {
+    t_tile_cache *cache = iter->cache;
+    if (!cache || iter->next >= cache->tilesX * cache->tilesY) return 0;
+
+    iter->tileX = iter->next % cache->tilesX;
+    iter->tileY = iter->next / cache->tilesX;
+    unsigned char *pixels = tilecache_tile(cache, iter->tileX, iter->tileY, iter->modify);
+    if (!pixels) return 0;
+    iter->next++;
+
+    int x0 = iter->tileX * TILECACHE_SIZE;
+    int y0 = iter->tileY * TILECACHE_SIZE;
+    memset(&iter->view, 0, sizeof(iter->view));
+    iter->view.data = pixels;
+    iter->view.width = cache->width - x0 < TILECACHE_SIZE ? cache->width - x0 : TILECACHE_SIZE;
+    iter->view.height = cache->height - y0 < TILECACHE_SIZE ? cache->height - y0 : TILECACHE_SIZE;
+    iter->view.stride = (ptrdiff_t)TILECACHE_SIZE * cache->pixelSize;
+    iter->view.format = cache->format;
+    return 1;
+}
+
+
+/**
+ * tilecache_copyRect
+ * Copies a rectangle of a tile (coordinates inside the tile) to a buffer.
+ *
+ * Returns:
+ * int: 1 on success, 0 on an I/O error.
+ */
+static int tilecache_copyRect(t_tile_cache *cache, int tileX, int tileY, int x, int y, int width, int height,
+                              unsigned char *dst, size_t dstStride) {
+    const unsigned char *tile = tilecache_tile(cache, tileX, tileY, 0);
+    if (!tile) return 0;
+
+    size_t ps = cache->pixelSize;
+    for (int row = 0; row < height; row++) {
+        memcpy(dst + row * dstStride, tile + ((size_t)(y + row) * TILECACHE_SIZE + x) * ps, width * ps);
+    }
+    return 1;
+}
+
+
+/**
+ * tilecache_replicateColumns
+ * Fills columns [from, to) of rows [top, bottom) of a buffer with column from - 1.
+ */
+static void tilecache_replicateColumns(unsigned char *buffer, size_t stride, int ps, int from, int to,
+                                       int top, int bottom) {
+    for (int y = top; y < bottom; y++) {
+        unsigned char *row = buffer + y * stride;
+        for (int x = from; x < to; x++) memcpy(row + (size_t)x * ps, row + (size_t)(from - 1) * ps, ps);
+    }
+}
+
+
+/**
+ * tilecache_convolve
+ * Applies a square convolution kernel to the whole image, with the border rule of the
+ * in-memory filters: the outer kernelSize / 2 pixels of a gray image are left untouched,
+ * the edges of a color image are clamped. Tiles are processed in place in walk order;
+ * the original pixels their neighbors still need (the last columns of the previous
+ * tile, the last rows of the previous band) are kept aside before each tile is
+ * overwritten.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Image to modify.
+ * kernel (const float*): kernelSize x kernelSize weights, row by row.
+ * kernelSize (int): Odd size of the kernel, at most 2 * TILECACHE_SIZE + 1.
+ *
+ * Returns:
+ * int: 0 on success, -1 on invalid kernel size, allocation failure or I/O error.
+ */
+int tilecache_convolve(t_tile_cache *cache, const float *kernel, int kernelSize) {
+    if (!cache || !kernel) return -1;
+    if (kernelSize < 1 || kernelSize % 2 == 0 || kernelSize > 2 * TILECACHE_SIZE + 1) {
+        fprintf(stderr, "Error: Unsupported kernel size for out-of-core convolution.\n");
+        return -1;
+    }
+
+    int n = kernelSize / 2;
+    int ps = cache->pixelSize;
+    int side = TILECACHE_SIZE + 2 * n;
+    size_t stride = (size_t)side * ps;
+    size_t lineBytes = (size_t)cache->width * ps;
+
+    // halo: tile with its margin; left: original last columns of the previous tile;
+    // above / below: original last rows of the previous / current band
+    unsigned char *halo = malloc(stride * side);
+    unsigned char *left = malloc((size_t)side * n * ps + 1);
+    unsigned char *above = malloc(lineBytes * n + 1);
+    unsigned char *below = malloc(lineBytes * n + 1);
+    if (!halo || !left || !above || !below) {
+        fprintf(stderr, "Error: Unable to allocate memory for out-of-core convolution.\n");
+        free(halo);
+        free(left);
+        free(above);
+        free(below);
+        return -1;
+    }
+
+    int ok = 1;
+    for (int ty = 0; ok && ty < cache->tilesY; ty++) {
+        for (int tx = 0; ok && tx < cache->tilesX; tx++) {
+            int x0 = tx * TILECACHE_SIZE;
+            int y0 = ty * TILECACHE_SIZE;
+            int w = cache->width - x0 < TILECACHE_SIZE ? cache->width - x0 : TILECACHE_SIZE;
+            int h = cache->height - y0 < TILECACHE_SIZE ? cache->height - y0 : TILECACHE_SIZE;
+            int right = cache->width - x0 - w < n ? cache->width - x0 - w : n;
+            int bottom = cache->height - y0 - h < n ? cache->height - y0 - h : n;
+            int haloWidth = w + 2 * n;
+            int haloHeight = h + 2 * n;
+
+            // Tile and right margin, then the bottom margin: none of them processed yet
+            unsigned char *origin = halo + n * stride + (size_t)n * ps;
+            ok = tilecache_copyRect(cache, tx, ty, 0, 0, w, h, origin, stride);
+            if (ok && right > 0) ok = tilecache_copyRect(cache, tx + 1, ty, 0, 0, right, h, origin + (size_t)w * ps, stride);
+            if (ok && bottom > 0) {
+                ok = tilecache_copyRect(cache, tx, ty + 1, 0, 0, w, bottom, origin + h * stride, stride);
+                if (ok && right > 0) {
+                    ok = tilecache_copyRect(cache, tx + 1, ty + 1, 0, 0, right, bottom,
+                                            origin + h * stride + (size_t)w * ps, stride);
+                }
+            }
+            if (!ok) break;
+            tilecache_replicateColumns(halo, stride, ps, n + w + right, haloWidth, n, n + h + bottom);
+            for (int y = n + h + bottom; y < haloHeight; y++) {
+                memcpy(halo + y * stride + (size_t)n * ps, halo + (n + h + bottom - 1) * stride + (size_t)n * ps,
+                       (size_t)(w + n) * ps);
+            }
+
+            // Top margin from the saved rows of the previous band (or the first row)
+            for (int y = 0; y < n; y++) {
+                unsigned char *dst = halo + y * stride + (size_t)n * ps;
+                if (ty == 0) {
+                    memcpy(dst, halo + n * stride + (size_t)n * ps, (size_t)(w + n) * ps);
+                    continue;
+                }
+                memcpy(dst, above + y * lineBytes + (size_t)x0 * ps, (size_t)(w + right) * ps);
+                tilecache_replicateColumns(halo, stride, ps, n + w + right, haloWidth, y, y + 1);
+            }
+
+            // Left margin from the saved columns of the previous tile (or the first column)
+            for (int y = 0; y < haloHeight; y++) {
+                if (tx > 0) memcpy(halo + y * stride, left + (size_t)y * n * ps, (size_t)n * ps);
+            }
+            if (tx == 0) {
+                for (int y = 0; y < haloHeight; y++) {
+                    unsigned char *row = halo + y * stride;
+                    for (int x = 0; x < n; x++) memcpy(row + (size_t)x * ps, row + (size_t)n * ps, ps);
+                }
+            }
+
+            // Keep the originals the next tile and the next band need
+            for (int y = 0; y < haloHeight; y++) {
+                memcpy(left + (size_t)y * n * ps, halo + y * stride + (size_t)w * ps, (size_t)n * ps);
+            }
+            if (h >= n) {
+                for (int y = 0; y < n; y++) {
+                    memcpy(below + y * lineBytes + (size_t)x0 * ps, halo + (h + y) * stride + (size_t)n * ps,
+                           (size_t)w * ps);
+                }
+            }
+
+            t_view view = {halo, haloWidth, haloHeight, (ptrdiff_t)stride, cache->format, NULL, 0, 1};
+            ok = view_convolve(&view, kernel, kernelSize);
+
+            // Gray images keep their outer n pixels, like bmp8_applyFilter
+            int keep = cache->format == VIEW_GRAY8 ? n : 0;
+            int first = x0 < keep ? keep - x0 : 0;
+            int last = cache->width - keep - x0 < w ? cache->width - keep - x0 : w;
+            unsigned char *tile = ok ? tilecache_tile(cache, tx, ty, 1) : NULL;
+            ok = tile != NULL;
+            for (int y = 0; ok && y < h && first < last; y++) {
+                if (y0 + y < keep || y0 + y >= cache->height - keep) continue;
+                memcpy(tile + ((size_t)y * TILECACHE_SIZE + first) * ps, origin + y * stride + (size_t)first * ps,
+                       (size_t)(last - first) * ps);
+            }
+        }
+
+        unsigned char *swap = above;
+        above = below;
+        below = swap;
+    }
+
+    free(halo);
+    free(left);
+    free(above);
+    free(below);
+    return ok ? 0 : -1;
+}
+
+
+/**
+ * tilecache_save
+ * Writes the image to a new BMP file with the headers of the source file.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Image to save.
+ * filename (const char*): Destination path (must not be the source file).
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int tilecache_save(t_tile_cache *cache, const char *filename) {
+    if (!cache || !filename || cache->failed) return -1;
+
+    // Writing over the source would destroy tiles that are still to be read
+    struct stat source;
+    struct stat target;
+    if (fstat(cache->source, &source) == 0 && stat(filename, &target) == 0 &&
+        source.st_dev == target.st_dev && source.st_ino == target.st_ino) {
+        fprintf(stderr, "Error: %s is the source image; choose another output file.\n", filename);
+        return -1;
+    }
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Unable to open file %s for writing.\n", filename);
+        return -1;
+    }
+
+    // Headers and palette as they are in the source file
+    unsigned char *header = malloc(cache->offset);
+    int ok = header && tilecache_io(cache->source, header, cache->offset, 0, 0) &&
+             tilecache_io(fd, header, cache->offset, 0, 1);
+    free(header);
+
+    // Groups of tiles of one band, written one row at a time
+    size_t tileLine = (size_t)TILECACHE_SIZE * cache->fileBytes;
+    int group = (int)(TILECACHE_SAVE_BYTES / (tileLine * TILECACHE_SIZE));
+    if (group < 1) group = 1;
+    unsigned char *rows = calloc((size_t)TILECACHE_SIZE, (size_t)group * tileLine + 4);
+    ok = ok && rows;
+
+    for (int ty = 0; ok && ty < cache->tilesY; ty++) {
+        int y0 = ty * TILECACHE_SIZE;
+        int h = cache->height - y0 < TILECACHE_SIZE ? cache->height - y0 : TILECACHE_SIZE;
+        for (int tx = 0; ok && tx < cache->tilesX; tx += group) {
+            int count = cache->tilesX - tx < group ? cache->tilesX - tx : group;
+            int x0 = tx * TILECACHE_SIZE;
+            int span = cache->width - x0 < count * TILECACHE_SIZE ? cache->width - x0 : count * TILECACHE_SIZE;
+            size_t bytes = (size_t)span * cache->fileBytes;
+            size_t rowBytes = (size_t)group * tileLine + 4;
+            // The last group carries the row padding (zeros)
+            if (tx + count == cache->tilesX) {
+                bytes = cache->fileStride - (size_t)x0 * cache->fileBytes;
+                for (int y = 0; y < h; y++) memset(rows + y * rowBytes + (size_t)span * cache->fileBytes, 0, 4);
+            }
+
+            for (int i = 0; ok && i < count; i++) {
+                const unsigned char *tile = tilecache_tile(cache, tx + i, ty, 0);
+                ok = tile != NULL;
+                int start = i * TILECACHE_SIZE;
+                int end = start + TILECACHE_SIZE < span ? start + TILECACHE_SIZE : span;
+                for (int y = 0; ok && y < h; y++) {
+                    const unsigned char *src = tile + (size_t)y * TILECACHE_SIZE * cache->pixelSize;
+                    unsigned char *dst = rows + y * rowBytes + (size_t)start * cache->fileBytes;
+                    if (cache->fileBytes == cache->pixelSize) {
+                        memcpy(dst, src, (size_t)(end - start) * cache->pixelSize);
+                    } else {
+                        for (int x = start; x < end; x++, src += 4, dst += 3) {
+                            dst[0] = src[0];
+                            dst[1] = src[1];
+                            dst[2] = src[2];
+                        }
+                    }
+                }
+            }
+            for (int y = 0; ok && y < h; y++) {
+                ok = tilecache_io(fd, rows + y * rowBytes, bytes,
+                                  tilecache_fileRow(cache, y0 + y) + (off_t)x0 * cache->fileBytes, 1);
+            }
+        }
+    }
+
+    free(rows);
+    if (close(fd) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Error: Unable to write file %s.\n", filename);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/**
+ * tilecache.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring an out-of-core image backend for BMP files too large for memory.
+ * The image stays in its file; square tiles are loaded on demand into a cache of fixed
+ * size and evicted in least-recently-used order. Modified tiles that are evicted go to
+ * an anonymous scratch file, so the source file is never written. Tiles are visited band
+ * by band, left to right, and a cache miss on the source file loads a run of the
+ * following tiles of the band with one read per image row while the kernel is asked to
+ * read the next band ahead.
+ *
+ * Each tile is exposed as a t_view, so the point operations of view.h run on it through
+ * the tile iterator; convolutions gather each tile with its halo.
+ *
+ * Role in the project:
+ * Processes images bigger than the available memory (for instance a 20 GB scan with a
+ * 512 MB budget) where bmp24_loadImage cannot allocate the pixels.
+ */
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <sys/types.h>
+#include "view.h"
+
+// Side of a cached tile in pixels (large enough for reads to be efficient)
+#define TILECACHE_SIZE 256
+
+/**
+ * t_tile_cache
+ * Structure representing an image backed by its file and a cache of tiles.
+ *
+ * Members:
+ * width, height (int): Image size in pixels.
+ * format (t_view_format): Layout of the tiles in memory (VIEW_GRAY8 for 8-bit files,
+ *     VIEW_BGRA32 for 24 and 32-bit files).
+ * pixelSize (int): Bytes per pixel in memory (1 or 4).
+ * fileBytes (int): Bytes per pixel in the file (1, 3 or 4).
+ * bottomUp (int): Non-zero if the first row of the file is the bottom of the image.
+ * tilesX, tilesY (int): Number of tile columns and rows.
+ * source (int): Descriptor of the BMP file, opened read-only.
+ * offset (off_t): Offset of the pixel data in the file.
+ * fileStride (size_t): Bytes per row in the file, padding included.
+ * scratch (int): Descriptor of the scratch file, or -1 until a modified tile is evicted.
+ * inScratch (unsigned char*): Per tile, non-zero once its current pixels are in the scratch file.
+ * slotOf (int*): Per tile, its slot in the cache, or -1.
+ * capacity (int): Number of slots.
+ * used (int): Number of slots holding a tile.
+ * memory (unsigned char*): Pixels of the slots, TILECACHE_SIZE^2 * pixelSize bytes each.
+ * slotTile (int*): Tile held by each slot.
+ * slotDirty (unsigned char*): Per slot, non-zero if the tile was modified since it was loaded.
+ * newer, older (int*): Per slot, neighbors in the recency list (-1 at the ends).
+ * newest, oldest (int): Ends of the recency list.
+ * readahead (int): Maximum number of tiles loaded by one miss on the source file.
+ * failed (int): Non-zero after an I/O error.
+ * reads (unsigned long): Tiles loaded (source or scratch).
+ * writes (unsigned long): Tiles written to the scratch file.
+ */
+typedef struct {
+    int width;
+    int height;
+    t_view_format format;
+    int pixelSize;
+    int fileBytes;
+    int bottomUp;
+    int tilesX;
+    int tilesY;
+    int source;
+    off_t offset;
+    size_t fileStride;
+    int scratch;
+    unsigned char *inScratch;
+    int *slotOf;
+    int capacity;
+    int used;
+    unsigned char *memory;
+    int *slotTile;
+    unsigned char *slotDirty;
+    int *newer;
+    int *older;
+    int newest;
+    int oldest;
+    int readahead;
+    int failed;
+    unsigned long reads;
+    unsigned long writes;
+} t_tile_cache;
+
+/**
+ * t_tile_iter
+ * Position of a walk over all the tiles of a cache, band by band, left to right.
+ *
+ * Members:
+ * cache (t_tile_cache*): Cache being walked.
+ * modify (int): Non-zero if the tiles are modified through the view.
+ * next (int): Index of the next tile.
+ * tileX, tileY (int): Position of the current tile, in tiles.
+ * view (t_view): Pixels of the current tile, cropped to the image. Valid until the next
+ *     call to tilecache_next or tilecache_tile.
+ */
+typedef struct {
+    t_tile_cache *cache;
+    int modify;
+    int next;
+    int tileX;
+    int tileY;
+    t_view view;
+} t_tile_iter;
+
+/**
+ * tilecache_open
+ * Opens an uncompressed 8, 24 or 32-bit BMP file without loading its pixels.
+ *
+ * Parameters:
+ * filename (const char*): Path of the file.
+ * budget (size_t): Memory given to the tile cache in bytes (at least 8 tiles).
+ *
+ * Returns:
+ * t_tile_cache*: Pointer to the cache, or NULL on failure.
+ */
+t_tile_cache * tilecache_open(const char *filename, size_t budget);
+
+/**
+ * tilecache_close
+ * Closes the files of a cache and frees it. Unsaved modifications are lost.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Cache to close (may be NULL).
+ */
+void tilecache_close(t_tile_cache *cache);
+
+/**
+ * tilecache_tile
+ * Returns the pixels of a tile, loading it if needed. Rows are TILECACHE_SIZE pixels
+ * apart, top row first. The pointer is valid until the next call on the cache.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Cache.
+ * tileX, tileY (int): Position of the tile, in tiles.
+ * modify (int): Non-zero if the caller modifies the pixels.
+ *
+ * Returns:
+ * unsigned char*: Pixels of the tile, or NULL on an I/O error.
+ */
+unsigned char * tilecache_tile(t_tile_cache *cache, int tileX, int tileY, int modify);
+
+/**
+ * tilecache_begin
+ * Starts a walk over all the tiles of a cache.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Cache to walk.
+ * iter (t_tile_iter*): Receives the position.
+ * modify (int): Non-zero if the tiles are modified through the view.
+ */
+void tilecache_begin(t_tile_cache *cache, t_tile_iter *iter, int modify);
+
+/**
+ * tilecache_next
+ * Moves to the next tile and describes it in iter->view.
+ *
+ * Parameters:
+ * iter (t_tile_iter*): Position started by tilecache_begin.
+ *
+ * Returns:
+ * int: 1 if a tile is available, 0 at the end of the walk or on an I/O error.
+ */
+int tilecache_next(t_tile_iter *iter);
+
+/**
+ * tilecache_convolve
+ * Applies a square convolution kernel to the whole image, with the border rule of the
+ * in-memory filters: the outer kernelSize / 2 pixels of a gray image are left untouched,
+ * the edges of a color image are clamped. Tiles are processed in place in walk order;
+ * the original pixels their neighbors still need (the last columns of the previous
+ * tile, the last rows of the previous band) are kept aside before each tile is
+ * overwritten.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Image to modify.
+ * kernel (const float*): kernelSize x kernelSize weights, row by row.
+ * kernelSize (int): Odd size of the kernel, at most 2 * TILECACHE_SIZE + 1.
+ *
+ * Returns:
+ * int: 0 on success, -1 on invalid kernel size, allocation failure or I/O error.
+ */
+int tilecache_convolve(t_tile_cache *cache, const float *kernel, int kernelSize);
+
+/**
+ * tilecache_save
+ * Writes the image to a new BMP file with the headers of the source file.
+ *
+ * Parameters:
+ * cache (t_tile_cache*): Image to save.
+ * filename (const char*): Destination path (must not be the source file).
+ *
+ * Returns:
+ * int: 0 on success, -1 on failure.
+ */
+int tilecache_save(t_tile_cache *cache, const char *filename);
+
+#endif // TILECACHE_H
@@ -13,6 +13,13 @@
 #include "utils.h"
 #include "equalize8.h"
 #include "equalize24.h"
+#include "pipeline.h"
+#include "pyramid.h"
+#include "resize.h"
+#include "luma.h"
+#include "kernels.h"
+#include "morph.h"
+#include "histogram.h"
 
 /**
  * cap
@@ -100,38 +107,7 @@ void free_kernel(float** kernel) {
  * float**: Pointer to the initialized kernel matrix.
  */
 float** init_kernel() {
-    float box_blur[3][3] = {
-        {1.0/9, 1.0/9, 1.0/9},
-        {1.0/9, 1.0/9, 1.0/9},
-        {1.0/9, 1.0/9, 1.0/9}
-    };
-
-    float gaussian_blur[3][3] = {
-        {1.0/16, 2.0/16, 1.0/16},
-        {2.0/16, 4.0/16, 2.0/16},
-        {1.0/16, 2.0/16, 1.0/16}
-    };
-
-    float outline[3][3] = {
-        {-1, -1, -1},
-        {-1,  8, -1},
-        {-1, -1, -1}
-    };
-
-    float emboss[3][3] = {
-        {-2, -1,  0},
-        {-1,  1,  1},
-        { 0,  1,  2}
-    };
-
-    float sharpen[3][3] = {
-        { 0, -1,  0},
-        {-1,  5, -1},
-        { 0, -1,  0}
-    };
-
     int choice;
-    float** output = NULL;
 
     while (1) {
         printf("\nSelect a filter:\n");
@@ -148,30 +124,19 @@ float** init_kernel() {
             continue;
         }
 
-        switch(choice) {
-            case 1:
-                output = create_kernel(box_blur);
-            break;
-            case 2:
-                output = create_kernel(gaussian_blur);
-            break;
-            case 3:
-                output = create_kernel(outline);
-            break;
-            case 4:
-                output = create_kernel(emboss);
-            break;
-            case 5:
-                output = create_kernel(sharpen);
-            break;
-            default:
-                printf("Invalid choice. Please select a number between 1-5.\n");
+        // The choices follow the order of the presets
+        const t_kernel_preset *preset = kernel_preset(choice - 1);
+        if (!preset) {
+            printf("Invalid choice. Please select a number between 1-5.\n");
             continue;
         }
-        break;
-    }
 
-    return output;
+        float weights[9];
+        float data[3][3];
+        kernel_presetWeights(preset, weights);
+        memcpy(data, weights, sizeof(data));
+        return create_kernel(data);
+    }
 }
 
 
@@ -213,6 +178,8 @@ void main_menu() {
  */
 void menu_bmp8() {
     t_bmp8* img = NULL;
+    t_pipeline* pipeline = pipeline_create();
+    int deferred = 0;
     char filename[256];
     int choice;
 
@@ -222,7 +189,8 @@ void menu_bmp8() {
         printf("2. Save image\n");
         printf("3. Apply image processing\n");
         printf("4. Show image info\n");
-        printf("5. Return to main menu\n");
+        printf("5. Toggle deferred processing (currently %s)\n", deferred ? "on" : "off");
+        printf("6. Return to main menu\n");
         printf("Enter choice: ");
 
         if (scanf("%d", &choice) != 1) {
@@ -239,6 +207,7 @@ void menu_bmp8() {
                 filename[strcspn(filename, "\n")] = 0;
 
                 if (img) bmp8_free(img);
+                pipeline_clear(pipeline);
                 img = bmp8_loadImage(filename);
                 if (img) {
                     printf("Image loaded successfully!\n");
@@ -257,8 +226,15 @@ void menu_bmp8() {
                 fgets(filename, sizeof(filename), stdin);
                 filename[strcspn(filename, "\n")] = 0;
 
-                bmp8_saveImage(filename, img);
-                printf("Image saved successfully!\n");
+                pipeline_execute8(pipeline, img);
+                int saved = bmp8_saveImageIncremental(filename, img);
+                if (saved < 0) {
+                    printf("Failed to save image.\n");
+                } else if (saved) {
+                    printf("Image saved successfully (modified rows updated in place)!\n");
+                } else {
+                    printf("Image saved successfully!\n");
+                }
                 break;
 
             case 3:
@@ -274,6 +250,12 @@ void menu_bmp8() {
                     printf("3. Apply threshold\n");
                     printf("4. Convert to negative\n");
                     printf("5. Equalize histogram\n");
+                    printf("6. Save image pyramid\n");
+                    printf("7. Resize\n");
+                    printf("8. Morphology (erode, dilate, open, close, gradient)\n");
+                    printf("9. Automatic threshold (Otsu)\n");
+                    printf("10. Auto-levels\n");
+                    printf("11. Percentile contrast stretch\n");
                     printf("Enter processing choice: ");
 
                     if (scanf("%d", &procChoice) != 1) {
@@ -286,6 +268,12 @@ void menu_bmp8() {
                     switch (procChoice) {
                         case 1: {
                             float **kernel = init_kernel();
+                            if (deferred) {
+                                pipeline_addConvolution(pipeline, kernel, 3);
+                                free_kernel(kernel);
+                                printf("Filter queued.\n");
+                                break;
+                            }
                             bmp8_applyFilter(img, kernel);
                             printf("Filter applied successfully!\n");
                             break;
@@ -299,6 +287,11 @@ void menu_bmp8() {
                                 break;
                             }
                             getchar();
+                            if (deferred) {
+                                pipeline_addBrightness(pipeline, brightness);
+                                printf("Brightness adjustment queued.\n");
+                                break;
+                            }
                             bmp8_brightness(img, brightness);
                             printf("Brightness adjusted successfully!\n");
                             break;
@@ -312,18 +305,122 @@ void menu_bmp8() {
                                 break;
                             }
                             getchar();
+                            if (deferred) {
+                                pipeline_addThreshold(pipeline, threshold);
+                                printf("Threshold queued.\n");
+                                break;
+                            }
                             bmp8_threshold(img, threshold);
                             printf("Threshold applied successfully!\n");
                             break;
                         }
                         case 4:
+                            if (deferred) {
+                                pipeline_addNegative(pipeline);
+                                printf("Negative conversion queued.\n");
+                                break;
+                            }
                             bmp8_negative(img);
                             printf("Negative conversion applied successfully!\n");
                             break;
                         case 5:
+                            // Equalization needs the histogram of the processed image
+                            pipeline_execute8(pipeline, img);
                             bmp8_equalize(img);
                             printf("Histogram equalization applied.\n");
                             break;
+                        case 6: {
+                            pipeline_execute8(pipeline, img);
+                            printf("Enter output prefix (levels are saved as <prefix>_<n>.bmp): ");
+                            fgets(filename, sizeof(filename), stdin);
+                            filename[strcspn(filename, "\n")] = 0;
+
+                            t_pyramid8 *pyramid = pyramid_build8(img, 16, PYRAMID_BOX);
+                            if (pyramid) {
+                                if (pyramid_save8(pyramid, filename) == 0) {
+                                    printf("%d pyramid levels saved.\n", pyramid->count);
+                                } else {
+                                    printf("Failed to save the pyramid.\n");
+                                }
+                                pyramid_free8(pyramid);
+                            }
+                            break;
+                        }
+                        case 7: {
+                            int newWidth, newHeight, filter;
+                            printf("Enter new width and height: ");
+                            if (scanf("%d %d", &newWidth, &newHeight) != 2) {
+                                printf("Invalid input!\n");
+                                while (getchar() != '\n');
+                                break;
+                            }
+                            printf("Filter (1. Bilinear, 2. Bicubic, 3. Lanczos): ");
+                            if (scanf("%d", &filter) != 1 || filter < 1 || filter > 3) {
+                                printf("Invalid input!\n");
+                                while (getchar() != '\n');
+                                break;
+                            }
+                            getchar();
+
+                            pipeline_execute8(pipeline, img);
+                            t_bmp8 *resized = bmp8_resize(img, newWidth, newHeight, (t_resize_filter)(filter - 1));
+                            if (resized) {
+                                bmp8_free(img);
+                                img = resized;
+                                printf("Image resized successfully!\n");
+                            }
+                            break;
+                        }
+                        case 8: {
+                            int op, width, height;
+                            printf("Operation (1. Erode, 2. Dilate, 3. Open, 4. Close, 5. Gradient): ");
+                            if (scanf("%d", &op) != 1 || op < 1 || op > 5) {
+                                printf("Invalid input!\n");
+                                while (getchar() != '\n');
+                                break;
+                            }
+                            printf("Enter element width and height: ");
+                            if (scanf("%d %d", &width, &height) != 2 || width < 1 || height < 1) {
+                                printf("Invalid input!\n");
+                                while (getchar() != '\n');
+                                break;
+                            }
+                            getchar();
+
+                            pipeline_execute8(pipeline, img);
+                            if (bmp8_morphology(img, (t_morph_op)(op - 1), width, height) == 0) {
+                                printf("Morphological operation applied successfully!\n");
+                            }
+                            break;
+                        }
+                        case 9: {
+                            // The threshold depends on the histogram of the processed image
+                            pipeline_execute8(pipeline, img);
+                            int threshold = bmp8_otsuThreshold(img);
+                            bmp8_threshold(img, threshold);
+                            printf("Threshold %d applied successfully!\n", threshold);
+                            break;
+                        }
+                        case 10:
+                            pipeline_execute8(pipeline, img);
+                            bmp8_autoLevels(img);
+                            printf("Auto-levels applied successfully!\n");
+                            break;
+                        case 11: {
+                            double low, high;
+                            printf("Enter low and high percentiles (e.g. 1 99): ");
+                            if (scanf("%lf %lf", &low, &high) != 2 || low < 0 || high > 100 || low >= high) {
+                                printf("Invalid input!\n");
+                                while (getchar() != '\n');
+                                break;
+                            }
+                            getchar();
+
+                            pipeline_execute8(pipeline, img);
+                            bmp8_percentileStretch(img, low, high);
+                            printf("Contrast stretched successfully!\n");
+                            break;
+                        }
                         default:
                             printf("Invalid processing choice!\n");
                     }
@@ -333,16 +430,24 @@ void menu_bmp8() {
             case 4:
                 if (img) {
                     bmp8_printInfo(img);
+                    if (deferred) pipeline_print(pipeline);
                 } else {
                     printf("No image loaded!\n");
                 }
                 break;
 
             case 5:
+                deferred = !deferred;
+                if (!deferred && img) pipeline_execute8(pipeline, img);
+                printf("Deferred processing %s.\n", deferred ? "enabled, operations run on save" : "disabled");
+                break;
+
+            case 6:
                 if (img) {
                     bmp8_free(img);
                     img = NULL;
                 }
+                pipeline_free(pipeline);
                 return;
 
             default:
@@ -358,6 +463,8 @@ void menu_bmp8() {
  */
 void menu_bmp24() {
     t_bmp24* img = NULL;
+    t_pipeline* pipeline = pipeline_create();
+    int deferred = 0;
     char filename[256];
     int choice;
 
@@ -367,7 +474,8 @@ void menu_bmp24() {
         printf("2. Save image\n");
         printf("3. Apply image processing\n");
         printf("4. Show image info\n");
-        printf("5. Return to main menu\n");
+        printf("5. Toggle deferred processing (currently %s)\n", deferred ? "on" : "off");
+        printf("6. Return to main menu\n");
         printf("Enter choice: ");
 
         if (scanf("%d", &choice) != 1) {
@@ -384,6 +492,7 @@ void menu_bmp24() {
                 filename[strcspn(filename, "\n")] = 0;
 
                 if (img) bmp24_free(img);
+                pipeline_clear(pipeline);
                 img = bmp24_loadImage(filename);
                 if (img) {
                     printf("Image loaded successfully!\n");
@@ -402,8 +511,15 @@ void menu_bmp24() {
                 fgets(filename, sizeof(filename), stdin);
                 filename[strcspn(filename, "\n")] = 0;
 
-                bmp24_saveImage(img, filename);
-                printf("Image saved successfully!\n");
+                pipeline_execute24(pipeline, img);
+                int saved = bmp24_saveImageIncremental(img, filename);
+                if (saved < 0) {
+                    printf("Failed to save image.\n");
+                } else if (saved) {
+                    printf("Image saved successfully (modified rows updated in place)!\n");
+                } else {
+                    printf("Image saved successfully!\n");
+                }
                 break;
 
             case 3:
@@ -419,6 +535,9 @@ void menu_bmp24() {
                     printf("3. Convert to negative\n");
                     printf("4. Convert to grayscale\n");
                     printf("5. Equalize histogram\n");
+                    printf("6. Save image pyramid\n");
+                    printf("7. Resize\n");
+                    printf("8. Save as 8-bit grayscale\n");
                     printf("Enter processing choice: ");
 
                     if (scanf("%d", &processingChoice) != 1) {
@@ -430,7 +549,14 @@ void menu_bmp24() {
 
                     switch (processingChoice) {
                         case 1:
-                            bmp24_apply_filter(img, 3);
+                            if (deferred) {
+                                float **kernel = init_kernel();
+                                pipeline_addConvolution(pipeline, kernel, 3);
+                                free_kernel(kernel);
+                                printf("Filter queued.\n");
+                                break;
+                            }
+                            bmp24_apply_filter(img);
                             printf("Filter applied successfully!\n");
                             break;
                         case 2: {
@@ -442,22 +568,103 @@ void menu_bmp24() {
                                 break;
                             }
                             getchar();
+                            if (deferred) {
+                                pipeline_addBrightness(pipeline, brightness);
+                                printf("Brightness adjustment queued.\n");
+                                break;
+                            }
                             bmp24_brightness(img, brightness);
                             printf("Brightness adjusted successfully!\n");
                             break;
                         }
                         case 3:
+                            if (deferred) {
+                                pipeline_addNegative(pipeline);
+                                printf("Negative conversion queued.\n");
+                                break;
+                            }
                             bmp24_negative(img);
                             printf("Negative conversion applied successfully!\n");
                             break;
                         case 4:
+                            if (deferred) {
+                                pipeline_addGrayscale(pipeline);
+                                printf("Grayscale conversion queued.\n");
+                                break;
+                            }
                             bmp24_grayscale(img);
                             printf("Grayscale conversion applied successfully!\n");
                             break;
                         case 5:
+                            // Equalization needs the histogram of the processed image
+                            pipeline_execute24(pipeline, img);
                             bmp24_equalize(img);
                             printf("Histogram equalization applied successfully!\n");
                             break;
+                        case 6: {
+                            pipeline_execute24(pipeline, img);
+                            printf("Enter output prefix (levels are saved as <prefix>_<n>.bmp): ");
+                            fgets(filename, sizeof(filename), stdin);
+                            filename[strcspn(filename, "\n")] = 0;
+
+                            t_pyramid24 *pyramid = pyramid_build24(img, 16, PYRAMID_BOX);
+                            if (pyramid) {
+                                if (pyramid_save24(pyramid, filename) == 0) {
+                                    printf("%d pyramid levels saved.\n", pyramid->count);
+                                } else {
+                                    printf("Failed to save the pyramid.\n");
+                                }
+                                pyramid_free24(pyramid);
+                            }
+                            break;
+                        }
+                        case 7: {
+                            int newWidth, newHeight, filter;
+                            printf("Enter new width and height: ");
+                            if (scanf("%d %d", &newWidth, &newHeight) != 2) {
+                                printf("Invalid input!\n");
+                                while (getchar() != '\n');
+                                break;
+                            }
+                            printf("Filter (1. Bilinear, 2. Bicubic, 3. Lanczos): ");
+                            if (scanf("%d", &filter) != 1 || filter < 1 || filter > 3) {
+                                printf("Invalid input!\n");
+                                while (getchar() != '\n');
+                                break;
+                            }
+                            getchar();
+
+                            pipeline_execute24(pipeline, img);
+                            t_bmp24 *resized = bmp24_resize(img, newWidth, newHeight, (t_resize_filter)(filter - 1));
+                            if (resized) {
+                                bmp24_free(img);
+                                img = resized;
+                                printf("Image resized successfully!\n");
+                            }
+                            break;
+                        }
+                        case 8: {
+                            int standard;
+                            printf("Luma weights (1. BT.601, 2. BT.709): ");
+                            if (scanf("%d", &standard) != 1 || standard < 1 || standard > 2) {
+                                printf("Invalid input!\n");
+                                while (getchar() != '\n');
+                                break;
+                            }
+                            getchar();
+                            printf("Enter output filename: ");
+                            fgets(filename, sizeof(filename), stdin);
+                            filename[strcspn(filename, "\n")] = 0;
+
+                            pipeline_execute24(pipeline, img);
+                            t_bmp8 *gray = bmp24_toBmp8(img, (t_luma_standard)(standard - 1));
+                            if (gray) {
+                                bmp8_saveImage(filename, gray);
+                                bmp8_free(gray);
+                                printf("Grayscale image saved successfully!\n");
+                            }
+                            break;
+                        }
                         default:
                             printf("Invalid processing choice!\n");
                     }
@@ -467,16 +674,24 @@ void menu_bmp24() {
             case 4:
                 if (img) {
                     bmp24_printInfo(img);
+                    if (deferred) pipeline_print(pipeline);
                 } else {
                     printf("No image loaded!\n");
                 }
                 break;
 
             case 5:
+                deferred = !deferred;
+                if (!deferred && img) pipeline_execute24(pipeline, img);
+                printf("Deferred processing %s.\n", deferred ? "enabled, operations run on save" : "disabled");
+                break;
+
+            case 6:
                 if (img) {
                     bmp24_free(img);
                     img = NULL;
                 }
+                pipeline_free(pipeline);
                 return;
 
             default:
@@ -19,6 +19,12 @@
 #include <stdio.h>
 #include <math.h>
 
+// BMP compression methods (info header field at offset 0x1E)
+#define BI_RGB 0
+#define BI_RLE8 1
+#define BI_RLE4 2
+#define BI_BITFIELDS 3
+
 /**
  * cap
  * Caps the sum of number1 and number2 to not exceed the given ceiling.
@@ -0,0 +1,485 @@
+/**
+ * view.c
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Implements image views and the operations working on them. Every operation walks the
+ * rows of the view through its stride and processes each row with a row function (SSE2
+ * when available, chosen by kernel_select for convolutions), so a crop costs no more
+ * than the pixels it contains. Operations flag the rows they modify in the tracker of
+ * the image for incremental saves.
+ *
+ * Role in the project:
+ * Lets the processing operations run on a region of interest (a crop, a text box...)
+ * while touching only the pixels inside it.
+ */
+
+
+#include "view.h"
+#include "kernels.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * view_pixelSize
+ * Bytes per pixel of a format.
+ */
+static int view_pixelSize(t_view_format format) {
+    return format == VIEW_BGRA32 ? (int)sizeof(t_pixel) : 1;
+}
+
+
+/**
+ * view_touch
+ * Flags the rows of a view as modified in the dirty tracker of its image, so the
+ * incremental saves rewrite them. Does nothing for views without a tracker.
+ *
+ * Parameters:
+ * view (const t_view*): View whose pixels were written.
+ */
+void view_touch(const t_view *view) {
+    if (!view->dirty || view->height <= 0) return;
+    int last = view->dirtyRow + (view->height - 1) * view->dirtyStep;
+    dirty_mark(view->dirty, view->dirtyStep > 0 ? view->dirtyRow : last, view->height);
+}
+
+
+/**
+ * bmp8_view
+ * Describes a whole 8-bit image. Rows are seen top-down, the padding is skipped.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image.
+ *
+ * Returns:
+ * t_view: View of every pixel of the image.
+ */
+t_view bmp8_view(t_bmp8 *img) {
+    // Stored row height - 1 is the top of the image
+    ptrdiff_t rowSize = BMP8_ROW_SIZE(img->width);
+    t_view view = {img->data + (img->height > 0 ? (ptrdiff_t)(img->height - 1) * rowSize : 0),
+                   (int)img->width, (int)img->height, -rowSize, VIEW_GRAY8,
+                   &img->dirty, (int)img->height - 1, -1};
+    return view;
+}
+
+
+/**
+ * bmp24_view
+ * Describes a whole 24/32-bit image. The stride is read from the row pointers, so that
+ * an image flipped by bmp24_flipVertical is seen bottom row first.
+ *
+ * Parameters:
+ * img (t_bmp24*): Image, with the row layout set by bmp24_allocateDataPixels.
+ *
+ * Returns:
+ * t_view: View of every pixel of the image.
+ */
+t_view bmp24_view(t_bmp24 *img) {
+    ptrdiff_t stride = img->height > 1 ? (unsigned char *)img->data[1] - (unsigned char *)img->data[0]
+                                       : (ptrdiff_t)BMP24_ROW_STRIDE(img->width);
+    t_view view = {img->height > 0 ? (unsigned char *)img->data[0] : NULL,
+                   img->width, img->height, stride, VIEW_BGRA32,
+                   &img->dirty, 0, 1};
+    return view;
+}
+
+
+/**
+ * view_crop
+ * Describes a rectangle of a view, without copying any pixel.
+ *
+ * Parameters:
+ * view (const t_view*): Parent view.
+ * x, y (int): Top-left corner of the rectangle, relative to the parent.
+ * width, height (int): Size of the rectangle.
+ * crop (t_view*): Receives the view of the rectangle.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the rectangle is empty or not inside the parent.
+ */
+int view_crop(const t_view *view, int x, int y, int width, int height, t_view *crop) {
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        width > view->width - x || height > view->height - y) {
+        fprintf(stderr, "Error: Rectangle %dx%d+%d+%d is outside the %dx%d image.\n",
+                width, height, x, y, view->width, view->height);
+        return 0;
+    }
+
+    *crop = *view;
+    crop->data = view_row(view, y) + (ptrdiff_t)x * view_pixelSize(view->format);
+    crop->width = width;
+    crop->height = height;
+    crop->dirtyRow = view->dirtyRow + y * view->dirtyStep;
+    return 1;
+}
+
+
+/**
+ * view_row
+ * Address of a row of a view.
+ *
+ * Parameters:
+ * view (const t_view*): View.
+ * y (int): Row, 0 being the top row.
+ *
+ * Returns:
+ * unsigned char*: First pixel of the row.
+ */
+unsigned char *view_row(const t_view *view, int y) {
+    return view->data + (ptrdiff_t)y * view->stride;
+}
+
+
+/**
+ * negative_row8 / negative_row32
+ * Inverts one row. 255 - v is v ^ 0xFF.
+ */
+static void negative_row8(unsigned char *row, int width) {
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi8((char)0xFF);
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(row + x));
+        _mm_storeu_si128((__m128i *)(row + x), _mm_xor_si128(v, mask));
+    }
+#endif
+    for (; x < width; x++) {
+        row[x] = 255 - row[x];
+    }
+}
+
+static void negative_row32(t_pixel *row, int width) {
+    int x = 0;
+#ifdef __SSE2__
+    // Flip the blue, green and red bytes of 4 pixels at once
+    const __m128i mask = _mm_set1_epi32(0x00FFFFFF);
+    for (; x + 4 <= width; x += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(row + x));
+        _mm_storeu_si128((__m128i *)(row + x), _mm_xor_si128(v, mask));
+    }
+#endif
+    for (; x < width; x++) {
+        row[x].red = 255 - row[x].red;
+        row[x].green = 255 - row[x].green;
+        row[x].blue = 255 - row[x].blue;
+    }
+}
+
+
+/**
+ * view_negative
+ * Inverts the pixels of a view (colors only, alpha is kept).
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ */
+void view_negative(const t_view *view) {
+    for (int y = 0; y < view->height; y++) {
+        if (view->format == VIEW_BGRA32) {
+            negative_row32((t_pixel *)view_row(view, y), view->width);
+        } else {
+            negative_row8(view_row(view, y), view->width);
+        }
+    }
+    view_touch(view);
+}
+
+
+/**
+ * brightness_row
+ * Adds value to the bytes of one row with saturation. channelMask has one bit per byte
+ * of a 4-byte group, clear for the bytes to leave unchanged (alpha).
+ */
+static void brightness_row(unsigned char *row, int bytes, int value, unsigned int channelMask) {
+    int amount = value < 0 ? -value : value;
+    if (amount > 255) amount = 255;
+    int x = 0;
+#ifdef __SSE2__
+    // Saturating byte arithmetic, with a zero delta on the masked bytes
+    unsigned int pattern = 0;
+    for (int i = 0; i < 4; i++) {
+        if (channelMask & (1u << i)) pattern |= (unsigned int)amount << (8 * i);
+    }
+    const __m128i delta = _mm_set1_epi32((int)pattern);
+    for (; x + 16 <= bytes; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(row + x));
+        v = value >= 0 ? _mm_adds_epu8(v, delta) : _mm_subs_epu8(v, delta);
+        _mm_storeu_si128((__m128i *)(row + x), v);
+    }
+#endif
+    for (; x < bytes; x++) {
+        if (channelMask & (1u << (x & 3))) row[x] = (unsigned char)clamp(row[x] + value);
+    }
+}
+
+
+/**
+ * view_brightness
+ * Adds a value to the pixels of a view (colors only), clamped to [0, 255].
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ * value (int): Amount to add (positive or negative).
+ */
+void view_brightness(const t_view *view, int value) {
+    unsigned int channelMask = view->format == VIEW_BGRA32 ? 0x7 : 0xF;
+    int bytes = view->width * view_pixelSize(view->format);
+    for (int y = 0; y < view->height; y++) {
+        brightness_row(view_row(view, y), bytes, value, channelMask);
+    }
+    view_touch(view);
+}
+
+
+/**
+ * threshold_row
+ * Thresholds the bytes of one row, leaving the bytes outside channelMask unchanged
+ * (same mask as brightness_row).
+ */
+static void threshold_row(unsigned char *row, int bytes, int threshold, unsigned int channelMask) {
+    int x = 0;
+#ifdef __SSE2__
+    // v >= t exactly when max(v, t) == v; threshold 0 sets everything and 256 nothing
+    if (threshold > 0 && threshold <= 255) {
+        unsigned int keep = 0;
+        for (int i = 0; i < 4; i++) {
+            if (!(channelMask & (1u << i))) keep |= 0xFFu << (8 * i);
+        }
+        const __m128i limit = _mm_set1_epi8((char)threshold);
+        const __m128i keepMask = _mm_set1_epi32((int)keep);
+        for (; x + 16 <= bytes; x += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(row + x));
+            __m128i above = _mm_cmpeq_epi8(_mm_max_epu8(v, limit), v);
+            v = _mm_or_si128(_mm_and_si128(v, keepMask), _mm_andnot_si128(keepMask, above));
+            _mm_storeu_si128((__m128i *)(row + x), v);
+        }
+    }
+#endif
+    for (; x < bytes; x++) {
+        if (channelMask & (1u << (x & 3))) row[x] = row[x] >= threshold ? 255 : 0;
+    }
+}
+
+
+/**
+ * view_threshold
+ * Sets every value at or above the threshold to 255 and every other value to 0.
+ * Color views are thresholded channel by channel, alpha is kept.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ * threshold (int): Threshold value (0-255).
+ */
+void view_threshold(const t_view *view, int threshold) {
+    unsigned int channelMask = view->format == VIEW_BGRA32 ? 0x7 : 0xF;
+    int bytes = view->width * view_pixelSize(view->format);
+    for (int y = 0; y < view->height; y++) {
+        threshold_row(view_row(view, y), bytes, threshold, channelMask);
+    }
+    view_touch(view);
+}
+
+
+/**
+ * grayscale_row
+ * Replaces the colors of the pixels of one row by their average.
+ */
+static void grayscale_row(t_pixel *row, int width) {
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colors = _mm_set_epi16(0, 1, 1, 1, 0, 1, 1, 1);
+    const __m128i third = _mm_set1_epi32(21846);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    for (; x + 4 <= width; x += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(row + x));
+
+        // b + g and r + 0 per pixel, then add the two halves of each 64-bit lane
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), colors);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), colors);
+        lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+        hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+        __m128i sum = _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0)),
+                                         _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0)));
+
+        // sum / 3 is exact as (sum * 21846) >> 16 for sums up to 765
+        __m128i gray = _mm_mulhi_epu16(sum, third);
+        gray = _mm_or_si128(gray, _mm_or_si128(_mm_slli_epi32(gray, 8), _mm_slli_epi32(gray, 16)));
+        gray = _mm_or_si128(gray, _mm_and_si128(v, alpha));
+        _mm_storeu_si128((__m128i *)(row + x), gray);
+    }
+#endif
+    for (; x < width; x++) {
+        int average = (row[x].blue + row[x].green + row[x].red) / 3;
+        row[x].red = average;
+        row[x].green = average;
+        row[x].blue = average;
+    }
+}
+
+
+/**
+ * view_grayscale
+ * Replaces the colors of each pixel by their average. No effect on 8-bit views.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ */
+void view_grayscale(const t_view *view) {
+    if (view->format != VIEW_BGRA32) return;
+    for (int y = 0; y < view->height; y++) {
+        grayscale_row((t_pixel *)view_row(view, y), view->width);
+    }
+    view_touch(view);
+}
+
+
+/**
+ * view_convolve
+ * Applies a convolution kernel inside a view, with the conventions of the in-memory
+ * filters of each format. On gray views, like bmp8_applyFilter, kernel rows follow the
+ * bottom-up order in which 8-bit images are stored, and the outer kernelSize / 2 pixels
+ * are read but not modified, so a region of interest filtered with its real neighbors is
+ * a crop widened by that margin. On color views, like bmp24_apply_filter, kernel rows go
+ * top-down and every pixel is filtered, the edges of the view being clamped.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ * kernel (const float*): kernelSize x kernelSize weights, row by row.
+ * kernelSize (int): Odd size of the kernel.
+ *
+ * Returns:
+ * int: 1 on success, 0 on invalid kernel size or allocation failure.
+ */
+int view_convolve(const t_view *view, const float *kernel, int kernelSize) {
+    if (kernelSize < 1 || kernelSize % 2 == 0) {
+        fprintf(stderr, "Error: Kernel size must be odd.\n");
+        return 0;
+    }
+    int n = kernelSize / 2;
+    int color = view->format == VIEW_BGRA32;
+    if (!color && (view->width <= 2 * n || view->height <= 2 * n)) return 1;
+
+    // Gray rows are walked bottom-up, so that the sums are those of pipeline_apply8
+    t_view rows = *view;
+    if (!color) {
+        rows.data = view_row(view, view->height - 1);
+        rows.stride = -view->stride;
+    }
+
+    // Ring buffer holding copies of the source rows y - n .. y + n, so rows can be
+    // overwritten in place once their neighbors no longer need them. Color rows are
+    // padded with n replicated pixels on both sides.
+    int pad = color ? n : 0;
+    size_t pixelSize = view_pixelSize(view->format);
+    size_t rowBytes = (size_t)(view->width + 2 * pad) * pixelSize;
+    unsigned char *ring = malloc((size_t)kernelSize * rowBytes);
+    unsigned char **lines = malloc((size_t)kernelSize * sizeof(unsigned char *));
+    t_pixel *out = color ? malloc(rowBytes) : NULL;
+    if (!ring || !lines || (color && !out)) {
+        fprintf(stderr, "Error: Unable to allocate memory for convolution.\n");
+        free(ring);
+        free(lines);
+        free(out);
+        return 0;
+    }
+
+    t_kernel_impl impl = kernel_select(kernel, kernelSize);
+    int loaded = 0;
+    for (int y = color ? 0 : n; y < (color ? view->height : view->height - n); y++) {
+        while (loaded < view->height && loaded <= y + n) {
+            unsigned char *dst = ring + (size_t)(loaded % kernelSize) * rowBytes + pad * pixelSize;
+            memcpy(dst, view_row(&rows, loaded), (size_t)view->width * pixelSize);
+            for (int k = 1; k <= pad; k++) {
+                ((t_pixel *)dst)[-k] = ((t_pixel *)dst)[0];
+                ((t_pixel *)dst)[view->width - 1 + k] = ((t_pixel *)dst)[view->width - 1];
+            }
+            loaded++;
+        }
+        for (int k = 0; k < kernelSize; k++) {
+            int sy = y - n + k;
+            if (sy < 0) sy = 0;
+            if (sy >= view->height) sy = view->height - 1;
+            lines[k] = ring + (size_t)(sy % kernelSize) * rowBytes;
+        }
+
+        if (color) {
+            t_pixel *row = (t_pixel *)view_row(&rows, y);
+            impl.color((unsigned char *)out, lines, view->width + 2 * pad, kernel, kernelSize);
+            for (int x = 0; x < view->width; x++) {
+                uint8_t alpha = row[x].alpha;
+                row[x] = out[x + n];
+                row[x].alpha = alpha;
+            }
+        } else {
+            impl.gray(view_row(&rows, y), lines, view->width, kernel, kernelSize);
+        }
+    }
+
+    free(ring);
+    free(lines);
+    free(out);
+    view_touch(view);
+    return 1;
+}
+
+
+/**
+ * bmp8_fromView
+ * Copies the pixels of an 8-bit view into a new image, for instance to save a crop.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to copy (VIEW_GRAY8).
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp8 *bmp8_fromView(const t_view *view) {
+    if (view->format != VIEW_GRAY8) {
+        fprintf(stderr, "Error: An 8-bit image needs a gray view.\n");
+        return NULL;
+    }
+
+    t_bmp8 *img = bmp8_allocate(view->width, view->height);
+    if (!img) return NULL;
+
+    t_view copy = bmp8_view(img);
+    for (int y = 0; y < view->height; y++) {
+        memcpy(view_row(&copy, y), view_row(view, y), view->width);
+    }
+    return img;
+}
+
+
+/**
+ * bmp24_fromView
+ * Copies the pixels of a view into a new 24-bit image. Gray pixels are copied to the
+ * three colors and are opaque.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to copy.
+ * colorDepth (int): Depth of the new image (24, or 32 to keep the alpha of BGRA views).
+ *
+ * Returns:
+ * t_bmp24*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp24 *bmp24_fromView(const t_view *view, int colorDepth) {
+    t_bmp24 *img = bmp24_allocate(view->width, view->height, colorDepth);
+    if (!img) return NULL;
+
+    for (int y = 0; y < view->height; y++) {
+        const unsigned char *src = view_row(view, y);
+        if (view->format == VIEW_BGRA32) {
+            memcpy(img->data[y], src, (size_t)view->width * sizeof(t_pixel));
+            continue;
+        }
+        for (int x = 0; x < view->width; x++) {
+            img->data[y][x] = (t_pixel){src[x], src[x], src[x], 255};
+        }
+    }
+    return img;
+}
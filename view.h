@@ -0,0 +1,206 @@
+/**
+ * view.h
+ * Authors: Rafael Veclin, Clement Moussy
+ *
+ * Description:
+ * Header file declaring image views. A view describes a rectangle of pixels by the address
+ * of its top-left pixel, its size and the distance in bytes between two rows (negative
+ * when rows are stored bottom-up, like in 8-bit images). Both bit depths expose a view of
+ * the whole image, and cropping a view only moves the pointer: no pixel is copied.
+ *
+ * Role in the project:
+ * Lets the processing operations run on a region of interest (a crop, a text box...)
+ * while touching only the pixels inside it.
+ */
+
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <stddef.h>
+#include "bmp8.h"
+#include "bmp24.h"
+
+/**
+ * t_view_format
+ * Pixel layout of a view.
+ *
+ * VIEW_GRAY8: one byte per pixel.
+ * VIEW_BGRA32: one t_pixel (blue, green, red, alpha) per pixel.
+ */
+typedef enum {
+    VIEW_GRAY8,
+    VIEW_BGRA32
+} t_view_format;
+
+/**
+ * t_view
+ * Rectangle of pixels inside an image. The view does not own its pixels.
+ *
+ * Members:
+ * data (unsigned char*): First pixel of the top row.
+ * width (int): Width in pixels.
+ * height (int): Height in pixels.
+ * stride (ptrdiff_t): Bytes from one row to the row below it (negative for bottom-up storage).
+ * format (t_view_format): Pixel layout.
+ * dirty (t_dirty_rows*): Modified-row tracker of the image, or NULL.
+ * dirtyRow (int): Tracker row of the top row of the view.
+ * dirtyStep (int): Tracker row increment for each row down (1 or -1).
+ */
+typedef struct {
+    unsigned char *data;
+    int width;
+    int height;
+    ptrdiff_t stride;
+    t_view_format format;
+    t_dirty_rows *dirty;
+    int dirtyRow;
+    int dirtyStep;
+} t_view;
+
+/**
+ * bmp8_view
+ * Describes a whole 8-bit image. Rows are seen top-down, the padding is skipped.
+ *
+ * Parameters:
+ * img (t_bmp8*): Image.
+ *
+ * Returns:
+ * t_view: View of every pixel of the image.
+ */
+t_view bmp8_view(t_bmp8 *img);
+
+/**
+ * bmp24_view
+ * Describes a whole 24/32-bit image.
+ *
+ * Parameters:
+ * img (t_bmp24*): Image, with the row layout set by bmp24_allocateDataPixels.
+ *
+ * Returns:
+ * t_view: View of every pixel of the image.
+ */
+t_view bmp24_view(t_bmp24 *img);
+
+/**
+ * view_crop
+ * Describes a rectangle of a view, without copying any pixel.
+ *
+ * Parameters:
+ * view (const t_view*): Parent view.
+ * x, y (int): Top-left corner of the rectangle, relative to the parent.
+ * width, height (int): Size of the rectangle.
+ * crop (t_view*): Receives the view of the rectangle.
+ *
+ * Returns:
+ * int: 1 on success, 0 if the rectangle is empty or not inside the parent.
+ */
+int view_crop(const t_view *view, int x, int y, int width, int height, t_view *crop);
+
+/**
+ * view_row
+ * Address of a row of a view.
+ *
+ * Parameters:
+ * view (const t_view*): View.
+ * y (int): Row, 0 being the top row.
+ *
+ * Returns:
+ * unsigned char*: First pixel of the row.
+ */
+unsigned char * view_row(const t_view *view, int y);
+
+/**
+ * view_touch
+ * Flags the rows of a view as modified in the dirty tracker of its image, so the
+ * incremental saves rewrite them. Does nothing for views without a tracker.
+ *
+ * Parameters:
+ * view (const t_view*): View whose pixels were written.
+ */
+void view_touch(const t_view *view);
+
+/**
+ * view_negative
+ * Inverts the pixels of a view (colors only, alpha is kept).
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ */
+void view_negative(const t_view *view);
+
+/**
+ * view_brightness
+ * Adds a value to the pixels of a view (colors only), clamped to [0, 255].
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ * value (int): Amount to add (positive or negative).
+ */
+void view_brightness(const t_view *view, int value);
+
+/**
+ * view_threshold
+ * Sets every value at or above the threshold to 255 and every other value to 0.
+ * Color views are thresholded channel by channel, alpha is kept.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ * threshold (int): Threshold value (0-255).
+ */
+void view_threshold(const t_view *view, int threshold);
+
+/**
+ * view_grayscale
+ * Replaces the colors of each pixel by their average. No effect on 8-bit views.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ */
+void view_grayscale(const t_view *view);
+
+/**
+ * view_convolve
+ * Applies a convolution kernel inside a view, with the conventions of the in-memory
+ * filters of each format. On gray views, like bmp8_applyFilter, kernel rows follow the
+ * bottom-up order in which 8-bit images are stored, and the outer kernelSize / 2 pixels
+ * are read but not modified, so a region of interest filtered with its real neighbors is
+ * a crop widened by that margin. On color views, like bmp24_apply_filter, kernel rows go
+ * top-down and every pixel is filtered, the edges of the view being clamped.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to modify.
+ * kernel (const float*): kernelSize x kernelSize weights, row by row.
+ * kernelSize (int): Odd size of the kernel.
+ *
+ * Returns:
+ * int: 1 on success, 0 on invalid kernel size or allocation failure.
+ */
+int view_convolve(const t_view *view, const float *kernel, int kernelSize);
+
+/**
+ * bmp8_fromView
+ * Copies the pixels of an 8-bit view into a new image, for instance to save a crop.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to copy (VIEW_GRAY8).
+ *
+ * Returns:
+ * t_bmp8*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp8 * bmp8_fromView(const t_view *view);
+
+/**
+ * bmp24_fromView
+ * Copies the pixels of a view into a new 24-bit image. Gray pixels are copied to the
+ * three colors and are opaque.
+ *
+ * Parameters:
+ * view (const t_view*): Pixels to copy.
+ * colorDepth (int): Depth of the new image (24, or 32 to keep the alpha of BGRA views).
+ *
+ * Returns:
+ * t_bmp24*: Pointer to the new image, or NULL on failure.
+ */
+t_bmp24 * bmp24_fromView(const t_view *view, int colorDepth);
+
+#endif // VIEW_H